@@ -8,6 +8,9 @@
 #include "wavreader.h"
 #include "mp3reader.h"
 #include "audiomixer.h"
+#ifdef HAS_DECODE_AHEAD
+#include "decodeworker.h"
+#endif
 
 size_t tell_callback(void *file_context)
 {
@@ -49,7 +52,7 @@ void track_end_callback(int track)
 int main(int argc, char *argv[])
 {
     if (argc < 5) {
-        fprintf(stderr, "Usage: %s <file_1> <file_2> <level_1> <level_2>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <file_1> <file_2> <level_1> <level_2> [ahead_frames]\n", argv[0]);
         return 1;
     }
 
@@ -97,6 +100,19 @@ int main(int argc, char *argv[])
     mixer.addTrack(&track_1);
     mixer.addTrack(&track_2);
 
+#ifdef HAS_DECODE_AHEAD
+    // Decodes on a worker thread when given, so pa_simple_write() never waits for the decoder
+    DecodeWorker worker;
+
+    if (argc > 5) {
+        size_t ahead_frames = static_cast<size_t>(atol(argv[5]));
+
+        worker.start();
+        track_1.decodeAhead(&worker, ahead_frames);
+        track_2.decodeAhead(&worker, ahead_frames);
+    }
+#endif
+
     AudioTrack::Mode mode = AudioTrack::Mode::Single;
 
     uint16_t level_1 = static_cast<uint16_t>(atof(argv[3]) * AudioMixer::UNIT_LEVEL);
@@ -0,0 +1,206 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "mp3reader.h"
+#include "mp3bulkdecoder.h"
+
+struct MemoryFile
+{
+    const std::vector<uint8_t> *data;
+    size_t position;
+};
+
+size_t tell_callback(void *file_context)
+{
+    return reinterpret_cast<MemoryFile *>(file_context)->position;
+}
+
+bool seek_callback(void *file_context, size_t offset)
+{
+    MemoryFile *file = reinterpret_cast<MemoryFile *>(file_context);
+
+    if (offset > file->data->size()) {
+        return false;
+    }
+
+    file->position = offset;
+
+    return true;
+}
+
+size_t read_callback(void *file_context, uint8_t *buffer, size_t length)
+{
+    MemoryFile *file = reinterpret_cast<MemoryFile *>(file_context);
+
+    size_t available = file->data->size() - file->position;
+    if (length > available) {
+        length = available;
+    }
+
+    memcpy(buffer, file->data->data() + file->position, length);
+    file->position += length;
+
+    return length;
+}
+
+static bool loadFile(const char *path, std::vector<uint8_t> *data)
+{
+    FILE *input = fopen(path, "rb");
+    if (input == nullptr) {
+        return false;
+    }
+
+    uint8_t buffer[4096];
+    size_t length;
+
+    while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        data->insert(data->end(), buffer, buffer + length);
+    }
+
+    fclose(input);
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int first_file = 1;
+    unsigned int repeats = 3;
+    unsigned int max_threads = std::thread::hardware_concurrency();
+
+    while (first_file + 1 < argc) {
+        if (strcmp(argv[first_file], "-n") == 0) {
+            repeats = static_cast<unsigned int>(atoi(argv[first_file + 1]));
+        } else if (strcmp(argv[first_file], "-j") == 0) {
+            max_threads = static_cast<unsigned int>(atoi(argv[first_file + 1]));
+        } else {
+            break;
+        }
+
+        first_file += 2;
+    }
+
+    if ((first_file >= argc) || (repeats == 0)) {
+        fprintf(stderr, "Usage: %s [-n repeats] [-j max_threads] <file>...\n", argv[0]);
+        return 1;
+    }
+
+    if ((max_threads == 0) || (max_threads > Mp3BulkDecoder::MAX_SEGMENTS)) {
+        max_threads = Mp3BulkDecoder::MAX_SEGMENTS;
+    }
+
+    Mp3Reader::Footprint footprint = Mp3Reader::footprint();
+
+    printf("Mp3Reader: %zu bytes each (%zu decoder state, %zu buffers), %zu bytes of scratch per thread\n",
+           footprint.reader_bytes,
+           footprint.decoder_bytes,
+           footprint.buffer_bytes,
+           footprint.scratch_bytes);
+
+    std::vector<std::unique_ptr<Mp3Reader>> readers;
+    MemoryFile files[Mp3BulkDecoder::MAX_SEGMENTS];
+
+    Mp3BulkDecoder decoder;
+
+    for (unsigned int index = 0; index < max_threads; index++) {
+        readers.emplace_back(new Mp3Reader(&tell_callback,
+                                           &seek_callback,
+                                           &read_callback));
+
+        decoder.addReader(readers.back().get(), &files[index]);
+    }
+
+    for (int argument = first_file; argument < argc; argument++) {
+        std::vector<uint8_t> data;
+
+        if (!loadFile(argv[argument], &data)) {
+            fprintf(stderr, "Cannot open file \"%s\"\n", argv[argument]);
+            return 1;
+        }
+
+        for (MemoryFile &file : files) {
+            file.data = &data;
+            file.position = 0;
+        }
+
+        if (!decoder.open()) {
+            fprintf(stderr, "Cannot parse file \"%s\"\n", argv[argument]);
+            return 1;
+        }
+
+        size_t total_frames = decoder.totalFrames();
+        unsigned int channels = decoder.channels();
+
+        if (total_frames == 0) {
+            fprintf(stderr, "Cannot split file \"%s\" without a known length\n", argv[argument]);
+            return 1;
+        }
+
+        // The single threaded decode is the reference for every other run
+        std::vector<int16_t> reference(total_frames * channels);
+        std::vector<int16_t> output(total_frames * channels);
+
+        size_t reference_frames = decoder.decodeToI16(reference.data(), total_frames, 1);
+
+        double audio_seconds = static_cast<double>(reference_frames) / static_cast<double>(decoder.samplingRate());
+
+        printf("%s: %u ch, %lu Hz, %zu frames\n",
+               argv[argument],
+               channels,
+               decoder.samplingRate(),
+               reference_frames);
+
+        double serial_seconds = 0.0;
+
+        for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+            double best_seconds = 0.0;
+            size_t frames = 0;
+
+            for (unsigned int repeat = 0; repeat < repeats; repeat++) {
+                memset(output.data(), 0, output.size() * sizeof(int16_t));
+
+                auto start = std::chrono::steady_clock::now();
+
+                frames = decoder.decodeToI16(output.data(), total_frames, threads);
+
+                auto finish = std::chrono::steady_clock::now();
+                double seconds = std::chrono::duration<double>(finish - start).count();
+
+                if ((repeat == 0) || (seconds < best_seconds)) {
+                    best_seconds = seconds;
+                }
+            }
+
+            if (threads == 1) {
+                serial_seconds = best_seconds;
+            }
+
+            bool matches = (frames == reference_frames) &&
+                           (memcmp(output.data(), reference.data(), frames * channels * sizeof(int16_t)) == 0);
+
+            printf("    %2u threads: %8.3f ms, %6.1fx real time, %.2fx speedup, %s\n",
+                   threads,
+                   best_seconds * 1e3,
+                   audio_seconds / best_seconds,
+                   serial_seconds / best_seconds,
+                   matches ? "matches serial decode" : "MISMATCH");
+
+            if (!matches) {
+                return 1;
+            }
+
+            if ((threads < max_threads) && (threads * 2 > max_threads)) {
+                threads = max_threads / 2;
+            }
+        }
+
+        decoder.close();
+    }
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// The Helix decoder state and stages are C symbols
+extern "C" {
+#include "coder.h"
+}
+
+// Where DecodeHuffman starts for one granule and channel
+struct HuffmanBlock
+{
+    int offset;
+    int bit_offset;
+    int bits;
+};
+
+struct Decoder
+{
+    FrameHeader frame_header;
+    SideInfo side_info;
+    ScaleFactorInfo scale_factor_info;
+    HuffmanInfo huffman_info;
+    DequantInfo dequant_info;
+    IMDCTInfo imdct_info;
+    IMDCTOutInfo imdct_out_info;
+    SubbandInfo subband_info;
+    MP3DecInfo info;
+
+    void reset()
+    {
+        memset(this, 0, sizeof(*this));
+
+        info.FrameHeaderPS = &frame_header;
+        info.SideInfoPS = &side_info;
+        info.ScaleFactorInfoPS = &scale_factor_info;
+        info.HuffmanInfoPS = &huffman_info;
+        info.DequantInfoPS = &dequant_info;
+        info.IMDCTInfoPS = &imdct_info;
+        info.IMDCTOutInfoPS = &imdct_out_info;
+        info.SubbandInfoPS = &subband_info;
+    }
+};
+
+static bool loadFile(const char *path, std::vector<uint8_t> *data)
+{
+    FILE *input = fopen(path, "rb");
+    if (input == nullptr) {
+        return false;
+    }
+
+    uint8_t buffer[4096];
+    size_t length;
+
+    while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        data->insert(data->end(), buffer, buffer + length);
+    }
+
+    fclose(input);
+
+    return true;
+}
+
+// Walk the main data of the frame MP3Decode just decoded the way
+// MP3DecodeFrame does, and note where each Huffman block starts. Unpacking
+// the scale factors again gives the same result, so the decoder state is
+// left as it was
+static bool findHuffmanBlocks(MP3DecInfo *info, HuffmanBlock blocks[MAX_NGRAN][MAX_NCHAN])
+{
+    unsigned char *main_data = info->mainBuf;
+    int bit_offset = 0;
+    int main_bits = info->mainDataBytes * 8;
+
+    for (int gr = 0; gr < info->nGrans; gr++) {
+        for (int ch = 0; ch < info->nChans; ch++) {
+            int previous_bit_offset = bit_offset;
+            int offset = UnpackScaleFactors(info, main_data, &bit_offset, main_bits, gr, ch);
+
+            if (offset < 0) {
+                return false;
+            }
+
+            int scale_factor_bits = 8 * offset - previous_bit_offset + bit_offset;
+            main_data += offset;
+            main_bits -= scale_factor_bits;
+
+            HuffmanBlock &block = blocks[gr][ch];
+            block.offset = static_cast<int>(main_data - info->mainBuf);
+            block.bit_offset = bit_offset;
+            block.bits = info->part23Length[gr][ch] - scale_factor_bits;
+
+            previous_bit_offset = bit_offset;
+            offset = DecodeHuffman(info, main_data, &bit_offset, block.bits, gr, ch);
+
+            if (offset < 0) {
+                return false;
+            }
+
+            main_data += offset;
+            main_bits -= 8 * offset - previous_bit_offset + bit_offset;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int first_file = 1;
+    unsigned int repeats = 20;
+
+    if ((argc > 2) && (strcmp(argv[1], "-n") == 0)) {
+        repeats = static_cast<unsigned int>(atoi(argv[2]));
+        first_file = 3;
+    }
+
+    if ((first_file >= argc) || (repeats == 0)) {
+        fprintf(stderr, "Usage: %s [-n repeats] <file>...\n", argv[0]);
+        return 1;
+    }
+
+    static Decoder decoder;
+    static short pcm[MAX_NGRAN * MAX_NCHAN * MAX_NSAMP];
+
+    printf("%-32s %8s %8s %10s %12s %10s\n", "file", "kbit/s", "frames", "bits/frame", "ns/frame", "Mbit/s");
+
+    for (int argument = first_file; argument < argc; argument++) {
+        std::vector<uint8_t> data;
+
+        if (!loadFile(argv[argument], &data)) {
+            fprintf(stderr, "Cannot open file \"%s\"\n", argv[argument]);
+            return 1;
+        }
+
+        decoder.reset();
+
+        unsigned char *position = data.data();
+        int bytes_left = static_cast<int>(data.size());
+
+        size_t frames = 0;
+        double bitrate_sum = 0.0;
+        double huffman_bits = 0.0;
+        double nanoseconds = 0.0;
+
+        while (bytes_left > 0) {
+            int offset = MP3FindSyncWord(position, bytes_left);
+            if (offset < 0) {
+                break;
+            }
+
+            position += offset;
+            bytes_left -= offset;
+
+            unsigned char *frame = position;
+            int result = MP3Decode(&decoder.info, &position, &bytes_left, pcm, 0);
+
+            if (result == ERR_MP3_INDATA_UNDERFLOW) {
+                break;
+            }
+
+            if (result != ERR_MP3_NONE) {
+                // Not a frame after all, or no bit reservoir yet
+                if (position == frame) {
+                    position++;
+                    bytes_left--;
+                }
+
+                continue;
+            }
+
+            HuffmanBlock blocks[MAX_NGRAN][MAX_NCHAN];
+
+            if (!findHuffmanBlocks(&decoder.info, blocks)) {
+                continue;
+            }
+
+            // Time the entropy decode of the whole frame, from the warm
+            // caches the first pass left behind. The fastest repeat is the
+            // least disturbed by the rest of the system
+            double best = 0.0;
+
+            for (unsigned int repeat = 0; repeat < repeats; repeat++) {
+                auto start = std::chrono::steady_clock::now();
+
+                for (int gr = 0; gr < decoder.info.nGrans; gr++) {
+                    for (int ch = 0; ch < decoder.info.nChans; ch++) {
+                        const HuffmanBlock &block = blocks[gr][ch];
+                        int bit_offset = block.bit_offset;
+
+                        DecodeHuffman(&decoder.info, decoder.info.mainBuf + block.offset, &bit_offset, block.bits, gr, ch);
+                    }
+                }
+
+                auto finish = std::chrono::steady_clock::now();
+                double elapsed = std::chrono::duration<double, std::nano>(finish - start).count();
+
+                if ((repeat == 0) || (elapsed < best)) {
+                    best = elapsed;
+                }
+            }
+
+            nanoseconds += best;
+
+            for (int gr = 0; gr < decoder.info.nGrans; gr++) {
+                for (int ch = 0; ch < decoder.info.nChans; ch++) {
+                    huffman_bits += blocks[gr][ch].bits;
+                }
+            }
+
+            bitrate_sum += decoder.info.bitrate;
+            frames++;
+        }
+
+        if (frames == 0) {
+            fprintf(stderr, "No frames decoded from \"%s\"\n", argv[argument]);
+            return 1;
+        }
+
+        printf("%-32s %8.1f %8zu %10.0f %12.1f %10.1f\n",
+               argv[argument],
+               bitrate_sum / frames / 1000.0,
+               frames,
+               huffman_bits / frames,
+               nanoseconds / frames,
+               huffman_bits / nanoseconds * 1000.0);
+    }
+
+    return 0;
+}
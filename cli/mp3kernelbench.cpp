@@ -0,0 +1,611 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// The Helix tables are C symbols
+extern "C" {
+#include "coder.h"
+}
+
+// One implementation of a decoder kernel, usable when the CPU has all of
+// its features
+template <typename Function>
+struct Variant
+{
+    const char *name;
+    int features;
+    Function function;
+};
+
+template <typename Run>
+static double nanosecondsPerCall(Run run, unsigned int iterations)
+{
+    // Warm up the caches and the branch predictors first
+    run();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned int iteration = 0; iteration < iterations; iteration++) {
+        run();
+    }
+
+    auto finish = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(finish - start).count() / iterations;
+}
+
+static void printResult(const char *kernel, const char *variant, double nanoseconds, double reference, bool matches)
+{
+    printf("%-18s %-6s %9.1f ns/call, %5.2fx, %s\n",
+           kernel,
+           variant,
+           nanoseconds,
+           reference / nanoseconds,
+           matches ? "bit-exact" : "MISMATCH");
+}
+
+typedef void (*PolyphaseFunction)(short *pcm, int *vbuf, const int *coefBase);
+
+static const Variant<PolyphaseFunction> POLYPHASE_MONO[] = {
+    {"C", 0, &PolyphaseMonoC},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &PolyphaseMonoSSE41},
+    {"AVX2", CPU_AVX2, &PolyphaseMonoAVX2},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &PolyphaseMonoNEON},
+#endif
+};
+
+static const Variant<PolyphaseFunction> POLYPHASE_STEREO[] = {
+    {"C", 0, &PolyphaseStereoC},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &PolyphaseStereoSSE41},
+    {"AVX2", CPU_AVX2, &PolyphaseStereoAVX2},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &PolyphaseStereoNEON},
+#endif
+};
+
+template <size_t VARIANTS>
+static bool benchPolyphase(const char *kernel,
+                           const Variant<PolyphaseFunction> (&variants)[VARIANTS],
+                           unsigned int channels,
+                           unsigned int iterations,
+                           std::mt19937 &random)
+{
+    // Full-scale random input also exercises the clipping, which decoded
+    // audio rarely reaches
+    static int vbuf[VBUF_LENGTH];
+
+    for (int &value : vbuf) {
+        value = static_cast<int>(random());
+    }
+
+    short reference[2 * NBANDS];
+    short output[2 * NBANDS];
+
+    variants[0].function(reference, vbuf, polyCoef);
+
+    int features = GetCPUFeatures();
+    double reference_nanoseconds = 0.0;
+    bool matches_all = true;
+
+    for (const Variant<PolyphaseFunction> &variant : variants) {
+        if ((variant.features & features) != variant.features) {
+            continue;
+        }
+
+        memset(output, 0, sizeof(output));
+        variant.function(output, vbuf, polyCoef);
+
+        bool matches = memcmp(output, reference, channels * NBANDS * sizeof(short)) == 0;
+
+        double nanoseconds = nanosecondsPerCall([&]() {
+            variant.function(output, vbuf, polyCoef);
+        }, iterations);
+
+        if (variant.features == 0) {
+            reference_nanoseconds = nanoseconds;
+        }
+
+        printResult(kernel, variant.name, nanoseconds, reference_nanoseconds, matches);
+
+        matches_all = matches_all && matches;
+    }
+
+    return matches_all;
+}
+
+typedef void (*FDCT32Function)(int *x, int *d, int offset, int oddBlock, int gb);
+
+static const Variant<FDCT32Function> FDCT32_MONO[] = {
+    {"C", 0, &FDCT32C},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &FDCT32SSE41},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &FDCT32NEON},
+#endif
+};
+
+typedef void (*FDCT32StereoFunction)(int *xL, int *xR, int *d, int offset, int oddBlock, int gbL, int gbR);
+
+static const Variant<FDCT32StereoFunction> FDCT32_STEREO[] = {
+    {"C", 0, &FDCT32StereoC},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &FDCT32StereoSSE41},
+    {"AVX2", CPU_AVX2, &FDCT32StereoAVX2},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &FDCT32StereoNEON},
+#endif
+};
+
+// FDCT32 works in place, so every call starts from a fresh copy of the
+// input. The copy is part of every variant's time
+template <size_t VARIANTS, typename Function, typename Call>
+static bool benchFDCT32(const char *kernel,
+                        const Variant<Function> (&variants)[VARIANTS],
+                        Call call,
+                        unsigned int iterations,
+                        std::mt19937 &random)
+{
+    // 7 sign bits leave the 6 guard bits the DCT asks for
+    int input[2 * NBANDS];
+
+    for (int &value : input) {
+        value = static_cast<int>(random()) >> 7;
+    }
+
+    static int reference[2 * VBUF_LENGTH];
+    static int output[2 * VBUF_LENGTH];
+    int buffer[2 * NBANDS];
+
+    memcpy(buffer, input, sizeof(buffer));
+    call(variants[0].function, buffer, reference);
+
+    int features = GetCPUFeatures();
+    double reference_nanoseconds = 0.0;
+    bool matches_all = true;
+
+    for (const Variant<Function> &variant : variants) {
+        if ((variant.features & features) != variant.features) {
+            continue;
+        }
+
+        memset(output, 0, sizeof(output));
+        memcpy(buffer, input, sizeof(buffer));
+        call(variant.function, buffer, output);
+
+        bool matches = memcmp(output, reference, sizeof(output)) == 0;
+
+        double nanoseconds = nanosecondsPerCall([&]() {
+            memcpy(buffer, input, sizeof(buffer));
+            call(variant.function, buffer, output);
+        }, iterations);
+
+        if (variant.features == 0) {
+            reference_nanoseconds = nanoseconds;
+        }
+
+        printResult(kernel, variant.name, nanoseconds, reference_nanoseconds, matches);
+
+        matches_all = matches_all && matches;
+    }
+
+    return matches_all;
+}
+
+typedef void (*AntiAliasFunction)(int *x, int nBfly);
+
+static const Variant<AntiAliasFunction> ANTI_ALIAS[] = {
+    {"C", 0, &AntiAliasC},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &AntiAliasSSE41},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &AntiAliasNEON},
+#endif
+};
+
+template <size_t VARIANTS>
+static bool benchAntiAlias(const char *kernel,
+                           const Variant<AntiAliasFunction> (&variants)[VARIANTS],
+                           unsigned int iterations,
+                           std::mt19937 &random)
+{
+    // All 32 blocks, 31 boundaries. One guard bit is all AntiAlias asks for
+    int input[NBANDS * 18];
+
+    for (int &value : input) {
+        value = static_cast<int>(random()) >> 1;
+    }
+
+    int reference[NBANDS * 18];
+    int output[NBANDS * 18];
+
+    memcpy(reference, input, sizeof(reference));
+    variants[0].function(reference, NBANDS - 1);
+
+    int features = GetCPUFeatures();
+    double reference_nanoseconds = 0.0;
+    bool matches_all = true;
+
+    for (const Variant<AntiAliasFunction> &variant : variants) {
+        if ((variant.features & features) != variant.features) {
+            continue;
+        }
+
+        memcpy(output, input, sizeof(output));
+        variant.function(output, NBANDS - 1);
+
+        bool matches = memcmp(output, reference, sizeof(output)) == 0;
+
+        double nanoseconds = nanosecondsPerCall([&]() {
+            memcpy(output, input, sizeof(output));
+            variant.function(output, NBANDS - 1);
+        }, iterations);
+
+        if (variant.features == 0) {
+            reference_nanoseconds = nanoseconds;
+        }
+
+        printResult(kernel, variant.name, nanoseconds, reference_nanoseconds, matches);
+
+        matches_all = matches_all && matches;
+    }
+
+    return matches_all;
+}
+
+typedef int (*IMDCT36x4Function)(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb);
+
+static const Variant<IMDCT36x4Function> IMDCT36_X4[] = {
+    {"C", 0, &IMDCT36x4C},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &IMDCT36x4SSE41},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &IMDCT36x4NEON},
+#endif
+};
+
+typedef int (*IMDCT12x3x4Function)(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb);
+
+static const Variant<IMDCT12x3x4Function> IMDCT12X3_X4[] = {
+    {"C", 0, &IMDCT12x3x4C},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &IMDCT12x3x4SSE41},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &IMDCT12x3x4NEON},
+#endif
+};
+
+// The four-block IMDCTs update xPrev (and, when rescaling, xCurr) in place.
+// Every window type pair, both block parities and the rescaling path are
+// checked; the common case, long blocks on both sides of an even block
+// index, is timed
+template <size_t VARIANTS, typename Function, typename Call>
+static bool benchIMDCT(const char *kernel,
+                       const Variant<Function> (&variants)[VARIANTS],
+                       Call call,
+                       unsigned int iterations,
+                       std::mt19937 &random)
+{
+    // 8 sign bits leave the 7 guard bits that keep the SIMD versions off the
+    // scalar rescaling path
+    int inputCurr[4 * 18];
+    int inputPrev[4 * 9];
+
+    for (int &value : inputCurr) {
+        value = static_cast<int>(random()) >> 8;
+    }
+
+    for (int &value : inputPrev) {
+        value = static_cast<int>(random()) >> 8;
+    }
+
+    static int referenceY[BLOCK_SIZE][NBANDS];
+    static int outputY[BLOCK_SIZE][NBANDS];
+    int referenceCurr[4 * 18], referencePrev[4 * 9];
+    int outputCurr[4 * 18], outputPrev[4 * 9];
+
+    int features = GetCPUFeatures();
+    double reference_nanoseconds = 0.0;
+    bool matches_all = true;
+
+    for (const Variant<Function> &variant : variants) {
+        if ((variant.features & features) != variant.features) {
+            continue;
+        }
+
+        bool matches = true;
+
+        for (int btCurr = 0; btCurr < 4; btCurr++) {
+            for (int btPrev = 0; btPrev < 4; btPrev++) {
+                for (int blockIdx = 0; blockIdx < 2; blockIdx++) {
+                    for (int gb : {7, 3}) {
+                        memcpy(referenceCurr, inputCurr, sizeof(referenceCurr));
+                        memcpy(referencePrev, inputPrev, sizeof(referencePrev));
+                        memset(referenceY, 0, sizeof(referenceY));
+                        int referenceOut = call(variants[0].function, referenceCurr, referencePrev, &referenceY[0][blockIdx], btCurr, btPrev, blockIdx, gb);
+
+                        memcpy(outputCurr, inputCurr, sizeof(outputCurr));
+                        memcpy(outputPrev, inputPrev, sizeof(outputPrev));
+                        memset(outputY, 0, sizeof(outputY));
+                        int out = call(variant.function, outputCurr, outputPrev, &outputY[0][blockIdx], btCurr, btPrev, blockIdx, gb);
+
+                        matches = matches &&
+                                  (out == referenceOut) &&
+                                  (memcmp(outputCurr, referenceCurr, sizeof(outputCurr)) == 0) &&
+                                  (memcmp(outputPrev, referencePrev, sizeof(outputPrev)) == 0) &&
+                                  (memcmp(outputY, referenceY, sizeof(outputY)) == 0);
+                    }
+                }
+            }
+        }
+
+        double nanoseconds = nanosecondsPerCall([&]() {
+            memcpy(outputCurr, inputCurr, sizeof(outputCurr));
+            memcpy(outputPrev, inputPrev, sizeof(outputPrev));
+            call(variant.function, outputCurr, outputPrev, &outputY[0][0], 0, 0, 0, 7);
+        }, iterations);
+
+        if (variant.features == 0) {
+            reference_nanoseconds = nanoseconds;
+        }
+
+        printResult(kernel, variant.name, nanoseconds, reference_nanoseconds, matches);
+
+        matches_all = matches_all && matches;
+    }
+
+    return matches_all;
+}
+
+typedef int (*DequantBlockFunction)(int *inbuf, int *outbuf, int num, int scale);
+
+static const Variant<DequantBlockFunction> DEQUANT_BLOCK[] = {
+    {"C", 0, &DequantBlockC},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &DequantBlockSSE41},
+    {"AVX2", CPU_AVX2, &DequantBlockAVX2},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &DequantBlockNEON},
+#endif
+};
+
+// One call is a granule of long blocks at 44.1 kHz, dequantized band by
+// band the way DequantChannel does it. The mix of magnitudes is roughly
+// that of a 128-320 kbit/s stream: almost all below 4, a few up to 63 and
+// the odd larger one for the scalar path
+template <size_t VARIANTS>
+static bool benchDequant(const char *kernel,
+                         const Variant<DequantBlockFunction> (&variants)[VARIANTS],
+                         unsigned int iterations,
+                         std::mt19937 &random)
+{
+    const short *bands = sfBandTable[0][0].l;
+
+    int input[MAX_NSAMP];
+    int scales[22];
+
+    for (int &value : input) {
+        unsigned int kind = random() % 1000;
+        int magnitude;
+
+        if (kind < 940) {
+            magnitude = static_cast<int>(random() % 4);
+        } else if (kind < 985) {
+            magnitude = static_cast<int>(random() % 16);
+        } else if (kind < 995) {
+            magnitude = static_cast<int>(random() % 64);
+        } else {
+            magnitude = static_cast<int>(random() % 1024);
+        }
+
+        value = magnitude | ((random() & 1) ? static_cast<int>(0x80000000) : 0);
+    }
+
+    // Both the right shifts of quiet bands and the clipping left shifts
+    for (int &scale : scales) {
+        scale = static_cast<int>(random() % 120) - 20;
+    }
+
+    auto run = [&](DequantBlockFunction function, int *output) {
+        int mask = 0;
+
+        for (int band = 0; band < 22; band++) {
+            mask |= function(input + bands[band], output + bands[band], bands[band + 1] - bands[band], scales[band]);
+        }
+
+        return mask;
+    };
+
+    int reference[MAX_NSAMP];
+    int output[MAX_NSAMP];
+
+    int referenceMask = run(variants[0].function, reference);
+
+    int features = GetCPUFeatures();
+    double reference_nanoseconds = 0.0;
+    bool matches_all = true;
+
+    for (const Variant<DequantBlockFunction> &variant : variants) {
+        if ((variant.features & features) != variant.features) {
+            continue;
+        }
+
+        memset(output, 0, sizeof(output));
+        int mask = run(variant.function, output);
+
+        bool matches = (mask == referenceMask) && (memcmp(output, reference, sizeof(output)) == 0);
+
+        double nanoseconds = nanosecondsPerCall([&]() {
+            run(variant.function, output);
+        }, iterations);
+
+        if (variant.features == 0) {
+            reference_nanoseconds = nanoseconds;
+        }
+
+        printResult(kernel, variant.name, nanoseconds, reference_nanoseconds, matches);
+
+        matches_all = matches_all && matches;
+    }
+
+    return matches_all;
+}
+
+typedef void (*MidSideFunction)(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2]);
+
+static const Variant<MidSideFunction> MID_SIDE[] = {
+    {"C", 0, &MidSideProcC},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &MidSideProcSSE41},
+    {"AVX2", CPU_AVX2, &MidSideProcAVX2},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &MidSideProcNEON},
+#endif
+};
+
+typedef void (*IntensityBandFunction)(int *xl, int *xr, int n, int fl, int fr, int mOut[2]);
+
+static const Variant<IntensityBandFunction> INTENSITY_BAND[] = {
+    {"C", 0, &IntensityBandC},
+#ifdef MP3DEC_SIMD_X86
+    {"SSE4.1", CPU_SSE41, &IntensityBandSSE41},
+    {"AVX2", CPU_AVX2, &IntensityBandAVX2},
+#endif
+#ifdef MP3DEC_SIMD_NEON
+    {"NEON", CPU_NEON, &IntensityBandNEON},
+#endif
+};
+
+// The stereo stages work in place on both channels of a granule, so every
+// call starts from a fresh copy of the input. The copy is part of every
+// variant's time
+template <size_t VARIANTS, typename Function, typename Call>
+static bool benchStereo(const char *kernel,
+                        const Variant<Function> (&variants)[VARIANTS],
+                        Call call,
+                        unsigned int iterations,
+                        std::mt19937 &random)
+{
+    // The one guard bit joint stereo asks for
+    static int input[MAX_NCHAN][MAX_NSAMP];
+
+    for (int *channel : input) {
+        for (int i = 0; i < MAX_NSAMP; i++) {
+            channel[i] = static_cast<int>(random()) >> 2;
+        }
+    }
+
+    static int reference[MAX_NCHAN][MAX_NSAMP];
+    static int output[MAX_NCHAN][MAX_NSAMP];
+    int referenceMask[2] = {0, 0};
+
+    memcpy(reference, input, sizeof(reference));
+    call(variants[0].function, reference, referenceMask);
+
+    int features = GetCPUFeatures();
+    double reference_nanoseconds = 0.0;
+    bool matches_all = true;
+
+    for (const Variant<Function> &variant : variants) {
+        if ((variant.features & features) != variant.features) {
+            continue;
+        }
+
+        int mask[2] = {0, 0};
+
+        memcpy(output, input, sizeof(output));
+        call(variant.function, output, mask);
+
+        bool matches = (mask[0] == referenceMask[0]) && (mask[1] == referenceMask[1]) &&
+                       (memcmp(output, reference, sizeof(output)) == 0);
+
+        double nanoseconds = nanosecondsPerCall([&]() {
+            memcpy(output, input, sizeof(output));
+            call(variant.function, output, mask);
+        }, iterations);
+
+        if (variant.features == 0) {
+            reference_nanoseconds = nanoseconds;
+        }
+
+        printResult(kernel, variant.name, nanoseconds, reference_nanoseconds, matches);
+
+        matches_all = matches_all && matches;
+    }
+
+    return matches_all;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int iterations = 1000000;
+
+    if (argc > 1) {
+        if ((argc != 3) || (strcmp(argv[1], "-n") != 0) || (atoi(argv[2]) <= 0)) {
+            fprintf(stderr, "Usage: %s [-n iterations]\n", argv[0]);
+            return 1;
+        }
+
+        iterations = static_cast<unsigned int>(atoi(argv[2]));
+    }
+
+    // A fixed seed keeps the runs comparable
+    std::mt19937 random(1);
+
+    bool matches = true;
+
+    matches = benchPolyphase("PolyphaseMono", POLYPHASE_MONO, 1, iterations, random) && matches;
+    matches = benchPolyphase("PolyphaseStereo", POLYPHASE_STEREO, 2, iterations, random) && matches;
+
+    matches = benchFDCT32("FDCT32", FDCT32_MONO, [](FDCT32Function function, int *buffer, int *vbuf) {
+        function(buffer, vbuf, 3, 1, 6);
+    }, iterations, random) && matches;
+
+    matches = benchFDCT32("FDCT32Stereo", FDCT32_STEREO, [](FDCT32StereoFunction function, int *buffer, int *vbuf) {
+        function(buffer, buffer + NBANDS, vbuf, 3, 1, 6, 6);
+    }, iterations, random) && matches;
+
+    matches = benchAntiAlias("AntiAlias", ANTI_ALIAS, iterations, random) && matches;
+
+    matches = benchIMDCT("IMDCT36x4", IMDCT36_X4, [](IMDCT36x4Function function, int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb) {
+        return function(xCurr, xPrev, y, btCurr, btPrev, blockIdx, gb);
+    }, iterations, random) && matches;
+
+    // Short blocks only take the previous window type
+    matches = benchIMDCT("IMDCT12x3x4", IMDCT12X3_X4, [](IMDCT12x3x4Function function, int *xCurr, int *xPrev, int *y, int, int btPrev, int blockIdx, int gb) {
+        return function(xCurr, xPrev, y, btPrev, blockIdx, gb);
+    }, iterations, random) && matches;
+
+    matches = benchDequant("DequantBlock", DEQUANT_BLOCK, iterations, random) && matches;
+
+    // A nonZeroBound that leaves a tail for every vector width
+    matches = benchStereo("MidSideProc", MID_SIDE, [](MidSideFunction function, int x[MAX_NCHAN][MAX_NSAMP], int mOut[2]) {
+        function(x, MAX_NSAMP - 7, mOut);
+    }, iterations, random) && matches;
+
+    // Intensity stereo from the third long band on, the factors of an MPEG1
+    // intensity position of 2 without mid/side
+    matches = benchStereo("IntensityBand", INTENSITY_BAND, [](IntensityBandFunction function, int x[MAX_NCHAN][MAX_NSAMP], int mOut[2]) {
+        const short *bands = sfBandTable[0][0].l;
+
+        for (int band = 2; band < 22; band++) {
+            function(x[0] + bands[band], x[1] + bands[band], bands[band + 1] - bands[band], ISFMpeg1[0][2], ISFMpeg1[0][6] - ISFMpeg1[0][2], mOut);
+        }
+    }, iterations, random) && matches;
+
+    return matches ? 0 : 1;
+}
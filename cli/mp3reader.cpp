@@ -89,6 +89,8 @@ int main(int argc, char *argv[])
 
     printf("Bits per sample: %u\n", reader.bitsPerSample());
 
+    printf("Frames: %zu\n", reader.totalFrames());
+
     pa_sample_spec sample_format = {
         .format = PA_SAMPLE_S16NE,
         .rate = static_cast<uint32_t>(reader.samplingRate()),
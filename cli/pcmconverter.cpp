@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "pcmconverter.h"
+
+struct Format
+{
+    const char *name;
+    bool floating;
+    size_t sample_size;
+};
+
+static const Format FORMATS[] = {
+    {"u8", false, 1},
+    {"s16", false, 2},
+    {"s24", false, 3},
+    {"s32", false, 4},
+#ifdef HAS_IEEE_FLOAT
+    {"f32", true, 4},
+    {"f64", true, 8},
+#endif
+};
+
+static const size_t BLOCK_SAMPLES = 4096;
+
+static void fillInput(std::vector<uint8_t> &input, const Format &format)
+{
+    uint32_t random = 0x12345678;
+
+    for (size_t sample = 0; sample < BLOCK_SAMPLES; sample++) {
+        random = random * 1664525 + 1013904223;
+
+        uint8_t *pointer = input.data() + sample * format.sample_size;
+
+        if (!format.floating) {
+            for (size_t byte = 0; byte < format.sample_size; byte++) {
+                pointer[byte] = static_cast<uint8_t>(random >> (8 * (byte % 4)));
+            }
+        } else if (format.sample_size == 4) {
+            // Slightly beyond full scale to exercise clipping
+            float value = static_cast<float>(static_cast<int32_t>(random)) / 1.95e9f;
+            memcpy(pointer, &value, sizeof(value));
+        } else {
+            double value = static_cast<double>(static_cast<int32_t>(random)) / 1.95e9;
+            memcpy(pointer, &value, sizeof(value));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t total_samples = 64 * 1000 * 1000;
+
+    if (argc >= 2) {
+        total_samples = static_cast<size_t>(atof(argv[1]) * 1e6);
+    }
+
+    if (total_samples < BLOCK_SAMPLES) {
+        total_samples = BLOCK_SAMPLES;
+    }
+
+    size_t blocks = total_samples / BLOCK_SAMPLES;
+
+    printf("Vector extension: %s\n", PcmConverter::vectorExtension());
+    printf("Samples per run: %zu\n", blocks * BLOCK_SAMPLES);
+
+    std::vector<uint8_t> input(BLOCK_SAMPLES * 8);
+    std::vector<int16_t> output(BLOCK_SAMPLES * 2);
+
+    int16_t checksum = 0;
+
+    for (const Format &format : FORMATS) {
+        PcmConverter converter;
+
+        if (!converter.setFormat(format.floating, format.sample_size)) {
+            fprintf(stderr, "Cannot set up format %s\n", format.name);
+            return 1;
+        }
+
+        fillInput(input, format);
+
+        for (unsigned int upmixing = 1; upmixing <= 2; upmixing++) {
+            for (int dither = 0; dither <= 1; dither++) {
+                if (dither && (format.sample_size <= 2) && !format.floating) {
+                    continue;
+                }
+
+                converter.setDither(dither != 0);
+
+                auto start = std::chrono::steady_clock::now();
+
+                for (size_t block = 0; block < blocks; block++) {
+                    converter.convert(output.data(), input.data(), BLOCK_SAMPLES, upmixing);
+                    checksum ^= output[block % (BLOCK_SAMPLES * upmixing)];
+                }
+
+                auto finish = std::chrono::steady_clock::now();
+                double seconds = std::chrono::duration<double>(finish - start).count();
+
+                printf("%-4s upmixing %u%s: %8.1f Msamples/s, %7.1f MB/s in\n",
+                       format.name,
+                       upmixing,
+                       dither ? " dither" : "       ",
+                       static_cast<double>(blocks * BLOCK_SAMPLES) / seconds / 1e6,
+                       static_cast<double>(blocks * BLOCK_SAMPLES * format.sample_size) / seconds / 1e6);
+            }
+        }
+    }
+
+    printf("Checksum: %d\n", checksum);
+
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "wavreader.h"
+#include "mp3reader.h"
+
+struct MemoryFile
+{
+    std::vector<uint8_t> data;
+    size_t position;
+};
+
+size_t tell_callback(void *file_context)
+{
+    return reinterpret_cast<MemoryFile *>(file_context)->position;
+}
+
+bool seek_callback(void *file_context, size_t offset)
+{
+    MemoryFile *file = reinterpret_cast<MemoryFile *>(file_context);
+
+    if (offset > file->data.size()) {
+        return false;
+    }
+
+    file->position = offset;
+
+    return true;
+}
+
+size_t read_callback(void *file_context, uint8_t *buffer, size_t length)
+{
+    MemoryFile *file = reinterpret_cast<MemoryFile *>(file_context);
+
+    size_t available = file->data.size() - file->position;
+    if (length > available) {
+        length = available;
+    }
+
+    memcpy(buffer, file->data.data() + file->position, length);
+    file->position += length;
+
+    return length;
+}
+
+static bool loadFile(const char *path, MemoryFile *file)
+{
+    FILE *input = fopen(path, "rb");
+    if (input == nullptr) {
+        return false;
+    }
+
+    uint8_t buffer[4096];
+    size_t length;
+
+    while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        file->data.insert(file->data.end(), buffer, buffer + length);
+    }
+
+    fclose(input);
+
+    file->position = 0;
+
+    return true;
+}
+
+static const char *formatName(WavReader &reader)
+{
+    switch (reader.format()) {
+    case WavReader::Format::Pcm:
+        return "PCM";
+#ifdef HAS_ADPCM
+    case WavReader::Format::MsAdpcm:
+        return "Microsoft ADPCM";
+    case WavReader::Format::ImaAdpcm:
+        return "IMA ADPCM";
+#endif
+#ifdef HAS_IEEE_FLOAT
+    case WavReader::Format::IeeeFloat:
+        return "IEEE float";
+#endif
+#ifdef HAS_G711
+    case WavReader::Format::ALaw:
+        return "A-law";
+    case WavReader::Format::MuLaw:
+        return "Mu-law";
+#endif
+    default:
+        return "Unknown";
+    }
+}
+
+// Silent 128 kbit/s mono frames around two stereo free format frames, the
+// second of which the first one's size is derived from
+static void buildFormatChange(MemoryFile *file)
+{
+    static const uint8_t MONO_HEADER[] = {0xff, 0xfb, 0x90, 0xc0};
+    static const uint8_t FREE_STEREO_HEADER[] = {0xff, 0xfb, 0x00, 0x00};
+
+    static const size_t FRAME_BYTES = 417;
+    static const size_t MONO_FRAMES = 4;
+
+    file->data.clear();
+    file->position = 0;
+
+    for (size_t frame = 0; frame < MONO_FRAMES * 2 + 2; frame++) {
+        const uint8_t *header = MONO_HEADER;
+        if ((frame == MONO_FRAMES) || (frame == MONO_FRAMES + 1)) {
+            header = FREE_STEREO_HEADER;
+        }
+
+        file->data.insert(file->data.end(), header, header + 4);
+        file->data.insert(file->data.end(), FRAME_BYTES - 4, 0);
+    }
+}
+
+// Decodes into buffers with room for exactly one MP3 frame, so a frame with
+// more channels than the stream would run into the guard samples
+static bool checkFormatChange(Mp3Reader *reader)
+{
+    static const size_t FRAMES = MP3READER_PLANE_LENGTH;
+    static const size_t GUARD_SAMPLES = FRAMES;
+    static const int16_t GUARD = 0x5a5a;
+
+    MemoryFile file;
+    buildFormatChange(&file);
+
+    if (!reader->open(&file, AudioReader::Mode::Single, false) || (reader->channels() != 1)) {
+        return false;
+    }
+
+    bool intact = true;
+
+    for (int planar = 0; planar < 2; planar++) {
+        std::vector<int16_t> buffer(FRAMES + GUARD_SAMPLES, GUARD);
+        int16_t *planes[] = {buffer.data()};
+
+        reader->rewind(false);
+
+        for (;;) {
+            size_t frames = (planar != 0) ? reader->decodeToI16(planes, FRAMES) : reader->decodeToI16(buffer.data(), FRAMES);
+            if (frames == 0) {
+                break;
+            }
+        }
+
+        for (size_t sample = FRAMES; sample < buffer.size(); sample++) {
+            if (buffer[sample] != GUARD) {
+                intact = false;
+                break;
+            }
+        }
+    }
+
+    reader->close();
+
+    return intact;
+}
+
+// A seek past the end has to leave the reader where it was, so decoding
+// carries on to the end from the first buffer
+static bool checkSeekPastEnd(AudioReader *reader, size_t total_frames, int16_t *buffer, size_t buffer_frames)
+{
+    reader->rewind(false);
+
+    size_t frames = reader->decodeToI16(buffer, buffer_frames);
+
+    if (reader->seek(total_frames) || reader->seek(total_frames * 2 + buffer_frames)) {
+        return false;
+    }
+
+    for (;;) {
+        size_t decoded_frames = reader->decodeToI16(buffer, buffer_frames);
+        if (decoded_frames == 0) {
+            break;
+        }
+
+        frames += decoded_frames;
+    }
+
+    return frames == total_frames;
+}
+
+int main(int argc, char *argv[])
+{
+    int first_file = 1;
+    unsigned int repeats = 5;
+
+    if ((argc >= 3) && (strcmp(argv[1], "-n") == 0)) {
+        repeats = static_cast<unsigned int>(atoi(argv[2]));
+        first_file = 3;
+    }
+
+    if ((first_file >= argc) || (repeats == 0)) {
+        fprintf(stderr, "Usage: %s [-n repeats] <file>...\n", argv[0]);
+        return 1;
+    }
+
+    static const size_t BUFFER_FRAMES = 1024;
+    std::vector<int16_t> buffer(BUFFER_FRAMES * 2);
+
+    WavReader wav_reader(&tell_callback,
+                         &seek_callback,
+                         &read_callback);
+
+    Mp3Reader mp3_reader(&tell_callback,
+                         &seek_callback,
+                         &read_callback);
+
+    bool format_change_ok = checkFormatChange(&mp3_reader);
+
+    printf("MP3 format change mid-stream: %s\n", format_change_ok ? "stays in the output buffer" : "OVERRUN");
+
+    if (!format_change_ok) {
+        return 1;
+    }
+
+    for (int argument = first_file; argument < argc; argument++) {
+        MemoryFile file;
+
+        if (!loadFile(argv[argument], &file)) {
+            fprintf(stderr, "Cannot open file \"%s\"\n", argv[argument]);
+            return 1;
+        }
+
+        AudioReader *reader = &wav_reader;
+        const char *format = nullptr;
+
+        if (wav_reader.open(&file, AudioReader::Mode::Single, false)) {
+            format = formatName(wav_reader);
+        } else if (mp3_reader.open(&file, AudioReader::Mode::Single, false)) {
+            reader = &mp3_reader;
+            format = "MP3";
+        } else {
+            fprintf(stderr, "Cannot parse file \"%s\"\n", argv[argument]);
+            return 1;
+        }
+
+        size_t frames = 0;
+        double best_seconds = 0.0;
+
+        for (unsigned int repeat = 0; repeat < repeats; repeat++) {
+            reader->rewind(false);
+
+            auto start = std::chrono::steady_clock::now();
+
+            frames = 0;
+
+            for (;;) {
+                size_t decoded_frames = reader->decodeToI16(buffer.data(), BUFFER_FRAMES);
+                if (decoded_frames == 0) {
+                    break;
+                }
+
+                frames += decoded_frames;
+            }
+
+            auto finish = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(finish - start).count();
+
+            if ((repeat == 0) || (seconds < best_seconds)) {
+                best_seconds = seconds;
+            }
+        }
+
+        double audio_seconds = static_cast<double>(frames) / static_cast<double>(reader->samplingRate());
+
+        printf("%s: %s, %u ch, %lu Hz, %zu frames\n",
+               argv[argument],
+               format,
+               reader->channels(),
+               reader->samplingRate(),
+               frames);
+
+        printf("    %.3f ms decode for %.3f s, %.1fx real time, %.3f%% CPU per stream\n",
+               best_seconds * 1e3,
+               audio_seconds,
+               audio_seconds / best_seconds,
+               best_seconds / audio_seconds * 100.0);
+
+        bool seek_ok = checkSeekPastEnd(reader, frames, buffer.data(), BUFFER_FRAMES);
+
+        printf("    seek past the end: %s\n", seek_ok ? "keeps the position" : "MOVES THE READER");
+
+        reader->close();
+
+        if (!seek_ok) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,312 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "wavreader.h"
+#include "mp3reader.h"
+#include "audiomixer.h"
+#include "wavwriter.h"
+
+size_t tell_callback(void *file_context)
+{
+    long result = ftell(reinterpret_cast<FILE *>(file_context));
+
+    if (result >= 0) {
+        return static_cast<size_t>(result);
+    }
+
+    return 0;
+}
+
+bool seek_callback(void *file_context, size_t offset)
+{
+    int result = fseek(reinterpret_cast<FILE *>(file_context),
+                       static_cast<long>(offset),
+                       SEEK_SET);
+
+    if (result >= 0) {
+        return true;
+    }
+
+    return false;
+}
+
+size_t read_callback(void *file_context, uint8_t *buffer, size_t length)
+{
+    return fread(buffer,
+                 1,
+                 length,
+                 reinterpret_cast<FILE *>(file_context));
+}
+
+size_t write_callback(void *file_context, const uint8_t *buffer, size_t length)
+{
+    return fwrite(buffer,
+                  1,
+                  length,
+                  reinterpret_cast<FILE *>(file_context));
+}
+
+static int running_tracks = 0;
+
+void track_end_callback(int)
+{
+    running_tracks--;
+}
+
+struct Source
+{
+    explicit Source(unsigned int channels)
+        : wav_reader(&tell_callback,
+                     &seek_callback,
+                     &read_callback),
+          mp3_reader(&tell_callback,
+                     &seek_callback,
+                     &read_callback),
+          track(channels),
+          file(nullptr)
+    {
+        track.addReader(&wav_reader);
+        track.addReader(&mp3_reader);
+    }
+
+    WavReader wav_reader;
+    Mp3Reader mp3_reader;
+    AudioTrack track;
+    FILE *file;
+};
+
+static bool parseEncoding(const char *name, WavWriter::Encoding *encoding)
+{
+    if (strcmp(name, "s16") == 0) {
+        *encoding = WavWriter::Encoding::Signed16;
+    } else if (strcmp(name, "s24") == 0) {
+        *encoding = WavWriter::Encoding::Signed24;
+    } else if (strcmp(name, "s32") == 0) {
+        *encoding = WavWriter::Encoding::Signed32;
+#ifdef HAS_IEEE_FLOAT
+    } else if (strcmp(name, "f32") == 0) {
+        *encoding = WavWriter::Encoding::Float32;
+#endif
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [-o output.wav] [-e s16|s24|s32|f32] [-c channels] [-b frames]\n"
+            "       [-l level] [-t seconds] [-p] <file>...\n"
+            "Renders the mix as fast as possible, to a null sink without -o.\n"
+            "With -t every file loops until the given duration is rendered.\n",
+            program);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output_path = nullptr;
+    WavWriter::Encoding encoding = WavWriter::Encoding::Signed16;
+    unsigned int channels = 2;
+    size_t buffer_frames = 1024;
+    double level = 1.0;
+    double duration = 0.0;
+    bool planar = false;
+
+    int argument = 1;
+
+    for (; argument < argc; argument++) {
+        const char *option = argv[argument];
+
+        if (option[0] != '-') {
+            break;
+        }
+
+        if (strcmp(option, "-p") == 0) {
+            planar = true;
+            continue;
+        }
+
+        if (argument + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        const char *value = argv[++argument];
+
+        if (strcmp(option, "-o") == 0) {
+            output_path = value;
+        } else if (strcmp(option, "-e") == 0) {
+            if (!parseEncoding(value, &encoding)) {
+                fprintf(stderr, "Unknown encoding \"%s\"\n", value);
+                return 1;
+            }
+        } else if (strcmp(option, "-c") == 0) {
+            channels = static_cast<unsigned int>(atoi(value));
+        } else if (strcmp(option, "-b") == 0) {
+            buffer_frames = static_cast<size_t>(atol(value));
+        } else if (strcmp(option, "-l") == 0) {
+            level = atof(value);
+        } else if (strcmp(option, "-t") == 0) {
+            duration = atof(value);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    int files = argc - argument;
+
+    if ((files < 1) || (files > AudioMixer::TRACK_SLOTS) ||
+        (channels < 1) || (channels > AudioMixer::MAX_PLANES) ||
+        (buffer_frames == 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    AudioMixer mixer(&track_end_callback,
+                     channels);
+
+    std::vector<std::unique_ptr<Source>> sources;
+
+    AudioTrack::Mode mode = AudioTrack::Mode::Single;
+    if (duration > 0.0) {
+        mode = AudioTrack::Mode::Continuous;
+    }
+
+    uint16_t track_level = static_cast<uint16_t>(level * AudioMixer::UNIT_LEVEL);
+
+    for (int index = 0; index < files; index++) {
+        const char *path = argv[argument + index];
+
+        sources.emplace_back(new Source(channels));
+        Source &source = *sources.back();
+
+        mixer.addTrack(&source.track);
+
+        source.file = fopen(path, "rb");
+        if (source.file == nullptr) {
+            fprintf(stderr, "Cannot open file \"%s\"\n", path);
+            return 1;
+        }
+
+        if (mixer.start(source.file, mode, true, track_level) < 0) {
+            fprintf(stderr, "Cannot play file \"%s\"\n", path);
+            return 1;
+        }
+
+        running_tracks++;
+    }
+
+    FILE *output_file = nullptr;
+
+    WavWriter writer(&seek_callback,
+                     &write_callback);
+
+    if (output_path != nullptr) {
+        output_file = fopen(output_path, "wb");
+        if (output_file == nullptr) {
+            fprintf(stderr, "Cannot create file \"%s\"\n", output_path);
+            return 1;
+        }
+
+        if (!writer.open(output_file, mixer.samplingRate(), channels, encoding)) {
+            fprintf(stderr, "Cannot write WAV file header\n");
+            fclose(output_file);
+            return 1;
+        }
+    }
+
+    size_t frame_limit = SIZE_MAX;
+    if (duration > 0.0) {
+        frame_limit = static_cast<size_t>(duration * static_cast<double>(mixer.samplingRate()));
+    }
+
+    std::vector<int16_t> buffer(buffer_frames * channels);
+    int16_t *planes[AudioMixer::MAX_PLANES];
+
+    for (unsigned int channel = 0; channel < channels; channel++) {
+        planes[channel] = buffer.data() + channel * buffer_frames;
+    }
+
+    size_t rendered_frames = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    while ((running_tracks > 0) && (rendered_frames < frame_limit)) {
+        size_t frames = buffer_frames;
+        if (frames > frame_limit - rendered_frames) {
+            frames = frame_limit - rendered_frames;
+        }
+
+        if (planar) {
+            frames = mixer.play(planes, frames);
+        } else {
+            frames = mixer.play(buffer.data(), frames);
+        }
+
+        if (frames == 0) {
+            break;
+        }
+
+        if (writer.opened()) {
+            size_t written_frames;
+
+            if (planar) {
+                written_frames = writer.write(planes, frames);
+            } else {
+                written_frames = writer.write(buffer.data(), frames);
+            }
+
+            if (written_frames < frames) {
+                fprintf(stderr, "Cannot write output file\n");
+                break;
+            }
+        }
+
+        rendered_frames += frames;
+    }
+
+    bool closed = true;
+
+    if (writer.opened()) {
+        closed = writer.close();
+    }
+
+    auto finish = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(finish - start).count();
+
+    if (output_file != nullptr) {
+        fclose(output_file);
+    }
+
+    for (auto &source : sources) {
+        fclose(source->file);
+    }
+
+    if (!closed) {
+        fprintf(stderr, "Cannot finish output file\n");
+        return 1;
+    }
+
+    double audio_seconds = static_cast<double>(rendered_frames) / static_cast<double>(mixer.samplingRate());
+
+    printf("%zu frames, %u ch, %lu Hz, %.3f s of audio to %s\n",
+           rendered_frames,
+           channels,
+           mixer.samplingRate(),
+           audio_seconds,
+           (output_path != nullptr) ? output_path : "null sink");
+
+    printf("    %.3f ms, %.0f frames/s, %.1fx real time\n",
+           seconds * 1e3,
+           static_cast<double>(rendered_frames) / seconds,
+           audio_seconds / seconds);
+
+    return 0;
+}
@@ -91,10 +91,26 @@ int main(int argc, char *argv[])
     case WavReader::Format::Pcm:
         printf("PCM\n");
         break;
+#ifdef HAS_ADPCM
+    case WavReader::Format::MsAdpcm:
+        printf("Microsoft ADPCM\n");
+        break;
+    case WavReader::Format::ImaAdpcm:
+        printf("IMA ADPCM\n");
+        break;
+#endif
 #ifdef HAS_IEEE_FLOAT
     case WavReader::Format::IeeeFloat:
         printf("IEEE float\n");
         break;
+#endif
+#ifdef HAS_G711
+    case WavReader::Format::ALaw:
+        printf("A-law\n");
+        break;
+    case WavReader::Format::MuLaw:
+        printf("Mu-law\n");
+        break;
 #endif
     }
 
@@ -108,6 +124,10 @@ int main(int argc, char *argv[])
 
     printf("Bits per sample: %u\n", reader.bitsPerSample());
 
+    printf("Frames: %zu\n", reader.totalFrames());
+
+    printf("Loop: %zu-%zu\n", reader.loopStart(), reader.loopEnd());
+
     pa_sample_spec sample_format = {
         .format = PA_SAMPLE_S16NE,
         .rate = static_cast<uint32_t>(reader.samplingRate()),
@@ -81,7 +81,7 @@ typedef struct _SFBandTable {
 
 typedef struct _BitStreamInfo {
 	unsigned char *bytePtr;
-	unsigned int iCache;
+	unsigned long long iCache;	/* left-justified, see RefillBitstreamCache() */
 	int cachedBits;
 	int nBytes;
 } BitStreamInfo;
@@ -163,14 +163,18 @@ typedef struct _HuffTabLookup {
 } HuffTabLookup;
 
 typedef struct _IMDCTInfo {
-	int outBuf[MAX_NCHAN][BLOCK_SIZE][NBANDS];	/* output of IMDCT */
 	int overBuf[MAX_NCHAN][MAX_NSAMP / 2];		/* overlap-add buffer (by symmetry, only need 1/2 size) */
 	int numPrevIMDCT[MAX_NCHAN];				/* how many IMDCT's calculated in this channel on prev. granule */
 	int prevType[MAX_NCHAN];
 	int prevWinSwitch[MAX_NCHAN];
-	int gb[MAX_NCHAN];
 } IMDCTInfo;
 
+/* IMDCT output for the subband transform, rewritten for every granule */
+typedef struct _IMDCTOutInfo {
+	int outBuf[MAX_NCHAN][BLOCK_SIZE][NBANDS];	/* output of IMDCT */
+	int gb[MAX_NCHAN];							/* minimum number of guard bits in outBuf[ch] */
+} IMDCTOutInfo;
+
 typedef struct _BlockCount {
 	int nBlocksLong;
 	int nBlocksTotal;
@@ -209,6 +213,19 @@ typedef struct _SubbandInfo {
 	int vindex;								/* internal index for tracking position in vbuf */
 } SubbandInfo;
 
+/* per-frame working state: MP3Decode rebuilds all of it from the bitstream before reading it,
+ *   so one copy can be shared by every decoder running on the same thread. FrameHeader,
+ *   ScaleFactorInfo, IMDCTInfo, SubbandInfo and MP3DecInfo carry state from frame to frame
+ *   and are per decoder (scfsi copies granule 0 scalefactors that a short or mixed granule 0
+ *   leaves over from earlier frames).
+ */
+typedef struct _MP3DecScratch {
+	SideInfo si;
+	HuffmanInfo hi;
+	DequantInfo di;
+	IMDCTOutInfo mo;
+} MP3DecScratch;
+
 typedef struct _MP3DecInfo {
 	/* pointers to platform-specific data structures */
 	void *FrameHeaderPS;
@@ -217,11 +234,9 @@ typedef struct _MP3DecInfo {
 	void *HuffmanInfoPS;
 	void *DequantInfoPS;
 	void *IMDCTInfoPS;
+	void *IMDCTOutInfoPS;
 	void *SubbandInfoPS;
 
-	/* buffer which must be large enough to hold largest possible main_data section */
-	unsigned char mainBuf[MAINBUF_SIZE];
-
 	/* special info for "free" bitrate files */
 	int freeBitrateFlag;
 	int freeBitrateSlots;
@@ -241,6 +256,11 @@ typedef struct _MP3DecInfo {
 
 	int part23Length[MAX_NGRAN][MAX_NCHAN];
 
+	/* buffer which must be large enough to hold largest possible main_data section
+	 *   (last, so the fields above share cache lines with the pointers)
+	 */
+	unsigned char mainBuf[MAINBUF_SIZE];
+
 } MP3DecInfo;
 
 /* decoder functions which must be implemented for each platform */
@@ -254,6 +274,7 @@ int Dequantize(MP3DecInfo *mp3DecInfo, int gr);
 int IMDCT(MP3DecInfo *mp3DecInfo, int gr, int ch);
 int UnpackScaleFactors(MP3DecInfo *mp3DecInfo, unsigned char *buf, int *bitOffset, int bitsAvail, int gr, int ch);
 int Subband(MP3DecInfo *mp3DecInfo, short *pcmBuf);
+int SubbandPlanar(MP3DecInfo *mp3DecInfo, short *pcmBuf[MAX_NCHAN]);
 
 /* mp3tabs.c - global ROM tables */
 extern const int samplerateTab[3][3];
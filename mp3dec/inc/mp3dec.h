@@ -98,6 +98,7 @@ typedef struct _MP3FrameInfo {
 
 /* public API */
 int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, short *outbuf, int useSize);
+int MP3DecodePlanar(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, short *outbuf[MAX_NCHAN], int useSize);
 
 void MP3GetLastFrameInfo(HMP3Decoder hMP3Decoder, MP3FrameInfo *mp3FrameInfo);
 int MP3GetNextFrameInfo(HMP3Decoder hMP3Decoder, MP3FrameInfo *mp3FrameInfo, unsigned char *buf);
@@ -48,15 +48,32 @@
  * MULSHIFT32(x, y)    signed multiply of two 32-bit integers (x and y), returns top 32 bits of 64-bit result
  * FASTABS(x)          branchless absolute value of signed integer x
  * CLZ(x)              count leading zeros in x
- * MADD64(sum, x, y)   (Windows only) sum [64-bit] += x [32-bit] * y [32-bit]
- * SHL64(sum, x, y)    (Windows only) 64-bit left shift using __int64
- * SAR64(sum, x, y)    (Windows only) 64-bit right shift using __int64
+ * MADD64(sum, x, y)   sum [64-bit] += x [32-bit] * y [32-bit]
+ * SHL64(sum, x, y)    64-bit left shift
+ * SAR64(sum, x, y)    64-bit right shift
+ *
+ * - Thumb-2 (GCC): inline smull/smlal and clz
+ * - x86, x86-64 and AArch64 (GCC, Clang): plain C the compiler maps onto single instructions
+ *     (imul/smull for MULSHIFT32, imul + add/smaddl for MADD64) and __builtin_clz
+ *     (bsr or lzcnt, clz) for CLZ
+ * - anything else: portable C
  */
 
 #ifndef _ASSEMBLY_H
 #define _ASSEMBLY_H
 
-#if defined(__GNUC__) && defined(__arm__) && defined(__thumb__)
+#if defined(__GNUC__) && defined(__arm__) && defined(__thumb2__)
+
+typedef long long Word64;
+
+typedef union _U64 {
+	Word64 w64;
+	struct {
+		/* little endian */
+		unsigned int lo32;
+		signed int   hi32;
+	} r;
+} U64;
 
 static __inline int MULSHIFT32(int x, int y)
 {
@@ -94,16 +111,72 @@ static __inline int CLZ(int x)
 {
 	int numZeros;
 
+	__asm__ ("clz %0,%1" : "=r" (numZeros) : "r" (x));
+
+	return numZeros;
+}
+
+static __inline Word64 MADD64(Word64 sum64, int x, int y)
+{
+	U64 u;
+
+	u.w64 = sum64;
+	__asm__ ("smlal %0,%1,%2,%3" : "+&r" (u.r.lo32), "+&r" (u.r.hi32) : "r" (x), "r" (y));
+
+	return u.w64;
+}
+
+static __inline Word64 SHL64(Word64 x, int n) {
+	return x <<= n;
+}
+
+static __inline Word64 SAR64(Word64 x, int n) {
+	return x >>= n;
+}
+
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__) || defined(__aarch64__))
+
+typedef long long Word64;
+
+/* one-operand imul (x86), imul + sar (x86-64), smull + asr (AArch64) */
+static __inline int MULSHIFT32(int x, int y) {
+	return ((Word64)x * (Word64)y) >> 32;
+}
+
+static __inline int FASTABS(int x)
+{
+	int sign;
+
+	sign = x >> (sizeof(int) * 8 - 1);
+	x ^= sign;
+	x -= sign;
+
+	return x;
+}
+
+/* __builtin_clz(0) is undefined (bsr leaves the result register unchanged) */
+static __inline int CLZ(int x)
+{
 	if (!x)
 		return (sizeof(int) * 8);
 
-	numZeros = 0;
-	while (!(x & 0x80000000)) {
-		numZeros++;
-		x <<= 1;
-	} 
+	return __builtin_clz((unsigned int)x);
+}
 
-	return numZeros;
+/* imul + add/adc (x86), imul + add (x86-64), smaddl (AArch64) */
+static __inline Word64 MADD64(Word64 sum64, int x, int y)
+{
+	sum64 += (Word64)x * (Word64)y;
+
+	return sum64;
+}
+
+static __inline Word64 SHL64(Word64 x, int n) {
+	return x <<= n;
+}
+
+static __inline Word64 SAR64(Word64 x, int n) {
+	return x >>= n;
 }
 
 #else
@@ -63,6 +63,25 @@
 #define MIN(a,b)	((a) < (b) ? (a) : (b))
 #endif
 
+/* SIMD kernels are built for GCC-compatible compilers and picked at runtime,
+ *   define MP3DEC_NO_SIMD to build the C reference versions only
+ */
+#if !defined(MP3DEC_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MP3DEC_SIMD_X86
+
+/* x86 kernels are compiled per function for their level, the rest of the build stays baseline */
+#define TARGET_SSE41	__attribute__((target("sse4.1")))
+#define TARGET_AVX2		__attribute__((target("avx2")))
+#endif
+
+#if !defined(MP3DEC_NO_SIMD) && defined(__ARM_NEON)
+#define MP3DEC_SIMD_NEON
+#endif
+
+#define CPU_SSE41	0x01
+#define CPU_AVX2	0x02
+#define CPU_NEON	0x04
+
 /* clip to range [-2^n, 2^n - 1] */
 #define CLIP_2N(y, n) { \
 	int sign = (y) >> 31;  \
@@ -87,10 +106,25 @@
 
 /* additional external symbols to name-mangle for static linking */
 #define	SetBitstreamPointer	STATNAME(SetBitstreamPointer)
-#define	GetBits				STATNAME(GetBits)
 #define	CalcBitsUsed		STATNAME(CalcBitsUsed)
 #define	DequantChannel		STATNAME(DequantChannel)
+#define	DequantBlockC		STATNAME(DequantBlockC)
+#define	DequantBlockSSE41	STATNAME(DequantBlockSSE41)
+#define	DequantBlockAVX2	STATNAME(DequantBlockAVX2)
+#define	DequantBlockNEON	STATNAME(DequantBlockNEON)
+#define	pow14				STATNAME(pow14)
+#define	pow43_14			STATNAME(pow43_14)
+#define	pow43				STATNAME(pow43)
+#define	pow43_14Planes		STATNAME(pow43_14Planes)
 #define	MidSideProc			STATNAME(MidSideProc)
+#define	MidSideProcC		STATNAME(MidSideProcC)
+#define	MidSideProcSSE41	STATNAME(MidSideProcSSE41)
+#define	MidSideProcAVX2		STATNAME(MidSideProcAVX2)
+#define	MidSideProcNEON		STATNAME(MidSideProcNEON)
+#define	IntensityBandC		STATNAME(IntensityBandC)
+#define	IntensityBandSSE41	STATNAME(IntensityBandSSE41)
+#define	IntensityBandAVX2	STATNAME(IntensityBandAVX2)
+#define	IntensityBandNEON	STATNAME(IntensityBandNEON)
 #define	IntensityProcMPEG1	STATNAME(IntensityProcMPEG1)
 #define	IntensityProcMPEG2	STATNAME(IntensityProcMPEG2)
 #define PolyphaseMono		STATNAME(PolyphaseMono)
@@ -103,6 +137,37 @@
 #define uniqueIDTab			STATNAME(uniqueIDTab)
 #define	coef32				STATNAME(coef32)
 #define	polyCoef			STATNAME(polyCoef)
+
+#define	GetCPUFeatures		STATNAME(GetCPUFeatures)
+#define	kernelTab			STATNAME(kernelTab)
+#define	PolyphaseMonoC		STATNAME(PolyphaseMonoC)
+#define	PolyphaseStereoC	STATNAME(PolyphaseStereoC)
+#define	PolyphaseMonoSSE41	STATNAME(PolyphaseMonoSSE41)
+#define	PolyphaseStereoSSE41	STATNAME(PolyphaseStereoSSE41)
+#define	PolyphaseMonoAVX2	STATNAME(PolyphaseMonoAVX2)
+#define	PolyphaseStereoAVX2	STATNAME(PolyphaseStereoAVX2)
+#define	PolyphaseMonoNEON	STATNAME(PolyphaseMonoNEON)
+#define	PolyphaseStereoNEON	STATNAME(PolyphaseStereoNEON)
+#define	FDCT32C				STATNAME(FDCT32C)
+#define	FDCT32Output		STATNAME(FDCT32Output)
+#define	FDCT32Stereo		STATNAME(FDCT32Stereo)
+#define	FDCT32StereoC		STATNAME(FDCT32StereoC)
+#define	FDCT32SSE41			STATNAME(FDCT32SSE41)
+#define	FDCT32StereoSSE41	STATNAME(FDCT32StereoSSE41)
+#define	FDCT32StereoAVX2	STATNAME(FDCT32StereoAVX2)
+#define	FDCT32NEON			STATNAME(FDCT32NEON)
+#define	FDCT32StereoNEON	STATNAME(FDCT32StereoNEON)
+#define	dcttabLanes			STATNAME(dcttabLanes)
+#define	AntiAliasC			STATNAME(AntiAliasC)
+#define	AntiAliasSSE41		STATNAME(AntiAliasSSE41)
+#define	AntiAliasNEON		STATNAME(AntiAliasNEON)
+#define	IMDCT36x4C			STATNAME(IMDCT36x4C)
+#define	IMDCT36x4SSE41		STATNAME(IMDCT36x4SSE41)
+#define	IMDCT36x4NEON		STATNAME(IMDCT36x4NEON)
+#define	IMDCT12x3x4C		STATNAME(IMDCT12x3x4C)
+#define	IMDCT12x3x4SSE41	STATNAME(IMDCT12x3x4SSE41)
+#define	IMDCT12x3x4NEON		STATNAME(IMDCT12x3x4NEON)
+#define	fastWin36			STATNAME(fastWin36)
 #define	csa					STATNAME(csa)
 #define	imdctWin			STATNAME(imdctWin)
 
@@ -115,9 +180,68 @@
 
 /* bitstream.c */
 void SetBitstreamPointer(BitStreamInfo *bsi, int nBytes, unsigned char *buf);
-unsigned int GetBits(BitStreamInfo *bsi, int nBits);
 int CalcBitsUsed(BitStreamInfo *bsi, unsigned char *startBuf, int startOffset);
 
+/* 8 bytes of bitstream, big-endian (compilers turn this into one unaligned load + byte swap) */
+static __inline unsigned long long LoadBE64(const unsigned char *p)
+{
+	return ((unsigned long long)p[0] << 56) | ((unsigned long long)p[1] << 48) | ((unsigned long long)p[2] << 40) | ((unsigned long long)p[3] << 32) |
+	       ((unsigned long long)p[4] << 24) | ((unsigned long long)p[5] << 16) | ((unsigned long long)p[6] <<  8) | ((unsigned long long)p[7] <<  0);
+}
+
+/* top up bsi->iCache (64 bits, left-justified) with as many whole bytes as fit
+ *   while at least 8 bytes are left this is one unaligned load, after which the cache
+ *   holds 56-63 bits - bits past cachedBits may then already be filled in, but with the
+ *   right values, so OR-ing them in again is harmless
+ *   near the end of the buffer bytes are added one at a time, never reading past nBytes
+ */
+static __inline void RefillBitstreamCache(BitStreamInfo *bsi)
+{
+	int nBytes;
+
+	if (bsi->nBytes >= 8) {
+		bsi->iCache |= LoadBE64(bsi->bytePtr) >> bsi->cachedBits;
+		nBytes = (63 - bsi->cachedBits) >> 3;
+		bsi->bytePtr += nBytes;
+		bsi->nBytes -= nBytes;
+		bsi->cachedBits += 8*nBytes;
+	} else {
+		while (bsi->nBytes > 0 && bsi->cachedBits <= 56) {
+			bsi->iCache |= (unsigned long long)(*bsi->bytePtr++) << (56 - bsi->cachedBits);
+			bsi->nBytes--;
+			bsi->cachedBits += 8;
+		}
+	}
+}
+
+/* next nBits (0-32) of the cache, without consuming them - call RefillBitstreamCache() first */
+static __inline unsigned int PeekBits(BitStreamInfo *bsi, int nBits)
+{
+	return (unsigned int)((bsi->iCache >> 1) >> (63 - nBits));	/* >> 1 first so that nBits = 0 returns 0 */
+}
+
+/* consume nBits (0-56) from the cache */
+static __inline void SkipBits(BitStreamInfo *bsi, int nBits)
+{
+	bsi->iCache <<= nBits;
+	bsi->cachedBits -= nBits;
+}
+
+/* get the next nBits (0-32) from the bitstream
+ *   like before, reading past the end returns zeros and is not flagged as an error
+ *   (CalcBitsUsed() will then be larger than the buffer)
+ */
+static __inline unsigned int GetBits(BitStreamInfo *bsi, int nBits)
+{
+	unsigned int data;
+
+	RefillBitstreamCache(bsi);
+	data = PeekBits(bsi, nBits);
+	SkipBits(bsi, nBits);
+
+	return data;
+}
+
 /* dequant.c, dqchan.c, stproc.c */
 int DequantChannel(int *sampleBuf, int *workBuf, int *nonZeroBound, FrameHeader *fh, SideInfoSub *sis, 
 					ScaleFactorInfoSub *sfis, CriticalBandInfo *cbi);
@@ -127,9 +251,81 @@ void IntensityProcMPEG1(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, FrameHeader *fh
 void IntensityProcMPEG2(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, FrameHeader *fh, ScaleFactorInfoSub *sfis, 
 						CriticalBandInfo *cbi, ScaleFactorJS *sfjs, int midSideFlag, int mixFlag, int mOut[2]);
 
+/* stproc.c C reference, x86/stproc_x86.c, neon/stproc_neon.c
+ *   (all bit-exact, kernelTab holds the one MidSideProc and IntensityProcMPEGx use)
+ */
+void MidSideProcC(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2]);
+void IntensityBandC(int *xl, int *xr, int n, int fl, int fr, int mOut[2]);
+#ifdef MP3DEC_SIMD_X86
+void MidSideProcSSE41(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2]);
+void MidSideProcAVX2(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2]);
+void IntensityBandSSE41(int *xl, int *xr, int n, int fl, int fr, int mOut[2]);
+void IntensityBandAVX2(int *xl, int *xr, int n, int fl, int fr, int mOut[2]);
+#endif
+#ifdef MP3DEC_SIMD_NEON
+void MidSideProcNEON(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2]);
+void IntensityBandNEON(int *xl, int *xr, int n, int fl, int fr, int mOut[2]);
+#endif
+
+/* dqchan.c C reference, x86/dqchan_x86.c, neon/dqchan_neon.c
+ *   (all bit-exact, kernelTab holds the one DequantChannel uses)
+ */
+int DequantBlockC(int *inbuf, int *outbuf, int num, int scale);
+#ifdef MP3DEC_SIMD_X86
+int DequantBlockSSE41(int *inbuf, int *outbuf, int num, int scale);
+int DequantBlockAVX2(int *inbuf, int *outbuf, int num, int scale);
+#endif
+#ifdef MP3DEC_SIMD_NEON
+int DequantBlockNEON(int *inbuf, int *outbuf, int num, int scale);
+#endif
+extern int pow14[4];
+extern int pow43_14[4][16];
+extern int pow43[];
+#if defined(MP3DEC_SIMD_X86) || defined(MP3DEC_SIMD_NEON)
+extern const unsigned char pow43_14Planes[4][4][16];
+#endif
+
 /* dct32.c */
 // about 1 ms faster in RAM, but very large
 void FDCT32(int *x, int *d, int offset, int oddBlock, int gb);// __attribute__ ((section (".data")));
+void FDCT32Stereo(int *xL, int *xR, int *d, int offset, int oddBlock, int gbL, int gbR);
+
+/* dct32.c C reference, x86/dct32_x86.c, neon/dct32_neon.c
+ *   (all bit-exact, kernelTab holds the one FDCT32/FDCT32Stereo use)
+ */
+void FDCT32C(int *x, int *d, int offset, int oddBlock, int gb);
+void FDCT32StereoC(int *xL, int *xR, int *d, int offset, int oddBlock, int gbL, int gbR);
+void FDCT32Output(int *x, int *d, int offset, int oddBlock, int es);
+#ifdef MP3DEC_SIMD_X86
+void FDCT32SSE41(int *x, int *d, int offset, int oddBlock, int gb);
+void FDCT32StereoSSE41(int *xL, int *xR, int *d, int offset, int oddBlock, int gbL, int gbR);
+void FDCT32StereoAVX2(int *xL, int *xR, int *d, int offset, int oddBlock, int gbL, int gbR);
+#endif
+#ifdef MP3DEC_SIMD_NEON
+void FDCT32NEON(int *x, int *d, int offset, int oddBlock, int gb);
+void FDCT32StereoNEON(int *xL, int *xR, int *d, int offset, int oddBlock, int gbL, int gbR);
+#endif
+#if defined(MP3DEC_SIMD_X86) || defined(MP3DEC_SIMD_NEON)
+extern const int dcttabLanes[12][8];
+#endif
+
+/* imdct.c C reference, x86/imdct_x86.c, neon/imdct_neon.c
+ *   (all bit-exact, kernelTab holds the one IMDCT uses)
+ */
+void AntiAliasC(int *x, int nBfly);
+int IMDCT36x4C(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb);
+int IMDCT12x3x4C(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb);
+#ifdef MP3DEC_SIMD_X86
+void AntiAliasSSE41(int *x, int nBfly);
+int IMDCT36x4SSE41(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb);
+int IMDCT12x3x4SSE41(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb);
+#endif
+#ifdef MP3DEC_SIMD_NEON
+void AntiAliasNEON(int *x, int nBfly);
+int IMDCT36x4NEON(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb);
+int IMDCT12x3x4NEON(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb);
+#endif
+extern int fastWin36[18];
 
 /* hufftabs.c */
 extern const HuffTabLookup huffTabLookup[HUFF_PAIRTABS];
@@ -149,6 +345,42 @@ extern "C" {
 #endif
 void PolyphaseMono(short *pcm, int *vbuf, const int *coefBase);
 void PolyphaseStereo(short *pcm, int *vbuf, const int *coefBase);
+
+/* polyphase.c C reference, x86/polyphase_x86.c, neon/polyphase_neon.c
+ *   (all bit-exact, kernelTab holds the one PolyphaseMono/PolyphaseStereo use)
+ */
+void PolyphaseMonoC(short *pcm, int *vbuf, const int *coefBase);
+void PolyphaseStereoC(short *pcm, int *vbuf, const int *coefBase);
+#ifdef MP3DEC_SIMD_X86
+void PolyphaseMonoSSE41(short *pcm, int *vbuf, const int *coefBase);
+void PolyphaseStereoSSE41(short *pcm, int *vbuf, const int *coefBase);
+void PolyphaseMonoAVX2(short *pcm, int *vbuf, const int *coefBase);
+void PolyphaseStereoAVX2(short *pcm, int *vbuf, const int *coefBase);
+#endif
+#ifdef MP3DEC_SIMD_NEON
+void PolyphaseMonoNEON(short *pcm, int *vbuf, const int *coefBase);
+void PolyphaseStereoNEON(short *pcm, int *vbuf, const int *coefBase);
+#endif
+
+/* cpu.c - one version of each kernel, picked once at startup from the CPU features
+ *   (capped by the AUDIO_SIMD environment variable, see LimitCPUFeatures)
+ */
+typedef struct _MP3DecKernels {
+	int features;	/* CPU_xxx flags the table was filled from */
+	void (*PolyphaseMono)(short *pcm, int *vbuf, const int *coefBase);
+	void (*PolyphaseStereo)(short *pcm, int *vbuf, const int *coefBase);
+	void (*FDCT32)(int *x, int *d, int offset, int oddBlock, int gb);
+	void (*FDCT32Stereo)(int *xL, int *xR, int *d, int offset, int oddBlock, int gbL, int gbR);
+	void (*AntiAlias)(int *x, int nBfly);
+	int (*IMDCT36x4)(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb);
+	int (*IMDCT12x3x4)(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb);
+	int (*DequantBlock)(int *inbuf, int *outbuf, int num, int scale);
+	void (*MidSideProc)(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2]);
+	void (*IntensityBand)(int *xl, int *xr, int n, int fl, int fr, int mOut[2]);
+} MP3DecKernels;
+
+extern MP3DecKernels kernelTab;
+int GetCPUFeatures(void);
 #ifdef __cplusplus
 }
 #endif
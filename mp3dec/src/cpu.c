@@ -0,0 +1,174 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * cpu.c - runtime detection of the instruction set extensions used by the SIMD kernels,
+ *   and the table of kernels picked from them
+ **************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "coder.h"
+
+/* C versions until InitKernels runs (or for good, without SIMD kernels), so a decoder
+ *   used before startup finishes still works: every kernel gives bit-exact output
+ */
+MP3DecKernels kernelTab = {
+	0,
+	PolyphaseMonoC,
+	PolyphaseStereoC,
+	FDCT32C,
+	FDCT32StereoC,
+	AntiAliasC,
+	IMDCT36x4C,
+	IMDCT12x3x4C,
+	DequantBlockC,
+	MidSideProcC,
+	IntensityBandC,
+};
+
+#if defined(MP3DEC_SIMD_X86) || defined(MP3DEC_SIMD_NEON)
+
+/**************************************************************************************
+ * Function:    DetectCPUFeatures
+ *
+ * Description: ask the CPU which SIMD kernels it can execute
+ *
+ * Inputs:      none
+ *
+ * Outputs:     none
+ *
+ * Return:      CPU_xxx flags
+ **************************************************************************************/
+static int DetectCPUFeatures(void)
+{
+	int features = 0;
+
+#ifdef MP3DEC_SIMD_X86
+	if (__builtin_cpu_supports("sse4.1"))
+		features |= CPU_SSE41;
+	if (__builtin_cpu_supports("avx2"))
+		features |= CPU_AVX2;
+#endif
+
+#ifdef MP3DEC_SIMD_NEON
+	/* NEON is part of the base ISA whenever the compiler targets it */
+	features |= CPU_NEON;
+#endif
+
+	return features;
+}
+
+/**************************************************************************************
+ * Function:    LimitCPUFeatures
+ *
+ * Description: apply the AUDIO_SIMD environment variable
+ *
+ * Inputs:      CPU_xxx flags of the running CPU
+ *
+ * Outputs:     none
+ *
+ * Return:      CPU_xxx flags to use
+ *
+ * Notes:       AUDIO_SIMD = c, sse2, sse4.1, avx2 or neon is the highest level to use,
+ *                for benchmarking each level and as a fallback in production.
+ *                It never enables what the CPU lacks, and other values are ignored.
+ *                sse2 is for the mixer and the PCM converter, the decoder has no
+ *                SSE2 kernels so it runs the C versions.
+ **************************************************************************************/
+static int LimitCPUFeatures(int features)
+{
+	const char *level = getenv("AUDIO_SIMD");
+
+	if (!level)
+		return features;
+
+	if (!strcmp(level, "c") || !strcmp(level, "sse2"))
+		return 0;
+	if (!strcmp(level, "sse4.1"))
+		return features & CPU_SSE41;
+	if (!strcmp(level, "avx2"))
+		return features & (CPU_SSE41 | CPU_AVX2);
+	if (!strcmp(level, "neon"))
+		return features & CPU_NEON;
+
+	return features;
+}
+
+/**************************************************************************************
+ * Function:    InitKernels
+ *
+ * Description: fill the kernel table with the fastest version of each kernel the CPU
+ *                supports
+ *
+ * Inputs:      none
+ *
+ * Outputs:     kernelTab
+ *
+ * Return:      none
+ *
+ * Notes:       runs once, before main(), so decoders on any thread only read the table
+ **************************************************************************************/
+static void __attribute__((constructor)) InitKernels(void)
+{
+	int features = LimitCPUFeatures(DetectCPUFeatures());
+
+	kernelTab.features = features;
+
+#ifdef MP3DEC_SIMD_X86
+	if (features & CPU_SSE41) {
+		kernelTab.PolyphaseMono = PolyphaseMonoSSE41;
+		kernelTab.PolyphaseStereo = PolyphaseStereoSSE41;
+		kernelTab.FDCT32 = FDCT32SSE41;
+		kernelTab.FDCT32Stereo = FDCT32StereoSSE41;
+		kernelTab.AntiAlias = AntiAliasSSE41;
+		kernelTab.IMDCT36x4 = IMDCT36x4SSE41;
+		kernelTab.IMDCT12x3x4 = IMDCT12x3x4SSE41;
+		kernelTab.DequantBlock = DequantBlockSSE41;
+		kernelTab.MidSideProc = MidSideProcSSE41;
+		kernelTab.IntensityBand = IntensityBandSSE41;
+	}
+	if (features & CPU_AVX2) {
+		kernelTab.PolyphaseMono = PolyphaseMonoAVX2;
+		kernelTab.PolyphaseStereo = PolyphaseStereoAVX2;
+		kernelTab.FDCT32Stereo = FDCT32StereoAVX2;
+		kernelTab.DequantBlock = DequantBlockAVX2;
+		kernelTab.MidSideProc = MidSideProcAVX2;
+		kernelTab.IntensityBand = IntensityBandAVX2;
+	}
+#endif
+
+#ifdef MP3DEC_SIMD_NEON
+	if (features & CPU_NEON) {
+		kernelTab.PolyphaseMono = PolyphaseMonoNEON;
+		kernelTab.PolyphaseStereo = PolyphaseStereoNEON;
+		kernelTab.FDCT32 = FDCT32NEON;
+		kernelTab.FDCT32Stereo = FDCT32StereoNEON;
+		kernelTab.AntiAlias = AntiAliasNEON;
+		kernelTab.IMDCT36x4 = IMDCT36x4NEON;
+		kernelTab.IMDCT12x3x4 = IMDCT12x3x4NEON;
+		kernelTab.DequantBlock = DequantBlockNEON;
+		kernelTab.MidSideProc = MidSideProcNEON;
+		kernelTab.IntensityBand = IntensityBandNEON;
+	}
+#endif
+}
+
+#endif	/* MP3DEC_SIMD_X86 || MP3DEC_SIMD_NEON */
+
+/**************************************************************************************
+ * Function:    GetCPUFeatures
+ *
+ * Description: report which SIMD kernels the decoder uses
+ *
+ * Inputs:      none
+ *
+ * Outputs:     none
+ *
+ * Return:      CPU_xxx flags the kernel table was filled from, 0 if only the C reference
+ *                versions are used
+ **************************************************************************************/
+int GetCPUFeatures(void)
+{
+	return kernelTab.features;
+}
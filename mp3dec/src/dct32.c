@@ -103,6 +103,29 @@ static const int dcttab[48] = {
 	-COS2_1, -COS2_2, COS3_1, 	/* 31, 31, 30 */
 };
 
+#if defined(MP3DEC_SIMD_X86) || defined(MP3DEC_SIMD_NEON)
+/* dcttab regrouped for the SIMD versions, one coefficient per vector lane
+ *   first pass: lane i = butterfly i, shifts stored as multipliers (1 << s)
+ *   second pass: lane i = block (i & 3), so 8 lanes cover both channels
+ */
+const int dcttabLanes[12][8] = {
+	/* first pass */
+	{ COS0_0,  COS0_1,  COS0_2,  COS0_3,  COS0_4,  COS0_5,  COS0_6,  COS0_7  },
+	{ COS0_15, COS0_14, COS0_13, COS0_12, COS0_11, COS0_10, COS0_9,  COS0_8  },
+	{ COS1_0,  COS1_1,  COS1_2,  COS1_3,  COS1_4,  COS1_5,  COS1_6,  COS1_7  },
+	{ 1 << 5,  1 << 3,  1 << 3,  1 << 2,  1 << 2,  1 << 1,  1 << 1,  1 << 1  },
+	{ 1 << 1,  1 << 1,  1 << 1,  1 << 1,  1 << 1,  1 << 2,  1 << 2,  1 << 4  },
+	/* second pass */
+	{ COS2_0, -COS2_0,  COS2_0, -COS2_0,  COS2_0, -COS2_0,  COS2_0, -COS2_0  },
+	{ COS2_3, -COS2_3,  COS2_3, -COS2_3,  COS2_3, -COS2_3,  COS2_3, -COS2_3  },
+	{ COS3_0,  COS3_0,  COS3_0,  COS3_0,  COS3_0,  COS3_0,  COS3_0,  COS3_0  },
+	{ COS2_1, -COS2_1,  COS2_1, -COS2_1,  COS2_1, -COS2_1,  COS2_1, -COS2_1  },
+	{ COS2_2, -COS2_2,  COS2_2, -COS2_2,  COS2_2, -COS2_2,  COS2_2, -COS2_2  },
+	{ COS3_1,  COS3_1,  COS3_1,  COS3_1,  COS3_1,  COS3_1,  COS3_1,  COS3_1  },
+	{ COS4_0,  COS4_0,  COS4_0,  COS4_0,  COS4_0,  COS4_0,  COS4_0,  COS4_0  },
+};
+#endif
+
 #define D32FP(i, s0, s1, s2) { \
     a0 = buf[i];			a3 = buf[31-i]; \
 	a1 = buf[15-i];			a2 = buf[16+i]; \
@@ -113,7 +136,7 @@ static const int dcttab[48] = {
 }
 
 /**************************************************************************************
- * Function:    FDCT32
+ * Function:    FDCT32C
  *
  * Description: Ken's highly-optimized 32-point DCT (radix-4 + radix-8) 
  *
@@ -141,13 +164,12 @@ static const int dcttab[48] = {
  *                enough registers)
  **************************************************************************************/
 // about 1ms faster in RAM
-void FDCT32(int *buf, int *dest, int offset, int oddBlock, int gb)
+void FDCT32C(int *buf, int *dest, int offset, int oddBlock, int gb)
 {
-    int i, s, tmp, es;
+    int i, es;
     const int *cptr = dcttab;
     int a0, a1, a2, a3, a4, a5, a6, a7;
     int b0, b1, b2, b3, b4, b5, b6, b7;
-	int *d;
 
 	/* scaling - ensure at least 6 guard bits for DCT 
 	 * (in practice this is already true 99% of time, so this code is
@@ -199,6 +221,31 @@ void FDCT32(int *buf, int *dest, int offset, int oddBlock, int gb)
 	}
 	buf -= 32;	/* reset */
 
+	FDCT32Output(buf, dest, offset, oddBlock, es);
+}
+
+/**************************************************************************************
+ * Function:    FDCT32Output
+ *
+ * Description: final stage of FDCT32, shuffle the DCT output into the polyphase
+ *                filter input buffer
+ *
+ * Inputs:      buffer with the 32 outputs of the second pass
+ *              buffer offset and oddblock flag for polyphase filter input buffer
+ *              number of bits the input was scaled down by (0 almost always)
+ *
+ * Outputs:     output buffer, data copied and interleaved for polyphase filter
+ *
+ * Return:      none
+ *
+ * Notes:       shared by all the versions of FDCT32, which only differ in the first
+ *                two passes
+ **************************************************************************************/
+void FDCT32Output(int *buf, int *dest, int offset, int oddBlock, int es)
+{
+	int i, s, tmp;
+	int *d;
+
 	/* sample 0 - always delayed one block */
 	d = dest + 64*16 + ((offset - oddBlock) & 7) + (oddBlock ? 0 : VBUF_LENGTH);
 	s = buf[ 0];				d[0] = d[8] = s;
@@ -278,3 +325,46 @@ void FDCT32(int *buf, int *dest, int offset, int oddBlock, int gb)
 		}
 	}
 }
+
+/**************************************************************************************
+ * Function:    FDCT32StereoC
+ *
+ * Description: 32-point DCT of one block of both channels
+ *
+ * Inputs:      input buffers for left and right channels, length = 32 samples each
+ *              buffer offset and oddblock flag for polyphase filter input buffer
+ *              number of guard bits in each input
+ *
+ * Outputs:     output buffer, left channel at d + 0, right channel at d + 32
+ *
+ * Return:      none
+ **************************************************************************************/
+void FDCT32StereoC(int *bufL, int *bufR, int *dest, int offset, int oddBlock, int gbL, int gbR)
+{
+	FDCT32C(bufL, dest + 0*32, offset, oddBlock, gbL);
+	FDCT32C(bufR, dest + 1*32, offset, oddBlock, gbR);
+}
+
+/**************************************************************************************
+ * Function:    FDCT32, FDCT32Stereo
+ *
+ * Description: run the 32-point DCT picked at startup (see InitKernels)
+ *
+ * Inputs:      see FDCT32C, FDCT32StereoC
+ *
+ * Outputs:     see FDCT32C, FDCT32StereoC
+ *
+ * Return:      none
+ *
+ * Notes:       the SIMD versions use the same 32x32 -> top 32 bit multiplies and shifts,
+ *                so every choice gives bit-exact output
+ **************************************************************************************/
+void FDCT32(int *buf, int *dest, int offset, int oddBlock, int gb)
+{
+	kernelTab.FDCT32(buf, dest, offset, oddBlock, gb);
+}
+
+void FDCT32Stereo(int *bufL, int *bufR, int *dest, int offset, int oddBlock, int gbL, int gbR)
+{
+	kernelTab.FDCT32Stereo(bufL, bufR, dest, offset, oddBlock, gbL, gbR);
+}
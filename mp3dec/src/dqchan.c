@@ -77,6 +77,38 @@ int pow43_14[4][16] = {
 	0x20abd76a, 0x2459d551, 0x28204fbb, 0x2bfe1808, },
 };
 
+#if defined(MP3DEC_SIMD_X86) || defined(MP3DEC_SIMD_NEON)
+/* pow43_14 split into byte planes for the SIMD versions (16-entry byte table lookups)
+ *   pow43_14Planes[i][b][j] = byte b (LSB first) of pow43_14[i][j]
+ */
+const unsigned char pow43_14Planes[4][4][16] = {
+{
+	{ 0x00, 0x00, 0xf3, 0xdb, 0x53, 0xd6, 0xc8, 0x03, 0x00, 0xb9, 0xa3, 0xb4, 0xa5, 0xd3, 0x56, 0x3c },
+	{ 0x00, 0x00, 0x45, 0x5c, 0xff, 0x89, 0x31, 0xf2, 0x00, 0x06, 0xb4, 0x74, 0x3f, 0x7b, 0xe6, 0x82 },
+	{ 0x00, 0x00, 0x51, 0x3a, 0xb2, 0x19, 0xce, 0xc7, 0x00, 0x71, 0x16, 0xed, 0xf2, 0x22, 0x7b, 0xfc },
+	{ 0x00, 0x10, 0x28, 0x45, 0x0c, 0x11, 0x15, 0x1a, 0x20, 0x25, 0x2b, 0x30, 0x36, 0x3d, 0x43, 0x49 },
+},
+{
+	{ 0x00, 0xcd, 0x26, 0xd9, 0x84, 0x6e, 0x1d, 0xcf, 0x99, 0xa4, 0x49, 0x67, 0x0f, 0x85, 0xff, 0x82 },
+	{ 0x00, 0x4f, 0x1f, 0xab, 0xc0, 0x0e, 0x0c, 0x23, 0x9f, 0x03, 0xae, 0x9c, 0x42, 0x6f, 0x3d, 0x01 },
+	{ 0x00, 0x74, 0xe7, 0x36, 0xad, 0x61, 0x56, 0x85, 0xe8, 0x7c, 0x3b, 0x24, 0x34, 0x68, 0xbf, 0x37 },
+	{ 0x00, 0x0d, 0x21, 0x3a, 0x0a, 0x0e, 0x12, 0x16, 0x1a, 0x1f, 0x24, 0x29, 0x2e, 0x33, 0x38, 0x3e },
+},
+{
+	{ 0x00, 0x33, 0x07, 0x55, 0x62, 0x19, 0x22, 0xad, 0x66, 0x17, 0x01, 0xb4, 0xfc, 0x2a, 0xe7, 0x50 },
+	{ 0x00, 0x4f, 0x3e, 0x9a, 0xcd, 0x63, 0x35, 0xe2, 0x9e, 0xa3, 0xe3, 0xd5, 0x56, 0x90, 0xe7, 0xf6 },
+	{ 0x00, 0x50, 0x82, 0xf3, 0xfa, 0x17, 0x6b, 0xef, 0xa0, 0x79, 0x77, 0x98, 0xda, 0x3a, 0xb7, 0x50 },
+	{ 0x00, 0x0b, 0x1c, 0x30, 0x08, 0x0c, 0x0f, 0x12, 0x16, 0x1a, 0x1e, 0x22, 0x26, 0x2b, 0x2f, 0x34 },
+},
+{
+	{ 0x00, 0x05, 0xd7, 0xa9, 0xfa, 0x61, 0x54, 0xcb, 0x0a, 0x6c, 0x95, 0x3d, 0x6a, 0x51, 0xbb, 0x08 },
+	{ 0x00, 0x7f, 0x10, 0xc7, 0x0d, 0xe6, 0x31, 0x91, 0xfe, 0x4a, 0xe5, 0xae, 0xd7, 0xd5, 0x4f, 0x18 },
+	{ 0x00, 0x83, 0xf9, 0x29, 0x8d, 0x2a, 0xf7, 0xec, 0x06, 0x43, 0x9e, 0x17, 0xab, 0x59, 0x20, 0xfe },
+	{ 0x00, 0x09, 0x17, 0x29, 0x07, 0x0a, 0x0c, 0x0f, 0x13, 0x16, 0x19, 0x1d, 0x20, 0x24, 0x28, 0x2b },
+},
+};
+#endif
+
 /* pow(j,4/3) for j=16..63, Q23 format */
 int pow43[] = {
 	0x1428a2fa, 0x15db1bd6, 0x1796302c, 0x19598d85, 
@@ -116,7 +148,7 @@ int pow2frac[8] = {
 };
 
 /**************************************************************************************
- * Function:    DequantBlock
+ * Function:    DequantBlockC
  *
  * Description: Ken's highly-optimized, low memory dequantizer performing the operation
  *              y = pow(x, 4.0/3.0) * pow(2, 25 - scale/4.0)
@@ -128,8 +160,10 @@ int pow2frac[8] = {
  * Outputs:     dequantized samples in Q25 format
  *
  * Return:      bitwise-OR of the unsigned outputs (for guard bit calculations)
+ *
+ * Notes:       num must be > 0
  **************************************************************************************/
-static int DequantBlock(int *inbuf, int *outbuf, int num, int scale)
+int DequantBlockC(int *inbuf, int *outbuf, int num, int scale)
 {
 	int tab4[4];
 	int scalef, scalei, shift;
@@ -175,15 +209,10 @@ static int DequantBlock(int *inbuf, int *outbuf, int num, int scale)
 
 			} else {
 
-				/* normalize to [0x40000000, 0x7fffffff] */
+				/* normalize to [0x40000000, 0x7fffffff] (x < 2^14, so shift = 0-7) */
 				x <<= 17;
-				shift = 0;
-				if (x < 0x08000000)
-					x <<= 4, shift += 4;
-				if (x < 0x20000000)
-					x <<= 2, shift += 2;
-				if (x < 0x40000000)
-					x <<= 1, shift += 1;
+				shift = CLZ(x) - 1;
+				x <<= shift;
 
 				coef = (x < SQRTHALF) ? poly43lo : poly43hi;
 
@@ -221,6 +250,26 @@ static int DequantBlock(int *inbuf, int *outbuf, int num, int scale)
 	return mask;
 }
 
+/**************************************************************************************
+ * Function:    DequantBlock
+ *
+ * Description: run the version picked at startup (see InitKernels)
+ *
+ * Inputs:      see DequantBlockC
+ *
+ * Outputs:     see DequantBlockC
+ *
+ * Return:      see DequantBlockC
+ *
+ * Notes:       the SIMD versions look up the magnitudes below 64 in the same tables,
+ *                with the same multiplies and shifts, and hand anything larger to
+ *                DequantBlockC, so every choice gives bit-exact output
+ **************************************************************************************/
+static __inline int DequantBlock(int *inbuf, int *outbuf, int num, int scale)
+{
+	return kernelTab.DequantBlock(inbuf, outbuf, num, scale);
+}
+
 /**************************************************************************************
  * Function:    DequantChannel
  *
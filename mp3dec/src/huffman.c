@@ -41,6 +41,8 @@
  * huffman.c - Huffman decoding of transform coefficients
  **************************************************************************************/
 
+#include <string.h>
+
 #include "coder.h"
 
 /* helper macros - see comments in hufftabs.c about the format of the huffman tables */
@@ -56,8 +58,310 @@
 #define GetCWXQ(x)      ((int)( (((unsigned char)(x)) >> 1) & 0x01))
 #define GetCWYQ(x)      ((int)( (((unsigned char)(x)) >> 0) & 0x01))
 
-/* apply sign of s to the positive number x (save in MSB, will do two's complement in dequant) */
-#define ApplySign(x, s)	{ (x) |= ((s) & 0x80000000); }
+/* apply sign of s (the MSB of the 64-bit cache) to the positive number x (save in MSB, will do two's complement in dequant) */
+#define ApplySign(x, s)	{ (x) |= ((unsigned int)((s) >> 32) & 0x80000000); }
+
+/* the cache is 64 bits, left-justified (next bit to decode is the MSB), like BitStreamInfo.iCache
+ *   it's kept in locals here rather than in a BitStreamInfo so it can stay in registers
+ */
+typedef unsigned long long HuffCache;
+
+/**************************************************************************************
+ * Function:    RefillCache
+ *
+ * Description: top up the 64-bit bit cache with as many whole bytes as fit
+ *
+ * Inputs:      cache, number of valid bits in cache, number of bits left in the
+ *                bitstream (not counting the cache), read pointer
+ *              number of zero bits to pad with after the last valid bit
+ *
+ * Outputs:     updated cache, cachedBits, bitsLeft, buf
+ *
+ * Return:      0 if there is more data after the cache
+ *              padBits if the cache now holds the last valid bits (then zero padded)
+ *              -1 if there are no bits left
+ *
+ * Notes:       while at least 8 bytes are left, one unaligned 64-bit load refills the
+ *                cache to 57-64 bits; bits past cachedBits may then already be filled
+ *                in, but with the right values, so OR-ing them in again is harmless
+ *              the bytes past the end of the bitstream are never read
+ **************************************************************************************/
+static __inline int RefillCache(HuffCache *cache, int *cachedBits, int *bitsLeft, unsigned char **buf, int padBits)
+{
+	int nBytes;
+
+	if (*bitsLeft >= 64) {
+		/* load 8 bytes, keep the whole bytes that fit behind the cached bits */
+		*cache |= LoadBE64(*buf) >> *cachedBits;
+		nBytes = (64 - *cachedBits) >> 3;
+		*buf += nBytes;
+		*cachedBits += 8*nBytes;
+		*bitsLeft -= 8*nBytes;
+		return 0;
+	}
+
+	while (*bitsLeft > 0 && *cachedBits <= 56) {
+		*cache |= (HuffCache)(*(*buf)++) << (56 - *cachedBits);
+		*cachedBits += 8;
+		*bitsLeft -= 8;
+	}
+	if (*bitsLeft > 0)
+		return 0;
+
+	/* last time through, pad cache with zeros and drain cache */
+	if (*cachedBits + *bitsLeft <= 0)
+		return -1;
+	*cachedBits += *bitsLeft;
+	*bitsLeft = 0;
+
+	*cache &= ~(HuffCache)0 << (64 - *cachedBits);
+	*cachedBits += padBits;	/* okay if this is > 64 (0's automatically shifted in from right) */
+
+	return padBits;
+}
+
+/* for linbits escapes - make sure the cache holds at least minBits, see DecodeHuffmanPairs */
+static __inline int RefillEscape(HuffCache *cache, int *cachedBits, int *bitsLeft, unsigned char **buf, int minBits)
+{
+	if (*cachedBits + *bitsLeft < minBits)
+		return -1;
+	while (*cachedBits < minBits) {
+		*cache |= (HuffCache)(*(*buf)++) << (56 - *cachedBits);
+		*cachedBits += 8;
+		*bitsLeft -= 8;
+	}
+	if (*bitsLeft < 0) {
+		*cachedBits += *bitsLeft;
+		*bitsLeft = 0;
+		*cache &= ~(HuffCache)0 << (64 - *cachedBits);
+	}
+
+	return 0;
+}
+
+/* multi-symbol first-level tables, built at startup (see InitHuffTables)
+ *
+ * format of an entry, indexed by the next HUFF_MULTI_BITS bits of the stream
+ *  bits 0-3  = number of bits the codewords take, sign bits included
+ *  bits 4-6  = number of pairs (up to 4) or quads (up to 3), 0 if the first one does not
+ *                fit, then the regular tables decode it
+ *  bits 8-31 = the values, 3 bits each for pairs (2 bits magnitude, then the sign)
+ *                and 2 bits each for quads (1 bit magnitude, then the sign), in bitstream order
+ *
+ * only pairs with both values <= 3 go in, so linbits escapes never do
+ * quad table B has fixed 4-bit codewords, hardly two quads fit an entry, so only table A
+ *   has a multi-symbol table
+ * the entries are 0 (no pairs) until InitHuffTables runs (or for good, without GCC-style
+ *   constructors), so a decoder used before startup finishes still decodes every codeword
+ *   on its own
+ */
+#define HUFF_MULTI_BITS		10		/* <= 10, the fewest bits the decode loops keep in the cache */
+#define HUFF_MULTI_PAIRTABS	15		/* 16-23 and 24-31 share their codewords */
+#define HUFF_MULTI_PAIRS	4
+#define HUFF_MULTI_QUADS	3
+
+#define GetMultiLen(x)		((int)( ((x) >> 0) & 0x0f))
+#define GetMultiCount(x)	((int)( ((x) >> 4) & 0x07))
+
+#define GetMultiPair(x, n)	((int)( ((x) >> (8 + 6*(n))) & 0x3f))
+#define GetMultiQuad(x, n)	((int)( ((x) >> (8 + 8*(n))) & 0xff))
+
+/* index into pairMultiTab for each pair table, -1 if it has none */
+static const signed char pairMultiIdx[HUFF_PAIRTABS] = {
+	-1,  0,  1,  2, -1,  3,  4,  5,  6,  7,  8,  9, 10, 11, -1, 12,
+	13, 13, 13, 13, 13, 13, 13, 13, 14, 14, 14, 14, 14, 14, 14, 14,
+};
+
+static unsigned int pairMultiTab[HUFF_MULTI_PAIRTABS][1 << HUFF_MULTI_BITS];
+static unsigned int quadMultiTab[1 << HUFF_MULTI_BITS];
+
+/* the decoded values for the 6 bits of a pair or the 8 bits of a quad in an entry,
+ *   sign in the MSB like ApplySign, so each one is a single copy into the output
+ */
+static int pairMultiVals[1 << 6][2];
+static int quadMultiVals[1 << 8][4];
+
+#ifdef __GNUC__
+/**************************************************************************************
+ * Function:    PeekIndexBits
+ *
+ * Description: read bits from a HUFF_MULTI_BITS-bit index into a multi-symbol table
+ *
+ * Inputs:      index, left-justified in 32 bits
+ *              bit position to read from, number of bits to read (> 0)
+ *
+ * Outputs:     none
+ *
+ * Return:      the bits, zero past the end of the index (don't cares for any codeword
+ *                that ends inside it)
+ **************************************************************************************/
+static int PeekIndexBits(unsigned int window, int pos, int nBits)
+{
+	return (int)((window << pos) >> (32 - nBits));
+}
+
+/**************************************************************************************
+ * Function:    PeekPair
+ *
+ * Description: decode one pair with its sign bits from a multi-symbol table index, the
+ *                way DecodeHuffmanPairs does
+ *
+ * Inputs:      index, left-justified in 32 bits
+ *              bit position of the codeword
+ *              index of Huffman table to use
+ *
+ * Outputs:     the pair, 3 bits per value as in pairMultiTab
+ *
+ * Return:      bit position after the pair, 0 if it does not fit in the index or
+ *                a value is > 3
+ **************************************************************************************/
+static int PeekPair(unsigned int window, int pos, int tabIdx, unsigned int *pair)
+{
+	int x, y, len, maxBits;
+	unsigned short cw;
+	const unsigned short *tCurr = huffTable + huffTabOffset[tabIdx];
+
+	if (huffTabLookup[tabIdx].tabType == oneShot) {
+		cw = tCurr[PeekIndexBits(window, pos, GetMaxbits(tCurr[0])) + 1];
+	} else {
+		for (;;) {
+			maxBits = GetMaxbits(tCurr[0]);
+			cw = tCurr[PeekIndexBits(window, pos, maxBits) + 1];
+			if (GetHLen(cw))
+				break;
+			pos += maxBits;
+			if (pos >= HUFF_MULTI_BITS)
+				return 0;
+			tCurr += cw;
+		}
+	}
+
+	len = GetHLen(cw);
+	x = GetCWX(cw);
+	y = GetCWY(cw);
+	if (x > 3 || y > 3)
+		return 0;
+
+	pos += len + (x ? 1 : 0) + (y ? 1 : 0);
+	if (pos > HUFF_MULTI_BITS)
+		return 0;
+
+	*pair = x | (y << 3);
+	if (y)
+		*pair |= (unsigned int)PeekIndexBits(window, pos - 1, 1) << 5;
+	if (x)
+		*pair |= (unsigned int)PeekIndexBits(window, pos - (y ? 2 : 1), 1) << 2;
+
+	return pos;
+}
+
+/**************************************************************************************
+ * Function:    PeekQuad
+ *
+ * Description: decode one quad with its sign bits from a multi-symbol table index, the
+ *                way DecodeHuffmanQuads does
+ *
+ * Inputs:      index, left-justified in 32 bits
+ *              bit position of the codeword
+ *              index of quadword table
+ *
+ * Outputs:     the quad, 2 bits per value as in quadMultiTab
+ *
+ * Return:      bit position after the quad, 0 if it does not fit in the index
+ **************************************************************************************/
+static int PeekQuad(unsigned int window, int pos, int tabIdx, unsigned int *quad)
+{
+	int i, vals[4];
+	unsigned char cw;
+
+	cw = quadTable[quadTabOffset[tabIdx] + PeekIndexBits(window, pos, quadTabMaxBits[tabIdx])];
+	pos += GetHLenQ(cw);
+
+	vals[0] = GetCWVQ(cw);
+	vals[1] = GetCWWQ(cw);
+	vals[2] = GetCWXQ(cw);
+	vals[3] = GetCWYQ(cw);
+
+	*quad = 0;
+	for (i = 0; i < 4; i++) {
+		if (!vals[i])
+			continue;
+		if (pos >= HUFF_MULTI_BITS)
+			return 0;
+		*quad |= (1U | ((unsigned int)PeekIndexBits(window, pos, 1) << 1)) << (2*i);
+		pos++;
+	}
+
+	return pos <= HUFF_MULTI_BITS ? pos : 0;
+}
+
+/**************************************************************************************
+ * Function:    InitHuffTables
+ *
+ * Description: build the multi-symbol tables from huffTable and quadTable
+ *
+ * Inputs:      none
+ *
+ * Outputs:     pairMultiTab, quadMultiTab, pairMultiVals, quadMultiVals
+ *
+ * Return:      none
+ *
+ * Notes:       runs once, before main(), so decoders on any thread only read the tables
+ **************************************************************************************/
+static void __attribute__((constructor)) InitHuffTables(void)
+{
+	int tabIdx, n, pos, next;
+	unsigned int index, window, entry, vals;
+
+	for (index = 0; index < (1U << 6); index++) {
+		for (n = 0; n < 2; n++) {
+			vals = index >> (3*n);
+			pairMultiVals[index][n] = (int)((vals & 0x03) | ((vals & 0x04) << 29));
+		}
+	}
+
+	for (index = 0; index < (1U << 8); index++) {
+		for (n = 0; n < 4; n++) {
+			vals = index >> (2*n);
+			quadMultiVals[index][n] = (int)((vals & 0x01) | ((vals & 0x02) << 30));
+		}
+	}
+
+	for (tabIdx = 0; tabIdx < HUFF_PAIRTABS; tabIdx++) {
+		/* tables sharing their codewords share the multi-symbol table too */
+		if (pairMultiIdx[tabIdx] < 0 || (tabIdx > 0 && pairMultiIdx[tabIdx] == pairMultiIdx[tabIdx - 1]))
+			continue;
+
+		for (index = 0; index < (1U << HUFF_MULTI_BITS); index++) {
+			window = index << (32 - HUFF_MULTI_BITS);
+			entry = 0;
+			pos = 0;
+			for (n = 0; n < HUFF_MULTI_PAIRS && pos < HUFF_MULTI_BITS; n++) {
+				next = PeekPair(window, pos, tabIdx, &vals);
+				if (!next)
+					break;
+				entry |= vals << (8 + 6*n);
+				pos = next;
+			}
+			pairMultiTab[(int)pairMultiIdx[tabIdx]][index] = n ? (entry | pos | (n << 4)) : 0;
+		}
+	}
+
+	for (index = 0; index < (1U << HUFF_MULTI_BITS); index++) {
+		window = index << (32 - HUFF_MULTI_BITS);
+		entry = 0;
+		pos = 0;
+		for (n = 0; n < HUFF_MULTI_QUADS && pos < HUFF_MULTI_BITS; n++) {
+			next = PeekQuad(window, pos, 0, &vals);
+			if (!next)
+				break;
+			entry |= vals << (8 + 8*n);
+			pos = next;
+		}
+		quadMultiTab[index] = n ? (entry | pos | (n << 4)) : 0;
+	}
+}
+#endif
 
 /**************************************************************************************
  * Function:    DecodeHuffmanPairs
@@ -78,15 +382,21 @@
  * Notes:       assumes that nVals is an even number
  *              si_huff.bit tests every Huffman codeword in every table (though not
  *                necessarily all linBits outputs for x,y > 15)
+ *              each refill of the 64-bit cache is good for several codewords
+ *                (up to 5 pairs with their sign bits from the one-shot tables)
+ *              short pairs come up to 4 at a time from pairMultiTab, which always writes
+ *                4 pairs and keeps the decoded ones, so it only runs with 4 pairs to go
  **************************************************************************************/
 // no improvement with section=data
 static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsigned char *buf, int bitOffset)
 {
 	int i, x, y;
-	int cachedBits, padBits, len, startBits, linBits, maxBits, minBits;
+	int cachedBits, padBits, len, startBits, linBits, maxBits;
 	HuffTabType tabType;
 	unsigned short cw, *tBase, *tCurr;
-	unsigned int cache;
+	unsigned int mcw;
+	const unsigned int *mTab;
+	HuffCache cache;
 
 	if(nVals <= 0) 
 		return 0;
@@ -98,6 +408,7 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 	tBase = (unsigned short *)(huffTable + huffTabOffset[tabIdx]);
 	linBits = huffTabLookup[tabIdx].linBits;
 	tabType = huffTabLookup[tabIdx].tabType;
+	mTab = (pairMultiIdx[tabIdx] >= 0) ? pairMultiTab[(int)pairMultiIdx[tabIdx]] : 0;
 
 	ASSERT(!(nVals & 0x01));
 	ASSERT(tabIdx < HUFF_PAIRTABS);
@@ -108,7 +419,7 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 	cache = 0;
 	cachedBits = (8 - bitOffset) & 0x07;
 	if (cachedBits)
-		cache = (unsigned int)(*buf++) << (32 - cachedBits);
+		cache = (HuffCache)(*buf++) << (64 - cachedBits);
 	bitsLeft -= cachedBits;
 
 	if (tabType == noBits) {
@@ -124,29 +435,33 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 		tBase++;
 		padBits = 0;
 		while (nVals > 0) {
-			/* refill cache - assumes cachedBits <= 16 */
-			if (bitsLeft >= 16) {
-				/* load 2 new bytes into left-justified cache */
-				cache |= (unsigned int)(*buf++) << (24 - cachedBits);
-				cache |= (unsigned int)(*buf++) << (16 - cachedBits);
-				cachedBits += 16;
-				bitsLeft -= 16;
-			} else {
-				/* last time through, pad cache with zeros and drain cache */
-				if (cachedBits + bitsLeft <= 0)	return -1;
-				if (bitsLeft > 0)	cache |= (unsigned int)(*buf++) << (24 - cachedBits);
-				if (bitsLeft > 8)	cache |= (unsigned int)(*buf++) << (16 - cachedBits);
-				cachedBits += bitsLeft;
-				bitsLeft = 0;
-
-				cache &= (signed int)0x80000000 >> (cachedBits - 1);
-				padBits = 11;
-				cachedBits += padBits;	/* okay if this is > 32 (0's automatically shifted in from right) */
-			}
+			/* refill cache - assumes cachedBits <= 10 */
+			padBits = RefillCache(&cache, &cachedBits, &bitsLeft, &buf, 11);
+			if (padBits < 0)
+				return -1;
 
 			/* largest maxBits = 9, plus 2 for sign bits, so make sure cache has at least 11 bits */
 			while (nVals > 0 && cachedBits >= 11 ) {
-				cw = tBase[cache >> (32 - maxBits)];
+				/* up to 4 short pairs in one lookup, as long as they leave the padding alone */
+				if (nVals >= 2*HUFF_MULTI_PAIRS) {
+					mcw = mTab[cache >> (64 - HUFF_MULTI_BITS)];
+					len = GetMultiLen(mcw);
+					if (GetMultiCount(mcw) && cachedBits - len >= padBits) {
+						cachedBits -= len;
+						cache <<= len;
+
+						memcpy(xy + 0, pairMultiVals[GetMultiPair(mcw, 0)], sizeof(pairMultiVals[0]));
+						memcpy(xy + 2, pairMultiVals[GetMultiPair(mcw, 1)], sizeof(pairMultiVals[0]));
+						memcpy(xy + 4, pairMultiVals[GetMultiPair(mcw, 2)], sizeof(pairMultiVals[0]));
+						memcpy(xy + 6, pairMultiVals[GetMultiPair(mcw, 3)], sizeof(pairMultiVals[0]));
+
+						xy += 2*GetMultiCount(mcw);
+						nVals -= 2*GetMultiCount(mcw);
+						continue;
+					}
+				}
+
+				cw = tBase[cache >> (64 - maxBits)];
 				len = GetHLen(cw);
 				cachedBits -= len;
 				cache <<= len;
@@ -169,30 +484,34 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 		tCurr = tBase;
 		padBits = 0;
 		while (nVals > 0) {
-			/* refill cache - assumes cachedBits <= 16 */
-			if (bitsLeft >= 16) {
-				/* load 2 new bytes into left-justified cache */
-				cache |= (unsigned int)(*buf++) << (24 - cachedBits);
-				cache |= (unsigned int)(*buf++) << (16 - cachedBits);
-				cachedBits += 16;
-				bitsLeft -= 16;
-			} else {
-				/* last time through, pad cache with zeros and drain cache */
-				if (cachedBits + bitsLeft <= 0)	return -1;
-				if (bitsLeft > 0)	cache |= (unsigned int)(*buf++) << (24 - cachedBits);
-				if (bitsLeft > 8)	cache |= (unsigned int)(*buf++) << (16 - cachedBits);
-				cachedBits += bitsLeft;
-				bitsLeft = 0;
-
-				cache &= (signed int)0x80000000 >> (cachedBits - 1);
-				padBits = 11;
-				cachedBits += padBits;	/* okay if this is > 32 (0's automatically shifted in from right) */
-			}
+			/* refill cache - assumes cachedBits <= 10 */
+			padBits = RefillCache(&cache, &cachedBits, &bitsLeft, &buf, 11);
+			if (padBits < 0)
+				return -1;
 
 			/* largest maxBits = 9, plus 2 for sign bits, so make sure cache has at least 11 bits */
 			while (nVals > 0 && cachedBits >= 11 ) {
+				/* up to 4 short pairs in one lookup, as long as they leave the padding alone */
+				if (tCurr == tBase && nVals >= 2*HUFF_MULTI_PAIRS) {
+					mcw = mTab[cache >> (64 - HUFF_MULTI_BITS)];
+					len = GetMultiLen(mcw);
+					if (GetMultiCount(mcw) && cachedBits - len >= padBits) {
+						cachedBits -= len;
+						cache <<= len;
+
+						memcpy(xy + 0, pairMultiVals[GetMultiPair(mcw, 0)], sizeof(pairMultiVals[0]));
+						memcpy(xy + 2, pairMultiVals[GetMultiPair(mcw, 1)], sizeof(pairMultiVals[0]));
+						memcpy(xy + 4, pairMultiVals[GetMultiPair(mcw, 2)], sizeof(pairMultiVals[0]));
+						memcpy(xy + 6, pairMultiVals[GetMultiPair(mcw, 3)], sizeof(pairMultiVals[0]));
+
+						xy += 2*GetMultiCount(mcw);
+						nVals -= 2*GetMultiCount(mcw);
+						continue;
+					}
+				}
+
 				maxBits = GetMaxbits(tCurr[0]);
-				cw = tCurr[(cache >> (32 - maxBits)) + 1];
+				cw = tCurr[(cache >> (64 - maxBits)) + 1];
 				len = GetHLen(cw);
 				if (!len) {
 					cachedBits -= maxBits;
@@ -207,40 +526,18 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
 				y = GetCWY(cw);
 
 				if (x == 15 && tabType == loopLinbits) {
-					minBits = linBits + 1 + (y ? 1 : 0);
-					if (cachedBits + bitsLeft < minBits)
+					if (RefillEscape(&cache, &cachedBits, &bitsLeft, &buf, linBits + 1 + (y ? 1 : 0)) < 0)
 						return -1;
-					while (cachedBits < minBits) {
-						cache |= (unsigned int)(*buf++) << (24 - cachedBits);
-						cachedBits += 8;
-						bitsLeft -= 8;
-					}
-					if (bitsLeft < 0) {
-						cachedBits += bitsLeft;
-						bitsLeft = 0;
-						cache &= (signed int)0x80000000 >> (cachedBits - 1);
-					}
-					x += (int)(cache >> (32 - linBits));
+					x += (int)(cache >> (64 - linBits));
 					cachedBits -= linBits;
 					cache <<= linBits;
 				}
 				if (x)	{ApplySign(x, cache); cache <<= 1; cachedBits--;}
 
 				if (y == 15 && tabType == loopLinbits) {
-					minBits = linBits + 1;
-					if (cachedBits + bitsLeft < minBits)
+					if (RefillEscape(&cache, &cachedBits, &bitsLeft, &buf, linBits + 1) < 0)
 						return -1;
-					while (cachedBits < minBits) {
-						cache |= (unsigned int)(*buf++) << (24 - cachedBits);
-						cachedBits += 8;
-						bitsLeft -= 8;
-					}
-					if (bitsLeft < 0) {
-						cachedBits += bitsLeft;
-						bitsLeft = 0;
-						cache &= (signed int)0x80000000 >> (cachedBits - 1);
-					}
-					y += (int)(cache >> (32 - linBits));
+					y += (int)(cache >> (64 - linBits));
 					cachedBits -= linBits;
 					cache <<= linBits;
 				}
@@ -282,53 +579,62 @@ static int DecodeHuffmanPairs(int *xy, int nVals, int tabIdx, int bitsLeft, unsi
  *                of the quad word after which all samples are 0)
  * 
  * Notes:        si_huff.bit tests every vwxy output in both quad tables
+ *               short quads from table A come up to 3 at a time from quadMultiTab, which
+ *                 always writes 3 quads and keeps the decoded ones, so it only runs with
+ *                 3 quads to go
  **************************************************************************************/
 // no improvement with section=data
 static int DecodeHuffmanQuads(int *vwxy, int nVals, int tabIdx, int bitsLeft, unsigned char *buf, int bitOffset)
 {
 	int i, v, w, x, y;
 	int len, maxBits, cachedBits, padBits;
-	unsigned int cache;
+	HuffCache cache;
 	unsigned char cw, *tBase;
+	unsigned int mcw;
+	const unsigned int *mTab;
 
 	if (bitsLeft <= 0)
 		return 0;
 
 	tBase = (unsigned char *)quadTable + quadTabOffset[tabIdx];
 	maxBits = quadTabMaxBits[tabIdx];
+	mTab = (tabIdx == 0) ? quadMultiTab : 0;
 
 	/* initially fill cache with any partial byte */
 	cache = 0;
 	cachedBits = (8 - bitOffset) & 0x07;
 	if (cachedBits)
-		cache = (unsigned int)(*buf++) << (32 - cachedBits);
+		cache = (HuffCache)(*buf++) << (64 - cachedBits);
 	bitsLeft -= cachedBits;
 
 	i = padBits = 0;
 	while (i < (nVals - 3)) {
-		/* refill cache - assumes cachedBits <= 16 */
-		if (bitsLeft >= 16) {
-			/* load 2 new bytes into left-justified cache */
-			cache |= (unsigned int)(*buf++) << (24 - cachedBits);
-			cache |= (unsigned int)(*buf++) << (16 - cachedBits);
-			cachedBits += 16;
-			bitsLeft -= 16;
-		} else {
-			/* last time through, pad cache with zeros and drain cache */
-			if (cachedBits + bitsLeft <= 0) return i;
-			if (bitsLeft > 0)	cache |= (unsigned int)(*buf++) << (24 - cachedBits);
-			if (bitsLeft > 8)	cache |= (unsigned int)(*buf++) << (16 - cachedBits);
-			cachedBits += bitsLeft;
-			bitsLeft = 0;
-
-			cache &= (signed int)0x80000000 >> (cachedBits - 1);
-			padBits = 10;
-			cachedBits += padBits;	/* okay if this is > 32 (0's automatically shifted in from right) */
-		}
+		/* refill cache - assumes cachedBits <= 9 */
+		padBits = RefillCache(&cache, &cachedBits, &bitsLeft, &buf, 10);
+		if (padBits < 0)
+			return i;
 
 		/* largest maxBits = 6, plus 4 for sign bits, so make sure cache has at least 10 bits */
 		while (i < (nVals - 3) && cachedBits >= 10 ) {
-			cw = tBase[cache >> (32 - maxBits)];
+			/* up to 3 short quads in one lookup, as long as they leave the padding alone */
+			if (mTab && i + 4*HUFF_MULTI_QUADS <= nVals) {
+				mcw = mTab[cache >> (64 - HUFF_MULTI_BITS)];
+				len = GetMultiLen(mcw);
+				if (GetMultiCount(mcw) && cachedBits - len >= padBits) {
+					cachedBits -= len;
+					cache <<= len;
+
+					memcpy(vwxy + 0, quadMultiVals[GetMultiQuad(mcw, 0)], sizeof(quadMultiVals[0]));
+					memcpy(vwxy + 4, quadMultiVals[GetMultiQuad(mcw, 1)], sizeof(quadMultiVals[0]));
+					memcpy(vwxy + 8, quadMultiVals[GetMultiQuad(mcw, 2)], sizeof(quadMultiVals[0]));
+
+					vwxy += 4*GetMultiCount(mcw);
+					i += 4*GetMultiCount(mcw);
+					continue;
+				}
+			}
+
+			cw = tBase[cache >> (64 - maxBits)];
 			len = GetHLenQ(cw);
 			cachedBits -= len;
 			cache <<= len;
@@ -46,7 +46,7 @@
 #include "assembly.h"
 
 /**************************************************************************************
- * Function:    AntiAlias
+ * Function:    AntiAliasC
  *
  * Description: smooth transition across DCT block boundaries (every 18 coefficients)
  *
@@ -70,7 +70,7 @@
  *                 gain from AntiAlias < 2.0)
  **************************************************************************************/
 // a little bit faster in RAM (< 1 ms per block)
-static void AntiAlias(int *x, int nBfly)
+void AntiAliasC(int *x, int nBfly)
 {
 	int k, a0, b0, c0, c1;
 	const int *c;
@@ -595,6 +595,78 @@ static int IMDCT12x3(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, i
 	return mOut;
 }
 
+/**************************************************************************************
+ * Function:    IMDCT36x4C, IMDCT12x3x4C
+ *
+ * Description: IMDCT36 or IMDCT12x3 on four consecutive blocks which use the same
+ *                window types
+ *
+ * Inputs:      see IMDCT36, IMDCT12x3 (for the first of the four blocks)
+ *
+ * Outputs:     see IMDCT36, IMDCT12x3
+ *
+ * Return:      mOut (OR of abs(y) for all y calculated here)
+ *
+ * Notes:       reference for the SIMD versions, which process the four blocks in
+ *                lockstep (one block per vector lane)
+ **************************************************************************************/
+int IMDCT36x4C(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb)
+{
+	int i, mOut;
+
+	mOut = 0;
+	for (i = 0; i < 4; i++)
+		mOut |= IMDCT36(xCurr + 18*i, xPrev + 9*i, y + i, btCurr, btPrev, blockIdx + i, gb);
+
+	return mOut;
+}
+
+int IMDCT12x3x4C(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb)
+{
+	int i, mOut;
+
+	mOut = 0;
+	for (i = 0; i < 4; i++)
+		mOut |= IMDCT12x3(xCurr + 18*i, xPrev + 9*i, y + i, btPrev, blockIdx + i, gb);
+
+	return mOut;
+}
+
+/**************************************************************************************
+ * Function:    AntiAlias, IMDCT36x4, IMDCT12x3x4
+ *
+ * Description: run the version picked at startup (see InitKernels)
+ *
+ * Inputs:      see AntiAliasC, IMDCT36x4C, IMDCT12x3x4C
+ *
+ * Outputs:     see AntiAliasC, IMDCT36x4C, IMDCT12x3x4C
+ *
+ * Return:      see AntiAliasC, IMDCT36x4C, IMDCT12x3x4C
+ *
+ * Notes:       the SIMD versions use the same 32x32 -> top 32 bit multiplies and shifts,
+ *                so every choice gives bit-exact output
+ **************************************************************************************/
+static __inline void AntiAlias(int *x, int nBfly)
+{
+	kernelTab.AntiAlias(x, nBfly);
+}
+
+static __inline int IMDCT36x4(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb)
+{
+	return kernelTab.IMDCT36x4(xCurr, xPrev, y, btCurr, btPrev, blockIdx, gb);
+}
+
+static __inline int IMDCT12x3x4(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb)
+{
+	return kernelTab.IMDCT12x3x4(xCurr, xPrev, y, btPrev, blockIdx, gb);
+}
+
+/* nonzero if blocks i ... i+3 would not all be on the same side of a window switch */
+static __inline int WinSwitchWithin4(int i, int winSwitch)
+{
+	return (i < winSwitch && i + 3 >= winSwitch);
+}
+
 /**************************************************************************************
  * Function:    HybridTransform
  *
@@ -631,8 +703,10 @@ static int HybridTransform(int *xCurr, int *xPrev, int y[BLOCK_SIZE][NBANDS], Si
 
 	mOut = 0;
 
-	/* do long blocks, if any */
-	for(i = 0; i < bc->nBlocksLong; i++) {
+	/* do long blocks, if any
+	 *   four at a time while the window types do not switch within the four
+	 */
+	for (i = 0; i < bc->nBlocksLong; ) {
 		/* currWinIdx picks the right window for long blocks (if mixed, long blocks use window type 0) */
 		currWinIdx = sis->blockType;
 		if (sis->mixedBlock && i < bc->currWinSwitch) 
@@ -643,22 +717,38 @@ static int HybridTransform(int *xCurr, int *xPrev, int y[BLOCK_SIZE][NBANDS], Si
 			 prevWinIdx = 0;
 
 		/* do 36-point IMDCT, including windowing and overlap-add */
-		mOut |= IMDCT36(xCurr, xPrev, &(y[0][i]), currWinIdx, prevWinIdx, i, bc->gbIn);
-		xCurr += 18;
-		xPrev += 9;
+		if (i + 4 <= bc->nBlocksLong && !WinSwitchWithin4(i, bc->currWinSwitch) && !WinSwitchWithin4(i, bc->prevWinSwitch)) {
+			mOut |= IMDCT36x4(xCurr, xPrev, &(y[0][i]), currWinIdx, prevWinIdx, i, bc->gbIn);
+			xCurr += 4*18;
+			xPrev += 4*9;
+			i += 4;
+		} else {
+			mOut |= IMDCT36(xCurr, xPrev, &(y[0][i]), currWinIdx, prevWinIdx, i, bc->gbIn);
+			xCurr += 18;
+			xPrev += 9;
+			i++;
+		}
 	}
 
 	/* do short blocks (if any) */
-	for (   ; i < bc->nBlocksTotal; i++) {
+	for (   ; i < bc->nBlocksTotal; ) {
 		ASSERT(sis->blockType == 2);
 
 		prevWinIdx = bc->prevType;
 		if (i < bc->prevWinSwitch)
 			 prevWinIdx = 0;
 		
-		mOut |= IMDCT12x3(xCurr, xPrev, &(y[0][i]), prevWinIdx, i, bc->gbIn);
-		xCurr += 18;
-		xPrev += 9;
+		if (i + 4 <= bc->nBlocksTotal && !WinSwitchWithin4(i, bc->prevWinSwitch)) {
+			mOut |= IMDCT12x3x4(xCurr, xPrev, &(y[0][i]), prevWinIdx, i, bc->gbIn);
+			xCurr += 4*18;
+			xPrev += 4*9;
+			i += 4;
+		} else {
+			mOut |= IMDCT12x3(xCurr, xPrev, &(y[0][i]), prevWinIdx, i, bc->gbIn);
+			xCurr += 18;
+			xPrev += 9;
+			i++;
+		}
 	}
 	nBlocksOut = i;
 	
@@ -712,7 +802,7 @@ static int HybridTransform(int *xCurr, int *xPrev, int y[BLOCK_SIZE][NBANDS], Si
  *                includes PCM samples in overBuf (from last call to IMDCT) for OLA
  *              index of current granule and channel
  *
- * Outputs:     PCM samples in outBuf, for input to subband transform
+ * Outputs:     PCM samples in outBuf (IMDCTOutInfo), for input to subband transform
  *              PCM samples in overBuf, for OLA next time
  *              updated hi->nonZeroBound index for this channel
  *
@@ -726,11 +816,12 @@ int IMDCT(MP3DecInfo *mp3DecInfo, int gr, int ch)
 	SideInfo *si;
 	HuffmanInfo *hi;
 	IMDCTInfo *mi;
+	IMDCTOutInfo *mo;
 	BlockCount bc;
 
 	/* validate pointers */
 	if (!mp3DecInfo || !mp3DecInfo->FrameHeaderPS || !mp3DecInfo->SideInfoPS || 
-		!mp3DecInfo->HuffmanInfoPS || !mp3DecInfo->IMDCTInfoPS)
+		!mp3DecInfo->HuffmanInfoPS || !mp3DecInfo->IMDCTInfoPS || !mp3DecInfo->IMDCTOutInfoPS)
 		return -1;
 
 	/* si is an array of up to 4 structs, stored as gr0ch0, gr0ch1, gr1ch0, gr1ch1 */
@@ -738,6 +829,7 @@ int IMDCT(MP3DecInfo *mp3DecInfo, int gr, int ch)
 	si = (SideInfo *)(mp3DecInfo->SideInfoPS);
 	hi = (HuffmanInfo*)(mp3DecInfo->HuffmanInfoPS);
 	mi = (IMDCTInfo *)(mp3DecInfo->IMDCTInfoPS);
+	mo = (IMDCTOutInfo *)(mp3DecInfo->IMDCTOutInfoPS);
 
 	/* anti-aliasing done on whole long blocks only
 	 * for mixed blocks, nBfly always 1, except 3 for 8 kHz MPEG 2.5 (see sfBandTab) 
@@ -772,10 +864,10 @@ int IMDCT(MP3DecInfo *mp3DecInfo, int gr, int ch)
 	bc.currWinSwitch = (si->sis[gr][ch].mixedBlock ? blockCutoff : 0);	/* where WINDOW switches (not nec. transform) */
 	bc.gbIn = hi->gb[ch];
 
-	mi->numPrevIMDCT[ch] = HybridTransform(hi->huffDecBuf[ch], mi->overBuf[ch], mi->outBuf[ch], &si->sis[gr][ch], &bc);
+	mi->numPrevIMDCT[ch] = HybridTransform(hi->huffDecBuf[ch], mi->overBuf[ch], mo->outBuf[ch], &si->sis[gr][ch], &bc);
 	mi->prevType[ch] = si->sis[gr][ch].blockType;
 	mi->prevWinSwitch[ch] = bc.currWinSwitch;		/* 0 means not a mixed block (either all short or all long) */
-	mi->gb[ch] = bc.gbOut;
+	mo->gb[ch] = bc.gbOut;
 
 	ASSERT(mi->numPrevIMDCT[ch] <= NBANDS);
 
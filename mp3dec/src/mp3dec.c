@@ -195,49 +195,55 @@ int MP3GetNextFrameInfo(HMP3Decoder hMP3Decoder, MP3FrameInfo *mp3FrameInfo, uns
  * Description: zero out pcm buffer if error decoding MP3 frame
  *
  * Inputs:      mp3DecInfo struct with correct frame size parameters filled in
- *              pointer pcm output buffer
+ *              pointers to pcm output buffers (only outbuf[0] is used if interleaved)
+ *              flag indicating whether output is planar (one buffer per channel)
  *
- * Outputs:     zeroed out pcm buffer
+ * Outputs:     zeroed out pcm buffer(s)
  *
  * Return:      none
  **************************************************************************************/
-static void MP3ClearBadFrame(MP3DecInfo *mp3DecInfo, short *outbuf)
+static void MP3ClearBadFrame(MP3DecInfo *mp3DecInfo, short *outbuf[MAX_NCHAN], int planar)
 {
-	int i;
+	int i, ch, nSamps;
 
 	if (!mp3DecInfo)
 		return;
 
-	for (i = 0; i < mp3DecInfo->nGrans * mp3DecInfo->nGranSamps * mp3DecInfo->nChans; i++)
-		outbuf[i] = 0;
+	nSamps = mp3DecInfo->nGrans * mp3DecInfo->nGranSamps;
+
+	if (planar) {
+		for (ch = 0; ch < mp3DecInfo->nChans; ch++)
+			for (i = 0; i < nSamps; i++)
+				outbuf[ch][i] = 0;
+	} else {
+		for (i = 0; i < nSamps * mp3DecInfo->nChans; i++)
+			outbuf[0][i] = 0;
+	}
 }
 
 /**************************************************************************************
- * Function:    MP3Decode
+ * Function:    MP3DecodeFrame
  *
- * Description: decode one frame of MP3 data
+ * Description: decode one frame of MP3 data, common part of MP3Decode and MP3DecodePlanar
  *
  * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
  *              double pointer to buffer of MP3 data (containing headers + mainData)
  *              number of valid bytes remaining in inbuf
- *              pointer to outbuf, big enough to hold one frame of decoded PCM samples
+ *              pointers to output buffers (only outbuf[0] is used if interleaved)
+ *              flag indicating whether output is planar (one buffer per channel)
  *              flag indicating whether MP3 data is normal MPEG format (useSize = 0)
  *                or reformatted as "self-contained" frames (useSize = 1)
  *
- * Outputs:     PCM data in outbuf, interleaved LRLRLR... if stereo
- *                number of output samples = nGrans * nGranSamps * nChans
- *              updated inbuf pointer, updated bytesLeft
+ * Outputs:     see MP3Decode and MP3DecodePlanar
  *
  * Return:      error code, defined in mp3dec.h (0 means no error, < 0 means error)
- *
- * Notes:       switching useSize on and off between frames in the same stream
- *                is not supported (bit reservoir is not maintained if useSize on)
  **************************************************************************************/
-int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, short *outbuf, int useSize)
+static int MP3DecodeFrame(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, short *outbuf[MAX_NCHAN], int planar, int useSize)
 {
 	int offset, bitOffset, mainBits, gr, ch, fhBytes, siBytes, freeFrameBytes;
 	int prevBitOffset, sfBlockBits, huffBlockBits;
 	unsigned char *mainPtr;
+	short *pcmBuf[MAX_NCHAN];
 	MP3DecInfo *mp3DecInfo = (MP3DecInfo *)hMP3Decoder;
 
 	if (!mp3DecInfo)
@@ -252,7 +258,7 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 	/* unpack side info */
 	siBytes = UnpackSideInfo(mp3DecInfo, *inbuf);
 	if (siBytes < 0) {
-		MP3ClearBadFrame(mp3DecInfo, outbuf);
+		MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
 		return ERR_MP3_INVALID_SIDEINFO;
 	}
 	*inbuf += siBytes;
@@ -265,7 +271,7 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 			mp3DecInfo->freeBitrateFlag = 1;
 			mp3DecInfo->freeBitrateSlots = MP3FindFreeSync(*inbuf, *inbuf - fhBytes - siBytes, *bytesLeft);
 			if (mp3DecInfo->freeBitrateSlots < 0) {
-				MP3ClearBadFrame(mp3DecInfo, outbuf);
+				MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
 				return ERR_MP3_FREE_BITRATE_SYNC;
 			}
 			freeFrameBytes = mp3DecInfo->freeBitrateSlots + fhBytes + siBytes;
@@ -284,7 +290,7 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 		mp3DecInfo->nSlots = *bytesLeft;
 		if (mp3DecInfo->mainDataBegin != 0 || mp3DecInfo->nSlots <= 0) {
 			/* error - non self-contained frame, or missing frame (size <= 0), could do loss concealment here */
-			MP3ClearBadFrame(mp3DecInfo, outbuf);
+			MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
 			return ERR_MP3_INVALID_FRAMEHEADER;
 		}
 
@@ -296,7 +302,7 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 	} else {
 		/* out of data - assume last or truncated frame */
 		if (mp3DecInfo->nSlots > *bytesLeft) {
-			MP3ClearBadFrame(mp3DecInfo, outbuf);
+			MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
 			return ERR_MP3_INDATA_UNDERFLOW;
 		}
 		/* fill main data buffer with enough new data for this frame */
@@ -315,7 +321,7 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 			mp3DecInfo->mainDataBytes += mp3DecInfo->nSlots;
 			*inbuf += mp3DecInfo->nSlots;
 			*bytesLeft -= (mp3DecInfo->nSlots);
-			MP3ClearBadFrame(mp3DecInfo, outbuf);
+			MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
 			return ERR_MP3_MAINDATA_UNDERFLOW;
 		}
 	}
@@ -335,7 +341,7 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 			mainBits -= sfBlockBits;
 
 			if (offset < 0 || mainBits < huffBlockBits) {
-				MP3ClearBadFrame(mp3DecInfo, outbuf);
+				MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
 				return ERR_MP3_INVALID_SCALEFACT;
 			}
 
@@ -343,7 +349,7 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 			prevBitOffset = bitOffset;
 			offset = DecodeHuffman(mp3DecInfo, mainPtr, &bitOffset, huffBlockBits, gr, ch);
 			if (offset < 0) {
-				MP3ClearBadFrame(mp3DecInfo, outbuf);
+				MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
 				return ERR_MP3_INVALID_HUFFCODES;
 			}
 
@@ -352,22 +358,90 @@ int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, sh
 		}
 		/* dequantize coefficients, decode stereo, reorder short blocks */
 		if (Dequantize(mp3DecInfo, gr) < 0) {
-			MP3ClearBadFrame(mp3DecInfo, outbuf);
+			MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
 			return ERR_MP3_INVALID_DEQUANTIZE;
 		}
 
 		/* alias reduction, inverse MDCT, overlap-add, frequency inversion */
 		for (ch = 0; ch < mp3DecInfo->nChans; ch++)
 			if (IMDCT(mp3DecInfo, gr, ch) < 0) {
-				MP3ClearBadFrame(mp3DecInfo, outbuf);
+				MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
 				return ERR_MP3_INVALID_IMDCT;
 			}
 
-		/* subband transform - if stereo, interleaves pcm LRLRLR */
-		if (Subband(mp3DecInfo, outbuf + gr*mp3DecInfo->nGranSamps*mp3DecInfo->nChans) < 0) {
-			MP3ClearBadFrame(mp3DecInfo, outbuf);
-			return ERR_MP3_INVALID_SUBBAND;
+		/* subband transform - if stereo, interleaves pcm LRLRLR unless planar output requested */
+		if (planar) {
+			for (ch = 0; ch < mp3DecInfo->nChans; ch++)
+				pcmBuf[ch] = outbuf[ch] + gr*mp3DecInfo->nGranSamps;
+
+			if (SubbandPlanar(mp3DecInfo, pcmBuf) < 0) {
+				MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
+				return ERR_MP3_INVALID_SUBBAND;
+			}
+		} else {
+			if (Subband(mp3DecInfo, outbuf[0] + gr*mp3DecInfo->nGranSamps*mp3DecInfo->nChans) < 0) {
+				MP3ClearBadFrame(mp3DecInfo, outbuf, planar);
+				return ERR_MP3_INVALID_SUBBAND;
+			}
 		}
 	}
 	return ERR_MP3_NONE;
 }
+
+/**************************************************************************************
+ * Function:    MP3Decode
+ *
+ * Description: decode one frame of MP3 data
+ *
+ * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
+ *              double pointer to buffer of MP3 data (containing headers + mainData)
+ *              number of valid bytes remaining in inbuf
+ *              pointer to outbuf, big enough to hold one frame of decoded PCM samples
+ *              flag indicating whether MP3 data is normal MPEG format (useSize = 0)
+ *                or reformatted as "self-contained" frames (useSize = 1)
+ *
+ * Outputs:     PCM data in outbuf, interleaved LRLRLR... if stereo
+ *                number of output samples = nGrans * nGranSamps * nChans
+ *              updated inbuf pointer, updated bytesLeft
+ *
+ * Return:      error code, defined in mp3dec.h (0 means no error, < 0 means error)
+ *
+ * Notes:       switching useSize on and off between frames in the same stream
+ *                is not supported (bit reservoir is not maintained if useSize on)
+ **************************************************************************************/
+int MP3Decode(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, short *outbuf, int useSize)
+{
+	short *pcmBuf[MAX_NCHAN];
+	int ch;
+
+	for (ch = 0; ch < MAX_NCHAN; ch++)
+		pcmBuf[ch] = outbuf;
+
+	return MP3DecodeFrame(hMP3Decoder, inbuf, bytesLeft, pcmBuf, 0, useSize);
+}
+
+/**************************************************************************************
+ * Function:    MP3DecodePlanar
+ *
+ * Description: decode one frame of MP3 data into separate per-channel buffers
+ *
+ * Inputs:      valid MP3 decoder instance pointer (HMP3Decoder)
+ *              double pointer to buffer of MP3 data (containing headers + mainData)
+ *              number of valid bytes remaining in inbuf
+ *              array of nChans pointers to outbufs, each big enough to hold one frame
+ *                of decoded PCM samples for one channel
+ *              flag indicating whether MP3 data is normal MPEG format (useSize = 0)
+ *                or reformatted as "self-contained" frames (useSize = 1)
+ *
+ * Outputs:     PCM data in outbuf[ch], not interleaved
+ *                number of output samples per channel = nGrans * nGranSamps
+ *              updated inbuf pointer, updated bytesLeft
+ *
+ * Return:      error code, defined in mp3dec.h (0 means no error, < 0 means error)
+ *
+ * Notes:       output is bit-exact with MP3Decode, only the sample layout differs
+ **************************************************************************************/
+int MP3DecodePlanar(HMP3Decoder hMP3Decoder, unsigned char **inbuf, int *bytesLeft, short *outbuf[MAX_NCHAN], int useSize)
+{
+	return MP3DecodeFrame(hMP3Decoder, inbuf, bytesLeft, outbuf, 1, useSize);
+}
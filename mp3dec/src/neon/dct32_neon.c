@@ -0,0 +1,206 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * dct32_neon.c - NEON version of the 32-point DCT (ARMv7-A and AArch64)
+ *
+ * Bit-exact with dct32.c: the first pass runs 4 of the 8 butterflies side by side,
+ *   the second pass runs the 4 blocks of 8 side by side, with MULSHIFT32 done as a
+ *   full 32x32 -> 64-bit multiply (vmull) narrowed to the top half.
+ *   The output shuffle into the polyphase buffer is FDCT32Output.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_NEON
+
+#include <arm_neon.h>
+
+/* scaling - ensure at least 6 guard bits for DCT, see FDCT32C */
+static __inline int Prescale(int *buf, int gb)
+{
+	int i, es;
+
+	es = 0;
+	if (gb < 6) {
+		es = 6 - gb;
+		for (i = 0; i < 32; i++)
+			buf[i] >>= es;
+	}
+
+	return es;
+}
+
+/* MULSHIFT32 of each lane (vqdmulh doubles and saturates, so it is not exact) */
+static __inline int32x4_t MulShift32(int32x4_t x, int32x4_t y)
+{
+	int64x2_t lo, hi;
+
+	lo = vmull_s32(vget_low_s32(x), vget_low_s32(y));
+	hi = vmull_s32(vget_high_s32(x), vget_high_s32(y));
+
+	return vcombine_s32(vshrn_n_s64(lo, 32), vshrn_n_s64(hi, 32));
+}
+
+static __inline int32x4_t Reverse(int32x4_t x)
+{
+	x = vrev64q_s32(x);
+
+	return vcombine_s32(vget_high_s32(x), vget_low_s32(x));
+}
+
+static __inline void Transpose4(int32x4_t *r0, int32x4_t *r1, int32x4_t *r2, int32x4_t *r3)
+{
+	int32x4x2_t t01, t23;
+
+	t01 = vtrnq_s32(*r0, *r1);
+	t23 = vtrnq_s32(*r2, *r3);
+
+	*r0 = vcombine_s32(vget_low_s32(t01.val[0]), vget_low_s32(t23.val[0]));
+	*r1 = vcombine_s32(vget_low_s32(t01.val[1]), vget_low_s32(t23.val[1]));
+	*r2 = vcombine_s32(vget_high_s32(t01.val[0]), vget_high_s32(t23.val[0]));
+	*r3 = vcombine_s32(vget_high_s32(t01.val[1]), vget_high_s32(t23.val[1]));
+}
+
+/* first pass (D32FP) on butterflies i = 4*h ... 4*h + 3
+ *   x = buf[i], y = buf[15-i], z = buf[16+i], w = buf[31-i]
+ */
+static __inline void FirstPass(const int *buf, int h, int32x4_t *x, int32x4_t *y, int32x4_t *z, int32x4_t *w)
+{
+	int32x4_t a0, a1, a2, a3, b0, b1, b2, b3;
+	int32x4_t c0, c1, c2, m1, m2;
+
+	c0 = vld1q_s32(dcttabLanes[0] + 4*h);
+	c1 = vld1q_s32(dcttabLanes[1] + 4*h);
+	c2 = vld1q_s32(dcttabLanes[2] + 4*h);
+	m1 = vld1q_s32(dcttabLanes[3] + 4*h);
+	m2 = vld1q_s32(dcttabLanes[4] + 4*h);
+
+	a0 = vld1q_s32(buf + 4*h);
+	a3 = Reverse(vld1q_s32(buf + 28 - 4*h));
+	a1 = Reverse(vld1q_s32(buf + 12 - 4*h));
+	a2 = vld1q_s32(buf + 16 + 4*h);
+
+	/* the variable shifts are multiplies by (1 << s), exact in 32 bits */
+	b0 = vaddq_s32(a0, a3);
+	b3 = vshlq_n_s32(MulShift32(c0, vsubq_s32(a0, a3)), 1);
+	b1 = vaddq_s32(a1, a2);
+	b2 = vmulq_s32(MulShift32(c1, vsubq_s32(a1, a2)), m1);
+
+	*x = vaddq_s32(b0, b1);
+	*y = vmulq_s32(MulShift32(c2, vsubq_s32(b0, b1)), m2);
+	*z = vaddq_s32(b2, b3);
+	*w = vmulq_s32(MulShift32(c2, vsubq_s32(b3, b2)), m2);
+}
+
+/* second pass on the four blocks of 8, r[j] holds sample j of blocks 0, 1, 2, 3 */
+static __inline void SecondPass(int32x4_t *r)
+{
+	int32x4_t a0, a1, a2, a3, a4, a5, a6, a7;
+	int32x4_t b0, b1, b2, b3, b4, b5, b6, b7;
+	int32x4_t c0, c1, c2, c3, c4, c5, c6;
+
+	c0 = vld1q_s32(dcttabLanes[5]);
+	c1 = vld1q_s32(dcttabLanes[6]);
+	c2 = vld1q_s32(dcttabLanes[7]);
+	c3 = vld1q_s32(dcttabLanes[8]);
+	c4 = vld1q_s32(dcttabLanes[9]);
+	c5 = vld1q_s32(dcttabLanes[10]);
+	c6 = vld1q_s32(dcttabLanes[11]);
+
+	b0 = vaddq_s32(r[0], r[7]);		b7 = vshlq_n_s32(MulShift32(c0, vsubq_s32(r[0], r[7])), 1);
+	b3 = vaddq_s32(r[3], r[4]);		b4 = vshlq_n_s32(MulShift32(c1, vsubq_s32(r[3], r[4])), 3);
+	a0 = vaddq_s32(b0, b3);			a3 = vshlq_n_s32(MulShift32(c2, vsubq_s32(b0, b3)), 1);
+	a4 = vaddq_s32(b4, b7);			a7 = vshlq_n_s32(MulShift32(c2, vsubq_s32(b7, b4)), 1);
+
+	b1 = vaddq_s32(r[1], r[6]);		b6 = vshlq_n_s32(MulShift32(c3, vsubq_s32(r[1], r[6])), 1);
+	b2 = vaddq_s32(r[2], r[5]);		b5 = vshlq_n_s32(MulShift32(c4, vsubq_s32(r[2], r[5])), 1);
+	a1 = vaddq_s32(b1, b2);			a2 = vshlq_n_s32(MulShift32(c5, vsubq_s32(b1, b2)), 2);
+	a5 = vaddq_s32(b5, b6);			a6 = vshlq_n_s32(MulShift32(c5, vsubq_s32(b6, b5)), 2);
+
+	b0 = vaddq_s32(a0, a1);			b1 = vshlq_n_s32(MulShift32(c6, vsubq_s32(a0, a1)), 1);
+	b2 = vaddq_s32(a2, a3);			b3 = vshlq_n_s32(MulShift32(c6, vsubq_s32(a3, a2)), 1);
+	r[0] = b0;						r[1] = b1;
+	r[2] = vaddq_s32(b2, b3);		r[3] = b3;
+
+	b4 = vaddq_s32(a4, a5);			b5 = vshlq_n_s32(MulShift32(c6, vsubq_s32(a4, a5)), 1);
+	b6 = vaddq_s32(a6, a7);			b7 = vshlq_n_s32(MulShift32(c6, vsubq_s32(a7, a6)), 1);
+	b6 = vaddq_s32(b6, b7);
+	r[4] = vaddq_s32(b4, b6);		r[5] = vaddq_s32(b5, b7);
+	r[6] = vaddq_s32(b5, b6);		r[7] = b7;
+}
+
+/* both passes of FDCT32C on one channel, leaving the same buf[] for FDCT32Output */
+static __inline void Transform(int *buf)
+{
+	int k;
+	int32x4_t x0, y0, z0, w0, x1, y1, z1, w1;
+	int32x4_t r[8];
+
+	FirstPass(buf, 0, &x0, &y0, &z0, &w0);
+	FirstPass(buf, 1, &x1, &y1, &z1, &w1);
+
+	/* buf[j], buf[8+j], buf[16+j], buf[24+j] for j = 0 ... 3, then j = 4 ... 7 */
+	r[0] = x0;	r[1] = Reverse(y1);	r[2] = z0;	r[3] = Reverse(w1);
+	r[4] = x1;	r[5] = Reverse(y0);	r[6] = z1;	r[7] = Reverse(w0);
+	Transpose4(&r[0], &r[1], &r[2], &r[3]);
+	Transpose4(&r[4], &r[5], &r[6], &r[7]);
+
+	SecondPass(r);
+
+	/* back to buf[8*k + j] */
+	Transpose4(&r[0], &r[1], &r[2], &r[3]);
+	Transpose4(&r[4], &r[5], &r[6], &r[7]);
+	for (k = 0; k < 4; k++) {
+		vst1q_s32(buf + 8*k + 0, r[k]);
+		vst1q_s32(buf + 8*k + 4, r[4 + k]);
+	}
+}
+
+/**************************************************************************************
+ * Function:    FDCT32NEON
+ *
+ * Description: NEON version of FDCT32C, four butterflies per instruction
+ *
+ * Inputs:      see FDCT32C
+ *
+ * Outputs:     see FDCT32C
+ *
+ * Return:      none
+ **************************************************************************************/
+void FDCT32NEON(int *buf, int *dest, int offset, int oddBlock, int gb)
+{
+	int es;
+
+	es = Prescale(buf, gb);
+	Transform(buf);
+	FDCT32Output(buf, dest, offset, oddBlock, es);
+}
+
+/**************************************************************************************
+ * Function:    FDCT32StereoNEON
+ *
+ * Description: NEON version of FDCT32StereoC
+ *
+ * Inputs:      see FDCT32StereoC
+ *
+ * Outputs:     see FDCT32StereoC
+ *
+ * Return:      none
+ *
+ * Notes:       the two channels are independent, so running them in one function
+ *                lets their multiplies overlap
+ **************************************************************************************/
+void FDCT32StereoNEON(int *bufL, int *bufR, int *dest, int offset, int oddBlock, int gbL, int gbR)
+{
+	int esL, esR;
+
+	esL = Prescale(bufL, gbL);
+	esR = Prescale(bufR, gbR);
+	Transform(bufL);
+	Transform(bufR);
+	FDCT32Output(bufL, dest + 0*32, offset, oddBlock, esL);
+	FDCT32Output(bufR, dest + 1*32, offset, oddBlock, esR);
+}
+
+#endif	/* MP3DEC_SIMD_NEON */
@@ -0,0 +1,192 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * dqchan_neon.c - NEON version of DequantBlock (ARMv7-A and AArch64)
+ *
+ * Bit-exact with dqchan.c: most Huffman values are 0 or 1, so the common case is a
+ *   group where every magnitude is below 4. DequantBlockC's tab4 then fits in one
+ *   register and a single vtbl/tbl looks up all the lanes.
+ *   Otherwise magnitudes 0-15 look up pow43_14 with vtbl/tbl (the table is split into
+ *   4 byte planes, pow43_14Planes) and do the scalar shifts, with the same uniform
+ *   shift in every lane.
+ *   Magnitudes 16-63 load pow43[] lane by lane and do the scalar MULSHIFT32 (vmull)
+ *   and shift.
+ *   A group of samples holding a magnitude of 64 or more goes through DequantBlockC.
+ *   Like the rest of the NEON code this assumes a little-endian target.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_NEON
+
+#include <arm_neon.h>
+
+/* MULSHIFT32 of each lane */
+static __inline int32x4_t MulShift32(int32x4_t x, int32x4_t y)
+{
+	int64x2_t lo, hi;
+
+	lo = vmull_s32(vget_low_s32(x), vget_low_s32(y));
+	hi = vmull_s32(vget_high_s32(x), vget_high_s32(y));
+
+	return vcombine_s32(vshrn_n_s64(lo, 32), vshrn_n_s64(hi, 32));
+}
+
+/* bitwise-OR of the 4 lanes */
+static __inline unsigned int OrLanes(uint32x4_t x)
+{
+	uint32x2_t t;
+
+	t = vorr_u32(vget_low_u32(x), vget_high_u32(x));
+
+	return vget_lane_u32(t, 0) | vget_lane_u32(t, 1);
+}
+
+/* 16 bytes of table, indices >= 16 give 0 */
+static __inline uint8x16_t Lookup16(uint8x16_t tab, uint8x16_t idx)
+{
+#ifdef __aarch64__
+	return vqtbl1q_u8(tab, idx);
+#else
+	uint8x8x2_t t;
+
+	t.val[0] = vget_low_u8(tab);
+	t.val[1] = vget_high_u8(tab);
+
+	return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)), vtbl2_u8(t, vget_high_u8(idx)));
+#endif
+}
+
+/**************************************************************************************
+ * Function:    Dequant4
+ *
+ * Description: dequantize 4 samples with magnitudes < 64
+ *
+ * Inputs:      tab4 (see DequantBlockC) and the 4 byte planes of the pow43_14 row
+ *              shift for magnitudes 0-3, 4-15 and 16-63 (vshl counts, < 0 shifts right)
+ *              fractional scale for magnitudes 16-63, clip limit (before the left shift)
+ *              samples (sign|mag)
+ *
+ * Outputs:     bitwise-OR of the unsigned outputs, ORed into mask
+ *
+ * Return:      dequantized samples
+ **************************************************************************************/
+static __inline int32x4_t Dequant4(uint8x16_t tab4, const unsigned char *planes, int32x4_t shift4, int32x4_t shift16, int32x4_t shift64,
+                                   int32x4_t scalef, uint32x4_t limit, int32x4_t sx, uint32x4_t *mask)
+{
+	uint8x16_t idx;
+	uint32x4_t x, y, yb, clip;
+	int32x4_t ys, neg;
+
+	clip = vdupq_n_u32(0x7fffffff);
+	x = vandq_u32(vreinterpretq_u32_s32(sx), clip);	/* sx = sign|mag */
+	neg = vshrq_n_s32(sx, 31);
+
+	/* all below 4: bytes 4x ... 4x+3 of tab4 */
+	if (!OrLanes(vandq_u32(x, vdupq_n_u32(~3)))) {
+		idx = vreinterpretq_u8_u32(vaddq_u32(vmulq_n_u32(x, 0x04040404), vdupq_n_u32(0x03020100)));
+		y = vreinterpretq_u32_u8(Lookup16(tab4, idx));
+
+		*mask = vorrq_u32(*mask, y);
+
+		return vsubq_s32(veorq_s32(vreinterpretq_s32_u32(y), neg), neg);
+	}
+
+	/* pow43_14[x] for x < 16: the index of the upper 3 bytes of each lane is out of range,
+	 *   so only byte 0 is looked up in each plane
+	 */
+	idx = vreinterpretq_u8_u32(vorrq_u32(vandq_u32(x, vdupq_n_u32(0x0f)), vdupq_n_u32(0xffffff00)));
+	y = vreinterpretq_u32_u8(Lookup16(vld1q_u8(planes +  0), idx));
+	y = vsliq_n_u32(y, vreinterpretq_u32_u8(Lookup16(vld1q_u8(planes + 16), idx)),  8);
+	y = vsliq_n_u32(y, vreinterpretq_u32_u8(Lookup16(vld1q_u8(planes + 32), idx)), 16);
+	y = vsliq_n_u32(y, vreinterpretq_u32_u8(Lookup16(vld1q_u8(planes + 48), idx)), 24);
+
+	/* 0-3 have 3 more fraction bits than 4-15 */
+	ys = vreinterpretq_s32_u32(y);
+	y = vbslq_u32(vcltq_u32(x, vdupq_n_u32(4)), vreinterpretq_u32_s32(vshlq_s32(ys, shift4)), vreinterpretq_u32_s32(vshlq_s32(ys, shift16)));
+
+	/* 16-63: fractional scale, then integer scale (clipping if it shifts left) */
+	if (OrLanes(vandq_u32(x, vdupq_n_u32(~15)))) {
+		ys = vdupq_n_s32(0);
+		ys = vld1q_lane_s32(pow43 + MAX((int)vgetq_lane_u32(x, 0) - 16, 0), ys, 0);
+		ys = vld1q_lane_s32(pow43 + MAX((int)vgetq_lane_u32(x, 1) - 16, 0), ys, 1);
+		ys = vld1q_lane_s32(pow43 + MAX((int)vgetq_lane_u32(x, 2) - 16, 0), ys, 2);
+		ys = vld1q_lane_s32(pow43 + MAX((int)vgetq_lane_u32(x, 3) - 16, 0), ys, 3);
+		ys = MulShift32(ys, scalef);
+
+		yb = vbslq_u32(vcgtq_u32(vreinterpretq_u32_s32(ys), limit), clip, vreinterpretq_u32_s32(vshlq_s32(ys, shift64)));
+		y = vbslq_u32(vcgtq_u32(x, vdupq_n_u32(15)), yb, y);
+	}
+
+	/* sign */
+	*mask = vorrq_u32(*mask, y);
+
+	return vsubq_s32(veorq_s32(vreinterpretq_s32_u32(y), neg), neg);
+}
+
+/* sign bit is ignored, so this is also true for magnitudes of 64 or more */
+static __inline int AnyLarge(int32x4_t sx)
+{
+	return OrLanes(vandq_u32(vreinterpretq_u32_s32(sx), vdupq_n_u32(0x7fffffc0))) != 0;
+}
+
+/**************************************************************************************
+ * Function:    DequantBlockNEON
+ *
+ * Description: NEON version of DequantBlockC, 4 samples at a time
+ *
+ * Inputs:      see DequantBlockC
+ *
+ * Outputs:     see DequantBlockC
+ *
+ * Return:      see DequantBlockC
+ *
+ * Notes:       the last 1-3 samples are padded with zeros
+ **************************************************************************************/
+int DequantBlockNEON(int *inbuf, int *outbuf, int num, int scale)
+{
+	const unsigned char *planes;
+	uint8x16_t tab4;
+	int32x4_t sx, shift4, shift16, shift64, scalef;
+	uint32x4_t limit, mask;
+	int scalei, i, k, tail[4];
+	int m = 0;
+
+	scalei = MIN(scale >> 2, 31);	/* smallest input scale = -47, so smallest scalei = -12 */
+
+	planes = pow43_14Planes[scale & 0x3][0];
+	shift4 = vdupq_n_s32(-MAX(MIN(scalei + 3, 31), 0));
+	tab4 = vreinterpretq_u8_s32(vshlq_s32(vld1q_s32(pow43_14[scale & 0x3]), shift4));
+	shift16 = vdupq_n_s32(-scalei);
+	shift64 = vdupq_n_s32(3 - scalei);
+	scalef = vdupq_n_s32(pow14[scale & 0x3]);
+	limit = vdupq_n_u32(0x7fffffff >> MAX(3 - scalei, 0));
+	mask = vdupq_n_u32(0);
+
+	for (i = 0; i + 4 <= num; i += 4) {
+		sx = vld1q_s32(inbuf + i);
+		if (AnyLarge(sx))
+			m |= DequantBlockC(inbuf + i, outbuf + i, 4, scale);
+		else
+			vst1q_s32(outbuf + i, Dequant4(tab4, planes, shift4, shift16, shift64, scalef, limit, sx, &mask));
+	}
+
+	if (i < num) {
+		for (k = 0; k < 4; k++)
+			tail[k] = (i + k < num) ? inbuf[i + k] : 0;
+
+		sx = vld1q_s32(tail);
+		if (AnyLarge(sx)) {
+			m |= DequantBlockC(inbuf + i, outbuf + i, num - i, scale);
+		} else {
+			vst1q_s32(tail, Dequant4(tab4, planes, shift4, shift16, shift64, scalef, limit, sx, &mask));
+			for (k = 0; i + k < num; k++)
+				outbuf[i + k] = tail[k];
+		}
+	}
+
+	return m | (int)OrLanes(mask);
+}
+
+#endif	/* MP3DEC_SIMD_NEON */
@@ -0,0 +1,442 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * imdct_neon.c - NEON versions of antialias, IMDCT36 and IMDCT12x3 (ARMv7-A and AArch64)
+ *
+ * Bit-exact with imdct.c: IMDCT36x4 and IMDCT12x3x4 run four blocks in lockstep,
+ *   one block per vector lane, with MULSHIFT32 done as a full 32x32 -> 64-bit
+ *   multiply (vmull) narrowed to the top half.
+ *   The rare pre-IMDCT rescaling (fewer than 7 guard bits) stays scalar.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_NEON
+
+#include <arm_neon.h>
+
+/* see imdct.c */
+static const int c9_0 = 0x6ed9eba1;
+static const int c9_1 = 0x620dbe8b;
+static const int c9_2 = 0x163a1a7e;
+static const int c9_3 = 0x5246dd49;
+static const int c9_4 = 0x7e0e2e32;
+
+static const int c18[9] = {
+	0x7f834ed0, 0x7ba3751d, 0x7401e4c1, 0x68d9f964, 0x5a82799a, 0x496af3e2, 0x36185aee, 0x2120fb83, 0x0b27eb5c,
+};
+
+static const int c3_0 = 0x6ed9eba1;
+static const int c6[3] = { 0x7ba3751d, 0x5a82799a, 0x2120fb83 };
+
+/* MULSHIFT32 of each lane (vqdmulh doubles and saturates, so it is not exact) */
+static __inline int32x4_t MulShift32(int32x4_t x, int32x4_t y)
+{
+	int64x2_t lo, hi;
+
+	lo = vmull_s32(vget_low_s32(x), vget_low_s32(y));
+	hi = vmull_s32(vget_high_s32(x), vget_high_s32(y));
+
+	return vcombine_s32(vshrn_n_s64(lo, 32), vshrn_n_s64(hi, 32));
+}
+
+/* MULSHIFT32(c, x) with the same constant c in every lane */
+static __inline int32x4_t MulConst(int c, int32x4_t x)
+{
+	return MulShift32(vdupq_n_s32(c), x);
+}
+
+static __inline int32x4_t Reverse(int32x4_t x)
+{
+	x = vrev64q_s32(x);
+
+	return vcombine_s32(vget_high_s32(x), vget_low_s32(x));
+}
+
+static __inline void Transpose4(int32x4_t *r0, int32x4_t *r1, int32x4_t *r2, int32x4_t *r3)
+{
+	int32x4x2_t t01, t23;
+
+	t01 = vtrnq_s32(*r0, *r1);
+	t23 = vtrnq_s32(*r2, *r3);
+
+	*r0 = vcombine_s32(vget_low_s32(t01.val[0]), vget_low_s32(t23.val[0]));
+	*r1 = vcombine_s32(vget_low_s32(t01.val[1]), vget_low_s32(t23.val[1]));
+	*r2 = vcombine_s32(vget_high_s32(t01.val[0]), vget_high_s32(t23.val[0]));
+	*r3 = vcombine_s32(vget_high_s32(t01.val[1]), vget_high_s32(t23.val[1]));
+}
+
+/* v[k] = x[k], x[stride + k], x[2*stride + k], x[3*stride + k] for k = 0 ... n-1 */
+static __inline void LoadLanes(const int *x, int stride, int n, int32x4_t *v)
+{
+	int k, lanes[4];
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		v[k+0] = vld1q_s32(x + 0*stride + k);
+		v[k+1] = vld1q_s32(x + 1*stride + k);
+		v[k+2] = vld1q_s32(x + 2*stride + k);
+		v[k+3] = vld1q_s32(x + 3*stride + k);
+		Transpose4(&v[k+0], &v[k+1], &v[k+2], &v[k+3]);
+	}
+	for ( ; k < n; k++) {
+		lanes[0] = x[0*stride + k];
+		lanes[1] = x[1*stride + k];
+		lanes[2] = x[2*stride + k];
+		lanes[3] = x[3*stride + k];
+		v[k] = vld1q_s32(lanes);
+	}
+}
+
+/* inverse of LoadLanes */
+static __inline void StoreLanes(int *x, int stride, int n, const int32x4_t *v)
+{
+	int k, lanes[4];
+	int32x4_t r0, r1, r2, r3;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		r0 = v[k+0];	r1 = v[k+1];	r2 = v[k+2];	r3 = v[k+3];
+		Transpose4(&r0, &r1, &r2, &r3);
+		vst1q_s32(x + 0*stride + k, r0);
+		vst1q_s32(x + 1*stride + k, r1);
+		vst1q_s32(x + 2*stride + k, r2);
+		vst1q_s32(x + 3*stride + k, r3);
+	}
+	for ( ; k < n; k++) {
+		vst1q_s32(lanes, v[k]);
+		x[0*stride + k] = lanes[0];
+		x[1*stride + k] = lanes[1];
+		x[2*stride + k] = lanes[2];
+		x[3*stride + k] = lanes[3];
+	}
+}
+
+/* store the 18 output vectors (one row of y[][] each), with frequency inversion
+ *   of the odd samples in the odd blocks, and return the OR of abs(y)
+ */
+static __inline int StoreOutput(int *y, int32x4_t *yv, int blockIdx)
+{
+	int k, fiLanes[4];
+	int32x4_t fi, mOut;
+
+	/* all ones in the lanes of odd blocks: (y ^ fi) - fi = -y */
+	fiLanes[0] = fiLanes[2] = -(blockIdx & 0x01);
+	fiLanes[1] = fiLanes[3] = -((blockIdx + 1) & 0x01);
+	fi = vld1q_s32(fiLanes);
+
+	mOut = vdupq_n_s32(0);
+	for (k = 0; k < 18; k++) {
+		if (k & 0x01)
+			yv[k] = vsubq_s32(veorq_s32(yv[k], fi), fi);
+		vst1q_s32(y + k*NBANDS, yv[k]);
+		mOut = vorrq_s32(mOut, vabsq_s32(yv[k]));
+	}
+
+	return vgetq_lane_s32(mOut, 0) | vgetq_lane_s32(mOut, 1) | vgetq_lane_s32(mOut, 2) | vgetq_lane_s32(mOut, 3);
+}
+
+/* WinPrevious on four blocks */
+static __inline void WinPrevious(const int32x4_t *xPrev, int32x4_t *xPrevWin, int btPrev)
+{
+	int i;
+	const int *wpLo;
+
+	if (btPrev == 2) {
+		wpLo = imdctWin[btPrev];
+		xPrevWin[ 0] = vaddq_s32(MulConst(wpLo[ 6], xPrev[2]), MulConst(wpLo[0], xPrev[6]));
+		xPrevWin[ 1] = vaddq_s32(MulConst(wpLo[ 7], xPrev[1]), MulConst(wpLo[1], xPrev[7]));
+		xPrevWin[ 2] = vaddq_s32(MulConst(wpLo[ 8], xPrev[0]), MulConst(wpLo[2], xPrev[8]));
+		xPrevWin[ 3] = vaddq_s32(MulConst(wpLo[ 9], xPrev[0]), MulConst(wpLo[3], xPrev[8]));
+		xPrevWin[ 4] = vaddq_s32(MulConst(wpLo[10], xPrev[1]), MulConst(wpLo[4], xPrev[7]));
+		xPrevWin[ 5] = vaddq_s32(MulConst(wpLo[11], xPrev[2]), MulConst(wpLo[5], xPrev[6]));
+		xPrevWin[ 6] = MulConst(wpLo[ 6], xPrev[5]);
+		xPrevWin[ 7] = MulConst(wpLo[ 7], xPrev[4]);
+		xPrevWin[ 8] = MulConst(wpLo[ 8], xPrev[3]);
+		xPrevWin[ 9] = MulConst(wpLo[ 9], xPrev[3]);
+		xPrevWin[10] = MulConst(wpLo[10], xPrev[4]);
+		xPrevWin[11] = MulConst(wpLo[11], xPrev[5]);
+		for (i = 12; i < 18; i++)
+			xPrevWin[i] = vdupq_n_s32(0);
+	} else {
+		wpLo = imdctWin[btPrev] + 18;
+		for (i = 0; i < 9; i++) {
+			xPrevWin[i]    = MulConst(wpLo[i], xPrev[i]);
+			xPrevWin[17-i] = MulConst(wpLo[17-i], xPrev[i]);
+		}
+	}
+}
+
+/* idct9 on four blocks */
+static __inline void Idct9(int32x4_t *x)
+{
+	int32x4_t a1, a2, a3, a4, a5, a6, a7, a8, a9;
+	int32x4_t a10, a11, a12, a13, a14, a15, a16, a17, a18;
+	int32x4_t a19, a20, a21, a22, a23, a24, a25, a26, a27;
+	int32x4_t m1, m3, m5, m6, m7, m8, m9, m10, m11, m12;
+
+	a1 = vsubq_s32(x[0], x[6]);
+	a2 = vsubq_s32(x[1], x[5]);
+	a3 = vaddq_s32(x[1], x[5]);
+	a4 = vsubq_s32(x[2], x[4]);
+	a5 = vaddq_s32(x[2], x[4]);
+	a6 = vaddq_s32(x[2], x[8]);
+	a7 = vaddq_s32(x[1], x[7]);
+
+	a8 = vsubq_s32(a6, a5);
+	a9 = vsubq_s32(a3, a7);
+	a10 = vsubq_s32(a2, x[7]);
+	a11 = vsubq_s32(a4, x[8]);
+
+	/* the scalar version leaves the << 1 to where mX is used */
+	m1 =  vshlq_n_s32(MulConst(c9_0, x[3]), 1);
+	m3 =  vshlq_n_s32(MulConst(c9_0, a10), 1);
+	m5 =  vshlq_n_s32(MulConst(c9_1, a5), 1);
+	m6 =  vshlq_n_s32(MulConst(c9_2, a6), 1);
+	m7 =  vshlq_n_s32(MulConst(c9_1, a8), 1);
+	m8 =  vshlq_n_s32(MulConst(c9_2, a5), 1);
+	m9 =  vshlq_n_s32(MulConst(c9_3, a9), 1);
+	m10 = vshlq_n_s32(MulConst(c9_4, a7), 1);
+	m11 = vshlq_n_s32(MulConst(c9_3, a3), 1);
+	m12 = vshlq_n_s32(MulConst(c9_4, a9), 1);
+
+	a12 = vaddq_s32(x[0], vshrq_n_s32(x[6], 1));
+	a13 = vaddq_s32(a12, m1);
+	a14 = vsubq_s32(a12, m1);
+	a15 = vaddq_s32(a1, vshrq_n_s32(a11, 1));
+	a16 = vaddq_s32(m5, m6);
+	a17 = vsubq_s32(m7, m8);
+	a18 = vaddq_s32(a16, a17);
+	a19 = vaddq_s32(m9, m10);
+	a20 = vsubq_s32(m11, m12);
+
+	a21 = vsubq_s32(a20, a19);
+	a22 = vaddq_s32(a13, a16);
+	a23 = vaddq_s32(a14, a16);
+	a24 = vaddq_s32(a14, a17);
+	a25 = vaddq_s32(a13, a17);
+	a26 = vsubq_s32(a14, a18);
+	a27 = vsubq_s32(a13, a18);
+
+	x[0] = vaddq_s32(a22, a19);
+	x[1] = vaddq_s32(a15, m3);
+	x[2] = vaddq_s32(a24, a20);
+	x[3] = vsubq_s32(a26, a21);
+	x[4] = vsubq_s32(a1, a11);
+	x[5] = vaddq_s32(a27, a21);
+	x[6] = vsubq_s32(a25, a20);
+	x[7] = vsubq_s32(a15, m3);
+	x[8] = vsubq_s32(a23, a19);
+}
+
+/* imdct12 on four blocks, x[] spaced 3 apart as in IMDCT12x3 */
+static __inline void Imdct12(const int32x4_t *x, int32x4_t *out)
+{
+	int32x4_t a0, a1, a2;
+	int32x4_t x0, x1, x2, x3, x4, x5;
+
+	x0 = x[0];	x1 = x[3];	x2 = x[6];
+	x3 = x[9];	x4 = x[12];	x5 = x[15];
+
+	x4 = vsubq_s32(x4, x5);
+	x3 = vsubq_s32(x3, x4);
+	x2 = vsubq_s32(x2, x3);
+	x3 = vsubq_s32(x3, x5);
+	x1 = vsubq_s32(x1, x2);
+	x0 = vsubq_s32(x0, x1);
+	x1 = vsubq_s32(x1, x3);
+
+	x0 = vshrq_n_s32(x0, 1);
+	x1 = vshrq_n_s32(x1, 1);
+
+	a0 = vshlq_n_s32(MulConst(c3_0, x2), 1);
+	a1 = vaddq_s32(x0, vshrq_n_s32(x4, 1));
+	a2 = vsubq_s32(x0, x4);
+	x0 = vaddq_s32(a1, a0);
+	x2 = a2;
+	x4 = vsubq_s32(a1, a0);
+
+	a0 = vshlq_n_s32(MulConst(c3_0, x3), 1);
+	a1 = vaddq_s32(x1, vshrq_n_s32(x5, 1));
+	a2 = vsubq_s32(x1, x5);
+
+	x1 = vshlq_n_s32(MulConst(c6[0], vaddq_s32(a1, a0)), 2);
+	x3 = vshlq_n_s32(MulConst(c6[1], a2), 2);
+	x5 = vshlq_n_s32(MulConst(c6[2], vsubq_s32(a1, a0)), 2);
+
+	out[0] = vaddq_s32(x0, x1);
+	out[1] = vaddq_s32(x2, x3);
+	out[2] = vaddq_s32(x4, x5);
+	out[3] = vsubq_s32(x4, x5);
+	out[4] = vsubq_s32(x2, x3);
+	out[5] = vsubq_s32(x0, x1);
+}
+
+/**************************************************************************************
+ * Function:    AntiAliasNEON
+ *
+ * Description: NEON version of AntiAliasC, the 8 butterflies of each block
+ *                boundary in two vectors
+ *
+ * Inputs:      see AntiAliasC
+ *
+ * Outputs:     see AntiAliasC
+ *
+ * Return:      none
+ **************************************************************************************/
+void AntiAliasNEON(int *x, int nBfly)
+{
+	int k;
+	int32x4x2_t cA, cB;
+	int32x4_t aA, aB, bA, bB;
+
+	/* csa = Q31, vld2 splits the pairs into c0 and c1, lane i = butterfly i */
+	cA = vld2q_s32(csa[0]);
+	cB = vld2q_s32(csa[4]);
+
+	for (k = nBfly; k > 0; k--) {
+		x += 18;
+
+		/* a = x[-1], x[-2], ... x[-8]   b = x[0], x[1], ... x[7] */
+		aA = Reverse(vld1q_s32(x - 4));
+		aB = Reverse(vld1q_s32(x - 8));
+		bA = vld1q_s32(x + 0);
+		bB = vld1q_s32(x + 4);
+
+		vst1q_s32(x - 4, Reverse(vshlq_n_s32(vsubq_s32(MulShift32(cA.val[0], aA), MulShift32(cA.val[1], bA)), 1)));
+		vst1q_s32(x - 8, Reverse(vshlq_n_s32(vsubq_s32(MulShift32(cB.val[0], aB), MulShift32(cB.val[1], bB)), 1)));
+		vst1q_s32(x + 0, vshlq_n_s32(vaddq_s32(MulShift32(cA.val[0], bA), MulShift32(cA.val[1], aA)), 1));
+		vst1q_s32(x + 4, vshlq_n_s32(vaddq_s32(MulShift32(cB.val[0], bB), MulShift32(cB.val[1], aB)), 1));
+	}
+}
+
+/**************************************************************************************
+ * Function:    IMDCT36x4NEON
+ *
+ * Description: NEON version of IMDCT36x4C, one block per lane
+ *
+ * Inputs:      see IMDCT36x4C
+ *
+ * Outputs:     see IMDCT36x4C
+ *
+ * Return:      mOut (OR of abs(y) for all y calculated here)
+ **************************************************************************************/
+int IMDCT36x4NEON(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb)
+{
+	int i;
+	const int *wp;
+	int32x4_t x[18], xBuf[18], xPrevV[9], xPrevWin[18], yv[18];
+	int32x4_t acc1, acc2, xo, xe, s, d, t;
+
+	/* rescaling for fewer than 7 guard bits is rare, leave it to the scalar version */
+	if (gb < 7)
+		return IMDCT36x4C(xCurr, xPrev, y, btCurr, btPrev, blockIdx, gb);
+
+	LoadLanes(xCurr, 18, 18, x);
+	LoadLanes(xPrev, 9, 9, xPrevV);
+
+	acc1 = acc2 = vdupq_n_s32(0);
+	for (i = 8; i >= 0; i--) {
+		acc1 = vsubq_s32(x[2*i+1], acc1);
+		acc2 = vsubq_s32(acc1, acc2);
+		acc1 = vsubq_s32(x[2*i+0], acc1);
+		xBuf[i+9] = acc2;	/* odd */
+		xBuf[i+0] = acc1;	/* even */
+	}
+	/* xEven[0] and xOdd[0] scaled by 0.5 */
+	xBuf[9] = vshrq_n_s32(xBuf[9], 1);
+	xBuf[0] = vshrq_n_s32(xBuf[0], 1);
+
+	Idct9(xBuf + 0);	/* even */
+	Idct9(xBuf + 9);	/* odd */
+
+	if (btPrev == 0 && btCurr == 0) {
+		/* fast path - symmetric sin window */
+		wp = fastWin36;
+		for (i = 0; i < 9; i++) {
+			xo = MulConst(c18[8-i], xBuf[17-i]);
+			xe = vshrq_n_s32(xBuf[8-i], 2);
+
+			s = vnegq_s32(xPrevV[i]);
+			d = vsubq_s32(xo, xe);
+			xPrevV[i] = vaddq_s32(xe, xo);
+			t = vsubq_s32(s, d);
+
+			yv[i]    = vaddq_s32(d, vshlq_n_s32(MulConst(wp[2*i+0], t), 2));
+			yv[17-i] = vaddq_s32(s, vshlq_n_s32(MulConst(wp[2*i+1], t), 2));
+		}
+	} else {
+		/* full 36-point window */
+		WinPrevious(xPrevV, xPrevWin, btPrev);
+
+		wp = imdctWin[btCurr];
+		for (i = 0; i < 9; i++) {
+			xo = MulConst(c18[8-i], xBuf[17-i]);
+			xe = vshrq_n_s32(xBuf[8-i], 2);
+
+			d = vsubq_s32(xe, xo);
+			xPrevV[i] = vaddq_s32(xe, xo);
+
+			yv[i]    = vshlq_n_s32(vaddq_s32(xPrevWin[i],    MulConst(wp[i], d)), 2);
+			yv[17-i] = vshlq_n_s32(vaddq_s32(xPrevWin[17-i], MulConst(wp[17-i], d)), 2);
+		}
+	}
+
+	StoreLanes(xPrev, 9, 9, xPrevV);
+
+	return StoreOutput(y, yv, blockIdx);
+}
+
+/**************************************************************************************
+ * Function:    IMDCT12x3x4NEON
+ *
+ * Description: NEON version of IMDCT12x3x4C, one block per lane
+ *
+ * Inputs:      see IMDCT12x3x4C
+ *
+ * Outputs:     see IMDCT12x3x4C
+ *
+ * Return:      mOut (OR of abs(y) for all y calculated here)
+ **************************************************************************************/
+int IMDCT12x3x4NEON(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb)
+{
+	int i;
+	const int *wp;
+	int32x4_t x[18], xBuf[18], xPrevV[9], xPrevWin[18], yv[18];
+
+	/* rescaling for fewer than 7 guard bits is rare, leave it to the scalar version */
+	if (gb < 7)
+		return IMDCT12x3x4C(xCurr, xPrev, y, btPrev, blockIdx, gb);
+
+	LoadLanes(xCurr, 18, 18, x);
+	LoadLanes(xPrev, 9, 9, xPrevV);
+
+	Imdct12(x + 0, xBuf + 0);
+	Imdct12(x + 1, xBuf + 6);
+	Imdct12(x + 2, xBuf + 12);
+
+	WinPrevious(xPrevV, xPrevWin, btPrev);
+
+	wp = imdctWin[2];
+	for (i = 0; i < 3; i++) {
+		yv[ 0+i] = vshlq_n_s32(xPrevWin[ 0+i], 2);
+		yv[ 3+i] = vshlq_n_s32(xPrevWin[ 3+i], 2);
+		yv[ 6+i] = vaddq_s32(vshlq_n_s32(xPrevWin[ 6+i], 2), MulConst(wp[0+i], xBuf[3+i]));
+		yv[ 9+i] = vaddq_s32(vshlq_n_s32(xPrevWin[ 9+i], 2), MulConst(wp[3+i], xBuf[5-i]));
+		yv[12+i] = vaddq_s32(vshlq_n_s32(xPrevWin[12+i], 2),
+					vaddq_s32(MulConst(wp[6+i], xBuf[2-i]), MulConst(wp[0+i], xBuf[(6+3)+i])));
+		yv[15+i] = vaddq_s32(vshlq_n_s32(xPrevWin[15+i], 2),
+					vaddq_s32(MulConst(wp[9+i], xBuf[0+i]), MulConst(wp[3+i], xBuf[(6+5)-i])));
+	}
+
+	/* save previous (unwindowed) for overlap - only need samples 6-8, 12-17 */
+	for (i = 0; i < 3; i++)
+		xPrevV[i] = vshrq_n_s32(xBuf[6+i], 2);
+	for (i = 0; i < 6; i++)
+		xPrevV[3+i] = vshrq_n_s32(xBuf[12+i], 2);
+
+	StoreLanes(xPrev, 9, 9, xPrevV);
+
+	return StoreOutput(y, yv, blockIdx);
+}
+
+#endif	/* MP3DEC_SIMD_NEON */
@@ -0,0 +1,204 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * polyphase_neon.c - NEON version of the polyphase synthesis filter (ARMv7-A and AArch64)
+ *
+ * Bit-exact with polyphase.c: every tap is a full 32x32 -> 64-bit multiply-accumulate
+ *   (vmlal/vmlsl) into 64-bit lanes, which only reorders integer additions.
+ *   The rounding, shift and clip to 16 bits stay scalar.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_NEON
+
+#include <arm_neon.h>
+
+/* see polyphase.c */
+#define DEF_NFRACBITS	(DQ_FRACBITS_OUT - 2 - 2 - 15)
+#define CSHIFT	12
+
+static __inline short ClipToShort(int x, int fracBits)
+{
+	int sign;
+
+	x >>= fracBits;
+
+	sign = x >> 31;
+	if (sign != (x >> 15))
+		x = sign ^ ((1 << 15) - 1);
+
+	return (short)x;
+}
+
+static __inline short ClipSum(int64x2_t sum)
+{
+	Word64 rndVal = (Word64)( 1 << (DEF_NFRACBITS - 1 + (32 - CSHIFT)) );
+	Word64 sum64 = vgetq_lane_s64(sum, 0) + vgetq_lane_s64(sum, 1) + rndVal;
+
+	return ClipToShort((int)SAR64(sum64, (32-CSHIFT)), DEF_NFRACBITS);
+}
+
+/* reverse the four lanes of v */
+static __inline int32x4_t Reverse(int32x4_t v)
+{
+	v = vrev64q_s32(v);
+
+	return vcombine_s32(vget_high_s32(v), vget_low_s32(v));
+}
+
+/* 8 taps of one channel, for x = 0, 1, ... 7 with coef = c1, c2 pairs
+ *   sum1 += vb[x]*c1 - vb[23-x]*c2
+ *   sum2 += vb[x]*c2 + vb[23-x]*c1
+ */
+static __inline void Taps8(const int *vb, const int *coef, int64x2_t *sum1, int64x2_t *sum2)
+{
+	int32x4x2_t cA, cB;
+	int32x4_t vLoA, vLoB, vHiA, vHiB;
+	int64x2_t s1, s2;
+
+	/* vld2 splits the pairs into c1 and c2 */
+	cA = vld2q_s32(coef + 0);
+	cB = vld2q_s32(coef + 8);
+
+	vLoA = vld1q_s32(vb + 0);
+	vLoB = vld1q_s32(vb + 4);
+	vHiA = Reverse(vld1q_s32(vb + 20));
+	vHiB = Reverse(vld1q_s32(vb + 16));
+
+	s1 = vmull_s32(vget_low_s32(vLoA), vget_low_s32(cA.val[0]));
+	s1 = vmlal_s32(s1, vget_high_s32(vLoA), vget_high_s32(cA.val[0]));
+	s1 = vmlal_s32(s1, vget_low_s32(vLoB), vget_low_s32(cB.val[0]));
+	s1 = vmlal_s32(s1, vget_high_s32(vLoB), vget_high_s32(cB.val[0]));
+	s1 = vmlsl_s32(s1, vget_low_s32(vHiA), vget_low_s32(cA.val[1]));
+	s1 = vmlsl_s32(s1, vget_high_s32(vHiA), vget_high_s32(cA.val[1]));
+	s1 = vmlsl_s32(s1, vget_low_s32(vHiB), vget_low_s32(cB.val[1]));
+	s1 = vmlsl_s32(s1, vget_high_s32(vHiB), vget_high_s32(cB.val[1]));
+
+	s2 = vmull_s32(vget_low_s32(vLoA), vget_low_s32(cA.val[1]));
+	s2 = vmlal_s32(s2, vget_high_s32(vLoA), vget_high_s32(cA.val[1]));
+	s2 = vmlal_s32(s2, vget_low_s32(vLoB), vget_low_s32(cB.val[1]));
+	s2 = vmlal_s32(s2, vget_high_s32(vLoB), vget_high_s32(cB.val[1]));
+	s2 = vmlal_s32(s2, vget_low_s32(vHiA), vget_low_s32(cA.val[0]));
+	s2 = vmlal_s32(s2, vget_high_s32(vHiA), vget_high_s32(cA.val[0]));
+	s2 = vmlal_s32(s2, vget_low_s32(vHiB), vget_low_s32(cB.val[0]));
+	s2 = vmlal_s32(s2, vget_high_s32(vHiB), vget_high_s32(cB.val[0]));
+
+	*sum1 = s1;
+	*sum2 = s2;
+}
+
+/* 8 taps of one channel for output sample 16: sum += vb[x]*coef[x] */
+static __inline int64x2_t Taps8MC1(const int *vb, const int *coef)
+{
+	int32x4_t cA, cB, vA, vB;
+	int64x2_t s;
+
+	cA = vld1q_s32(coef + 0);
+	cB = vld1q_s32(coef + 4);
+	vA = vld1q_s32(vb + 0);
+	vB = vld1q_s32(vb + 4);
+
+	s = vmull_s32(vget_low_s32(vA), vget_low_s32(cA));
+	s = vmlal_s32(s, vget_high_s32(vA), vget_high_s32(cA));
+	s = vmlal_s32(s, vget_low_s32(vB), vget_low_s32(cB));
+	s = vmlal_s32(s, vget_high_s32(vB), vget_high_s32(cB));
+
+	return s;
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseMonoNEON
+ *
+ * Description: NEON version of PolyphaseMonoC, two 64-bit taps per instruction
+ *
+ * Inputs:      see PolyphaseMonoC
+ *
+ * Outputs:     32 samples of one channel of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ **************************************************************************************/
+void PolyphaseMonoNEON(short *pcm, int *vbuf, const int *coefBase)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	int64x2_t sum1L, sum2L;
+
+	/* special case, output sample 0 */
+	Taps8(vbuf, coefBase, &sum1L, &sum2L);
+	*(pcm + 0) = ClipSum(sum1L);
+
+	/* special case, output sample 16 */
+	sum1L = Taps8MC1(vbuf + 64*16, coefBase + 256);
+	*(pcm + 16) = ClipSum(sum1L);
+
+	/* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm++;
+
+	for (i = 15; i > 0; i--) {
+		Taps8(vb1, coef, &sum1L, &sum2L);
+
+		coef += 16;
+		vb1 += 64;
+		*(pcm)       = ClipSum(sum1L);
+		*(pcm + 2*i) = ClipSum(sum2L);
+		pcm++;
+	}
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseStereoNEON
+ *
+ * Description: NEON version of PolyphaseStereoC, two 64-bit taps per instruction
+ *
+ * Inputs:      see PolyphaseStereoC
+ *
+ * Outputs:     32 samples of two channels of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ *
+ * Notes:       interleaves PCM samples LRLRLR...
+ **************************************************************************************/
+void PolyphaseStereoNEON(short *pcm, int *vbuf, const int *coefBase)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	int64x2_t sum1L, sum2L, sum1R, sum2R;
+
+	/* special case, output sample 0 */
+	Taps8(vbuf, coefBase, &sum1L, &sum2L);
+	Taps8(vbuf + 32, coefBase, &sum1R, &sum2R);
+	*(pcm + 0) = ClipSum(sum1L);
+	*(pcm + 1) = ClipSum(sum1R);
+
+	/* special case, output sample 16 */
+	sum1L = Taps8MC1(vbuf + 64*16, coefBase + 256);
+	sum1R = Taps8MC1(vbuf + 64*16 + 32, coefBase + 256);
+	*(pcm + 2*16 + 0) = ClipSum(sum1L);
+	*(pcm + 2*16 + 1) = ClipSum(sum1R);
+
+	/* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm += 2;
+
+	for (i = 15; i > 0; i--) {
+		Taps8(vb1, coef, &sum1L, &sum2L);
+		Taps8(vb1 + 32, coef, &sum1R, &sum2R);
+
+		coef += 16;
+		vb1 += 64;
+		*(pcm + 0)         = ClipSum(sum1L);
+		*(pcm + 1)         = ClipSum(sum1R);
+		*(pcm + 2*2*i + 0) = ClipSum(sum2L);
+		*(pcm + 2*2*i + 1) = ClipSum(sum2R);
+		pcm += 2;
+	}
+}
+
+#endif	/* MP3DEC_SIMD_NEON */
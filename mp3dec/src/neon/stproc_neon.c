@@ -0,0 +1,120 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * stproc_neon.c - NEON versions of MidSideProc and IntensityBand (ARMv7-A and AArch64)
+ *
+ * Bit-exact with stproc.c: the sums, differences and MULSHIFT32s wrap the same way
+ *   in every lane, and vabs gives the same 0x80000000 as FASTABS for -2^31.
+ *   The guard bit masks are ORed in a register and folded into mOut once per call.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_NEON
+
+#include <arm_neon.h>
+
+/* MULSHIFT32 of each lane */
+static __inline int32x4_t MulShift32(int32x4_t x, int32x4_t y)
+{
+	int64x2_t lo, hi;
+
+	lo = vmull_s32(vget_low_s32(x), vget_low_s32(y));
+	hi = vmull_s32(vget_high_s32(x), vget_high_s32(y));
+
+	return vcombine_s32(vshrn_n_s64(lo, 32), vshrn_n_s64(hi, 32));
+}
+
+/* bitwise-OR of the 4 lanes */
+static __inline int OrLanes(int32x4_t x)
+{
+	int32x2_t t;
+
+	t = vorr_s32(vget_low_s32(x), vget_high_s32(x));
+
+	return vget_lane_s32(t, 0) | vget_lane_s32(t, 1);
+}
+
+/**************************************************************************************
+ * Function:    MidSideProcNEON
+ *
+ * Description: NEON version of MidSideProcC, 4 samples at a time
+ *
+ * Inputs:      see MidSideProcC
+ *
+ * Outputs:     see MidSideProcC
+ *
+ * Return:      none
+ **************************************************************************************/
+void MidSideProcNEON(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2])
+{
+	int i, xl, xr, mOutL, mOutR;
+	int32x4_t l, r, sum, diff, maskL, maskR;
+
+	maskL = maskR = vdupq_n_s32(0);
+	for (i = 0; i + 4 <= nSamps; i += 4) {
+		l = vld1q_s32(x[0] + i);
+		r = vld1q_s32(x[1] + i);
+		sum = vaddq_s32(l, r);
+		diff = vsubq_s32(l, r);
+		vst1q_s32(x[0] + i, sum);
+		vst1q_s32(x[1] + i, diff);
+		maskL = vorrq_s32(maskL, vabsq_s32(sum));
+		maskR = vorrq_s32(maskR, vabsq_s32(diff));
+	}
+
+	mOutL = OrLanes(maskL);
+	mOutR = OrLanes(maskR);
+	for ( ; i < nSamps; i++) {
+		xl = x[0][i];
+		xr = x[1][i];
+		x[0][i] = xl + xr;
+		x[1][i] = xl - xr;
+		mOutL |= FASTABS(x[0][i]);
+		mOutR |= FASTABS(x[1][i]);
+	}
+	mOut[0] |= mOutL;
+	mOut[1] |= mOutR;
+}
+
+/**************************************************************************************
+ * Function:    IntensityBandNEON
+ *
+ * Description: NEON version of IntensityBandC, 4 samples at a time
+ *
+ * Inputs:      see IntensityBandC
+ *
+ * Outputs:     see IntensityBandC
+ *
+ * Return:      none
+ **************************************************************************************/
+void IntensityBandNEON(int *xl, int *xr, int n, int fl, int fr, int mOut[2])
+{
+	int i, l, r, mOutL, mOutR;
+	int32x4_t x, vl, vr, factorL, factorR, maskL, maskR;
+
+	factorL = vdupq_n_s32(fl);
+	factorR = vdupq_n_s32(fr);
+	maskL = maskR = vdupq_n_s32(0);
+	for (i = 0; i + 4 <= n; i += 4) {
+		x = vld1q_s32(xl + i);
+		vr = vshlq_n_s32(MulShift32(factorR, x), 2);
+		vl = vshlq_n_s32(MulShift32(factorL, x), 2);
+		vst1q_s32(xr + i, vr);
+		vst1q_s32(xl + i, vl);
+		maskR = vorrq_s32(maskR, vabsq_s32(vr));
+		maskL = vorrq_s32(maskL, vabsq_s32(vl));
+	}
+
+	mOutL = OrLanes(maskL);
+	mOutR = OrLanes(maskR);
+	for ( ; i < n; i++) {
+		r = MULSHIFT32(fr, xl[i]) << 2;	xr[i] = r;	mOutR |= FASTABS(r);
+		l = MULSHIFT32(fl, xl[i]) << 2;	xl[i] = l;	mOutL |= FASTABS(l);
+	}
+	mOut[0] |= mOutL;
+	mOut[1] |= mOutR;
+}
+
+#endif	/* MP3DEC_SIMD_NEON */
@@ -91,7 +91,7 @@ static __inline short ClipToShort(int x, int fracBits)
 }
 
 /**************************************************************************************
- * Function:    PolyphaseMono
+ * Function:    PolyphaseMonoC
  *
  * Description: filter one subband and produce 32 output PCM samples for one channel
  *
@@ -109,7 +109,7 @@ static __inline short ClipToShort(int x, int fracBits)
  * TODO:        add 32-bit version for platforms where 64-bit mul-acc is not supported
  *                (note max filter gain - see polyCoef[] comments)
  **************************************************************************************/
-void PolyphaseMono(short *pcm, int *vbuf, const int *coefBase)
+void PolyphaseMonoC(short *pcm, int *vbuf, const int *coefBase)
 {	
 	int i;
 	const int *coef;
@@ -203,7 +203,7 @@ void PolyphaseMono(short *pcm, int *vbuf, const int *coefBase)
 }
 
 /**************************************************************************************
- * Function:    PolyphaseStereo
+ * Function:    PolyphaseStereoC
  *
  * Description: filter one subband and produce 32 output PCM samples for each channel
  *
@@ -222,7 +222,7 @@ void PolyphaseMono(short *pcm, int *vbuf, const int *coefBase)
  *
  * TODO:        add 32-bit version for platforms where 64-bit mul-acc is not supported
  **************************************************************************************/
-void PolyphaseStereo(short *pcm, int *vbuf, const int *coefBase)
+void PolyphaseStereoC(short *pcm, int *vbuf, const int *coefBase)
 {
 	int i;
 	const int *coef;
@@ -293,3 +293,27 @@ void PolyphaseStereo(short *pcm, int *vbuf, const int *coefBase)
 		pcm += 2;
 	}
 }
+
+/**************************************************************************************
+ * Function:    PolyphaseMono, PolyphaseStereo
+ *
+ * Description: run the polyphase filter picked at startup (see InitKernels)
+ *
+ * Inputs:      see PolyphaseMonoC, PolyphaseStereoC
+ *
+ * Outputs:     see PolyphaseMonoC, PolyphaseStereoC
+ *
+ * Return:      none
+ *
+ * Notes:       the SIMD versions keep the 64-bit accumulation, so every choice gives
+ *                bit-exact output
+ **************************************************************************************/
+void PolyphaseMono(short *pcm, int *vbuf, const int *coefBase)
+{
+	kernelTab.PolyphaseMono(pcm, vbuf, coefBase);
+}
+
+void PolyphaseStereo(short *pcm, int *vbuf, const int *coefBase)
+{
+	kernelTab.PolyphaseStereo(pcm, vbuf, coefBase);
+}
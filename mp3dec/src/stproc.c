@@ -45,7 +45,7 @@
 #include "assembly.h"
 
 /**************************************************************************************
- * Function:    MidSideProc
+ * Function:    MidSideProcC
  *
  * Description: sum-difference stereo reconstruction
  *
@@ -61,7 +61,7 @@
  *
  * Notes:       assume at least 1 GB in input
  **************************************************************************************/
-void MidSideProc(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2])  
+void MidSideProcC(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2])
 {
 	int i, xr, xl, mOutL, mOutR;
 	
@@ -81,6 +81,72 @@ void MidSideProc(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2])
 	mOut[1] |= mOutR;
 }
 
+/**************************************************************************************
+ * Function:    MidSideProc
+ *
+ * Description: run the version picked at startup (see InitKernels)
+ *
+ * Inputs:      see MidSideProcC
+ *
+ * Outputs:     see MidSideProcC
+ *
+ * Return:      none
+ *
+ * Notes:       sums, differences and the guard bit mask are exact in every version
+ **************************************************************************************/
+void MidSideProc(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2])
+{
+	kernelTab.MidSideProc(x, nSamps, mOut);
+}
+
+/**************************************************************************************
+ * Function:    IntensityBandC
+ *
+ * Description: intensity stereo reconstruction of one scale factor band, with the
+ *                same factors for every sample (long blocks)
+ *
+ * Inputs:      left and right channel samples of the band (right is output only)
+ *              number of samples (<= 0 does nothing)
+ *              left and right intensity factors
+ *              guard bit mask (left and right channels)
+ *
+ * Outputs:     left and right samples
+ *              updated guard bit mask
+ *
+ * Return:      none
+ **************************************************************************************/
+void IntensityBandC(int *xl, int *xr, int n, int fl, int fr, int mOut[2])
+{
+	int i, l, r, mOutL, mOutR;
+
+	mOutL = mOutR = 0;
+	for (i = 0; i < n; i++) {
+		r = MULSHIFT32(fr, xl[i]) << 2;	xr[i] = r;	mOutR |= FASTABS(r);
+		l = MULSHIFT32(fl, xl[i]) << 2;	xl[i] = l;	mOutL |= FASTABS(l);
+	}
+	mOut[0] |= mOutL;
+	mOut[1] |= mOutR;
+}
+
+/**************************************************************************************
+ * Function:    IntensityBand
+ *
+ * Description: run the version picked at startup (see InitKernels)
+ *
+ * Inputs:      see IntensityBandC
+ *
+ * Outputs:     see IntensityBandC
+ *
+ * Return:      none
+ *
+ * Notes:       the SIMD versions do the same MULSHIFT32 in every lane, so every choice
+ *                gives bit-exact output
+ **************************************************************************************/
+static __inline void IntensityBand(int *xl, int *xr, int n, int fl, int fr, int mOut[2])
+{
+	kernelTab.IntensityBand(xl, xr, n, fl, fr, mOut);
+}
+
 /**************************************************************************************
  * Function:    IntensityProcMPEG1
  *
@@ -108,7 +174,7 @@ void IntensityProcMPEG1(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, FrameHeader *fh
 {
 	int i=0, j=0, n=0, cb=0, w=0;
 	int sampsLeft, isf, mOutL, mOutR, xl, xr;
-	int fl, fr, fls[3], frs[3];
+	int fl, fr, fls[3], frs[3], mOutLR[2];
 	int cbStartL=0, cbStartS=0, cbEndL=0, cbEndS=0;
 	int *isfTab;
 	
@@ -134,7 +200,7 @@ void IntensityProcMPEG1(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, FrameHeader *fh
 
 	sampsLeft = nSamps - i;		/* process to length of left */
 	isfTab = (int *)ISFMpeg1[midSideFlag];
-	mOutL = mOutR = 0;
+	mOutLR[0] = mOutLR[1] = 0;
 
 	/* long blocks */
 	for (cb = cbStartL; cb < cbEndL && sampsLeft > 0; cb++) {
@@ -147,13 +213,13 @@ void IntensityProcMPEG1(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, FrameHeader *fh
 			fr = isfTab[6] - isfTab[isf];
 		}
 
-		n = fh->sfBand->l[cb + 1] - fh->sfBand->l[cb];
-		for (j = 0; j < n && sampsLeft > 0; j++, i++) {
-			xr = MULSHIFT32(fr, x[0][i]) << 2;	x[1][i] = xr; mOutR |= FASTABS(xr);
-			xl = MULSHIFT32(fl, x[0][i]) << 2;	x[0][i] = xl; mOutL |= FASTABS(xl);
-			sampsLeft--;
-		}
+		n = MIN(fh->sfBand->l[cb + 1] - fh->sfBand->l[cb], sampsLeft);
+		IntensityBand(x[0] + i, x[1] + i, n, fl, fr, mOutLR);
+		i += n;
+		sampsLeft -= n;
 	}
+	mOutL = mOutLR[0];
+	mOutR = mOutLR[1];
 
 	/* short blocks */
 	for (cb = cbStartS; cb < cbEndS && sampsLeft >= 3; cb++) {
@@ -214,7 +280,7 @@ void IntensityProcMPEG2(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, FrameHeader *fh
 {
 	int i, j, k, n, r, cb, w;
 	int fl, fr, mOutL, mOutR, xl, xr;
-	int sampsLeft;
+	int sampsLeft, mOutLR[2];
 	int isf, sfIdx, tmp, il[23];
 	int *isfTab;
 	int cbStartL, cbStartS, cbEndL, cbEndS;
@@ -232,6 +298,7 @@ void IntensityProcMPEG2(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, FrameHeader *fh
 	if (cbi[1].cbType == 0) {
 		/* long blocks */
 		il[21] = il[22] = 1;
+		mOutLR[0] = mOutLR[1] = 0;
 		cbStartL = cbi[1].cbEndL + 1;	/* start at end of right */
 		cbEndL =   cbi[0].cbEndL + 1;	/* process to end of left */
 		i = fh->sfBand->l[cbStartL];
@@ -249,16 +316,16 @@ void IntensityProcMPEG2(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, FrameHeader *fh
 			}
 			n = MIN(fh->sfBand->l[cb + 1] - fh->sfBand->l[cb], sampsLeft);
 
-			for(j = 0; j < n; j++, i++) {
-				xr = MULSHIFT32(fr, x[0][i]) << 2;	x[1][i] = xr;	mOutR |= FASTABS(xr);
-				xl = MULSHIFT32(fl, x[0][i]) << 2;	x[0][i] = xl;	mOutL |= FASTABS(xl);
-			}
+			IntensityBand(x[0] + i, x[1] + i, n, fl, fr, mOutLR);
+			i += n;
 
 			/* early exit once we've used all the non-zero samples */
 			sampsLeft -= n;
 			if (sampsLeft == 0)		
 				break;
 		}
+		mOutL = mOutLR[0];
+		mOutR = mOutLR[1];
 	} else {
 		/* short or mixed blocks */
 		il[12] = 1;
@@ -61,22 +61,21 @@ int Subband(MP3DecInfo *mp3DecInfo, short *pcmBuf)
 {
 	int b;
 	HuffmanInfo *hi;
-	IMDCTInfo *mi;
+	IMDCTOutInfo *mo;
 	SubbandInfo *sbi;
 
 	/* validate pointers */
-	if (!mp3DecInfo || !mp3DecInfo->HuffmanInfoPS || !mp3DecInfo->IMDCTInfoPS || !mp3DecInfo->SubbandInfoPS)
+	if (!mp3DecInfo || !mp3DecInfo->HuffmanInfoPS || !mp3DecInfo->IMDCTOutInfoPS || !mp3DecInfo->SubbandInfoPS)
 		return -1;
 
 	hi = (HuffmanInfo *)mp3DecInfo->HuffmanInfoPS;
-	mi = (IMDCTInfo *)(mp3DecInfo->IMDCTInfoPS);
+	mo = (IMDCTOutInfo *)(mp3DecInfo->IMDCTOutInfoPS);
 	sbi = (SubbandInfo*)(mp3DecInfo->SubbandInfoPS);
 
 	if (mp3DecInfo->nChans == 2) {
 		/* stereo */
 		for (b = 0; b < BLOCK_SIZE; b++) {
-			FDCT32(mi->outBuf[0][b], sbi->vbuf + 0*32, sbi->vindex, (b & 0x01), mi->gb[0]);
-			FDCT32(mi->outBuf[1][b], sbi->vbuf + 1*32, sbi->vindex, (b & 0x01), mi->gb[1]);
+			FDCT32Stereo(mo->outBuf[0][b], mo->outBuf[1][b], sbi->vbuf, sbi->vindex, (b & 0x01), mo->gb[0], mo->gb[1]);
 			PolyphaseStereo(pcmBuf, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef);
 			sbi->vindex = (sbi->vindex - (b & 0x01)) & 7;
 			pcmBuf += (2 * NBANDS);
@@ -84,7 +83,7 @@ int Subband(MP3DecInfo *mp3DecInfo, short *pcmBuf)
 	} else {
 		/* mono */
 		for (b = 0; b < BLOCK_SIZE; b++) {
-			FDCT32(mi->outBuf[0][b], sbi->vbuf + 0*32, sbi->vindex, (b & 0x01), mi->gb[0]);
+			FDCT32(mo->outBuf[0][b], sbi->vbuf + 0*32, sbi->vindex, (b & 0x01), mo->gb[0]);
 			PolyphaseMono(pcmBuf, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef);
 			sbi->vindex = (sbi->vindex - (b & 0x01)) & 7;
 			pcmBuf += NBANDS;
@@ -94,3 +93,62 @@ int Subband(MP3DecInfo *mp3DecInfo, short *pcmBuf)
 	return 0;
 }
 
+/**************************************************************************************
+ * Function:    SubbandPlanar
+ *
+ * Description: do subband transform on all the blocks in one granule, all channels,
+ *                writing each channel into its own output buffer
+ *
+ * Inputs:      filled MP3DecInfo structure, after calling IMDCT for all channels
+ *              vbuf[ch] and vindex[ch] must be preserved between calls
+ *              array of nChans pointers to PCM output buffers
+ *
+ * Outputs:     decoded PCM data, one buffer per channel (not interleaved)
+ *
+ * Return:      0 on success,  -1 if null input pointers
+ *
+ * Notes:       vbuf keeps the two channels in alternating 32-sample halves of each
+ *                64-sample row, so the mono filter run on vbuf + 32 produces exactly
+ *                the right channel of PolyphaseStereo (bit-exact with Subband)
+ **************************************************************************************/
+int SubbandPlanar(MP3DecInfo *mp3DecInfo, short *pcmBuf[MAX_NCHAN])
+{
+	int b;
+	short *pcmL, *pcmR;
+	HuffmanInfo *hi;
+	IMDCTOutInfo *mo;
+	SubbandInfo *sbi;
+
+	/* validate pointers */
+	if (!mp3DecInfo || !mp3DecInfo->HuffmanInfoPS || !mp3DecInfo->IMDCTOutInfoPS || !mp3DecInfo->SubbandInfoPS)
+		return -1;
+
+	hi = (HuffmanInfo *)mp3DecInfo->HuffmanInfoPS;
+	mo = (IMDCTOutInfo *)(mp3DecInfo->IMDCTOutInfoPS);
+	sbi = (SubbandInfo*)(mp3DecInfo->SubbandInfoPS);
+
+	pcmL = pcmBuf[0];
+
+	if (mp3DecInfo->nChans == 2) {
+		/* stereo */
+		pcmR = pcmBuf[1];
+		for (b = 0; b < BLOCK_SIZE; b++) {
+			FDCT32Stereo(mo->outBuf[0][b], mo->outBuf[1][b], sbi->vbuf, sbi->vindex, (b & 0x01), mo->gb[0], mo->gb[1]);
+			PolyphaseMono(pcmL, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01) + 0*32, polyCoef);
+			PolyphaseMono(pcmR, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01) + 1*32, polyCoef);
+			sbi->vindex = (sbi->vindex - (b & 0x01)) & 7;
+			pcmL += NBANDS;
+			pcmR += NBANDS;
+		}
+	} else {
+		/* mono */
+		for (b = 0; b < BLOCK_SIZE; b++) {
+			FDCT32(mo->outBuf[0][b], sbi->vbuf + 0*32, sbi->vindex, (b & 0x01), mo->gb[0]);
+			PolyphaseMono(pcmL, sbi->vbuf + sbi->vindex + VBUF_LENGTH * (b & 0x01), polyCoef);
+			sbi->vindex = (sbi->vindex - (b & 0x01)) & 7;
+			pcmL += NBANDS;
+		}
+	}
+
+	return 0;
+}
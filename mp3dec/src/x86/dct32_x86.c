@@ -0,0 +1,357 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * dct32_x86.c - SSE4.1 and AVX2 versions of the 32-point DCT
+ *
+ * Bit-exact with dct32.c: the first pass runs the butterflies side by side,
+ *   the second pass runs the 4 blocks of 8 side by side (and with AVX2 both
+ *   channels), with MULSHIFT32 done as a full 32x32 -> 64-bit multiply (pmuldq).
+ *   The output shuffle into the polyphase buffer is FDCT32Output.
+ *
+ * There is no AVX2 version for one channel: its second pass only fills 4 lanes
+ *   and the scalar output shuffle dominates, so it was slower than SSE4.1.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_X86
+
+#include <immintrin.h>
+
+/* scaling - ensure at least 6 guard bits for DCT, see FDCT32C */
+static __inline int Prescale(int *buf, int gb)
+{
+	int i, es;
+
+	es = 0;
+	if (gb < 6) {
+		es = 6 - gb;
+		for (i = 0; i < 32; i++)
+			buf[i] >>= es;
+	}
+
+	return es;
+}
+
+/* MULSHIFT32 of each lane: pmuldq multiplies the even lanes, so the odd lanes are moved down */
+static __inline TARGET_SSE41 __m128i MulShift32SSE41(__m128i x, __m128i y)
+{
+	__m128i even, odd;
+
+	even = _mm_srli_epi64(_mm_mul_epi32(x, y), 32);
+	odd = _mm_mul_epi32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32));
+
+	return _mm_blend_epi16(even, odd, 0xcc);
+}
+
+static __inline TARGET_SSE41 __m128i ReverseSSE41(__m128i x)
+{
+	return _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+static __inline TARGET_SSE41 void Transpose4SSE41(__m128i *r0, __m128i *r1, __m128i *r2, __m128i *r3)
+{
+	__m128i t0, t1, t2, t3;
+
+	t0 = _mm_unpacklo_epi32(*r0, *r1);
+	t1 = _mm_unpacklo_epi32(*r2, *r3);
+	t2 = _mm_unpackhi_epi32(*r0, *r1);
+	t3 = _mm_unpackhi_epi32(*r2, *r3);
+
+	*r0 = _mm_unpacklo_epi64(t0, t1);
+	*r1 = _mm_unpackhi_epi64(t0, t1);
+	*r2 = _mm_unpacklo_epi64(t2, t3);
+	*r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+/* first pass (D32FP) on butterflies i = 4*h ... 4*h + 3
+ *   x = buf[i], y = buf[15-i], z = buf[16+i], w = buf[31-i]
+ */
+static __inline TARGET_SSE41 void FirstPassSSE41(const int *buf, int h, __m128i *x, __m128i *y, __m128i *z, __m128i *w)
+{
+	__m128i a0, a1, a2, a3, b0, b1, b2, b3;
+	__m128i c0, c1, c2, m1, m2;
+
+	c0 = _mm_loadu_si128((const __m128i *)(dcttabLanes[0] + 4*h));
+	c1 = _mm_loadu_si128((const __m128i *)(dcttabLanes[1] + 4*h));
+	c2 = _mm_loadu_si128((const __m128i *)(dcttabLanes[2] + 4*h));
+	m1 = _mm_loadu_si128((const __m128i *)(dcttabLanes[3] + 4*h));
+	m2 = _mm_loadu_si128((const __m128i *)(dcttabLanes[4] + 4*h));
+
+	a0 = _mm_loadu_si128((const __m128i *)(buf + 4*h));
+	a3 = ReverseSSE41(_mm_loadu_si128((const __m128i *)(buf + 28 - 4*h)));
+	a1 = ReverseSSE41(_mm_loadu_si128((const __m128i *)(buf + 12 - 4*h)));
+	a2 = _mm_loadu_si128((const __m128i *)(buf + 16 + 4*h));
+
+	/* the variable shifts are multiplies by (1 << s), exact in 32 bits */
+	b0 = _mm_add_epi32(a0, a3);
+	b3 = _mm_slli_epi32(MulShift32SSE41(c0, _mm_sub_epi32(a0, a3)), 1);
+	b1 = _mm_add_epi32(a1, a2);
+	b2 = _mm_mullo_epi32(MulShift32SSE41(c1, _mm_sub_epi32(a1, a2)), m1);
+
+	*x = _mm_add_epi32(b0, b1);
+	*y = _mm_mullo_epi32(MulShift32SSE41(c2, _mm_sub_epi32(b0, b1)), m2);
+	*z = _mm_add_epi32(b2, b3);
+	*w = _mm_mullo_epi32(MulShift32SSE41(c2, _mm_sub_epi32(b3, b2)), m2);
+}
+
+/* second pass on the four blocks of 8, r[j] holds sample j of blocks 0, 1, 2, 3 */
+static __inline TARGET_SSE41 void SecondPassSSE41(__m128i *r)
+{
+	__m128i a0, a1, a2, a3, a4, a5, a6, a7;
+	__m128i b0, b1, b2, b3, b4, b5, b6, b7;
+	__m128i c0, c1, c2, c3, c4, c5, c6;
+
+	c0 = _mm_loadu_si128((const __m128i *)dcttabLanes[5]);
+	c1 = _mm_loadu_si128((const __m128i *)dcttabLanes[6]);
+	c2 = _mm_loadu_si128((const __m128i *)dcttabLanes[7]);
+	c3 = _mm_loadu_si128((const __m128i *)dcttabLanes[8]);
+	c4 = _mm_loadu_si128((const __m128i *)dcttabLanes[9]);
+	c5 = _mm_loadu_si128((const __m128i *)dcttabLanes[10]);
+	c6 = _mm_loadu_si128((const __m128i *)dcttabLanes[11]);
+
+	b0 = _mm_add_epi32(r[0], r[7]);		b7 = _mm_slli_epi32(MulShift32SSE41(c0, _mm_sub_epi32(r[0], r[7])), 1);
+	b3 = _mm_add_epi32(r[3], r[4]);		b4 = _mm_slli_epi32(MulShift32SSE41(c1, _mm_sub_epi32(r[3], r[4])), 3);
+	a0 = _mm_add_epi32(b0, b3);			a3 = _mm_slli_epi32(MulShift32SSE41(c2, _mm_sub_epi32(b0, b3)), 1);
+	a4 = _mm_add_epi32(b4, b7);			a7 = _mm_slli_epi32(MulShift32SSE41(c2, _mm_sub_epi32(b7, b4)), 1);
+
+	b1 = _mm_add_epi32(r[1], r[6]);		b6 = _mm_slli_epi32(MulShift32SSE41(c3, _mm_sub_epi32(r[1], r[6])), 1);
+	b2 = _mm_add_epi32(r[2], r[5]);		b5 = _mm_slli_epi32(MulShift32SSE41(c4, _mm_sub_epi32(r[2], r[5])), 1);
+	a1 = _mm_add_epi32(b1, b2);			a2 = _mm_slli_epi32(MulShift32SSE41(c5, _mm_sub_epi32(b1, b2)), 2);
+	a5 = _mm_add_epi32(b5, b6);			a6 = _mm_slli_epi32(MulShift32SSE41(c5, _mm_sub_epi32(b6, b5)), 2);
+
+	b0 = _mm_add_epi32(a0, a1);			b1 = _mm_slli_epi32(MulShift32SSE41(c6, _mm_sub_epi32(a0, a1)), 1);
+	b2 = _mm_add_epi32(a2, a3);			b3 = _mm_slli_epi32(MulShift32SSE41(c6, _mm_sub_epi32(a3, a2)), 1);
+	r[0] = b0;							r[1] = b1;
+	r[2] = _mm_add_epi32(b2, b3);		r[3] = b3;
+
+	b4 = _mm_add_epi32(a4, a5);			b5 = _mm_slli_epi32(MulShift32SSE41(c6, _mm_sub_epi32(a4, a5)), 1);
+	b6 = _mm_add_epi32(a6, a7);			b7 = _mm_slli_epi32(MulShift32SSE41(c6, _mm_sub_epi32(a7, a6)), 1);
+	b6 = _mm_add_epi32(b6, b7);
+	r[4] = _mm_add_epi32(b4, b6);		r[5] = _mm_add_epi32(b5, b7);
+	r[6] = _mm_add_epi32(b5, b6);		r[7] = b7;
+}
+
+/* transpose the second pass output back to buf[8*k + j] */
+static __inline TARGET_SSE41 void StoreBlocksSSE41(int *buf, __m128i *r)
+{
+	int k;
+
+	Transpose4SSE41(&r[0], &r[1], &r[2], &r[3]);
+	Transpose4SSE41(&r[4], &r[5], &r[6], &r[7]);
+
+	for (k = 0; k < 4; k++) {
+		_mm_storeu_si128((__m128i *)(buf + 8*k + 0), r[k]);
+		_mm_storeu_si128((__m128i *)(buf + 8*k + 4), r[4 + k]);
+	}
+}
+
+/* both passes of FDCT32C on one channel, leaving the same buf[] for FDCT32Output */
+static __inline TARGET_SSE41 void TransformSSE41(int *buf)
+{
+	__m128i x0, y0, z0, w0, x1, y1, z1, w1;
+	__m128i r[8];
+
+	FirstPassSSE41(buf, 0, &x0, &y0, &z0, &w0);
+	FirstPassSSE41(buf, 1, &x1, &y1, &z1, &w1);
+
+	/* buf[j], buf[8+j], buf[16+j], buf[24+j] for j = 0 ... 3, then j = 4 ... 7 */
+	r[0] = x0;	r[1] = ReverseSSE41(y1);	r[2] = z0;	r[3] = ReverseSSE41(w1);
+	r[4] = x1;	r[5] = ReverseSSE41(y0);	r[6] = z1;	r[7] = ReverseSSE41(w0);
+	Transpose4SSE41(&r[0], &r[1], &r[2], &r[3]);
+	Transpose4SSE41(&r[4], &r[5], &r[6], &r[7]);
+
+	SecondPassSSE41(r);
+
+	StoreBlocksSSE41(buf, r);
+}
+
+/**************************************************************************************
+ * Function:    FDCT32SSE41
+ *
+ * Description: SSE4.1 version of FDCT32C, four butterflies per instruction
+ *
+ * Inputs:      see FDCT32C
+ *
+ * Outputs:     see FDCT32C
+ *
+ * Return:      none
+ **************************************************************************************/
+TARGET_SSE41 void FDCT32SSE41(int *buf, int *dest, int offset, int oddBlock, int gb)
+{
+	int es;
+
+	es = Prescale(buf, gb);
+	TransformSSE41(buf);
+	FDCT32Output(buf, dest, offset, oddBlock, es);
+}
+
+/**************************************************************************************
+ * Function:    FDCT32StereoSSE41
+ *
+ * Description: SSE4.1 version of FDCT32StereoC
+ *
+ * Inputs:      see FDCT32StereoC
+ *
+ * Outputs:     see FDCT32StereoC
+ *
+ * Return:      none
+ *
+ * Notes:       the two channels are independent, so running them in one function
+ *                lets their multiplies overlap
+ **************************************************************************************/
+TARGET_SSE41 void FDCT32StereoSSE41(int *bufL, int *bufR, int *dest, int offset, int oddBlock, int gbL, int gbR)
+{
+	int esL, esR;
+
+	esL = Prescale(bufL, gbL);
+	esR = Prescale(bufR, gbR);
+	TransformSSE41(bufL);
+	TransformSSE41(bufR);
+	FDCT32Output(bufL, dest + 0*32, offset, oddBlock, esL);
+	FDCT32Output(bufR, dest + 1*32, offset, oddBlock, esR);
+}
+
+static __inline TARGET_AVX2 __m256i MulShift32AVX2(__m256i x, __m256i y)
+{
+	__m256i even, odd;
+
+	even = _mm256_srli_epi64(_mm256_mul_epi32(x, y), 32);
+	odd = _mm256_mul_epi32(_mm256_srli_epi64(x, 32), _mm256_srli_epi64(y, 32));
+
+	return _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+static __inline TARGET_AVX2 __m256i ReverseAVX2(__m256i x)
+{
+	return _mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+/* first pass on all 8 butterflies, rows q[k] = buf[8*k] ... buf[8*k + 7] */
+static __inline TARGET_AVX2 void FirstPassAVX2(const int *buf, __m256i *q)
+{
+	__m256i a0, a1, a2, a3, b0, b1, b2, b3;
+	__m256i c0, c1, c2, m1, m2;
+
+	c0 = _mm256_loadu_si256((const __m256i *)dcttabLanes[0]);
+	c1 = _mm256_loadu_si256((const __m256i *)dcttabLanes[1]);
+	c2 = _mm256_loadu_si256((const __m256i *)dcttabLanes[2]);
+	m1 = _mm256_loadu_si256((const __m256i *)dcttabLanes[3]);
+	m2 = _mm256_loadu_si256((const __m256i *)dcttabLanes[4]);
+
+	a0 = _mm256_loadu_si256((const __m256i *)(buf + 0));
+	a3 = ReverseAVX2(_mm256_loadu_si256((const __m256i *)(buf + 24)));
+	a1 = ReverseAVX2(_mm256_loadu_si256((const __m256i *)(buf + 8)));
+	a2 = _mm256_loadu_si256((const __m256i *)(buf + 16));
+
+	b0 = _mm256_add_epi32(a0, a3);
+	b3 = _mm256_slli_epi32(MulShift32AVX2(c0, _mm256_sub_epi32(a0, a3)), 1);
+	b1 = _mm256_add_epi32(a1, a2);
+	b2 = _mm256_mullo_epi32(MulShift32AVX2(c1, _mm256_sub_epi32(a1, a2)), m1);
+
+	q[0] = _mm256_add_epi32(b0, b1);
+	q[1] = ReverseAVX2(_mm256_mullo_epi32(MulShift32AVX2(c2, _mm256_sub_epi32(b0, b1)), m2));
+	q[2] = _mm256_add_epi32(b2, b3);
+	q[3] = ReverseAVX2(_mm256_mullo_epi32(MulShift32AVX2(c2, _mm256_sub_epi32(b3, b2)), m2));
+}
+
+/* Transpose4SSE41 on both 128-bit halves */
+static __inline TARGET_AVX2 void Transpose4AVX2(__m256i *r0, __m256i *r1, __m256i *r2, __m256i *r3)
+{
+	__m256i t0, t1, t2, t3;
+
+	t0 = _mm256_unpacklo_epi32(*r0, *r1);
+	t1 = _mm256_unpacklo_epi32(*r2, *r3);
+	t2 = _mm256_unpackhi_epi32(*r0, *r1);
+	t3 = _mm256_unpackhi_epi32(*r2, *r3);
+
+	*r0 = _mm256_unpacklo_epi64(t0, t1);
+	*r1 = _mm256_unpackhi_epi64(t0, t1);
+	*r2 = _mm256_unpacklo_epi64(t2, t3);
+	*r3 = _mm256_unpackhi_epi64(t2, t3);
+}
+
+/* SecondPassSSE41 with the left channel in the low half and the right channel in the high half */
+static __inline TARGET_AVX2 void SecondPassAVX2(__m256i *r)
+{
+	__m256i a0, a1, a2, a3, a4, a5, a6, a7;
+	__m256i b0, b1, b2, b3, b4, b5, b6, b7;
+	__m256i c0, c1, c2, c3, c4, c5, c6;
+
+	c0 = _mm256_loadu_si256((const __m256i *)dcttabLanes[5]);
+	c1 = _mm256_loadu_si256((const __m256i *)dcttabLanes[6]);
+	c2 = _mm256_loadu_si256((const __m256i *)dcttabLanes[7]);
+	c3 = _mm256_loadu_si256((const __m256i *)dcttabLanes[8]);
+	c4 = _mm256_loadu_si256((const __m256i *)dcttabLanes[9]);
+	c5 = _mm256_loadu_si256((const __m256i *)dcttabLanes[10]);
+	c6 = _mm256_loadu_si256((const __m256i *)dcttabLanes[11]);
+
+	b0 = _mm256_add_epi32(r[0], r[7]);	b7 = _mm256_slli_epi32(MulShift32AVX2(c0, _mm256_sub_epi32(r[0], r[7])), 1);
+	b3 = _mm256_add_epi32(r[3], r[4]);	b4 = _mm256_slli_epi32(MulShift32AVX2(c1, _mm256_sub_epi32(r[3], r[4])), 3);
+	a0 = _mm256_add_epi32(b0, b3);		a3 = _mm256_slli_epi32(MulShift32AVX2(c2, _mm256_sub_epi32(b0, b3)), 1);
+	a4 = _mm256_add_epi32(b4, b7);		a7 = _mm256_slli_epi32(MulShift32AVX2(c2, _mm256_sub_epi32(b7, b4)), 1);
+
+	b1 = _mm256_add_epi32(r[1], r[6]);	b6 = _mm256_slli_epi32(MulShift32AVX2(c3, _mm256_sub_epi32(r[1], r[6])), 1);
+	b2 = _mm256_add_epi32(r[2], r[5]);	b5 = _mm256_slli_epi32(MulShift32AVX2(c4, _mm256_sub_epi32(r[2], r[5])), 1);
+	a1 = _mm256_add_epi32(b1, b2);		a2 = _mm256_slli_epi32(MulShift32AVX2(c5, _mm256_sub_epi32(b1, b2)), 2);
+	a5 = _mm256_add_epi32(b5, b6);		a6 = _mm256_slli_epi32(MulShift32AVX2(c5, _mm256_sub_epi32(b6, b5)), 2);
+
+	b0 = _mm256_add_epi32(a0, a1);		b1 = _mm256_slli_epi32(MulShift32AVX2(c6, _mm256_sub_epi32(a0, a1)), 1);
+	b2 = _mm256_add_epi32(a2, a3);		b3 = _mm256_slli_epi32(MulShift32AVX2(c6, _mm256_sub_epi32(a3, a2)), 1);
+	r[0] = b0;							r[1] = b1;
+	r[2] = _mm256_add_epi32(b2, b3);	r[3] = b3;
+
+	b4 = _mm256_add_epi32(a4, a5);		b5 = _mm256_slli_epi32(MulShift32AVX2(c6, _mm256_sub_epi32(a4, a5)), 1);
+	b6 = _mm256_add_epi32(a6, a7);		b7 = _mm256_slli_epi32(MulShift32AVX2(c6, _mm256_sub_epi32(a7, a6)), 1);
+	b6 = _mm256_add_epi32(b6, b7);
+	r[4] = _mm256_add_epi32(b4, b6);	r[5] = _mm256_add_epi32(b5, b7);
+	r[6] = _mm256_add_epi32(b5, b6);	r[7] = b7;
+}
+
+/**************************************************************************************
+ * Function:    FDCT32StereoAVX2
+ *
+ * Description: AVX2 version of FDCT32StereoC, the second pass does both channels
+ *                in one set of 8-lane vectors
+ *
+ * Inputs:      see FDCT32StereoC
+ *
+ * Outputs:     see FDCT32StereoC
+ *
+ * Return:      none
+ **************************************************************************************/
+TARGET_AVX2 void FDCT32StereoAVX2(int *bufL, int *bufR, int *dest, int offset, int oddBlock, int gbL, int gbR)
+{
+	int k, esL, esR;
+	__m256i qL[4], qR[4];
+	__m256i r[8];
+
+	esL = Prescale(bufL, gbL);
+	esR = Prescale(bufR, gbR);
+
+	FirstPassAVX2(bufL, qL);
+	FirstPassAVX2(bufR, qR);
+
+	/* low half = left, high half = right, then transpose each half */
+	for (k = 0; k < 4; k++) {
+		r[k]     = _mm256_permute2x128_si256(qL[k], qR[k], 0x20);
+		r[4 + k] = _mm256_permute2x128_si256(qL[k], qR[k], 0x31);
+	}
+	Transpose4AVX2(&r[0], &r[1], &r[2], &r[3]);
+	Transpose4AVX2(&r[4], &r[5], &r[6], &r[7]);
+
+	SecondPassAVX2(r);
+
+	Transpose4AVX2(&r[0], &r[1], &r[2], &r[3]);
+	Transpose4AVX2(&r[4], &r[5], &r[6], &r[7]);
+	for (k = 0; k < 4; k++) {
+		_mm256_storeu_si256((__m256i *)(bufL + 8*k), _mm256_permute2x128_si256(r[k], r[4 + k], 0x20));
+		_mm256_storeu_si256((__m256i *)(bufR + 8*k), _mm256_permute2x128_si256(r[k], r[4 + k], 0x31));
+	}
+
+	FDCT32Output(bufL, dest + 0*32, offset, oddBlock, esL);
+	FDCT32Output(bufR, dest + 1*32, offset, oddBlock, esR);
+}
+
+#endif	/* MP3DEC_SIMD_X86 */
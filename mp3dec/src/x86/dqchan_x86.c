@@ -0,0 +1,288 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * dqchan_x86.c - SSE4.1 and AVX2 versions of DequantBlock
+ *
+ * Bit-exact with dqchan.c: most Huffman values are 0 or 1, so the common case is a
+ *   group where every magnitude is below 4. DequantBlockC's tab4 then fits in one
+ *   register and a single pshufb looks up all the lanes.
+ *   Otherwise magnitudes 0-15 look up pow43_14 with pshufb (the table is split into
+ *   4 byte planes, pow43_14Planes) and do the scalar shifts, with the same uniform
+ *   shift in every lane.
+ *   Magnitudes 16-63 load pow43[] (a hardware gather with AVX2) and do the scalar
+ *   MULSHIFT32 and shift.
+ *   A group of samples holding a magnitude of 64 or more goes through DequantBlockC.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_X86
+
+#include <immintrin.h>
+
+/* per-block scaling, see DequantBlockC (at most one of each right/left pair is non-zero) */
+typedef struct _DequantScale {
+	const int *tab16;				/* pow43_14[scale & 0x3] */
+	const unsigned char *planes;	/* pow43_14Planes[scale & 0x3] */
+	int shift4;						/* right shift for magnitudes 0-3 */
+	int shiftRight, shiftLeft;		/* magnitudes 4-15 */
+	int scalef;						/* fractional scale for magnitudes 16-63 */
+	int bigRight, bigLeft;			/* integer scale for magnitudes 16-63 */
+	int limit;						/* clip to 0x7fffffff above this (before bigLeft) */
+} DequantScale;
+
+static __inline void InitDequantScale(DequantScale *ds, int scale)
+{
+	int scalei;
+
+	scalei = MIN(scale >> 2, 31);	/* smallest input scale = -47, so smallest scalei = -12 */
+
+	ds->tab16 = pow43_14[scale & 0x3];
+	ds->planes = pow43_14Planes[scale & 0x3][0];
+	ds->shift4 = MAX(MIN(scalei + 3, 31), 0);
+	ds->shiftRight = MAX(scalei, 0);
+	ds->shiftLeft = MAX(-scalei, 0);
+	ds->scalef = pow14[scale & 0x3];
+	ds->bigRight = MAX(scalei - 3, 0);
+	ds->bigLeft = MAX(3 - scalei, 0);
+	ds->limit = 0x7fffffff >> ds->bigLeft;
+}
+
+/* MULSHIFT32 of each lane: pmuldq multiplies the even lanes, so the odd lanes are moved down */
+static __inline TARGET_SSE41 __m128i MulShift32SSE41(__m128i x, __m128i y)
+{
+	__m128i even, odd;
+
+	even = _mm_srli_epi64(_mm_mul_epi32(x, y), 32);
+	odd = _mm_mul_epi32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32));
+
+	return _mm_blend_epi16(even, odd, 0xcc);
+}
+
+static __inline TARGET_AVX2 __m256i MulShift32AVX2(__m256i x, __m256i y)
+{
+	__m256i even, odd;
+
+	even = _mm256_srli_epi64(_mm256_mul_epi32(x, y), 32);
+	odd = _mm256_mul_epi32(_mm256_srli_epi64(x, 32), _mm256_srli_epi64(y, 32));
+
+	return _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+/**************************************************************************************
+ * Function:    Dequant4SSE41
+ *
+ * Description: dequantize 4 samples with magnitudes < 64
+ *
+ * Inputs:      DequantScale struct for the block
+ *              tab4 (see DequantBlockC)
+ *              samples (sign|mag)
+ *
+ * Outputs:     bitwise-OR of the unsigned outputs, ORed into mask
+ *
+ * Return:      dequantized samples
+ **************************************************************************************/
+static __inline TARGET_SSE41 __m128i Dequant4SSE41(const DequantScale *ds, __m128i tab4, __m128i sx, __m128i *mask)
+{
+	const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
+	const __m128i odd = _mm_set1_epi16((short)0xff00);
+	__m128i x, idx, p0, p1, p2, p3, b01, b23, y, ys, yb;
+
+	x = _mm_and_si128(sx, _mm_set1_epi32(0x7fffffff));	/* sx = sign|mag */
+
+	/* all below 4: bytes 4x ... 4x+3 of tab4 */
+	if (_mm_testz_si128(x, _mm_set1_epi32(~3))) {
+		idx = _mm_add_epi8(_mm_shuffle_epi8(_mm_slli_epi32(x, 2), spread), _mm_set1_epi32(0x03020100));
+		y = _mm_shuffle_epi8(tab4, idx);
+
+		*mask = _mm_or_si128(*mask, y);
+
+		return _mm_sign_epi32(y, sx);
+	}
+
+	/* pow43_14[x] for x < 16, byte b from plane b (pshufb only looks at the low 4 bits of each index) */
+	p0 = _mm_loadu_si128((const __m128i *)(ds->planes +  0));
+	p1 = _mm_loadu_si128((const __m128i *)(ds->planes + 16));
+	p2 = _mm_loadu_si128((const __m128i *)(ds->planes + 32));
+	p3 = _mm_loadu_si128((const __m128i *)(ds->planes + 48));
+
+	idx = _mm_shuffle_epi8(x, spread);
+	b01 = _mm_blendv_epi8(_mm_shuffle_epi8(p0, idx), _mm_shuffle_epi8(p1, idx), odd);
+	b23 = _mm_blendv_epi8(_mm_shuffle_epi8(p2, idx), _mm_shuffle_epi8(p3, idx), odd);
+	y = _mm_blend_epi16(b01, b23, 0xaa);
+
+	/* 0-3 have 3 more fraction bits than 4-15 */
+	ys = _mm_sll_epi32(_mm_sra_epi32(y, _mm_cvtsi32_si128(ds->shiftRight)), _mm_cvtsi32_si128(ds->shiftLeft));
+	y = _mm_blendv_epi8(ys, _mm_sra_epi32(y, _mm_cvtsi32_si128(ds->shift4)), _mm_cmplt_epi32(x, _mm_set1_epi32(4)));
+
+	/* 16-63: fractional scale, then integer scale (clipping if it shifts left) */
+	if (!_mm_testz_si128(x, _mm_set1_epi32(~15))) {
+		int i[4];
+
+		_mm_storeu_si128((__m128i *)i, _mm_max_epi32(_mm_sub_epi32(x, _mm_set1_epi32(16)), _mm_setzero_si128()));
+		yb = _mm_setr_epi32(pow43[i[0]], pow43[i[1]], pow43[i[2]], pow43[i[3]]);
+		yb = MulShift32SSE41(yb, _mm_set1_epi32(ds->scalef));
+		yb = _mm_blendv_epi8(_mm_sll_epi32(_mm_sra_epi32(yb, _mm_cvtsi32_si128(ds->bigRight)), _mm_cvtsi32_si128(ds->bigLeft)),
+		                     _mm_set1_epi32(0x7fffffff), _mm_cmpgt_epi32(yb, _mm_set1_epi32(ds->limit)));
+
+		y = _mm_blendv_epi8(y, yb, _mm_cmpgt_epi32(x, _mm_set1_epi32(15)));
+	}
+
+	/* sign (x = 0 gives y = 0, so psignd's zeroing doesn't matter) */
+	*mask = _mm_or_si128(*mask, y);
+
+	return _mm_sign_epi32(y, sx);
+}
+
+static __inline TARGET_AVX2 __m256i Dequant8AVX2(const DequantScale *ds, __m256i tab4, __m256i sx, __m256i *mask)
+{
+	const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12,
+	                                        0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
+	const __m256i odd = _mm256_set1_epi16((short)0xff00);
+	__m256i x, idx, p0, p1, p2, p3, b01, b23, y, ys, yb;
+
+	x = _mm256_and_si256(sx, _mm256_set1_epi32(0x7fffffff));
+
+	if (_mm256_testz_si256(x, _mm256_set1_epi32(~3))) {
+		idx = _mm256_add_epi8(_mm256_shuffle_epi8(_mm256_slli_epi32(x, 2), spread), _mm256_set1_epi32(0x03020100));
+		y = _mm256_shuffle_epi8(tab4, idx);
+
+		*mask = _mm256_or_si256(*mask, y);
+
+		return _mm256_sign_epi32(y, sx);
+	}
+
+	p0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(ds->planes +  0)));
+	p1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(ds->planes + 16)));
+	p2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(ds->planes + 32)));
+	p3 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(ds->planes + 48)));
+
+	idx = _mm256_shuffle_epi8(x, spread);
+	b01 = _mm256_blendv_epi8(_mm256_shuffle_epi8(p0, idx), _mm256_shuffle_epi8(p1, idx), odd);
+	b23 = _mm256_blendv_epi8(_mm256_shuffle_epi8(p2, idx), _mm256_shuffle_epi8(p3, idx), odd);
+	y = _mm256_blend_epi16(b01, b23, 0xaa);
+
+	ys = _mm256_sll_epi32(_mm256_sra_epi32(y, _mm_cvtsi32_si128(ds->shiftRight)), _mm_cvtsi32_si128(ds->shiftLeft));
+	y = _mm256_blendv_epi8(ys, _mm256_sra_epi32(y, _mm_cvtsi32_si128(ds->shift4)), _mm256_cmpgt_epi32(_mm256_set1_epi32(4), x));
+
+	if (!_mm256_testz_si256(x, _mm256_set1_epi32(~15))) {
+		yb = _mm256_i32gather_epi32(pow43, _mm256_max_epi32(_mm256_sub_epi32(x, _mm256_set1_epi32(16)), _mm256_setzero_si256()), 4);
+		yb = MulShift32AVX2(yb, _mm256_set1_epi32(ds->scalef));
+		yb = _mm256_blendv_epi8(_mm256_sll_epi32(_mm256_sra_epi32(yb, _mm_cvtsi32_si128(ds->bigRight)), _mm_cvtsi32_si128(ds->bigLeft)),
+		                        _mm256_set1_epi32(0x7fffffff), _mm256_cmpgt_epi32(yb, _mm256_set1_epi32(ds->limit)));
+
+		y = _mm256_blendv_epi8(y, yb, _mm256_cmpgt_epi32(x, _mm256_set1_epi32(15)));
+	}
+
+	*mask = _mm256_or_si256(*mask, y);
+
+	return _mm256_sign_epi32(y, sx);
+}
+
+/* sign bit is ignored, so this is also true for magnitudes of 64 or more */
+static __inline TARGET_SSE41 int AnyLargeSSE41(__m128i sx)
+{
+	return !_mm_testz_si128(sx, _mm_set1_epi32(0x7fffffc0));
+}
+
+static __inline TARGET_SSE41 int OrLanesSSE41(__m128i mask)
+{
+	mask = _mm_or_si128(mask, _mm_shuffle_epi32(mask, _MM_SHUFFLE(1, 0, 3, 2)));
+	mask = _mm_or_si128(mask, _mm_shuffle_epi32(mask, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_cvtsi128_si32(mask);
+}
+
+/**************************************************************************************
+ * Function:    DequantBlockSSE41
+ *
+ * Description: SSE4.1 version of DequantBlockC, 4 samples at a time
+ *
+ * Inputs:      see DequantBlockC
+ *
+ * Outputs:     see DequantBlockC
+ *
+ * Return:      see DequantBlockC
+ *
+ * Notes:       the last 1-3 samples are padded with zeros
+ **************************************************************************************/
+TARGET_SSE41 int DequantBlockSSE41(int *inbuf, int *outbuf, int num, int scale)
+{
+	DequantScale ds;
+	__m128i tab4, sx, mask;
+	int i, k, tail[4];
+	int m = 0;
+
+	InitDequantScale(&ds, scale);
+	tab4 = _mm_sra_epi32(_mm_loadu_si128((const __m128i *)ds.tab16), _mm_cvtsi32_si128(ds.shift4));
+	mask = _mm_setzero_si128();
+
+	for (i = 0; i + 4 <= num; i += 4) {
+		sx = _mm_loadu_si128((const __m128i *)(inbuf + i));
+		if (AnyLargeSSE41(sx))
+			m |= DequantBlockC(inbuf + i, outbuf + i, 4, scale);
+		else
+			_mm_storeu_si128((__m128i *)(outbuf + i), Dequant4SSE41(&ds, tab4, sx, &mask));
+	}
+
+	if (i < num) {
+		for (k = 0; k < 4; k++)
+			tail[k] = (i + k < num) ? inbuf[i + k] : 0;
+
+		sx = _mm_loadu_si128((const __m128i *)tail);
+		if (AnyLargeSSE41(sx)) {
+			m |= DequantBlockC(inbuf + i, outbuf + i, num - i, scale);
+		} else {
+			_mm_storeu_si128((__m128i *)tail, Dequant4SSE41(&ds, tab4, sx, &mask));
+			for (k = 0; i + k < num; k++)
+				outbuf[i + k] = tail[k];
+		}
+	}
+
+	return m | OrLanesSSE41(mask);
+}
+
+/**************************************************************************************
+ * Function:    DequantBlockAVX2
+ *
+ * Description: AVX2 version of DequantBlockC, 8 samples at a time
+ *
+ * Inputs:      see DequantBlockC
+ *
+ * Outputs:     see DequantBlockC
+ *
+ * Return:      see DequantBlockC
+ *
+ * Notes:       a group of 8 with a large magnitude, and the last 1-7 samples, go
+ *                through DequantBlockSSE41
+ **************************************************************************************/
+TARGET_AVX2 int DequantBlockAVX2(int *inbuf, int *outbuf, int num, int scale)
+{
+	DequantScale ds;
+	__m256i tab4, sx, mask;
+	int i;
+	int m = 0;
+
+	if (num < 8)
+		return DequantBlockSSE41(inbuf, outbuf, num, scale);
+
+	InitDequantScale(&ds, scale);
+	tab4 = _mm256_broadcastsi128_si256(_mm_sra_epi32(_mm_loadu_si128((const __m128i *)ds.tab16), _mm_cvtsi32_si128(ds.shift4)));
+	mask = _mm256_setzero_si256();
+
+	for (i = 0; i + 8 <= num; i += 8) {
+		sx = _mm256_loadu_si256((const __m256i *)(inbuf + i));
+		if (!_mm256_testz_si256(sx, _mm256_set1_epi32(0x7fffffc0)))
+			m |= DequantBlockSSE41(inbuf + i, outbuf + i, 8, scale);
+		else
+			_mm256_storeu_si256((__m256i *)(outbuf + i), Dequant8AVX2(&ds, tab4, sx, &mask));
+	}
+
+	if (i < num)
+		m |= DequantBlockSSE41(inbuf + i, outbuf + i, num - i, scale);
+
+	return m | OrLanesSSE41(_mm_or_si128(_mm256_castsi256_si128(mask), _mm256_extracti128_si256(mask, 1)));
+}
+
+#endif	/* MP3DEC_SIMD_X86 */
@@ -0,0 +1,438 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * imdct_x86.c - SSE4.1 versions of antialias, IMDCT36 and IMDCT12x3
+ *
+ * Bit-exact with imdct.c: IMDCT36x4 and IMDCT12x3x4 run four blocks in lockstep,
+ *   one block per vector lane, so every lane does exactly the scalar operations
+ *   (MULSHIFT32 as a full 32x32 -> 64-bit multiply with pmuldq).
+ *   The rare pre-IMDCT rescaling (fewer than 7 guard bits) stays scalar.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_X86
+
+#include <immintrin.h>
+
+/* see imdct.c */
+static const int c9_0 = 0x6ed9eba1;
+static const int c9_1 = 0x620dbe8b;
+static const int c9_2 = 0x163a1a7e;
+static const int c9_3 = 0x5246dd49;
+static const int c9_4 = 0x7e0e2e32;
+
+static const int c18[9] = {
+	0x7f834ed0, 0x7ba3751d, 0x7401e4c1, 0x68d9f964, 0x5a82799a, 0x496af3e2, 0x36185aee, 0x2120fb83, 0x0b27eb5c,
+};
+
+static const int c3_0 = 0x6ed9eba1;
+static const int c6[3] = { 0x7ba3751d, 0x5a82799a, 0x2120fb83 };
+
+/* MULSHIFT32 of each lane: pmuldq multiplies the even lanes, so the odd lanes are moved down */
+static __inline TARGET_SSE41 __m128i MulShift32SSE41(__m128i x, __m128i y)
+{
+	__m128i even, odd;
+
+	even = _mm_srli_epi64(_mm_mul_epi32(x, y), 32);
+	odd = _mm_mul_epi32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32));
+
+	return _mm_blend_epi16(even, odd, 0xcc);
+}
+
+/* MULSHIFT32(c, x) with the same constant c in every lane */
+static __inline TARGET_SSE41 __m128i MulConstSSE41(int c, __m128i x)
+{
+	return MulShift32SSE41(_mm_set1_epi32(c), x);
+}
+
+static __inline TARGET_SSE41 __m128i ReverseSSE41(__m128i x)
+{
+	return _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+static __inline TARGET_SSE41 void Transpose4SSE41(__m128i *r0, __m128i *r1, __m128i *r2, __m128i *r3)
+{
+	__m128i t0, t1, t2, t3;
+
+	t0 = _mm_unpacklo_epi32(*r0, *r1);
+	t1 = _mm_unpacklo_epi32(*r2, *r3);
+	t2 = _mm_unpackhi_epi32(*r0, *r1);
+	t3 = _mm_unpackhi_epi32(*r2, *r3);
+
+	*r0 = _mm_unpacklo_epi64(t0, t1);
+	*r1 = _mm_unpackhi_epi64(t0, t1);
+	*r2 = _mm_unpacklo_epi64(t2, t3);
+	*r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+/* v[k] = x[k], x[stride + k], x[2*stride + k], x[3*stride + k] for k = 0 ... n-1 */
+static __inline TARGET_SSE41 void LoadLanesSSE41(const int *x, int stride, int n, __m128i *v)
+{
+	int k;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		v[k+0] = _mm_loadu_si128((const __m128i *)(x + 0*stride + k));
+		v[k+1] = _mm_loadu_si128((const __m128i *)(x + 1*stride + k));
+		v[k+2] = _mm_loadu_si128((const __m128i *)(x + 2*stride + k));
+		v[k+3] = _mm_loadu_si128((const __m128i *)(x + 3*stride + k));
+		Transpose4SSE41(&v[k+0], &v[k+1], &v[k+2], &v[k+3]);
+	}
+	for ( ; k < n; k++)
+		v[k] = _mm_setr_epi32(x[0*stride + k], x[1*stride + k], x[2*stride + k], x[3*stride + k]);
+}
+
+/* inverse of LoadLanesSSE41 */
+static __inline TARGET_SSE41 void StoreLanesSSE41(int *x, int stride, int n, const __m128i *v)
+{
+	int k;
+	__m128i r0, r1, r2, r3;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		r0 = v[k+0];	r1 = v[k+1];	r2 = v[k+2];	r3 = v[k+3];
+		Transpose4SSE41(&r0, &r1, &r2, &r3);
+		_mm_storeu_si128((__m128i *)(x + 0*stride + k), r0);
+		_mm_storeu_si128((__m128i *)(x + 1*stride + k), r1);
+		_mm_storeu_si128((__m128i *)(x + 2*stride + k), r2);
+		_mm_storeu_si128((__m128i *)(x + 3*stride + k), r3);
+	}
+	for ( ; k < n; k++) {
+		x[0*stride + k] = _mm_extract_epi32(v[k], 0);
+		x[1*stride + k] = _mm_extract_epi32(v[k], 1);
+		x[2*stride + k] = _mm_extract_epi32(v[k], 2);
+		x[3*stride + k] = _mm_extract_epi32(v[k], 3);
+	}
+}
+
+/* store the 18 output vectors (one row of y[][] each), with frequency inversion
+ *   of the odd samples in the odd blocks, and return the OR of abs(y)
+ */
+static __inline TARGET_SSE41 int StoreOutputSSE41(int *y, __m128i *yv, int blockIdx)
+{
+	int k;
+	__m128i fi, mOut;
+
+	/* all ones in the lanes of odd blocks: (y ^ fi) - fi = -y */
+	fi = _mm_setr_epi32(-(blockIdx & 0x01), -((blockIdx + 1) & 0x01), -(blockIdx & 0x01), -((blockIdx + 1) & 0x01));
+
+	mOut = _mm_setzero_si128();
+	for (k = 0; k < 18; k++) {
+		if (k & 0x01)
+			yv[k] = _mm_sub_epi32(_mm_xor_si128(yv[k], fi), fi);
+		_mm_storeu_si128((__m128i *)(y + k*NBANDS), yv[k]);
+		mOut = _mm_or_si128(mOut, _mm_abs_epi32(yv[k]));
+	}
+
+	mOut = _mm_or_si128(mOut, _mm_shuffle_epi32(mOut, _MM_SHUFFLE(1, 0, 3, 2)));
+	mOut = _mm_or_si128(mOut, _mm_shuffle_epi32(mOut, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_cvtsi128_si32(mOut);
+}
+
+/* WinPrevious on four blocks */
+static __inline TARGET_SSE41 void WinPreviousSSE41(const __m128i *xPrev, __m128i *xPrevWin, int btPrev)
+{
+	int i;
+	const int *wpLo;
+
+	if (btPrev == 2) {
+		wpLo = imdctWin[btPrev];
+		xPrevWin[ 0] = _mm_add_epi32(MulConstSSE41(wpLo[ 6], xPrev[2]), MulConstSSE41(wpLo[0], xPrev[6]));
+		xPrevWin[ 1] = _mm_add_epi32(MulConstSSE41(wpLo[ 7], xPrev[1]), MulConstSSE41(wpLo[1], xPrev[7]));
+		xPrevWin[ 2] = _mm_add_epi32(MulConstSSE41(wpLo[ 8], xPrev[0]), MulConstSSE41(wpLo[2], xPrev[8]));
+		xPrevWin[ 3] = _mm_add_epi32(MulConstSSE41(wpLo[ 9], xPrev[0]), MulConstSSE41(wpLo[3], xPrev[8]));
+		xPrevWin[ 4] = _mm_add_epi32(MulConstSSE41(wpLo[10], xPrev[1]), MulConstSSE41(wpLo[4], xPrev[7]));
+		xPrevWin[ 5] = _mm_add_epi32(MulConstSSE41(wpLo[11], xPrev[2]), MulConstSSE41(wpLo[5], xPrev[6]));
+		xPrevWin[ 6] = MulConstSSE41(wpLo[ 6], xPrev[5]);
+		xPrevWin[ 7] = MulConstSSE41(wpLo[ 7], xPrev[4]);
+		xPrevWin[ 8] = MulConstSSE41(wpLo[ 8], xPrev[3]);
+		xPrevWin[ 9] = MulConstSSE41(wpLo[ 9], xPrev[3]);
+		xPrevWin[10] = MulConstSSE41(wpLo[10], xPrev[4]);
+		xPrevWin[11] = MulConstSSE41(wpLo[11], xPrev[5]);
+		for (i = 12; i < 18; i++)
+			xPrevWin[i] = _mm_setzero_si128();
+	} else {
+		wpLo = imdctWin[btPrev] + 18;
+		for (i = 0; i < 9; i++) {
+			xPrevWin[i]    = MulConstSSE41(wpLo[i], xPrev[i]);
+			xPrevWin[17-i] = MulConstSSE41(wpLo[17-i], xPrev[i]);
+		}
+	}
+}
+
+/* idct9 on four blocks */
+static __inline TARGET_SSE41 void Idct9SSE41(__m128i *x)
+{
+	__m128i a1, a2, a3, a4, a5, a6, a7, a8, a9;
+	__m128i a10, a11, a12, a13, a14, a15, a16, a17, a18;
+	__m128i a19, a20, a21, a22, a23, a24, a25, a26, a27;
+	__m128i m1, m3, m5, m6, m7, m8, m9, m10, m11, m12;
+
+	a1 = _mm_sub_epi32(x[0], x[6]);
+	a2 = _mm_sub_epi32(x[1], x[5]);
+	a3 = _mm_add_epi32(x[1], x[5]);
+	a4 = _mm_sub_epi32(x[2], x[4]);
+	a5 = _mm_add_epi32(x[2], x[4]);
+	a6 = _mm_add_epi32(x[2], x[8]);
+	a7 = _mm_add_epi32(x[1], x[7]);
+
+	a8 = _mm_sub_epi32(a6, a5);
+	a9 = _mm_sub_epi32(a3, a7);
+	a10 = _mm_sub_epi32(a2, x[7]);
+	a11 = _mm_sub_epi32(a4, x[8]);
+
+	/* the scalar version leaves the << 1 to where mX is used */
+	m1 =  _mm_slli_epi32(MulConstSSE41(c9_0, x[3]), 1);
+	m3 =  _mm_slli_epi32(MulConstSSE41(c9_0, a10), 1);
+	m5 =  _mm_slli_epi32(MulConstSSE41(c9_1, a5), 1);
+	m6 =  _mm_slli_epi32(MulConstSSE41(c9_2, a6), 1);
+	m7 =  _mm_slli_epi32(MulConstSSE41(c9_1, a8), 1);
+	m8 =  _mm_slli_epi32(MulConstSSE41(c9_2, a5), 1);
+	m9 =  _mm_slli_epi32(MulConstSSE41(c9_3, a9), 1);
+	m10 = _mm_slli_epi32(MulConstSSE41(c9_4, a7), 1);
+	m11 = _mm_slli_epi32(MulConstSSE41(c9_3, a3), 1);
+	m12 = _mm_slli_epi32(MulConstSSE41(c9_4, a9), 1);
+
+	a12 = _mm_add_epi32(x[0], _mm_srai_epi32(x[6], 1));
+	a13 = _mm_add_epi32(a12, m1);
+	a14 = _mm_sub_epi32(a12, m1);
+	a15 = _mm_add_epi32(a1, _mm_srai_epi32(a11, 1));
+	a16 = _mm_add_epi32(m5, m6);
+	a17 = _mm_sub_epi32(m7, m8);
+	a18 = _mm_add_epi32(a16, a17);
+	a19 = _mm_add_epi32(m9, m10);
+	a20 = _mm_sub_epi32(m11, m12);
+
+	a21 = _mm_sub_epi32(a20, a19);
+	a22 = _mm_add_epi32(a13, a16);
+	a23 = _mm_add_epi32(a14, a16);
+	a24 = _mm_add_epi32(a14, a17);
+	a25 = _mm_add_epi32(a13, a17);
+	a26 = _mm_sub_epi32(a14, a18);
+	a27 = _mm_sub_epi32(a13, a18);
+
+	x[0] = _mm_add_epi32(a22, a19);
+	x[1] = _mm_add_epi32(a15, m3);
+	x[2] = _mm_add_epi32(a24, a20);
+	x[3] = _mm_sub_epi32(a26, a21);
+	x[4] = _mm_sub_epi32(a1, a11);
+	x[5] = _mm_add_epi32(a27, a21);
+	x[6] = _mm_sub_epi32(a25, a20);
+	x[7] = _mm_sub_epi32(a15, m3);
+	x[8] = _mm_sub_epi32(a23, a19);
+}
+
+/* imdct12 on four blocks, x[] spaced 3 apart as in IMDCT12x3 */
+static __inline TARGET_SSE41 void Imdct12SSE41(const __m128i *x, __m128i *out)
+{
+	__m128i a0, a1, a2;
+	__m128i x0, x1, x2, x3, x4, x5;
+
+	x0 = x[0];	x1 = x[3];	x2 = x[6];
+	x3 = x[9];	x4 = x[12];	x5 = x[15];
+
+	x4 = _mm_sub_epi32(x4, x5);
+	x3 = _mm_sub_epi32(x3, x4);
+	x2 = _mm_sub_epi32(x2, x3);
+	x3 = _mm_sub_epi32(x3, x5);
+	x1 = _mm_sub_epi32(x1, x2);
+	x0 = _mm_sub_epi32(x0, x1);
+	x1 = _mm_sub_epi32(x1, x3);
+
+	x0 = _mm_srai_epi32(x0, 1);
+	x1 = _mm_srai_epi32(x1, 1);
+
+	a0 = _mm_slli_epi32(MulConstSSE41(c3_0, x2), 1);
+	a1 = _mm_add_epi32(x0, _mm_srai_epi32(x4, 1));
+	a2 = _mm_sub_epi32(x0, x4);
+	x0 = _mm_add_epi32(a1, a0);
+	x2 = a2;
+	x4 = _mm_sub_epi32(a1, a0);
+
+	a0 = _mm_slli_epi32(MulConstSSE41(c3_0, x3), 1);
+	a1 = _mm_add_epi32(x1, _mm_srai_epi32(x5, 1));
+	a2 = _mm_sub_epi32(x1, x5);
+
+	x1 = _mm_slli_epi32(MulConstSSE41(c6[0], _mm_add_epi32(a1, a0)), 2);
+	x3 = _mm_slli_epi32(MulConstSSE41(c6[1], a2), 2);
+	x5 = _mm_slli_epi32(MulConstSSE41(c6[2], _mm_sub_epi32(a1, a0)), 2);
+
+	out[0] = _mm_add_epi32(x0, x1);
+	out[1] = _mm_add_epi32(x2, x3);
+	out[2] = _mm_add_epi32(x4, x5);
+	out[3] = _mm_sub_epi32(x4, x5);
+	out[4] = _mm_sub_epi32(x2, x3);
+	out[5] = _mm_sub_epi32(x0, x1);
+}
+
+/**************************************************************************************
+ * Function:    AntiAliasSSE41
+ *
+ * Description: SSE4.1 version of AntiAliasC, the 8 butterflies of each block
+ *                boundary in two vectors
+ *
+ * Inputs:      see AntiAliasC
+ *
+ * Outputs:     see AntiAliasC
+ *
+ * Return:      none
+ **************************************************************************************/
+TARGET_SSE41 void AntiAliasSSE41(int *x, int nBfly)
+{
+	int k;
+	__m128i c0A, c0B, c1A, c1B, aA, aB, bA, bB;
+
+	/* csa = Q31, lane i = butterfly i */
+	c0A = _mm_setr_epi32(csa[0][0], csa[1][0], csa[2][0], csa[3][0]);
+	c0B = _mm_setr_epi32(csa[4][0], csa[5][0], csa[6][0], csa[7][0]);
+	c1A = _mm_setr_epi32(csa[0][1], csa[1][1], csa[2][1], csa[3][1]);
+	c1B = _mm_setr_epi32(csa[4][1], csa[5][1], csa[6][1], csa[7][1]);
+
+	for (k = nBfly; k > 0; k--) {
+		x += 18;
+
+		/* a = x[-1], x[-2], ... x[-8]   b = x[0], x[1], ... x[7] */
+		aA = ReverseSSE41(_mm_loadu_si128((const __m128i *)(x - 4)));
+		aB = ReverseSSE41(_mm_loadu_si128((const __m128i *)(x - 8)));
+		bA = _mm_loadu_si128((const __m128i *)(x + 0));
+		bB = _mm_loadu_si128((const __m128i *)(x + 4));
+
+		_mm_storeu_si128((__m128i *)(x - 4), ReverseSSE41(_mm_slli_epi32(_mm_sub_epi32(MulShift32SSE41(c0A, aA), MulShift32SSE41(c1A, bA)), 1)));
+		_mm_storeu_si128((__m128i *)(x - 8), ReverseSSE41(_mm_slli_epi32(_mm_sub_epi32(MulShift32SSE41(c0B, aB), MulShift32SSE41(c1B, bB)), 1)));
+		_mm_storeu_si128((__m128i *)(x + 0), _mm_slli_epi32(_mm_add_epi32(MulShift32SSE41(c0A, bA), MulShift32SSE41(c1A, aA)), 1));
+		_mm_storeu_si128((__m128i *)(x + 4), _mm_slli_epi32(_mm_add_epi32(MulShift32SSE41(c0B, bB), MulShift32SSE41(c1B, aB)), 1));
+	}
+}
+
+/**************************************************************************************
+ * Function:    IMDCT36x4SSE41
+ *
+ * Description: SSE4.1 version of IMDCT36x4C, one block per lane
+ *
+ * Inputs:      see IMDCT36x4C
+ *
+ * Outputs:     see IMDCT36x4C
+ *
+ * Return:      mOut (OR of abs(y) for all y calculated here)
+ **************************************************************************************/
+TARGET_SSE41 int IMDCT36x4SSE41(int *xCurr, int *xPrev, int *y, int btCurr, int btPrev, int blockIdx, int gb)
+{
+	int i;
+	const int *wp;
+	__m128i x[18], xBuf[18], xPrevV[9], xPrevWin[18], yv[18];
+	__m128i acc1, acc2, xo, xe, s, d, t;
+
+	/* rescaling for fewer than 7 guard bits is rare, leave it to the scalar version */
+	if (gb < 7)
+		return IMDCT36x4C(xCurr, xPrev, y, btCurr, btPrev, blockIdx, gb);
+
+	LoadLanesSSE41(xCurr, 18, 18, x);
+	LoadLanesSSE41(xPrev, 9, 9, xPrevV);
+
+	acc1 = acc2 = _mm_setzero_si128();
+	for (i = 8; i >= 0; i--) {
+		acc1 = _mm_sub_epi32(x[2*i+1], acc1);
+		acc2 = _mm_sub_epi32(acc1, acc2);
+		acc1 = _mm_sub_epi32(x[2*i+0], acc1);
+		xBuf[i+9] = acc2;	/* odd */
+		xBuf[i+0] = acc1;	/* even */
+	}
+	/* xEven[0] and xOdd[0] scaled by 0.5 */
+	xBuf[9] = _mm_srai_epi32(xBuf[9], 1);
+	xBuf[0] = _mm_srai_epi32(xBuf[0], 1);
+
+	Idct9SSE41(xBuf + 0);	/* even */
+	Idct9SSE41(xBuf + 9);	/* odd */
+
+	if (btPrev == 0 && btCurr == 0) {
+		/* fast path - symmetric sin window */
+		wp = fastWin36;
+		for (i = 0; i < 9; i++) {
+			xo = MulConstSSE41(c18[8-i], xBuf[17-i]);
+			xe = _mm_srai_epi32(xBuf[8-i], 2);
+
+			s = _mm_sub_epi32(_mm_setzero_si128(), xPrevV[i]);
+			d = _mm_sub_epi32(xo, xe);
+			xPrevV[i] = _mm_add_epi32(xe, xo);
+			t = _mm_sub_epi32(s, d);
+
+			yv[i]    = _mm_add_epi32(d, _mm_slli_epi32(MulConstSSE41(wp[2*i+0], t), 2));
+			yv[17-i] = _mm_add_epi32(s, _mm_slli_epi32(MulConstSSE41(wp[2*i+1], t), 2));
+		}
+	} else {
+		/* full 36-point window */
+		WinPreviousSSE41(xPrevV, xPrevWin, btPrev);
+
+		wp = imdctWin[btCurr];
+		for (i = 0; i < 9; i++) {
+			xo = MulConstSSE41(c18[8-i], xBuf[17-i]);
+			xe = _mm_srai_epi32(xBuf[8-i], 2);
+
+			d = _mm_sub_epi32(xe, xo);
+			xPrevV[i] = _mm_add_epi32(xe, xo);
+
+			yv[i]    = _mm_slli_epi32(_mm_add_epi32(xPrevWin[i],    MulConstSSE41(wp[i], d)), 2);
+			yv[17-i] = _mm_slli_epi32(_mm_add_epi32(xPrevWin[17-i], MulConstSSE41(wp[17-i], d)), 2);
+		}
+	}
+
+	StoreLanesSSE41(xPrev, 9, 9, xPrevV);
+
+	return StoreOutputSSE41(y, yv, blockIdx);
+}
+
+/**************************************************************************************
+ * Function:    IMDCT12x3x4SSE41
+ *
+ * Description: SSE4.1 version of IMDCT12x3x4C, one block per lane
+ *
+ * Inputs:      see IMDCT12x3x4C
+ *
+ * Outputs:     see IMDCT12x3x4C
+ *
+ * Return:      mOut (OR of abs(y) for all y calculated here)
+ **************************************************************************************/
+TARGET_SSE41 int IMDCT12x3x4SSE41(int *xCurr, int *xPrev, int *y, int btPrev, int blockIdx, int gb)
+{
+	int i;
+	const int *wp;
+	__m128i x[18], xBuf[18], xPrevV[9], xPrevWin[18], yv[18];
+
+	/* rescaling for fewer than 7 guard bits is rare, leave it to the scalar version */
+	if (gb < 7)
+		return IMDCT12x3x4C(xCurr, xPrev, y, btPrev, blockIdx, gb);
+
+	LoadLanesSSE41(xCurr, 18, 18, x);
+	LoadLanesSSE41(xPrev, 9, 9, xPrevV);
+
+	Imdct12SSE41(x + 0, xBuf + 0);
+	Imdct12SSE41(x + 1, xBuf + 6);
+	Imdct12SSE41(x + 2, xBuf + 12);
+
+	WinPreviousSSE41(xPrevV, xPrevWin, btPrev);
+
+	wp = imdctWin[2];
+	for (i = 0; i < 3; i++) {
+		yv[ 0+i] = _mm_slli_epi32(xPrevWin[ 0+i], 2);
+		yv[ 3+i] = _mm_slli_epi32(xPrevWin[ 3+i], 2);
+		yv[ 6+i] = _mm_add_epi32(_mm_slli_epi32(xPrevWin[ 6+i], 2), MulConstSSE41(wp[0+i], xBuf[3+i]));
+		yv[ 9+i] = _mm_add_epi32(_mm_slli_epi32(xPrevWin[ 9+i], 2), MulConstSSE41(wp[3+i], xBuf[5-i]));
+		yv[12+i] = _mm_add_epi32(_mm_slli_epi32(xPrevWin[12+i], 2),
+					_mm_add_epi32(MulConstSSE41(wp[6+i], xBuf[2-i]), MulConstSSE41(wp[0+i], xBuf[(6+3)+i])));
+		yv[15+i] = _mm_add_epi32(_mm_slli_epi32(xPrevWin[15+i], 2),
+					_mm_add_epi32(MulConstSSE41(wp[9+i], xBuf[0+i]), MulConstSSE41(wp[3+i], xBuf[(6+5)-i])));
+	}
+
+	/* save previous (unwindowed) for overlap - only need samples 6-8, 12-17 */
+	for (i = 0; i < 3; i++)
+		xPrevV[i] = _mm_srai_epi32(xBuf[6+i], 2);
+	for (i = 0; i < 6; i++)
+		xPrevV[3+i] = _mm_srai_epi32(xBuf[12+i], 2);
+
+	StoreLanesSSE41(xPrev, 9, 9, xPrevV);
+
+	return StoreOutputSSE41(y, yv, blockIdx);
+}
+
+#endif	/* MP3DEC_SIMD_X86 */
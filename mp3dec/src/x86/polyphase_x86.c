@@ -0,0 +1,358 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * polyphase_x86.c - SSE4.1 and AVX2 versions of the polyphase synthesis filter
+ *
+ * Bit-exact with polyphase.c: every tap is a full 32x32 -> 64-bit multiply
+ *   (pmuldq) and the taps are summed in 64-bit lanes, which only reorders
+ *   integer additions. The rounding, shift and clip to 16 bits stay scalar.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_X86
+
+#include <immintrin.h>
+
+/* see polyphase.c */
+#define DEF_NFRACBITS	(DQ_FRACBITS_OUT - 2 - 2 - 15)
+#define CSHIFT	12
+
+static __inline short ClipToShort(int x, int fracBits)
+{
+	int sign;
+
+	x >>= fracBits;
+
+	sign = x >> 31;
+	if (sign != (x >> 15))
+		x = sign ^ ((1 << 15) - 1);
+
+	return (short)x;
+}
+
+static __inline short ClipSum(Word64 sum)
+{
+	Word64 rndVal = (Word64)( 1 << (DEF_NFRACBITS - 1 + (32 - CSHIFT)) );
+
+	return ClipToShort((int)SAR64(sum + rndVal, (32-CSHIFT)), DEF_NFRACBITS);
+}
+
+/* 8 taps of one channel, for x = 0, 1, ... 7 with coef = c1, c2 pairs
+ *   sum1 += vb[x]*c1 - vb[23-x]*c2
+ *   sum2 += vb[x]*c2 + vb[23-x]*c1
+ * pmuldq only reads the low 32 bits of each 64-bit lane, so c2 is moved down with a shift
+ */
+static __inline TARGET_SSE41 void Taps8SSE41(const int *vb, const int *coef, __m128i *sum1, __m128i *sum2)
+{
+	int j;
+	__m128i c1, c2, vLo, vHi, s1, s2;
+
+	s1 = _mm_setzero_si128();
+	s2 = _mm_setzero_si128();
+
+	for (j = 0; j < 4; j++) {
+		c1 = _mm_loadu_si128((const __m128i *)(coef + 4*j));
+		c2 = _mm_srli_epi64(c1, 32);
+
+		vLo = _mm_cvtepi32_epi64(_mm_loadl_epi64((const __m128i *)(vb + 2*j)));
+		vHi = _mm_loadl_epi64((const __m128i *)(vb + 22 - 2*j));
+		vHi = _mm_cvtepi32_epi64(_mm_shuffle_epi32(vHi, _MM_SHUFFLE(3, 2, 0, 1)));
+
+		s1 = _mm_add_epi64(s1, _mm_mul_epi32(vLo, c1));
+		s1 = _mm_sub_epi64(s1, _mm_mul_epi32(vHi, c2));
+		s2 = _mm_add_epi64(s2, _mm_mul_epi32(vLo, c2));
+		s2 = _mm_add_epi64(s2, _mm_mul_epi32(vHi, c1));
+	}
+
+	*sum1 = s1;
+	*sum2 = s2;
+}
+
+/* 8 taps of one channel for output sample 16: sum += vb[x]*coef[x] */
+static __inline TARGET_SSE41 __m128i Taps8MC1SSE41(const int *vb, const int *coef)
+{
+	__m128i c0, c1, v0, v1, s;
+
+	c0 = _mm_loadu_si128((const __m128i *)(coef + 0));
+	c1 = _mm_loadu_si128((const __m128i *)(coef + 4));
+	v0 = _mm_loadu_si128((const __m128i *)(vb + 0));
+	v1 = _mm_loadu_si128((const __m128i *)(vb + 4));
+
+	s = _mm_mul_epi32(v0, c0);
+	s = _mm_add_epi64(s, _mm_mul_epi32(_mm_srli_epi64(v0, 32), _mm_srli_epi64(c0, 32)));
+	s = _mm_add_epi64(s, _mm_mul_epi32(v1, c1));
+	s = _mm_add_epi64(s, _mm_mul_epi32(_mm_srli_epi64(v1, 32), _mm_srli_epi64(c1, 32)));
+
+	return s;
+}
+
+/* out[0] = both lanes of a summed, out[1] = both lanes of b summed */
+static __inline TARGET_SSE41 void Sum2SSE41(Word64 *out, __m128i a, __m128i b)
+{
+	_mm_storeu_si128((__m128i *)out, _mm_add_epi64(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b)));
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseMonoSSE41
+ *
+ * Description: SSE4.1 version of PolyphaseMonoC, two 64-bit taps per instruction
+ *
+ * Inputs:      see PolyphaseMonoC
+ *
+ * Outputs:     32 samples of one channel of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ **************************************************************************************/
+TARGET_SSE41 void PolyphaseMonoSSE41(short *pcm, int *vbuf, const int *coefBase)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	__m128i sum1L, sum2L;
+	Word64 sums[2];
+
+	/* special case, output sample 0 */
+	Taps8SSE41(vbuf, coefBase, &sum1L, &sum2L);
+	Sum2SSE41(sums, sum1L, sum1L);
+	*(pcm + 0) = ClipSum(sums[0]);
+
+	/* special case, output sample 16 */
+	sum1L = Taps8MC1SSE41(vbuf + 64*16, coefBase + 256);
+	Sum2SSE41(sums, sum1L, sum1L);
+	*(pcm + 16) = ClipSum(sums[0]);
+
+	/* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm++;
+
+	for (i = 15; i > 0; i--) {
+		Taps8SSE41(vb1, coef, &sum1L, &sum2L);
+		Sum2SSE41(sums, sum1L, sum2L);
+
+		coef += 16;
+		vb1 += 64;
+		*(pcm)       = ClipSum(sums[0]);
+		*(pcm + 2*i) = ClipSum(sums[1]);
+		pcm++;
+	}
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseStereoSSE41
+ *
+ * Description: SSE4.1 version of PolyphaseStereoC, two 64-bit taps per instruction
+ *
+ * Inputs:      see PolyphaseStereoC
+ *
+ * Outputs:     32 samples of two channels of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ *
+ * Notes:       interleaves PCM samples LRLRLR...
+ **************************************************************************************/
+TARGET_SSE41 void PolyphaseStereoSSE41(short *pcm, int *vbuf, const int *coefBase)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	__m128i sum1L, sum2L, sum1R, sum2R;
+	Word64 sumsL[2], sumsR[2];
+
+	/* special case, output sample 0 */
+	Taps8SSE41(vbuf, coefBase, &sum1L, &sum2L);
+	Taps8SSE41(vbuf + 32, coefBase, &sum1R, &sum2R);
+	Sum2SSE41(sumsL, sum1L, sum1R);
+	*(pcm + 0) = ClipSum(sumsL[0]);
+	*(pcm + 1) = ClipSum(sumsL[1]);
+
+	/* special case, output sample 16 */
+	sum1L = Taps8MC1SSE41(vbuf + 64*16, coefBase + 256);
+	sum1R = Taps8MC1SSE41(vbuf + 64*16 + 32, coefBase + 256);
+	Sum2SSE41(sumsL, sum1L, sum1R);
+	*(pcm + 2*16 + 0) = ClipSum(sumsL[0]);
+	*(pcm + 2*16 + 1) = ClipSum(sumsL[1]);
+
+	/* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm += 2;
+
+	for (i = 15; i > 0; i--) {
+		Taps8SSE41(vb1, coef, &sum1L, &sum2L);
+		Taps8SSE41(vb1 + 32, coef, &sum1R, &sum2R);
+		Sum2SSE41(sumsL, sum1L, sum2L);
+		Sum2SSE41(sumsR, sum1R, sum2R);
+
+		coef += 16;
+		vb1 += 64;
+		*(pcm + 0)         = ClipSum(sumsL[0]);
+		*(pcm + 1)         = ClipSum(sumsR[0]);
+		*(pcm + 2*2*i + 0) = ClipSum(sumsL[1]);
+		*(pcm + 2*2*i + 1) = ClipSum(sumsR[1]);
+		pcm += 2;
+	}
+}
+
+/* AVX2 version of Taps8SSE41, four taps per multiply */
+static __inline TARGET_AVX2 void Taps8AVX2(const int *vb, const int *coef, __m256i *sum1, __m256i *sum2)
+{
+	__m256i c1a, c1b, c2a, c2b, vLoA, vLoB, vHiA, vHiB, s1, s2;
+
+	c1a = _mm256_loadu_si256((const __m256i *)(coef + 0));
+	c1b = _mm256_loadu_si256((const __m256i *)(coef + 8));
+	c2a = _mm256_srli_epi64(c1a, 32);
+	c2b = _mm256_srli_epi64(c1b, 32);
+
+	/* vb[0..3], vb[4..7] and the reversed vb[23..20], vb[19..16] */
+	vLoA = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(vb + 0)));
+	vLoB = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)(vb + 4)));
+	vHiA = _mm256_cvtepi32_epi64(_mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(vb + 20)), _MM_SHUFFLE(0, 1, 2, 3)));
+	vHiB = _mm256_cvtepi32_epi64(_mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(vb + 16)), _MM_SHUFFLE(0, 1, 2, 3)));
+
+	s1 = _mm256_mul_epi32(vLoA, c1a);
+	s1 = _mm256_add_epi64(s1, _mm256_mul_epi32(vLoB, c1b));
+	s1 = _mm256_sub_epi64(s1, _mm256_mul_epi32(vHiA, c2a));
+	s1 = _mm256_sub_epi64(s1, _mm256_mul_epi32(vHiB, c2b));
+
+	s2 = _mm256_mul_epi32(vLoA, c2a);
+	s2 = _mm256_add_epi64(s2, _mm256_mul_epi32(vLoB, c2b));
+	s2 = _mm256_add_epi64(s2, _mm256_mul_epi32(vHiA, c1a));
+	s2 = _mm256_add_epi64(s2, _mm256_mul_epi32(vHiB, c1b));
+
+	*sum1 = s1;
+	*sum2 = s2;
+}
+
+/* AVX2 version of Taps8MC1SSE41 */
+static __inline TARGET_AVX2 __m256i Taps8MC1AVX2(const int *vb, const int *coef)
+{
+	__m256i c, v;
+
+	c = _mm256_loadu_si256((const __m256i *)coef);
+	v = _mm256_loadu_si256((const __m256i *)vb);
+
+	return _mm256_add_epi64(_mm256_mul_epi32(v, c), _mm256_mul_epi32(_mm256_srli_epi64(v, 32), _mm256_srli_epi64(c, 32)));
+}
+
+/* out[0..3] = all four lanes of a, b, c, d summed */
+static __inline TARGET_AVX2 void Sum4AVX2(Word64 *out, __m256i a, __m256i b, __m256i c, __m256i d)
+{
+	__m256i ab, cd;
+
+	ab = _mm256_add_epi64(_mm256_unpacklo_epi64(a, b), _mm256_unpackhi_epi64(a, b));
+	cd = _mm256_add_epi64(_mm256_unpacklo_epi64(c, d), _mm256_unpackhi_epi64(c, d));
+
+	_mm256_storeu_si256((__m256i *)out, _mm256_add_epi64(_mm256_permute2x128_si256(ab, cd, 0x20),
+	                                                    _mm256_permute2x128_si256(ab, cd, 0x31)));
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseMonoAVX2
+ *
+ * Description: AVX2 version of PolyphaseMonoC, four 64-bit taps per instruction
+ *
+ * Inputs:      see PolyphaseMonoC
+ *
+ * Outputs:     32 samples of one channel of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ *
+ * Notes:       two rows of the main loop share one horizontal sum
+ **************************************************************************************/
+TARGET_AVX2 void PolyphaseMonoAVX2(short *pcm, int *vbuf, const int *coefBase)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	__m256i sum1A, sum2A, sum1B, sum2B;
+	Word64 sums[4];
+
+	/* special cases, output samples 0 and 16 */
+	Taps8AVX2(vbuf, coefBase, &sum1A, &sum2A);
+	sum1B = Taps8MC1AVX2(vbuf + 64*16, coefBase + 256);
+	Sum4AVX2(sums, sum1A, sum1B, sum1A, sum1B);
+	*(pcm + 0) = ClipSum(sums[0]);
+	*(pcm + 16) = ClipSum(sums[1]);
+
+	/* main convolution loop: sum1 = samples 1, 2, 3, ... 15   sum2 = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm++;
+
+	for (i = 15; i > 1; i -= 2) {
+		Taps8AVX2(vb1, coef, &sum1A, &sum2A);
+		Taps8AVX2(vb1 + 64, coef + 16, &sum1B, &sum2B);
+		Sum4AVX2(sums, sum1A, sum2A, sum1B, sum2B);
+
+		coef += 32;
+		vb1 += 128;
+		*(pcm)           = ClipSum(sums[0]);
+		*(pcm + 2*i)     = ClipSum(sums[1]);
+		*(pcm + 1)       = ClipSum(sums[2]);
+		*(pcm + 2*i - 1) = ClipSum(sums[3]);
+		pcm += 2;
+	}
+
+	/* last row (i = 1) */
+	Taps8AVX2(vb1, coef, &sum1A, &sum2A);
+	Sum4AVX2(sums, sum1A, sum2A, sum1A, sum2A);
+	*(pcm)     = ClipSum(sums[0]);
+	*(pcm + 2) = ClipSum(sums[1]);
+}
+
+/**************************************************************************************
+ * Function:    PolyphaseStereoAVX2
+ *
+ * Description: AVX2 version of PolyphaseStereoC, four 64-bit taps per instruction
+ *
+ * Inputs:      see PolyphaseStereoC
+ *
+ * Outputs:     32 samples of two channels of decoded PCM data, (i.e. Q16.0)
+ *
+ * Return:      none
+ *
+ * Notes:       interleaves PCM samples LRLRLR...
+ **************************************************************************************/
+TARGET_AVX2 void PolyphaseStereoAVX2(short *pcm, int *vbuf, const int *coefBase)
+{
+	int i;
+	const int *coef;
+	int *vb1;
+	__m256i sum1L, sum2L, sum1R, sum2R;
+	Word64 sums[4];
+
+	/* special cases, output samples 0 and 16 */
+	Taps8AVX2(vbuf, coefBase, &sum1L, &sum2L);
+	Taps8AVX2(vbuf + 32, coefBase, &sum1R, &sum2R);
+	sum2L = Taps8MC1AVX2(vbuf + 64*16, coefBase + 256);
+	sum2R = Taps8MC1AVX2(vbuf + 64*16 + 32, coefBase + 256);
+	Sum4AVX2(sums, sum1L, sum1R, sum2L, sum2R);
+	*(pcm + 0)        = ClipSum(sums[0]);
+	*(pcm + 1)        = ClipSum(sums[1]);
+	*(pcm + 2*16 + 0) = ClipSum(sums[2]);
+	*(pcm + 2*16 + 1) = ClipSum(sums[3]);
+
+	/* main convolution loop: sum1L = samples 1, 2, 3, ... 15   sum2L = samples 31, 30, ... 17 */
+	coef = coefBase + 16;
+	vb1 = vbuf + 64;
+	pcm += 2;
+
+	for (i = 15; i > 0; i--) {
+		Taps8AVX2(vb1, coef, &sum1L, &sum2L);
+		Taps8AVX2(vb1 + 32, coef, &sum1R, &sum2R);
+		Sum4AVX2(sums, sum1L, sum1R, sum2L, sum2R);
+
+		coef += 16;
+		vb1 += 64;
+		*(pcm + 0)         = ClipSum(sums[0]);
+		*(pcm + 1)         = ClipSum(sums[1]);
+		*(pcm + 2*2*i + 0) = ClipSum(sums[2]);
+		*(pcm + 2*2*i + 1) = ClipSum(sums[3]);
+		pcm += 2;
+	}
+}
+
+#endif	/* MP3DEC_SIMD_X86 */
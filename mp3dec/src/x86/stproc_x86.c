@@ -0,0 +1,214 @@
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * stproc_x86.c - SSE4.1 and AVX2 versions of MidSideProc and IntensityBand
+ *
+ * Bit-exact with stproc.c: the sums, differences and MULSHIFT32s wrap the same way
+ *   in every lane, and pabsd gives the same 0x80000000 as FASTABS for -2^31.
+ *   The guard bit masks are ORed in a register and folded into mOut once per call.
+ **************************************************************************************/
+
+#include "../coder.h"
+#include "../assembly.h"
+
+#ifdef MP3DEC_SIMD_X86
+
+#include <immintrin.h>
+
+/* MULSHIFT32 of each lane: pmuldq multiplies the even lanes, so the odd lanes are moved down */
+static __inline TARGET_SSE41 __m128i MulShift32SSE41(__m128i x, __m128i y)
+{
+	__m128i even, odd;
+
+	even = _mm_srli_epi64(_mm_mul_epi32(x, y), 32);
+	odd = _mm_mul_epi32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32));
+
+	return _mm_blend_epi16(even, odd, 0xcc);
+}
+
+static __inline TARGET_AVX2 __m256i MulShift32AVX2(__m256i x, __m256i y)
+{
+	__m256i even, odd;
+
+	even = _mm256_srli_epi64(_mm256_mul_epi32(x, y), 32);
+	odd = _mm256_mul_epi32(_mm256_srli_epi64(x, 32), _mm256_srli_epi64(y, 32));
+
+	return _mm256_blend_epi32(even, odd, 0xaa);
+}
+
+static __inline TARGET_SSE41 int OrLanesSSE41(__m128i mask)
+{
+	mask = _mm_or_si128(mask, _mm_shuffle_epi32(mask, _MM_SHUFFLE(1, 0, 3, 2)));
+	mask = _mm_or_si128(mask, _mm_shuffle_epi32(mask, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_cvtsi128_si32(mask);
+}
+
+static __inline TARGET_AVX2 int OrLanesAVX2(__m256i mask)
+{
+	return OrLanesSSE41(_mm_or_si128(_mm256_castsi256_si128(mask), _mm256_extracti128_si256(mask, 1)));
+}
+
+/**************************************************************************************
+ * Function:    MidSideProcSSE41
+ *
+ * Description: SSE4.1 version of MidSideProcC, 4 samples at a time
+ *
+ * Inputs:      see MidSideProcC
+ *
+ * Outputs:     see MidSideProcC
+ *
+ * Return:      none
+ **************************************************************************************/
+TARGET_SSE41 void MidSideProcSSE41(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2])
+{
+	int i, xl, xr, mOutL, mOutR;
+	__m128i l, r, sum, diff, maskL, maskR;
+
+	maskL = maskR = _mm_setzero_si128();
+	for (i = 0; i + 4 <= nSamps; i += 4) {
+		l = _mm_loadu_si128((const __m128i *)(x[0] + i));
+		r = _mm_loadu_si128((const __m128i *)(x[1] + i));
+		sum = _mm_add_epi32(l, r);
+		diff = _mm_sub_epi32(l, r);
+		_mm_storeu_si128((__m128i *)(x[0] + i), sum);
+		_mm_storeu_si128((__m128i *)(x[1] + i), diff);
+		maskL = _mm_or_si128(maskL, _mm_abs_epi32(sum));
+		maskR = _mm_or_si128(maskR, _mm_abs_epi32(diff));
+	}
+
+	mOutL = OrLanesSSE41(maskL);
+	mOutR = OrLanesSSE41(maskR);
+	for ( ; i < nSamps; i++) {
+		xl = x[0][i];
+		xr = x[1][i];
+		x[0][i] = xl + xr;
+		x[1][i] = xl - xr;
+		mOutL |= FASTABS(x[0][i]);
+		mOutR |= FASTABS(x[1][i]);
+	}
+	mOut[0] |= mOutL;
+	mOut[1] |= mOutR;
+}
+
+/**************************************************************************************
+ * Function:    MidSideProcAVX2
+ *
+ * Description: AVX2 version of MidSideProcC, 8 samples at a time
+ *
+ * Inputs:      see MidSideProcC
+ *
+ * Outputs:     see MidSideProcC
+ *
+ * Return:      none
+ **************************************************************************************/
+TARGET_AVX2 void MidSideProcAVX2(int x[MAX_NCHAN][MAX_NSAMP], int nSamps, int mOut[2])
+{
+	int i, xl, xr, mOutL, mOutR;
+	__m256i l, r, sum, diff, maskL, maskR;
+
+	maskL = maskR = _mm256_setzero_si256();
+	for (i = 0; i + 8 <= nSamps; i += 8) {
+		l = _mm256_loadu_si256((const __m256i *)(x[0] + i));
+		r = _mm256_loadu_si256((const __m256i *)(x[1] + i));
+		sum = _mm256_add_epi32(l, r);
+		diff = _mm256_sub_epi32(l, r);
+		_mm256_storeu_si256((__m256i *)(x[0] + i), sum);
+		_mm256_storeu_si256((__m256i *)(x[1] + i), diff);
+		maskL = _mm256_or_si256(maskL, _mm256_abs_epi32(sum));
+		maskR = _mm256_or_si256(maskR, _mm256_abs_epi32(diff));
+	}
+
+	mOutL = OrLanesAVX2(maskL);
+	mOutR = OrLanesAVX2(maskR);
+	for ( ; i < nSamps; i++) {
+		xl = x[0][i];
+		xr = x[1][i];
+		x[0][i] = xl + xr;
+		x[1][i] = xl - xr;
+		mOutL |= FASTABS(x[0][i]);
+		mOutR |= FASTABS(x[1][i]);
+	}
+	mOut[0] |= mOutL;
+	mOut[1] |= mOutR;
+}
+
+/**************************************************************************************
+ * Function:    IntensityBandSSE41
+ *
+ * Description: SSE4.1 version of IntensityBandC, 4 samples at a time
+ *
+ * Inputs:      see IntensityBandC
+ *
+ * Outputs:     see IntensityBandC
+ *
+ * Return:      none
+ **************************************************************************************/
+TARGET_SSE41 void IntensityBandSSE41(int *xl, int *xr, int n, int fl, int fr, int mOut[2])
+{
+	int i, l, r, mOutL, mOutR;
+	__m128i x, vl, vr, factorL, factorR, maskL, maskR;
+
+	factorL = _mm_set1_epi32(fl);
+	factorR = _mm_set1_epi32(fr);
+	maskL = maskR = _mm_setzero_si128();
+	for (i = 0; i + 4 <= n; i += 4) {
+		x = _mm_loadu_si128((const __m128i *)(xl + i));
+		vr = _mm_slli_epi32(MulShift32SSE41(factorR, x), 2);
+		vl = _mm_slli_epi32(MulShift32SSE41(factorL, x), 2);
+		_mm_storeu_si128((__m128i *)(xr + i), vr);
+		_mm_storeu_si128((__m128i *)(xl + i), vl);
+		maskR = _mm_or_si128(maskR, _mm_abs_epi32(vr));
+		maskL = _mm_or_si128(maskL, _mm_abs_epi32(vl));
+	}
+
+	mOutL = OrLanesSSE41(maskL);
+	mOutR = OrLanesSSE41(maskR);
+	for ( ; i < n; i++) {
+		r = MULSHIFT32(fr, xl[i]) << 2;	xr[i] = r;	mOutR |= FASTABS(r);
+		l = MULSHIFT32(fl, xl[i]) << 2;	xl[i] = l;	mOutL |= FASTABS(l);
+	}
+	mOut[0] |= mOutL;
+	mOut[1] |= mOutR;
+}
+
+/**************************************************************************************
+ * Function:    IntensityBandAVX2
+ *
+ * Description: AVX2 version of IntensityBandC, 8 samples at a time
+ *
+ * Inputs:      see IntensityBandC
+ *
+ * Outputs:     see IntensityBandC
+ *
+ * Return:      none
+ **************************************************************************************/
+TARGET_AVX2 void IntensityBandAVX2(int *xl, int *xr, int n, int fl, int fr, int mOut[2])
+{
+	int i, l, r, mOutL, mOutR;
+	__m256i x, vl, vr, factorL, factorR, maskL, maskR;
+
+	factorL = _mm256_set1_epi32(fl);
+	factorR = _mm256_set1_epi32(fr);
+	maskL = maskR = _mm256_setzero_si256();
+	for (i = 0; i + 8 <= n; i += 8) {
+		x = _mm256_loadu_si256((const __m256i *)(xl + i));
+		vr = _mm256_slli_epi32(MulShift32AVX2(factorR, x), 2);
+		vl = _mm256_slli_epi32(MulShift32AVX2(factorL, x), 2);
+		_mm256_storeu_si256((__m256i *)(xr + i), vr);
+		_mm256_storeu_si256((__m256i *)(xl + i), vl);
+		maskR = _mm256_or_si256(maskR, _mm256_abs_epi32(vr));
+		maskL = _mm256_or_si256(maskL, _mm256_abs_epi32(vl));
+	}
+
+	mOutL = OrLanesAVX2(maskL);
+	mOutR = OrLanesAVX2(maskR);
+	for ( ; i < n; i++) {
+		r = MULSHIFT32(fr, xl[i]) << 2;	xr[i] = r;	mOutR |= FASTABS(r);
+		l = MULSHIFT32(fl, xl[i]) << 2;	xl[i] = l;	mOutL |= FASTABS(l);
+	}
+	mOut[0] |= mOutL;
+	mOut[1] |= mOutR;
+}
+
+#endif	/* MP3DEC_SIMD_X86 */
@@ -0,0 +1,343 @@
+#include "adpcmdecoder.h"
+
+static const unsigned int IMA_MAX_STEP_INDEX = 88;
+
+static const int16_t ima_step_table[IMA_MAX_STEP_INDEX + 1] = {
+    7, 8, 9, 10, 11, 12, 13, 14,
+    16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66,
+    73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411,
+    1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int16_t microsoft_adaptation_table[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
+};
+
+static const int16_t microsoft_coefficients[7][2] = {
+    {256, 0},
+    {512, -256},
+    {0, 0},
+    {192, 64},
+    {240, 0},
+    {460, -208},
+    {392, -232}
+};
+
+static const int32_t MICROSOFT_MIN_DELTA = 16;
+
+static inline int16_t readI16(const uint8_t *input)
+{
+    return static_cast<int16_t>(input[0] | (input[1] << 8));
+}
+
+static inline int32_t clampToI16(int32_t value)
+{
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    } else if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+
+    return value;
+}
+
+AdpcmDecoder::AdpcmDecoder()
+    : type_(Type::Unknown),
+      channels_(0),
+      block_size_(0),
+      block_frames_(0),
+      coefficients_(),
+      coefficient_count_(0),
+      block_(nullptr),
+      current_frame_(0),
+      available_frames_(0),
+      state_()
+{
+}
+
+bool AdpcmDecoder::setFormat(Type type, unsigned int channels, size_t block_size, size_t block_frames)
+{
+    type_ = Type::Unknown;
+
+    if ((channels < 1) || (channels > MAX_CHANNELS)) {
+        return false;
+    }
+
+    if ((type != Type::Ima) && (type != Type::Microsoft)) {
+        return false;
+    }
+
+    type_ = type;
+    channels_ = channels;
+    block_size_ = block_size;
+    block_frames_ = SIZE_MAX;
+
+    size_t max_block_frames = framesInBlock(block_size);
+
+    if (max_block_frames == 0) {
+        type_ = Type::Unknown;
+        return false;
+    }
+
+    if ((block_frames == 0) || (block_frames > max_block_frames)) {
+        block_frames = max_block_frames;
+    }
+
+    block_frames_ = block_frames;
+
+    for (unsigned int index = 0; index < 7; index++) {
+        coefficients_[index][0] = microsoft_coefficients[index][0];
+        coefficients_[index][1] = microsoft_coefficients[index][1];
+    }
+
+    coefficient_count_ = 7;
+
+    block_ = nullptr;
+    current_frame_ = 0;
+    available_frames_ = 0;
+
+    return true;
+}
+
+bool AdpcmDecoder::setCoefficients(unsigned int index, int16_t first, int16_t second)
+{
+    if (index >= MAX_COEFFICIENTS) {
+        return false;
+    }
+
+    coefficients_[index][0] = first;
+    coefficients_[index][1] = second;
+
+    if (coefficient_count_ <= index) {
+        coefficient_count_ = index + 1;
+    }
+
+    return true;
+}
+
+size_t AdpcmDecoder::framesInBlock(size_t bytes)
+{
+    size_t header_size = headerSize();
+
+    if ((header_size == 0) || (bytes < header_size)) {
+        return 0;
+    }
+
+    if (bytes > block_size_) {
+        bytes = block_size_;
+    }
+
+    size_t data_size = bytes - header_size;
+    size_t frames;
+
+    if (type_ == Type::Ima) {
+        // Stereo data is interleaved in words of eight samples per channel
+        if (channels_ == 1) {
+            frames = 1 + data_size * 2;
+        } else {
+            frames = 1 + (data_size / (4 * channels_)) * 8;
+        }
+    } else {
+        frames = 2 + data_size * 2 / channels_;
+    }
+
+    if (frames > block_frames_) {
+        frames = block_frames_;
+    }
+
+    return frames;
+}
+
+size_t AdpcmDecoder::startBlock(const uint8_t *block, size_t bytes)
+{
+    size_t frames = framesInBlock(bytes);
+
+    block_ = block;
+    current_frame_ = 0;
+    available_frames_ = 0;
+
+    if (frames == 0) {
+        return 0;
+    }
+
+    for (unsigned int channel = 0; channel < channels_; channel++) {
+        Channel &state = state_[channel];
+
+        if (type_ == Type::Ima) {
+            state.sample1 = readI16(block + 4 * channel);
+            state.step_index = block[4 * channel + 2];
+
+            if (state.step_index > IMA_MAX_STEP_INDEX) {
+                state.step_index = IMA_MAX_STEP_INDEX;
+            }
+        } else {
+            unsigned int predictor = block[channel];
+
+            if (predictor >= coefficient_count_) {
+                return 0;
+            }
+
+            state.first_coefficient = coefficients_[predictor][0];
+            state.second_coefficient = coefficients_[predictor][1];
+
+            state.delta = readI16(block + channels_ + 2 * channel);
+            state.sample1 = readI16(block + 3 * channels_ + 2 * channel);
+            state.sample2 = readI16(block + 5 * channels_ + 2 * channel);
+        }
+    }
+
+    available_frames_ = frames;
+
+    return frames;
+}
+
+void AdpcmDecoder::skip(size_t frames)
+{
+    if (frames > available_frames_ - current_frame_) {
+        frames = available_frames_ - current_frame_;
+    }
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            decodeSample(channel);
+        }
+
+        current_frame_++;
+    }
+}
+
+void AdpcmDecoder::decode(int16_t *const *outputs, size_t stride, unsigned int copies, size_t frames)
+{
+    if (frames > available_frames_ - current_frame_) {
+        frames = available_frames_ - current_frame_;
+    }
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            int16_t sample = decodeSample(channel);
+            int16_t *output = outputs[channel] + frame * stride;
+
+            for (unsigned int copy = 0; copy < copies; copy++) {
+                output[copy] = sample;
+            }
+        }
+
+        current_frame_++;
+    }
+}
+
+size_t AdpcmDecoder::headerSize()
+{
+    switch (type_) {
+    case Type::Ima:
+        return 4 * channels_;
+    case Type::Microsoft:
+        return 7 * channels_;
+    default:
+        return 0;
+    }
+}
+
+inline int16_t AdpcmDecoder::decodeImaSample(unsigned int channel)
+{
+    Channel &state = state_[channel];
+
+    if (current_frame_ == 0) {
+        return static_cast<int16_t>(state.sample1);
+    }
+
+    size_t position = current_frame_ - 1;
+    const uint8_t *word = block_ + 4 * channels_ * (1 + position / 8) + 4 * channel;
+    uint8_t byte = word[(position % 8) / 2];
+    unsigned int nibble = ((position & 1) != 0) ? (byte >> 4) : (byte & 0x0f);
+
+    int32_t step = ima_step_table[state.step_index];
+    int32_t difference = step >> 3;
+
+    if ((nibble & 1) != 0) {
+        difference += step >> 2;
+    }
+
+    if ((nibble & 2) != 0) {
+        difference += step >> 1;
+    }
+
+    if ((nibble & 4) != 0) {
+        difference += step;
+    }
+
+    if ((nibble & 8) != 0) {
+        state.sample1 = clampToI16(state.sample1 - difference);
+    } else {
+        state.sample1 = clampToI16(state.sample1 + difference);
+    }
+
+    int step_index = static_cast<int>(state.step_index) + ima_index_table[nibble];
+
+    if (step_index < 0) {
+        step_index = 0;
+    } else if (step_index > static_cast<int>(IMA_MAX_STEP_INDEX)) {
+        step_index = IMA_MAX_STEP_INDEX;
+    }
+
+    state.step_index = static_cast<unsigned int>(step_index);
+
+    return static_cast<int16_t>(state.sample1);
+}
+
+inline int16_t AdpcmDecoder::decodeMicrosoftSample(unsigned int channel)
+{
+    Channel &state = state_[channel];
+
+    if (current_frame_ == 0) {
+        return static_cast<int16_t>(state.sample2);
+    }
+
+    if (current_frame_ == 1) {
+        return static_cast<int16_t>(state.sample1);
+    }
+
+    // Nibbles follow the header high first, alternating between channels
+    size_t position = (current_frame_ - 2) * channels_ + channel;
+    uint8_t byte = block_[7 * channels_ + position / 2];
+    unsigned int nibble = ((position & 1) != 0) ? (byte & 0x0f) : (byte >> 4);
+
+    int32_t prediction = (state.sample1 * state.first_coefficient +
+                          state.sample2 * state.second_coefficient) >> 8;
+
+    prediction += (static_cast<int32_t>(nibble ^ 8) - 8) * state.delta;
+
+    state.sample2 = state.sample1;
+    state.sample1 = clampToI16(prediction);
+
+    state.delta = (microsoft_adaptation_table[nibble] * state.delta) >> 8;
+
+    if (state.delta < MICROSOFT_MIN_DELTA) {
+        state.delta = MICROSOFT_MIN_DELTA;
+    }
+
+    return static_cast<int16_t>(state.sample1);
+}
+
+inline int16_t AdpcmDecoder::decodeSample(unsigned int channel)
+{
+    if (type_ == Type::Ima) {
+        return decodeImaSample(channel);
+    }
+
+    return decodeMicrosoftSample(channel);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class AdpcmDecoder
+{
+public:
+    enum class Type : unsigned int
+    {
+        Unknown,
+        Ima,
+        Microsoft,
+    };
+
+    static const unsigned int MAX_CHANNELS = 2;
+
+    static const unsigned int MAX_COEFFICIENTS = 16;
+
+public:
+    AdpcmDecoder();
+
+    bool setFormat(Type type, unsigned int channels, size_t block_size, size_t block_frames);
+
+    // Microsoft ADPCM predictor pairs, the standard seven are set by setFormat()
+    bool setCoefficients(unsigned int index, int16_t first, int16_t second);
+
+    size_t framesInBlock(size_t bytes);
+
+    size_t startBlock(const uint8_t *block, size_t bytes);
+
+    void skip(size_t frames);
+
+    // Each sample is written copies times, consecutive frames are stride samples apart
+    void decode(int16_t *const *outputs, size_t stride, unsigned int copies, size_t frames);
+
+    Type type()
+    {
+        return type_;
+    }
+
+    size_t blockFrames()
+    {
+        return block_frames_;
+    }
+
+private:
+    struct Channel
+    {
+        int32_t sample1;
+        int32_t sample2;
+        int32_t delta;
+        int32_t first_coefficient;
+        int32_t second_coefficient;
+        unsigned int step_index;
+    };
+
+private:
+    size_t headerSize();
+
+    inline int16_t decodeImaSample(unsigned int channel);
+    inline int16_t decodeMicrosoftSample(unsigned int channel);
+    inline int16_t decodeSample(unsigned int channel);
+
+private:
+    Type type_;
+    unsigned int channels_;
+    size_t block_size_;
+    size_t block_frames_;
+
+    int16_t coefficients_[MAX_COEFFICIENTS][2];
+    unsigned int coefficient_count_;
+
+    const uint8_t *block_;
+    size_t current_frame_;
+    size_t available_frames_;
+
+    Channel state_[MAX_CHANNELS];
+};
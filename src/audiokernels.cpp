@@ -0,0 +1,849 @@
+#include "audiokernels.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#ifdef __ARM_ACLE
+#include <arm_acle.h>
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <immintrin.h>
+#define AUDIOKERNELS_X86
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUDIOKERNELS_NEON
+#endif
+
+// The converter loops load little-endian samples as they are
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define AUDIOKERNELS_CONVERSION
+#endif
+
+static inline int16_t saturate(int32_t value)
+{
+#if defined(__ARM_ACLE) && defined(__ARM_FEATURE_SAT)
+    return static_cast<int16_t>(__ssat(value, 16));
+#else
+    if (value > std::numeric_limits<int16_t>::max()) {
+        value = std::numeric_limits<int16_t>::max();
+    } else if (value < std::numeric_limits<int16_t>::min()) {
+        value = std::numeric_limits<int16_t>::min();
+    }
+
+    return static_cast<int16_t>(value);
+#endif
+}
+
+static void accumulateScalar(int32_t *mix, const int16_t *samples, size_t count)
+{
+    for (size_t index = 0; index < count; index++) {
+        mix[index] += samples[index];
+    }
+}
+
+static void mixDownScalar(int16_t *output, const int32_t *mix, size_t count, uint16_t level, unsigned int shift)
+{
+    int32_t unit = 1 << shift;
+
+    for (size_t index = 0; index < count; index++) {
+        output[index] = saturate((mix[index] * level) / unit);
+    }
+}
+
+#ifdef AUDIOKERNELS_X86
+static void accumulateSSE2(int32_t *mix, const int16_t *samples, size_t count)
+{
+    size_t index = 0;
+
+    for (; index + 8 <= count; index += 8) {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + index));
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(input, input), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(input, input), 16);
+
+        __m128i *destination = reinterpret_cast<__m128i *>(mix + index);
+
+        _mm_storeu_si128(destination, _mm_add_epi32(_mm_loadu_si128(destination), low));
+        _mm_storeu_si128(destination + 1, _mm_add_epi32(_mm_loadu_si128(destination + 1), high));
+    }
+
+    accumulateScalar(mix + index, samples + index, count - index);
+}
+
+// Low 32 bits of each product, the same for signed and unsigned inputs.
+// SSE2 only multiplies the even lanes, so the odd lanes are moved down
+static inline __m128i multiplySSE2(__m128i value, __m128i factor)
+{
+    __m128i even = _mm_mul_epu32(value, factor);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(value, 32), _mm_srli_epi64(factor, 32));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Division by 2^shift that rounds toward zero, like the scalar version
+static inline __m128i divideSSE2(__m128i value, __m128i bias, __m128i shift)
+{
+    value = _mm_add_epi32(value, _mm_and_si128(_mm_srai_epi32(value, 31), bias));
+
+    return _mm_sra_epi32(value, shift);
+}
+
+static void mixDownSSE2(int16_t *output, const int32_t *mix, size_t count, uint16_t level, unsigned int shift)
+{
+    __m128i factor = _mm_set1_epi32(level);
+    __m128i bias = _mm_set1_epi32((1 << shift) - 1);
+    __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+
+    size_t index = 0;
+
+    for (; index + 8 <= count; index += 8) {
+        const __m128i *source = reinterpret_cast<const __m128i *>(mix + index);
+
+        __m128i low = divideSSE2(multiplySSE2(_mm_loadu_si128(source), factor), bias, shift_count);
+        __m128i high = divideSSE2(multiplySSE2(_mm_loadu_si128(source + 1), factor), bias, shift_count);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + index), _mm_packs_epi32(low, high));
+    }
+
+    mixDownScalar(output + index, mix + index, count - index, level, shift);
+}
+
+TARGET_AVX2 static void accumulateAVX2(int32_t *mix, const int16_t *samples, size_t count)
+{
+    size_t index = 0;
+
+    for (; index + 16 <= count; index += 16) {
+        __m256i low = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + index)));
+        __m256i high = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + index + 8)));
+
+        __m256i *destination = reinterpret_cast<__m256i *>(mix + index);
+
+        _mm256_storeu_si256(destination, _mm256_add_epi32(_mm256_loadu_si256(destination), low));
+        _mm256_storeu_si256(destination + 1, _mm256_add_epi32(_mm256_loadu_si256(destination + 1), high));
+    }
+
+    accumulateSSE2(mix + index, samples + index, count - index);
+}
+
+TARGET_AVX2 static inline __m256i divideAVX2(__m256i value, __m256i bias, __m128i shift)
+{
+    value = _mm256_add_epi32(value, _mm256_and_si256(_mm256_srai_epi32(value, 31), bias));
+
+    return _mm256_sra_epi32(value, shift);
+}
+
+TARGET_AVX2 static void mixDownAVX2(int16_t *output, const int32_t *mix, size_t count, uint16_t level, unsigned int shift)
+{
+    __m256i factor = _mm256_set1_epi32(level);
+    __m256i bias = _mm256_set1_epi32((1 << shift) - 1);
+    __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+
+    size_t index = 0;
+
+    for (; index + 16 <= count; index += 16) {
+        const __m256i *source = reinterpret_cast<const __m256i *>(mix + index);
+
+        __m256i low = divideAVX2(_mm256_mullo_epi32(_mm256_loadu_si256(source), factor), bias, shift_count);
+        __m256i high = divideAVX2(_mm256_mullo_epi32(_mm256_loadu_si256(source + 1), factor), bias, shift_count);
+
+        // packs works within each 128-bit lane
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + index), packed);
+    }
+
+    mixDownSSE2(output + index, mix + index, count - index, level, shift);
+}
+#endif
+
+#ifdef AUDIOKERNELS_NEON
+static void accumulateNEON(int32_t *mix, const int16_t *samples, size_t count)
+{
+    size_t index = 0;
+
+    for (; index + 8 <= count; index += 8) {
+        int16x8_t input = vld1q_s16(samples + index);
+
+        vst1q_s32(mix + index, vaddw_s16(vld1q_s32(mix + index), vget_low_s16(input)));
+        vst1q_s32(mix + index + 4, vaddw_s16(vld1q_s32(mix + index + 4), vget_high_s16(input)));
+    }
+
+    accumulateScalar(mix + index, samples + index, count - index);
+}
+
+// Division by 2^shift that rounds toward zero, like the scalar version
+static inline int16x4_t divideNEON(int32x4_t value, int32x4_t bias, int32x4_t shift)
+{
+    value = vaddq_s32(value, vandq_s32(vshrq_n_s32(value, 31), bias));
+
+    return vqmovn_s32(vshlq_s32(value, shift));
+}
+
+static void mixDownNEON(int16_t *output, const int32_t *mix, size_t count, uint16_t level, unsigned int shift)
+{
+    int32x4_t bias = vdupq_n_s32((1 << shift) - 1);
+    int32x4_t shift_count = vdupq_n_s32(-static_cast<int32_t>(shift));
+
+    size_t index = 0;
+
+    for (; index + 8 <= count; index += 8) {
+        int16x4_t low = divideNEON(vmulq_n_s32(vld1q_s32(mix + index), level), bias, shift_count);
+        int16x4_t high = divideNEON(vmulq_n_s32(vld1q_s32(mix + index + 4), level), bias, shift_count);
+
+        vst1q_s16(output + index, vcombine_s16(low, high));
+    }
+
+    mixDownScalar(output + index, mix + index, count - index, level, shift);
+}
+#endif
+
+#ifdef AUDIOKERNELS_CONVERSION
+#ifdef AUDIOKERNELS_X86
+typedef __m128i VectorI32;
+typedef __m128i VectorI16;
+typedef __m128i VectorState;
+
+static inline VectorState loadDitherState(const uint32_t *state)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(state));
+}
+
+static inline void storeDitherState(uint32_t *state, VectorState vector)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), vector);
+}
+
+static inline VectorI32 nextVectorDither(VectorState *state)
+{
+    __m128i value = *state;
+
+    value = _mm_xor_si128(value, _mm_slli_epi32(value, 13));
+    value = _mm_xor_si128(value, _mm_srli_epi32(value, 17));
+    value = _mm_xor_si128(value, _mm_slli_epi32(value, 5));
+
+    *state = value;
+
+    __m128i mask = _mm_set1_epi32(0xff);
+
+    return _mm_sub_epi32(_mm_and_si128(value, mask),
+                         _mm_and_si128(_mm_srli_epi32(value, 8), mask));
+}
+
+static inline VectorI32 ditherVector(VectorI32 value, VectorState *state)
+{
+    __m128i sample = _mm_add_epi32(_mm_srai_epi32(value, 8), nextVectorDither(state));
+
+    return _mm_srai_epi32(_mm_add_epi32(sample, _mm_set1_epi32(128)), 8);
+}
+
+static inline VectorI16 reduceVector(VectorI32 low, VectorI32 high, VectorState *state)
+{
+    if (state == nullptr) {
+        return _mm_packs_epi32(_mm_srai_epi32(low, 16), _mm_srai_epi32(high, 16));
+    }
+
+    // Sequenced, the low half takes the first dither like on NEON
+    VectorI32 reduced_low = ditherVector(low, state);
+    VectorI32 reduced_high = ditherVector(high, state);
+
+    return _mm_packs_epi32(reduced_low, reduced_high);
+}
+
+static inline int16_t *storeVector(int16_t *output, VectorI16 samples, unsigned int upmixing)
+{
+    __m128i *pointer = reinterpret_cast<__m128i *>(output);
+
+    if (upmixing == 1) {
+        _mm_storeu_si128(pointer, samples);
+        return output + 8;
+    }
+
+    _mm_storeu_si128(pointer, _mm_unpacklo_epi16(samples, samples));
+    _mm_storeu_si128(pointer + 1, _mm_unpackhi_epi16(samples, samples));
+
+    return output + 16;
+}
+
+#ifdef HAS_IEEE_FLOAT
+static inline __m128i convertF32x4(__m128 value)
+{
+    // The second operand is returned for NaN, so it ends up as -1
+    value = _mm_max_ps(value, _mm_set1_ps(-1.0f));
+    value = _mm_min_ps(value, _mm_set1_ps(1.0f));
+
+    return _mm_cvttps_epi32(_mm_mul_ps(value, _mm_set1_ps(AudioKernels::F32_SCALE)));
+}
+
+static inline __m128i convertF64x2(__m128d value)
+{
+    value = _mm_max_pd(value, _mm_set1_pd(-1.0));
+    value = _mm_min_pd(value, _mm_set1_pd(1.0));
+
+    return _mm_cvttpd_epi32(_mm_mul_pd(value, _mm_set1_pd(AudioKernels::F64_SCALE)));
+}
+
+TARGET_AVX2 static inline __m256i convertF32x8(__m256 value)
+{
+    value = _mm256_max_ps(value, _mm256_set1_ps(-1.0f));
+    value = _mm256_min_ps(value, _mm256_set1_ps(1.0f));
+
+    return _mm256_cvttps_epi32(_mm256_mul_ps(value, _mm256_set1_ps(AudioKernels::F32_SCALE)));
+}
+
+TARGET_AVX2 static inline __m128i convertF64x4(__m256d value)
+{
+    value = _mm256_max_pd(value, _mm256_set1_pd(-1.0));
+    value = _mm256_min_pd(value, _mm256_set1_pd(1.0));
+
+    return _mm256_cvttpd_epi32(_mm256_mul_pd(value, _mm256_set1_pd(AudioKernels::F64_SCALE)));
+}
+#endif
+
+struct Unsigned8Vectors
+{
+    static const size_t SIZE = 1;
+
+    static VectorI16 load(const uint8_t *input)
+    {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(input));
+        bytes = _mm_xor_si128(bytes, _mm_set1_epi8(static_cast<char>(0x80)));
+
+        return _mm_unpacklo_epi8(_mm_setzero_si128(), bytes);
+    }
+};
+
+struct Signed16Vectors
+{
+    static const size_t SIZE = 2;
+
+    static VectorI16 load(const uint8_t *input)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+    }
+};
+
+// pshufb needs SSSE3, which every CPU of the SSE4.1 level has
+struct Signed24Vectors
+{
+    static const size_t SIZE = 3;
+
+    TARGET_SSE41 static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        // Both loads stay within the 24 bytes of the block
+        const __m128i low_shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+                                                  -1, 6, 7, 8, -1, 9, 10, 11);
+        const __m128i high_shuffle = _mm_setr_epi8(-1, 4, 5, 6, -1, 7, 8, 9,
+                                                   -1, 10, 11, 12, -1, 13, 14, 15);
+
+        *low = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input)),
+                                low_shuffle);
+        *high = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + 8)),
+                                 high_shuffle);
+    }
+};
+
+struct Signed32Vectors
+{
+    static const size_t SIZE = 4;
+
+    static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        *low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input));
+        *high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + 16));
+    }
+};
+
+#ifdef HAS_IEEE_FLOAT
+struct Float32Vectors
+{
+    static const size_t SIZE = 4;
+
+    static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        *low = convertF32x4(_mm_loadu_ps(reinterpret_cast<const float *>(input)));
+        *high = convertF32x4(_mm_loadu_ps(reinterpret_cast<const float *>(input + 16)));
+    }
+};
+
+struct Float64Vectors
+{
+    static const size_t SIZE = 8;
+
+    static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        const double *values = reinterpret_cast<const double *>(input);
+
+        *low = _mm_unpacklo_epi64(convertF64x2(_mm_loadu_pd(values)),
+                                  convertF64x2(_mm_loadu_pd(values + 2)));
+        *high = _mm_unpacklo_epi64(convertF64x2(_mm_loadu_pd(values + 4)),
+                                   convertF64x2(_mm_loadu_pd(values + 6)));
+    }
+};
+
+struct Float32AVX2Vectors
+{
+    static const size_t SIZE = 4;
+
+    TARGET_AVX2 static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        __m256i samples = convertF32x8(_mm256_loadu_ps(reinterpret_cast<const float *>(input)));
+
+        *low = _mm256_castsi256_si128(samples);
+        *high = _mm256_extractf128_si256(samples, 1);
+    }
+};
+
+struct Float64AVX2Vectors
+{
+    static const size_t SIZE = 8;
+
+    TARGET_AVX2 static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        const double *values = reinterpret_cast<const double *>(input);
+
+        *low = convertF64x4(_mm256_loadu_pd(values));
+        *high = convertF64x4(_mm256_loadu_pd(values + 4));
+    }
+};
+#endif
+#endif
+
+#ifdef AUDIOKERNELS_NEON
+typedef int32x4_t VectorI32;
+typedef int16x8_t VectorI16;
+typedef uint32x4_t VectorState;
+
+static inline VectorState loadDitherState(const uint32_t *state)
+{
+    return vld1q_u32(state);
+}
+
+static inline void storeDitherState(uint32_t *state, VectorState vector)
+{
+    vst1q_u32(state, vector);
+}
+
+static inline VectorI32 nextVectorDither(VectorState *state)
+{
+    uint32x4_t value = *state;
+
+    value = veorq_u32(value, vshlq_n_u32(value, 13));
+    value = veorq_u32(value, vshrq_n_u32(value, 17));
+    value = veorq_u32(value, vshlq_n_u32(value, 5));
+
+    *state = value;
+
+    uint32x4_t mask = vdupq_n_u32(0xff);
+
+    return vsubq_s32(vreinterpretq_s32_u32(vandq_u32(value, mask)),
+                     vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(value, 8), mask)));
+}
+
+static inline int16x4_t ditherVector(VectorI32 value, VectorState *state)
+{
+    int32x4_t sample = vaddq_s32(vshrq_n_s32(value, 8), nextVectorDither(state));
+
+    return vqrshrn_n_s32(sample, 8);
+}
+
+static inline VectorI16 reduceVector(VectorI32 low, VectorI32 high, VectorState *state)
+{
+    if (state == nullptr) {
+        return vcombine_s16(vshrn_n_s32(low, 16), vshrn_n_s32(high, 16));
+    }
+
+    int16x4_t reduced_low = ditherVector(low, state);
+    int16x4_t reduced_high = ditherVector(high, state);
+
+    return vcombine_s16(reduced_low, reduced_high);
+}
+
+static inline int16_t *storeVector(int16_t *output, VectorI16 samples, unsigned int upmixing)
+{
+    if (upmixing == 1) {
+        vst1q_s16(output, samples);
+        return output + 8;
+    }
+
+    int16x8x2_t pairs = {{samples, samples}};
+    vst2q_s16(output, pairs);
+
+    return output + 16;
+}
+
+#ifdef HAS_IEEE_FLOAT
+static inline int32x4_t convertF32x4(float32x4_t value)
+{
+    // Comparisons with NaN are false, so it ends up as -1
+    float32x4_t minimum = vdupq_n_f32(-1.0f);
+    value = vbslq_f32(vcgeq_f32(value, minimum), value, minimum);
+    value = vminq_f32(value, vdupq_n_f32(1.0f));
+
+    return vcvtq_s32_f32(vmulq_n_f32(value, AudioKernels::F32_SCALE));
+}
+
+#ifdef __aarch64__
+static inline int32x2_t convertF64x2(float64x2_t value)
+{
+    float64x2_t minimum = vdupq_n_f64(-1.0);
+    value = vbslq_f64(vcgeq_f64(value, minimum), value, minimum);
+    value = vminq_f64(value, vdupq_n_f64(1.0));
+
+    return vmovn_s64(vcvtq_s64_f64(vmulq_n_f64(value, AudioKernels::F64_SCALE)));
+}
+#endif
+#endif
+
+struct Unsigned8Vectors
+{
+    static const size_t SIZE = 1;
+
+    static VectorI16 load(const uint8_t *input)
+    {
+        uint8x8_t bytes = veor_u8(vld1_u8(input), vdup_n_u8(0x80));
+
+        return vshll_n_s8(vreinterpret_s8_u8(bytes), 8);
+    }
+};
+
+struct Signed16Vectors
+{
+    static const size_t SIZE = 2;
+
+    static VectorI16 load(const uint8_t *input)
+    {
+        return vreinterpretq_s16_u8(vld1q_u8(input));
+    }
+};
+
+struct Signed24Vectors
+{
+    static const size_t SIZE = 3;
+
+    static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        uint8x8x3_t bytes = vld3_u8(input);
+
+        uint8x8x2_t upper_bytes = vzip_u8(bytes.val[1], bytes.val[2]);
+        int16x8_t upper = vreinterpretq_s16_u8(vcombine_u8(upper_bytes.val[0],
+                                                           upper_bytes.val[1]));
+        uint16x8_t lower = vshll_n_u8(bytes.val[0], 8);
+
+        *low = vorrq_s32(vshll_n_s16(vget_low_s16(upper), 16),
+                         vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(lower))));
+        *high = vorrq_s32(vshll_n_s16(vget_high_s16(upper), 16),
+                          vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(lower))));
+    }
+};
+
+struct Signed32Vectors
+{
+    static const size_t SIZE = 4;
+
+    static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        *low = vreinterpretq_s32_u8(vld1q_u8(input));
+        *high = vreinterpretq_s32_u8(vld1q_u8(input + 16));
+    }
+};
+
+#ifdef HAS_IEEE_FLOAT
+struct Float32Vectors
+{
+    static const size_t SIZE = 4;
+
+    static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        *low = convertF32x4(vreinterpretq_f32_u8(vld1q_u8(input)));
+        *high = convertF32x4(vreinterpretq_f32_u8(vld1q_u8(input + 16)));
+    }
+};
+
+#ifdef __aarch64__
+struct Float64Vectors
+{
+    static const size_t SIZE = 8;
+
+    static void load(const uint8_t *input, VectorI32 *low, VectorI32 *high)
+    {
+        *low = vcombine_s32(convertF64x2(vreinterpretq_f64_u8(vld1q_u8(input))),
+                            convertF64x2(vreinterpretq_f64_u8(vld1q_u8(input + 16))));
+        *high = vcombine_s32(convertF64x2(vreinterpretq_f64_u8(vld1q_u8(input + 32))),
+                             convertF64x2(vreinterpretq_f64_u8(vld1q_u8(input + 48))));
+    }
+};
+#endif
+#endif
+#endif
+
+#if defined(AUDIOKERNELS_X86) || defined(AUDIOKERNELS_NEON)
+// Formats that already are 16-bit after loading
+template <typename Vectors>
+static size_t convertVectors(int16_t *output, const uint8_t *input, size_t samples, unsigned int upmixing)
+{
+    size_t sample = 0;
+
+    for (; sample + 8 <= samples; sample += 8) {
+        output = storeVector(output, Vectors::load(input), upmixing);
+        input += 8 * Vectors::SIZE;
+    }
+
+    return sample;
+}
+
+// Formats that are loaded as full scale 32-bit and then reduced to 16-bit
+template <typename Vectors>
+static size_t reduceVectors(int16_t *output,
+                            const uint8_t *input,
+                            size_t samples,
+                            unsigned int upmixing,
+                            uint32_t *dither_state)
+{
+    VectorState state = {};
+    VectorState *state_pointer = nullptr;
+
+    if (dither_state != nullptr) {
+        state = loadDitherState(dither_state);
+        state_pointer = &state;
+    }
+
+    size_t sample = 0;
+
+    for (; sample + 8 <= samples; sample += 8) {
+        VectorI32 low;
+        VectorI32 high;
+
+        Vectors::load(input, &low, &high);
+
+        output = storeVector(output, reduceVector(low, high, state_pointer), upmixing);
+        input += 8 * Vectors::SIZE;
+    }
+
+    if (dither_state != nullptr) {
+        storeDitherState(dither_state, state);
+    }
+
+    return sample;
+}
+#endif
+
+#ifdef AUDIOKERNELS_X86
+// reduceVectors() for loads of a higher level. GCC only inlines them into
+// a loop built for the same level, so the loop is repeated per level
+template <typename Vectors>
+TARGET_SSE41 static size_t reduceVectorsSSE41(int16_t *output,
+                                              const uint8_t *input,
+                                              size_t samples,
+                                              unsigned int upmixing,
+                                              uint32_t *dither_state)
+{
+    VectorState state = {};
+    VectorState *state_pointer = nullptr;
+
+    if (dither_state != nullptr) {
+        state = loadDitherState(dither_state);
+        state_pointer = &state;
+    }
+
+    size_t sample = 0;
+
+    for (; sample + 8 <= samples; sample += 8) {
+        VectorI32 low;
+        VectorI32 high;
+
+        Vectors::load(input, &low, &high);
+
+        output = storeVector(output, reduceVector(low, high, state_pointer), upmixing);
+        input += 8 * Vectors::SIZE;
+    }
+
+    if (dither_state != nullptr) {
+        storeDitherState(dither_state, state);
+    }
+
+    return sample;
+}
+
+template <typename Vectors>
+TARGET_AVX2 static size_t reduceVectorsAVX2(int16_t *output,
+                                            const uint8_t *input,
+                                            size_t samples,
+                                            unsigned int upmixing,
+                                            uint32_t *dither_state)
+{
+    VectorState state = {};
+    VectorState *state_pointer = nullptr;
+
+    if (dither_state != nullptr) {
+        state = loadDitherState(dither_state);
+        state_pointer = &state;
+    }
+
+    size_t sample = 0;
+
+    for (; sample + 8 <= samples; sample += 8) {
+        VectorI32 low;
+        VectorI32 high;
+
+        Vectors::load(input, &low, &high);
+
+        output = storeVector(output, reduceVector(low, high, state_pointer), upmixing);
+        input += 8 * Vectors::SIZE;
+    }
+
+    if (dither_state != nullptr) {
+        storeDitherState(dither_state, state);
+    }
+
+    return sample;
+}
+#endif
+#endif
+
+static AudioKernels::Level detectLevel()
+{
+#if defined(AUDIOKERNELS_X86)
+    if (__builtin_cpu_supports("avx2")) {
+        return AudioKernels::Level::AVX2;
+    }
+
+    if (__builtin_cpu_supports("sse4.1")) {
+        return AudioKernels::Level::SSE41;
+    }
+
+    return AudioKernels::Level::SSE2;
+#elif defined(AUDIOKERNELS_NEON)
+    return AudioKernels::Level::NEON;
+#else
+    return AudioKernels::Level::None;
+#endif
+}
+
+// AUDIO_SIMD only lowers the level. NEON and the x86 levels are not
+// comparable, asking for the other family gives the scalar versions
+static AudioKernels::Level limitLevel(AudioKernels::Level level)
+{
+    const char *name = getenv("AUDIO_SIMD");
+    if (name == nullptr) {
+        return level;
+    }
+
+    static const AudioKernels::Level LEVELS[] = {
+        AudioKernels::Level::None,
+        AudioKernels::Level::SSE2,
+        AudioKernels::Level::SSE41,
+        AudioKernels::Level::AVX2,
+        AudioKernels::Level::NEON,
+    };
+
+    for (AudioKernels::Level requested : LEVELS) {
+        if (strcmp(name, audioKernelsLevelName(requested)) != 0) {
+            continue;
+        }
+
+        if ((requested == AudioKernels::Level::NEON) || (level == AudioKernels::Level::NEON)) {
+            return (requested == level) ? level : AudioKernels::Level::None;
+        }
+
+        return (requested < level) ? requested : level;
+    }
+
+    return level;
+}
+
+static AudioKernels selectKernels()
+{
+    AudioKernels kernels = {AudioKernels::Level::None,
+                            &accumulateScalar,
+                            &mixDownScalar,
+                            nullptr,
+                            nullptr,
+                            nullptr,
+                            nullptr,
+                            nullptr,
+                            nullptr};
+
+    kernels.level = limitLevel(detectLevel());
+
+    switch (kernels.level) {
+#ifdef AUDIOKERNELS_X86
+    case AudioKernels::Level::AVX2:
+        kernels.accumulate = &accumulateAVX2;
+        kernels.mixDown = &mixDownAVX2;
+        break;
+    case AudioKernels::Level::SSE41:
+    case AudioKernels::Level::SSE2:
+        kernels.accumulate = &accumulateSSE2;
+        kernels.mixDown = &mixDownSSE2;
+        break;
+#endif
+#ifdef AUDIOKERNELS_NEON
+    case AudioKernels::Level::NEON:
+        kernels.accumulate = &accumulateNEON;
+        kernels.mixDown = &mixDownNEON;
+        break;
+#endif
+    default:
+        break;
+    }
+
+#if defined(AUDIOKERNELS_CONVERSION) && (defined(AUDIOKERNELS_X86) || defined(AUDIOKERNELS_NEON))
+    if (kernels.level != AudioKernels::Level::None) {
+        kernels.convertUnsigned8 = &convertVectors<Unsigned8Vectors>;
+        kernels.convertSigned16 = &convertVectors<Signed16Vectors>;
+#ifdef AUDIOKERNELS_NEON
+        kernels.convertSigned24 = &reduceVectors<Signed24Vectors>;
+#endif
+        kernels.convertSigned32 = &reduceVectors<Signed32Vectors>;
+#ifdef HAS_IEEE_FLOAT
+        kernels.convertFloat32 = &reduceVectors<Float32Vectors>;
+#if defined(AUDIOKERNELS_X86) || defined(__aarch64__)
+        kernels.convertFloat64 = &reduceVectors<Float64Vectors>;
+#endif
+#endif
+    }
+
+#ifdef AUDIOKERNELS_X86
+    if ((kernels.level == AudioKernels::Level::SSE41) || (kernels.level == AudioKernels::Level::AVX2)) {
+        kernels.convertSigned24 = &reduceVectorsSSE41<Signed24Vectors>;
+    }
+
+#ifdef HAS_IEEE_FLOAT
+    if (kernels.level == AudioKernels::Level::AVX2) {
+        kernels.convertFloat32 = &reduceVectorsAVX2<Float32AVX2Vectors>;
+        kernels.convertFloat64 = &reduceVectorsAVX2<Float64AVX2Vectors>;
+    }
+#endif
+#endif
+#endif
+
+    return kernels;
+}
+
+const AudioKernels &audioKernels()
+{
+    // Resolved on first use, once per process
+    static const AudioKernels kernels = selectKernels();
+
+    return kernels;
+}
+
+const char *audioKernelsLevelName(AudioKernels::Level level)
+{
+    switch (level) {
+    case AudioKernels::Level::SSE2:
+        return "sse2";
+    case AudioKernels::Level::SSE41:
+        return "sse4.1";
+    case AudioKernels::Level::AVX2:
+        return "avx2";
+    case AudioKernels::Level::NEON:
+        return "neon";
+    default:
+        return "c";
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Inner loops of the mixer and the PCM converter, one version of each
+// picked once per process from the CPU features. The AUDIO_SIMD environment
+// variable (c, sse2, sse4.1, avx2 or neon) caps the level, for benchmarking
+// each level and as a fallback in production. The MP3 decoder reads the same
+// variable for its own kernels
+struct AudioKernels
+{
+    enum class Level : unsigned int
+    {
+        None,
+        SSE2,
+        SSE41,
+        AVX2,
+        NEON,
+    };
+
+    // PcmConverter loops over packed little-endian samples, each one written
+    // upmixing (1 or 2) times. They convert whole groups of 8 samples and
+    // return how many they converted, PcmConverter converts the rest
+    typedef size_t (*ConvertKernel)(int16_t *output, const uint8_t *input, size_t samples, unsigned int upmixing);
+
+    // The same for samples loaded as full scale 32-bit and reduced to 16-bit,
+    // with triangular dither from the 4 states at dither_state unless it is null
+    typedef size_t (*ReduceKernel)(int16_t *output,
+                                   const uint8_t *input,
+                                   size_t samples,
+                                   unsigned int upmixing,
+                                   uint32_t *dither_state);
+
+    // Full scale of float samples loaded as 32-bit, with or without a kernel
+    static constexpr float F32_SCALE = static_cast<float>(INT32_MAX - 127);
+    static constexpr double F64_SCALE = static_cast<double>(INT32_MAX);
+
+    Level level;
+
+    // mix[i] += samples[i]
+    void (*accumulate)(int32_t *mix, const int16_t *samples, size_t count);
+
+    // output[i] = mix[i] * level / 2^shift, rounded toward zero and saturated
+    void (*mixDown)(int16_t *output, const int32_t *mix, size_t count, uint16_t level, unsigned int shift);
+
+    // Null where the level has no loop for the format
+    ConvertKernel convertUnsigned8;
+    ConvertKernel convertSigned16;
+    ReduceKernel convertSigned24;
+    ReduceKernel convertSigned32;
+    ReduceKernel convertFloat32;
+    ReduceKernel convertFloat64;
+};
+
+const AudioKernels &audioKernels();
+
+const char *audioKernelsLevelName(AudioKernels::Level level);
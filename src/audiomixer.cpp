@@ -1,26 +1,8 @@
 #include "audiomixer.h"
 
-#include <cstring>
-#include <limits>
-
-#ifdef __ARM_ACLE
-#include <arm_acle.h>
-#endif
-
-static inline int16_t saturate(int32_t value)
-{
-#if defined(__ARM_ACLE) && defined(__ARM_FEATURE_SAT)
-    return static_cast<int16_t>(__ssat(value, 16));
-#else
-    if (value > std::numeric_limits<int16_t>::max()) {
-        value = std::numeric_limits<int16_t>::max();
-    } else if (value < std::numeric_limits<int16_t>::min()) {
-        value = std::numeric_limits<int16_t>::min();
-    }
+#include "audiokernels.h"
 
-    return static_cast<int16_t>(value);
-#endif
-}
+#include <cstring>
 
 AudioMixer::AudioMixer(TrackEndCallback track_end_callback,
                        unsigned int channels)
@@ -174,6 +156,8 @@ void AudioMixer::clear()
 
 size_t AudioMixer::play(int16_t *buffer, size_t frames)
 {
+    const AudioKernels &kernels = audioKernels();
+
     size_t batch_size = AUDIOMIXER_BUFFER_SIZE;
     size_t batch_samples = AUDIOMIXER_BUFFER_LENGTH;
     size_t batch_frames = batch_samples / channels_;
@@ -198,25 +182,78 @@ size_t AudioMixer::play(int16_t *buffer, size_t frames)
                     continue;
                 }
 
-                for (size_t frame_index = 0; frame_index < track_frames; frame_index++) {
-                    for (unsigned int channel = 0; channel < channels_; channel++) {
-                        size_t offset = channels_ * frame_index + channel;
-                        sample_buffer_[offset] += buffer[offset];
-                    }
+                if (tracks_[slot]->silentBlock()) {
+                    continue;
                 }
-            }
-        }
 
-        for (size_t frame_index = 0; frame_index < batch_frames; frame_index++) {
-            for (unsigned int channel = 0; channel < channels_; channel++) {
-                size_t offset = channels_ * frame_index + channel;
-                buffer[offset] = saturate((sample_buffer_[offset] * level_) / UNIT_LEVEL);
+                kernels.accumulate(sample_buffer_, buffer, track_frames * channels_);
             }
         }
 
+        kernels.mixDown(buffer, sample_buffer_, batch_frames * channels_, level_, AudioTrack::UNIT_LEVEL_SHIFT);
+
         remaining_frames -= batch_frames;
         buffer += batch_samples;
     }
 
     return frames;
 }
+
+size_t AudioMixer::play(int16_t *const *buffers, size_t frames)
+{
+    if (channels_ > MAX_PLANES) {
+        return 0;
+    }
+
+    const AudioKernels &kernels = audioKernels();
+
+    // Keep every plane of the accumulator 16-byte aligned
+    size_t plane_length = (AUDIOMIXER_BUFFER_LENGTH / channels_) & ~static_cast<size_t>(3);
+    size_t batch_frames = plane_length;
+
+    int16_t *batch_buffers[MAX_PLANES];
+
+    size_t processed_frames = 0;
+
+    while (processed_frames < frames) {
+        if (batch_frames > frames - processed_frames) {
+            batch_frames = frames - processed_frames;
+        }
+
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            batch_buffers[channel] = buffers[channel] + processed_frames;
+            memset(sample_buffer_ + plane_length * channel, 0, batch_frames * 4);
+        }
+
+        for (int slot = 0; slot < TRACK_SLOTS; slot++) {
+            if (tracks_[slot] && tracks_[slot]->running()) {
+                size_t track_frames = tracks_[slot]->play(batch_buffers, batch_frames);
+                if (track_frames < 1) {
+                    tracks_[slot]->stop();
+                    track_end_callback_(slot);
+                    continue;
+                }
+
+                if (tracks_[slot]->silentBlock()) {
+                    continue;
+                }
+
+                for (unsigned int channel = 0; channel < channels_; channel++) {
+                    kernels.accumulate(sample_buffer_ + plane_length * channel, batch_buffers[channel], track_frames);
+                }
+            }
+        }
+
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            kernels.mixDown(batch_buffers[channel],
+                            sample_buffer_ + plane_length * channel,
+                            batch_frames,
+                            level_,
+                            AudioTrack::UNIT_LEVEL_SHIFT);
+        }
+
+        processed_frames += batch_frames;
+    }
+
+    return frames;
+}
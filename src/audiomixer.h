@@ -28,6 +28,8 @@ public:
 
     static const size_t AUDIOMIXER_BUFFER_LENGTH = AUDIOMIXER_BUFFER_SIZE / 4;
 
+    static const unsigned int MAX_PLANES = 8;
+
 public:
     AudioMixer(TrackEndCallback track_end_callback,
                unsigned int channels);
@@ -71,6 +73,8 @@ public:
 
     size_t play(int16_t *buffer, size_t frames);
 
+    size_t play(int16_t *const *buffers, size_t frames);
+
     unsigned long samplingRate()
     {
         return sampling_rate_;
@@ -84,7 +88,7 @@ public:
 private:
     Track *tracks_[TRACK_SLOTS];
 
-    int32_t sample_buffer_[AUDIOMIXER_BUFFER_LENGTH];
+    alignas(16) int32_t sample_buffer_[AUDIOMIXER_BUFFER_LENGTH];
 
     TrackEndCallback track_end_callback_;
 
@@ -27,7 +27,11 @@ public:
           seek_callback_(seek_callback),
           read_callback_(read_callback),
           sampling_rate_(0),
-          channels_(0)
+          channels_(0),
+          total_frames_(0),
+          loop_start_(0),
+          loop_end_(0),
+          silent_block_(false)
     {
     }
 
@@ -39,8 +43,16 @@ public:
 
     virtual void rewind(bool preload = true) = 0;
 
+    // Positions the next decode call at the given frame. False if it is past
+    // the end, which leaves the position unchanged, or if the stream does not
+    // decode there, which rewinds
+    virtual bool seek(size_t frame) = 0;
+
     virtual size_t decodeToI16(int16_t *buffer, size_t frames, unsigned int upmixing = 1) = 0;
 
+    // Planar variant: buffers holds channels() * upmixing pointers, one per output channel
+    virtual size_t decodeToI16(int16_t *const *buffers, size_t frames, unsigned int upmixing = 1) = 0;
+
     bool opened()
     {
         return opened_;
@@ -61,6 +73,29 @@ public:
         return channels_;
     }
 
+    // Exact length without decoding the whole file, 0 when unknown
+    size_t totalFrames()
+    {
+        return total_frames_;
+    }
+
+    // Frames repeated by Mode::Continuous, the end is exclusive and 0 when unknown
+    size_t loopStart()
+    {
+        return loop_start_;
+    }
+
+    size_t loopEnd()
+    {
+        return loop_end_;
+    }
+
+    // True if everything returned by the last decode call is digital silence
+    bool silentBlock()
+    {
+        return silent_block_;
+    }
+
 protected:
     bool opened_;
 
@@ -74,4 +109,11 @@ protected:
 
     unsigned long sampling_rate_;
     unsigned int channels_;
+
+    size_t total_frames_;
+
+    size_t loop_start_;
+    size_t loop_end_;
+
+    bool silent_block_;
 };
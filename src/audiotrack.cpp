@@ -1,5 +1,6 @@
 #include "audiotrack.h"
 
+#include <cstring>
 #include <limits>
 
 #ifdef __ARM_ACLE
@@ -25,6 +26,17 @@ static inline int16_t saturate(int32_t value)
 #include "cosine.h"
 #endif
 
+#ifdef HAS_DECODE_AHEAD
+#include "decodeworker.h"
+
+// Bounds the time the worker holds the reader per call
+static const size_t RING_FILL_FRAMES = 1152;
+
+#define LOCK_READER() std::lock_guard<std::mutex> reader_lock(reader_mutex_)
+#else
+#define LOCK_READER()
+#endif
+
 AudioTrack::AudioTrack(unsigned int channels)
     : readers_(),
       reader_(nullptr),
@@ -39,11 +51,37 @@ AudioTrack::AudioTrack(unsigned int channels)
       fade_progress_(0),
       initial_level_(0),
       final_level_(0),
+#ifdef HAS_DECODE_AHEAD
+      requested_worker_(nullptr),
+      ring_depth_(0),
+      ring_state_(RingState::Direct),
+      ring_worker_(nullptr),
+      ring_(),
+      ring_frames_(0),
+      ring_channels_(0),
+      ring_write_count_(0),
+      ring_read_count_(0),
+      ring_generation_(0),
+      ring_read_generation_(0),
+      ring_end_generation_(0),
+#endif
       running_(false),
-      stopping_(false)
+      stopping_(false),
+      silent_block_(false)
 {
 }
 
+#ifdef HAS_DECODE_AHEAD
+AudioTrack::~AudioTrack()
+{
+    // Not decodeAhead(nullptr), the reader may be gone before the track
+    DecodeWorker *worker = requested_worker_.load(std::memory_order_relaxed);
+    if (worker) {
+        worker->removeTrack(this);
+    }
+}
+#endif
+
 bool AudioTrack::addReader(AudioReader *reader)
 {
     for (int slot = 0; slot < READER_SLOTS; slot++) {
@@ -63,6 +101,8 @@ bool AudioTrack::start(void *file,
                        Fade fade_mode,
                        uint16_t fade_length_ms)
 {
+    LOCK_READER();
+
     running_ = false;
     stopping_ = false;
 
@@ -104,6 +144,21 @@ bool AudioTrack::start(void *file,
 
     running_ = true;
 
+#ifdef HAS_DECODE_AHEAD
+    // play() does not run alongside start(), which can set up both ends of
+    // the ring and fill it, leaving nothing to wait for on the first block
+    DecodeWorker *worker = requested_worker_.load(std::memory_order_acquire);
+
+    if (worker) {
+        openRing(worker);
+
+        while (decodeIntoRing()) {
+        }
+    } else {
+        ring_state_.store(RingState::Direct, std::memory_order_relaxed);
+    }
+#endif
+
     fade(level, fade_mode, fade_length_ms);
 
     return true;
@@ -152,6 +207,15 @@ void AudioTrack::stop(Fade fade_mode,
         return;
     }
 
+#ifdef HAS_DECODE_AHEAD
+    // Already ended by play(), which leaves the reader to the worker
+    if (!running_ && (ring_state_.load(std::memory_order_relaxed) == RingState::Ring)) {
+        return;
+    }
+#endif
+
+    LOCK_READER();
+
     fade(0, fade_mode, fade_length_ms);
 
     if (fade_mode_ != Fade::None) {
@@ -174,9 +238,98 @@ void AudioTrack::rewind(bool preload)
         return;
     }
 
+    LOCK_READER();
+
     reader_->rewind(preload);
+
+#ifdef HAS_DECODE_AHEAD
+    // Only play() drops what the ring holds, the worker waits for it
+    ring_generation_.fetch_add(1, std::memory_order_release);
+#endif
 }
 
+bool AudioTrack::seek(size_t frame)
+{
+    if (!reader_) {
+        return false;
+    }
+
+    if (!running_) {
+        return false;
+    }
+
+    LOCK_READER();
+
+    bool sought = reader_->seek(frame);
+
+#ifdef HAS_DECODE_AHEAD
+    // A seek past the end leaves the reader where the ring stops
+    if (sought) {
+        ring_generation_.fetch_add(1, std::memory_order_release);
+    }
+#endif
+
+    return sought;
+}
+
+#ifdef HAS_DECODE_AHEAD
+bool AudioTrack::decodeAhead(DecodeWorker *worker, size_t depth_frames)
+{
+    // The render thread splits planar blocks when it leaves the ring
+    if (channels_ > MAX_PLANES) {
+        return worker == nullptr;
+    }
+
+    ring_depth_.store(depth_frames, std::memory_order_relaxed);
+
+    DecodeWorker *previous = requested_worker_.load(std::memory_order_relaxed);
+    if (previous == worker) {
+        return true;
+    }
+
+    // Returns once the previous worker no longer decodes for the track
+    if (previous) {
+        previous->removeTrack(this);
+    }
+
+    bool added = !worker || worker->addTrack(this);
+    if (!added) {
+        worker = nullptr;
+    }
+
+    requested_worker_.store(worker, std::memory_order_release);
+
+    if (!worker) {
+        LOCK_READER();
+
+        // play() ended the track on the ring, the worker would have closed the reader
+        if (reader_ && !running_ && reader_->opened()) {
+            reader_->close();
+        }
+    }
+
+    return added;
+}
+
+bool AudioTrack::fillRing()
+{
+    // Tracks play() has not switched to the ring yet cost the worker no lock
+    if (ring_state_.load(std::memory_order_acquire) != RingState::Ring) {
+        return false;
+    }
+
+    // Nor do tracks waiting for play() to take over after a seek or rewind,
+    // which leaves the reader lock to play()
+    if (ring_read_generation_.load(std::memory_order_acquire) != ring_generation_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    LOCK_READER();
+
+    return decodeIntoRing();
+}
+#endif
+
 size_t AudioTrack::play(int16_t *buffer, size_t frames)
 {
     if (!reader_) {
@@ -187,12 +340,16 @@ size_t AudioTrack::play(int16_t *buffer, size_t frames)
         return 0;
     }
 
-    frames = reader_->decodeToI16(buffer, frames, upmixing_);
+    frames = fetchFrames(buffer, frames);
     if (frames < 1) {
-        stop(Fade::None, 0);
+        finish();
         return frames;
     }
 
+    if (silent_block_) {
+        return skipSilentFrames(frames);
+    }
+
     for (size_t frame_index = 0; frame_index < frames; frame_index++) {
         if (level_ != UNIT_LEVEL) {
             for (unsigned int channel = 0; channel < channels_; channel++) {
@@ -203,54 +360,507 @@ size_t AudioTrack::play(int16_t *buffer, size_t frames)
         }
 
         if (fade_mode_ != Fade::None) {
-            if (fade_progress_ == fade_length_) {
-                if (stopping_) {
-                    stop(Fade::None, 0);
-                    return frame_index;
-                } else {
-                    fade(final_level_, Fade::None, 0);
-                }
+            if (!advanceFade()) {
+                return frame_index;
             }
+        }
+    }
 
-            fade_progress_++;
+    return frames;
+}
 
-            int32_t level_offset = static_cast<int32_t>(final_level_) - static_cast<int32_t>(initial_level_);
-            uint16_t fade_progress_ms;
+size_t AudioTrack::play(int16_t *const *buffers, size_t frames)
+{
+    if (!reader_) {
+        return 0;
+    }
 
-            switch (fade_mode_) {
-            case Fade::LinearIn:
-            case Fade::LinearOut:
-                fade_progress_ms = static_cast<uint16_t>(fade_progress_ / frames_per_ms_);
-                level_offset *= fade_progress_ms;
-                level_offset /= fade_length_ms_;
-                level_ = initial_level_ + static_cast<uint16_t>(level_offset);
-                break;
-#ifdef HAS_COSINE_TABLE
-            case Fade::CosineIn:
-                fade_progress_ms = static_cast<uint16_t>(fade_progress_ / frames_per_ms_);
-                level_offset *= cosineFromZeroToHalfPi(fade_length_ms_ - fade_progress_ms, fade_length_ms_);
-                level_offset /= 32768;
-                level_ = initial_level_ + static_cast<uint16_t>(level_offset);
-                break;
-            case Fade::CosineOut:
-                fade_progress_ms = static_cast<uint16_t>(fade_progress_ / frames_per_ms_);
-                level_offset *= 32768 - cosineFromZeroToHalfPi(fade_progress_ms, fade_length_ms_);
-                level_offset /= 32768;
-                level_ = initial_level_ + static_cast<uint16_t>(level_offset);
-                break;
-            case Fade::SCurveIn:
-            case Fade::SCurveOut:
-                fade_progress_ms = static_cast<uint16_t>(fade_progress_ / frames_per_ms_);
-                level_offset *= 32768 - cosineFromZeroToHalfPi(fade_progress_ms * 2, fade_length_ms_);
-                level_offset /= 65536;
-                level_ = initial_level_ + static_cast<uint16_t>(level_offset);
-                break;
+    if (!running_) {
+        return 0;
+    }
+
+    frames = fetchFrames(buffers, frames);
+    if (frames < 1) {
+        finish();
+        return frames;
+    }
+
+    if (silent_block_) {
+        return skipSilentFrames(frames);
+    }
+
+    size_t frame_index = 0;
+
+    while ((fade_mode_ != Fade::None) && (frame_index < frames)) {
+        if (level_ != UNIT_LEVEL) {
+            for (unsigned int channel = 0; channel < channels_; channel++) {
+                int32_t sample = (buffers[channel][frame_index] * level_) / UNIT_LEVEL;
+                buffers[channel][frame_index] = saturate(sample);
+            }
+        }
+
+        if (!advanceFade()) {
+            return frame_index;
+        }
+
+        frame_index++;
+    }
+
+    if (level_ != UNIT_LEVEL) {
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            int16_t *plane = buffers[channel];
+
+            for (size_t index = frame_index; index < frames; index++) {
+                int32_t sample = (plane[index] * level_) / UNIT_LEVEL;
+                plane[index] = saturate(sample);
+            }
+        }
+    }
+
+    return frames;
+}
+
+size_t AudioTrack::fetchFrames(int16_t *buffer, size_t frames)
+{
+#ifdef HAS_DECODE_AHEAD
+    RingState state = switchRing();
+
+    // The ring does not keep the silence hints of the reader
+    silent_block_ = false;
+
+    if (state == RingState::Ring) {
+        return readRing(buffer, frames, false);
+    }
+
+    size_t ring_frames = 0;
+
+    if (state == RingState::Draining) {
+        ring_frames = readRing(buffer, frames, true);
+        if (ring_frames == frames) {
+            return frames;
+        }
+
+        // The worker stopped before decodeAhead() withdrew it, so the reader
+        // continues right where the ring ends
+        ring_state_.store(RingState::Direct, std::memory_order_release);
+    }
+
+    size_t direct_frames = reader_->decodeToI16(buffer + ring_frames * channels_, frames - ring_frames, upmixing_);
+
+    silent_block_ = (ring_frames == 0) && reader_->silentBlock();
+
+    if (direct_frames > 0) {
+        openRequestedRing();
+    }
+
+    return ring_frames + direct_frames;
+#else
+    frames = reader_->decodeToI16(buffer, frames, upmixing_);
+
+    silent_block_ = reader_->silentBlock();
+
+    return frames;
+#endif
+}
+
+size_t AudioTrack::fetchFrames(int16_t *const *buffers, size_t frames)
+{
+#ifdef HAS_DECODE_AHEAD
+    RingState state = switchRing();
+
+    silent_block_ = false;
+
+    if (state == RingState::Ring) {
+        return readRing(buffers, frames, false);
+    }
+
+    size_t ring_frames = 0;
+    int16_t *planes[MAX_PLANES];
+
+    for (unsigned int channel = 0; channel < channels_; channel++) {
+        planes[channel] = buffers[channel];
+    }
+
+    if (state == RingState::Draining) {
+        ring_frames = readRing(buffers, frames, true);
+        if (ring_frames == frames) {
+            return frames;
+        }
+
+        ring_state_.store(RingState::Direct, std::memory_order_release);
+
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            planes[channel] += ring_frames;
+        }
+    }
+
+    size_t direct_frames = reader_->decodeToI16(planes, frames - ring_frames, upmixing_);
+
+    silent_block_ = (ring_frames == 0) && reader_->silentBlock();
+
+    if (direct_frames > 0) {
+        openRequestedRing();
+    }
+
+    return ring_frames + direct_frames;
+#else
+    frames = reader_->decodeToI16(buffers, frames, upmixing_);
+
+    silent_block_ = reader_->silentBlock();
+
+    return frames;
 #endif
-            case Fade::None:
-                break;
+}
+
+// End of the stream or of a fade out, on the render thread
+void AudioTrack::finish()
+{
+#ifdef HAS_DECODE_AHEAD
+    // The worker may be decoding under the reader lock, it closes the reader
+    // once it sees the track stopped
+    if (ring_state_.load(std::memory_order_relaxed) == RingState::Ring) {
+        fade(0, Fade::None, 0);
+
+        stopping_ = false;
+        running_ = false;
+
+        ring_worker_->wake();
+        return;
+    }
+#endif
+
+    stop(Fade::None, 0);
+}
+
+size_t AudioTrack::skipSilentFrames(size_t frames)
+{
+    for (size_t frame_index = 0; frame_index < frames; frame_index++) {
+        if (fade_mode_ == Fade::None) {
+            break;
+        }
+
+        if (!advanceFade()) {
+            return frame_index;
+        }
+    }
+
+    return frames;
+}
+
+#ifdef HAS_DECODE_AHEAD
+// Applies decodeAhead() at a block boundary. decodeAhead() removes the track
+// from its worker before withdrawing it, so a null request also means the
+// write count is final and the ring can be played out. A draining ring is
+// played out even if a worker is requested again, nothing refills it in time
+AudioTrack::RingState AudioTrack::switchRing()
+{
+    RingState state = ring_state_.load(std::memory_order_relaxed);
+
+    if (state == RingState::Ring) {
+        DecodeWorker *worker = requested_worker_.load(std::memory_order_acquire);
+
+        if (!worker) {
+            state = RingState::Draining;
+            ring_state_.store(state, std::memory_order_release);
+        } else {
+            ring_worker_ = worker;
+        }
+    }
+
+    return state;
+}
+
+// The worker only fills the ring in RingState::Ring, so resetting the write
+// count before entering it does not race with the worker
+void AudioTrack::openRing(DecodeWorker *worker)
+{
+    unsigned int generation = ring_generation_.load(std::memory_order_acquire);
+
+    ring_channels_ = reader_->channels();
+    ring_frames_ = RING_LENGTH / ring_channels_;
+
+    size_t depth_frames = ring_depth_.load(std::memory_order_relaxed);
+    if ((depth_frames > 0) && (depth_frames < ring_frames_)) {
+        ring_frames_ = depth_frames;
+    }
+
+    ring_write_count_.store(0, std::memory_order_relaxed);
+    ring_read_count_.store(0, std::memory_order_relaxed);
+
+    ring_read_generation_.store(generation, std::memory_order_relaxed);
+    ring_end_generation_.store(generation - 1, std::memory_order_relaxed);
+
+    ring_worker_ = worker;
+
+    ring_state_.store(RingState::Ring, std::memory_order_release);
+}
+
+// Called after a block decoded in play(), which gives the worker a whole
+// block to get ahead of the next one
+void AudioTrack::openRequestedRing()
+{
+    DecodeWorker *worker = requested_worker_.load(std::memory_order_acquire);
+
+    if (worker && (ring_state_.load(std::memory_order_relaxed) == RingState::Direct)) {
+        openRing(worker);
+        worker->wake();
+    }
+}
+
+bool AudioTrack::decodeIntoRing()
+{
+    if (ring_state_.load(std::memory_order_acquire) != RingState::Ring) {
+        return false;
+    }
+
+    if (!reader_) {
+        return false;
+    }
+
+    // Ended by play(), which does not take the reader lock
+    if (!running_) {
+        if (reader_->opened()) {
+            reader_->close();
+        }
+
+        return false;
+    }
+
+    // Only changes under the reader lock
+    unsigned int generation = ring_generation_.load(std::memory_order_relaxed);
+
+    // Frames from before a seek or rewind have to be dropped by play() first
+    if (ring_read_generation_.load(std::memory_order_acquire) != generation) {
+        return false;
+    }
+
+    if (ring_end_generation_.load(std::memory_order_relaxed) == generation) {
+        return false;
+    }
+
+    size_t write_count = ring_write_count_.load(std::memory_order_relaxed);
+    size_t free_frames = ring_frames_ - (write_count - ring_read_count_.load(std::memory_order_acquire));
+
+    size_t ring_offset = write_count % ring_frames_;
+    if (free_frames > ring_frames_ - ring_offset) {
+        free_frames = ring_frames_ - ring_offset;
+    }
+
+    if (free_frames > RING_FILL_FRAMES) {
+        free_frames = RING_FILL_FRAMES;
+    }
+
+    if (free_frames == 0) {
+        return false;
+    }
+
+    size_t frames = reader_->decodeToI16(ring_ + ring_offset * ring_channels_, free_frames, 1);
+    if (frames < 1) {
+        ring_end_generation_.store(generation, std::memory_order_release);
+        return false;
+    }
+
+    ring_write_count_.store(write_count + frames, std::memory_order_release);
+
+    return true;
+}
+
+// Drops the ring after a seek or rewind and plays the block straight from the
+// reader, which the worker leaves alone until the new generation is
+// acknowledged. The worker continues from where the block ends. If the lock
+// is taken after all, syncRing() drops the ring and the block underruns
+template <typename Output>
+bool AudioTrack::restartRing(Output output, size_t *frames, bool draining)
+{
+    if (ring_generation_.load(std::memory_order_acquire) == ring_read_generation_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> reader_lock(reader_mutex_, std::try_to_lock);
+    if (!reader_lock.owns_lock()) {
+        return false;
+    }
+
+    // Stable under the reader lock, as is the write count
+    unsigned int generation = ring_generation_.load(std::memory_order_relaxed);
+    size_t write_count = ring_write_count_.load(std::memory_order_relaxed);
+
+    size_t requested_frames = *frames;
+
+    *frames = reader_->decodeToI16(output, requested_frames, upmixing_);
+    if (*frames < requested_frames) {
+        ring_end_generation_.store(generation, std::memory_order_release);
+    }
+
+    ring_read_count_.store(write_count, std::memory_order_release);
+    ring_read_generation_.store(generation, std::memory_order_release);
+
+    if (!draining) {
+        ring_worker_->wake();
+    }
+
+    return true;
+}
+
+// Drops the ring after a seek or rewind. The worker stops writing once the
+// generation changes, so the write count is final for the old position
+size_t AudioTrack::syncRing()
+{
+    size_t read_count = ring_read_count_.load(std::memory_order_relaxed);
+    unsigned int generation = ring_generation_.load(std::memory_order_acquire);
+
+    if (generation != ring_read_generation_.load(std::memory_order_relaxed)) {
+        read_count = ring_write_count_.load(std::memory_order_acquire);
+
+        ring_read_count_.store(read_count, std::memory_order_release);
+        ring_read_generation_.store(generation, std::memory_order_release);
+    }
+
+    return read_count;
+}
+
+size_t AudioTrack::readRing(int16_t *buffer, size_t frames, bool draining)
+{
+    if (restartRing(buffer, &frames, draining)) {
+        return frames;
+    }
+
+    size_t read_count = syncRing();
+
+    // Loading the end first makes the write count final once it is set
+    bool ended = ring_end_generation_.load(std::memory_order_acquire) == ring_read_generation_.load(std::memory_order_relaxed);
+    size_t available_frames = ring_write_count_.load(std::memory_order_acquire) - read_count;
+
+    if ((ended || draining) && (available_frames < frames)) {
+        frames = available_frames;
+    }
+
+    size_t copied_frames = (available_frames < frames) ? available_frames : frames;
+    int16_t *output = buffer;
+
+    for (size_t frame_index = 0; frame_index < copied_frames; frame_index++) {
+        const int16_t *input = ring_ + ((read_count + frame_index) % ring_frames_) * ring_channels_;
+
+        for (unsigned int channel = 0; channel < ring_channels_; channel++) {
+            for (unsigned int copy = 0; copy < upmixing_; copy++) {
+                *output++ = input[channel];
             }
         }
     }
 
+    // An underrun plays silence rather than ending the track
+    memset(output, 0, (frames - copied_frames) * channels_ * 2);
+
+    consumeRing(read_count, copied_frames, draining);
+
+    return frames;
+}
+
+size_t AudioTrack::readRing(int16_t *const *buffers, size_t frames, bool draining)
+{
+    if (restartRing(buffers, &frames, draining)) {
+        return frames;
+    }
+
+    size_t read_count = syncRing();
+
+    bool ended = ring_end_generation_.load(std::memory_order_acquire) == ring_read_generation_.load(std::memory_order_relaxed);
+    size_t available_frames = ring_write_count_.load(std::memory_order_acquire) - read_count;
+
+    if ((ended || draining) && (available_frames < frames)) {
+        frames = available_frames;
+    }
+
+    size_t copied_frames = (available_frames < frames) ? available_frames : frames;
+
+    for (unsigned int channel = 0; channel < ring_channels_; channel++) {
+        int16_t *plane = buffers[channel * upmixing_];
+
+        for (size_t frame_index = 0; frame_index < copied_frames; frame_index++) {
+            size_t ring_index = (read_count + frame_index) % ring_frames_;
+            plane[frame_index] = ring_[ring_index * ring_channels_ + channel];
+        }
+
+        memset(plane + copied_frames, 0, (frames - copied_frames) * 2);
+
+        for (unsigned int copy = 1; copy < upmixing_; copy++) {
+            memcpy(buffers[channel * upmixing_ + copy], plane, frames * 2);
+        }
+    }
+
+    consumeRing(read_count, copied_frames, draining);
+
     return frames;
 }
+
+void AudioTrack::consumeRing(size_t read_count, size_t frames, bool draining)
+{
+    if (frames > 0) {
+        read_count += frames;
+        ring_read_count_.store(read_count, std::memory_order_release);
+    }
+
+    // No worker fills a draining ring
+    if (draining) {
+        return;
+    }
+
+    // Waking on every call would cost a syscall per render block
+    size_t buffered_frames = ring_write_count_.load(std::memory_order_relaxed) - read_count;
+    if (buffered_frames < ring_frames_ / 2) {
+        ring_worker_->wake();
+    }
+}
+#endif
+
+bool AudioTrack::advanceFade()
+{
+    if (fade_progress_ == fade_length_) {
+        if (stopping_) {
+            finish();
+            return false;
+        } else {
+            fade(final_level_, Fade::None, 0);
+        }
+    }
+
+    fade_progress_++;
+
+    int32_t level_offset = static_cast<int32_t>(final_level_) - static_cast<int32_t>(initial_level_);
+    uint16_t fade_progress_ms;
+
+    switch (fade_mode_) {
+    case Fade::LinearIn:
+    case Fade::LinearOut:
+        fade_progress_ms = static_cast<uint16_t>(fade_progress_ / frames_per_ms_);
+        level_offset *= fade_progress_ms;
+        level_offset /= fade_length_ms_;
+        level_ = initial_level_ + static_cast<uint16_t>(level_offset);
+        break;
+#ifdef HAS_COSINE_TABLE
+    case Fade::CosineIn:
+        fade_progress_ms = static_cast<uint16_t>(fade_progress_ / frames_per_ms_);
+        level_offset *= cosineFromZeroToHalfPi(fade_length_ms_ - fade_progress_ms, fade_length_ms_);
+        level_offset /= 32768;
+        level_ = initial_level_ + static_cast<uint16_t>(level_offset);
+        break;
+    case Fade::CosineOut:
+        fade_progress_ms = static_cast<uint16_t>(fade_progress_ / frames_per_ms_);
+        level_offset *= 32768 - cosineFromZeroToHalfPi(fade_progress_ms, fade_length_ms_);
+        level_offset /= 32768;
+        level_ = initial_level_ + static_cast<uint16_t>(level_offset);
+        break;
+    case Fade::SCurveIn:
+    case Fade::SCurveOut:
+        fade_progress_ms = static_cast<uint16_t>(fade_progress_ / frames_per_ms_);
+        level_offset *= 32768 - cosineFromZeroToHalfPi(fade_progress_ms * 2, fade_length_ms_);
+        level_offset /= 65536;
+        level_ = initial_level_ + static_cast<uint16_t>(level_offset);
+        break;
+#endif
+    case Fade::None:
+        break;
+    }
+
+    return true;
+}
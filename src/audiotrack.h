@@ -3,8 +3,20 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <atomic>
+
 #include "audioreader.h"
 
+#ifdef HAS_DECODE_AHEAD
+#include <mutex>
+
+#ifndef AUDIOTRACK_RING_SIZE
+#define AUDIOTRACK_RING_SIZE 32768
+#endif
+
+class DecodeWorker;
+#endif
+
 class AudioTrack
 {
 public:
@@ -33,9 +45,20 @@ public:
 
     static const unsigned int MAX_TRACK_CHANNELS = 2;
 
+#ifdef HAS_DECODE_AHEAD
+    static const size_t RING_LENGTH = AUDIOTRACK_RING_SIZE / 2;
+
+    static const unsigned int MAX_PLANES = 8;
+#endif
+
 public:
     AudioTrack(unsigned int channels);
 
+#ifdef HAS_DECODE_AHEAD
+    // Leaves the decode worker, which may not hold the reader at that moment
+    ~AudioTrack();
+#endif
+
     bool addReader(AudioReader *reader);
 
     bool start(void *file,
@@ -54,8 +77,28 @@ public:
 
     void rewind(bool preload = true);
 
+    bool seek(size_t frame);
+
     size_t play(int16_t *buffer, size_t frames);
 
+    size_t play(int16_t *const *buffers, size_t frames);
+
+#ifdef HAS_DECODE_AHEAD
+    // Moves decoding to the worker, which keeps up to depth_frames (0 for
+    // the whole ring) decoded ahead, a null worker decodes in play() again.
+    // Safe while play() runs: play() switches at its next block, and plays
+    // out the ring before decoding itself again. The depth applies from the
+    // next switch or start(). Seeks and rewinds drop the ring, and play()
+    // decodes the next block itself before the worker takes over again,
+    // or plays it silent if the worker holds the reader at that moment. A
+    // replaced worker may still be woken by that block, so workers have to
+    // outlive the tracks they served
+    bool decodeAhead(DecodeWorker *worker, size_t depth_frames = 0);
+
+    // Called by the worker, true if the ring got new frames
+    bool fillRing();
+#endif
+
     bool running()
     {
         return running_;
@@ -81,6 +124,42 @@ public:
         return channels_;
     }
 
+    bool silentBlock()
+    {
+        return silent_block_;
+    }
+
+private:
+#ifdef HAS_DECODE_AHEAD
+    enum class RingState
+    {
+        Direct,
+        Ring,
+        Draining,
+    };
+#endif
+
+    size_t fetchFrames(int16_t *buffer, size_t frames);
+    size_t fetchFrames(int16_t *const *buffers, size_t frames);
+
+    void finish();
+
+    bool advanceFade();
+    size_t skipSilentFrames(size_t frames);
+
+#ifdef HAS_DECODE_AHEAD
+    RingState switchRing();
+    void openRing(DecodeWorker *worker);
+    void openRequestedRing();
+    bool decodeIntoRing();
+    template <typename Output>
+    bool restartRing(Output output, size_t *frames, bool draining);
+    size_t syncRing();
+    size_t readRing(int16_t *buffer, size_t frames, bool draining);
+    size_t readRing(int16_t *const *buffers, size_t frames, bool draining);
+    void consumeRing(size_t read_count, size_t frames, bool draining);
+#endif
+
 private:
     AudioReader *readers_[READER_SLOTS];
     AudioReader *reader_;
@@ -102,6 +181,40 @@ private:
     uint16_t initial_level_;
     uint16_t final_level_;
 
-    bool running_;
+#ifdef HAS_DECODE_AHEAD
+    // Set by decodeAhead(), play() follows it at block boundaries
+    std::atomic<DecodeWorker *> requested_worker_;
+    std::atomic<size_t> ring_depth_;
+
+    // Only play() and start() change the state, the worker fills the ring
+    // in RingState::Ring only
+    std::atomic<RingState> ring_state_;
+    DecodeWorker *ring_worker_;
+
+    // Serialises the reader between the worker and the control calls
+    std::mutex reader_mutex_;
+
+    alignas(16) int16_t ring_[RING_LENGTH];
+
+    size_t ring_frames_;
+    unsigned int ring_channels_;
+
+    // Free-running frame counters. The worker writes the first, play() the
+    // second, both are reset only while the worker cannot fill the ring
+    std::atomic<size_t> ring_write_count_;
+    std::atomic<size_t> ring_read_count_;
+
+    // seek() and rewind() move to a new generation, play() drops the ring,
+    // decodes a block and acknowledges it, and only then the worker fills
+    // it again
+    std::atomic<unsigned int> ring_generation_;
+    std::atomic<unsigned int> ring_read_generation_;
+    std::atomic<unsigned int> ring_end_generation_;
+#endif
+
+    std::atomic<bool> running_;
     bool stopping_;
+
+    bool silent_block_;
+
 };
@@ -0,0 +1,119 @@
+#include "decodeworker.h"
+
+// Only built for decodeAhead(), which needs HAS_DECODE_AHEAD
+#ifdef HAS_DECODE_AHEAD
+
+#include <chrono>
+
+#include "audiotrack.h"
+
+DecodeWorker::DecodeWorker()
+    : tracks_(),
+      stopping_(false),
+      woken_(false)
+{
+}
+
+DecodeWorker::~DecodeWorker()
+{
+    stop();
+}
+
+bool DecodeWorker::start()
+{
+    if (thread_.joinable()) {
+        return false;
+    }
+
+    stopping_ = false;
+
+    thread_ = std::thread(&DecodeWorker::run, this);
+
+    return true;
+}
+
+void DecodeWorker::stop()
+{
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    condition_.notify_one();
+    thread_.join();
+}
+
+bool DecodeWorker::addTrack(AudioTrack *track)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (int slot = 0; slot < TRACK_SLOTS; slot++) {
+        if (tracks_[slot] == track) {
+            return true;
+        }
+    }
+
+    for (int slot = 0; slot < TRACK_SLOTS; slot++) {
+        if (!tracks_[slot]) {
+            tracks_[slot] = track;
+            wake();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DecodeWorker::removeTrack(AudioTrack *track)
+{
+    // The worker holds the lock for a whole pass over the tracks
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (int slot = 0; slot < TRACK_SLOTS; slot++) {
+        if (tracks_[slot] == track) {
+            tracks_[slot] = nullptr;
+        }
+    }
+}
+
+void DecodeWorker::wake()
+{
+    // Skipping the lock may lose a wakeup, the wait timeout bounds the delay
+    if (!woken_.exchange(true, std::memory_order_acq_rel)) {
+        condition_.notify_one();
+    }
+}
+
+void DecodeWorker::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stopping_) {
+        bool filled = false;
+
+        for (int slot = 0; slot < TRACK_SLOTS; slot++) {
+            if (tracks_[slot] && tracks_[slot]->fillRing()) {
+                filled = true;
+            }
+        }
+
+        if (filled) {
+            // Lets track changes in between passes
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+            continue;
+        }
+
+        condition_.wait_for(lock,
+                            std::chrono::milliseconds(DECODEWORKER_WAKE_INTERVAL_MS),
+                            [this] { return stopping_ || woken_.load(std::memory_order_acquire); });
+
+        woken_.store(false, std::memory_order_release);
+    }
+}
+#endif
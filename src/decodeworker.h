@@ -0,0 +1,57 @@
+#pragma once
+
+#ifdef HAS_DECODE_AHEAD
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifndef DECODEWORKER_WAKE_INTERVAL_MS
+#define DECODEWORKER_WAKE_INTERVAL_MS 10
+#endif
+
+class AudioTrack;
+
+// Keeps the rings of its tracks filled from a single background thread
+class DecodeWorker
+{
+public:
+    static const int TRACK_SLOTS = 8;
+
+public:
+    DecodeWorker();
+
+    ~DecodeWorker();
+
+    bool start();
+
+    void stop();
+
+    bool addTrack(AudioTrack *track);
+
+    // Returns once the worker no longer touches the track
+    void removeTrack(AudioTrack *track);
+
+    // Never blocks, safe to call from the render thread
+    void wake();
+
+    bool running()
+    {
+        return thread_.joinable();
+    }
+
+private:
+    void run();
+
+private:
+    AudioTrack *tracks_[TRACK_SLOTS];
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::thread thread_;
+
+    bool stopping_;
+
+    std::atomic<bool> woken_;
+};
+#endif
@@ -0,0 +1,150 @@
+#include "mp3bulkdecoder.h"
+
+#include <thread>
+
+Mp3BulkDecoder::Mp3BulkDecoder()
+    : segments_(),
+      readers_(0),
+      opened_(false),
+      total_frames_(0),
+      sampling_rate_(0),
+      channels_(0)
+{
+}
+
+bool Mp3BulkDecoder::addReader(Mp3Reader *reader, void *file)
+{
+    if (readers_ == MAX_SEGMENTS) {
+        return false;
+    }
+
+    segments_[readers_].reader = reader;
+    segments_[readers_].file = file;
+    readers_++;
+
+    return true;
+}
+
+bool Mp3BulkDecoder::open()
+{
+    opened_ = false;
+
+    if (readers_ == 0) {
+        return false;
+    }
+
+    for (unsigned int index = 0; index < readers_; index++) {
+        Mp3Reader *reader = segments_[index].reader;
+
+        if (!reader->open(segments_[index].file, Mp3Reader::Mode::Single, false)) {
+            return false;
+        }
+
+        if (index == 0) {
+            sampling_rate_ = reader->samplingRate();
+            channels_ = reader->channels();
+        } else if ((reader->samplingRate() != sampling_rate_) || (reader->channels() != channels_)) {
+            return false;
+        }
+    }
+
+    // Without a length the stream cannot be split and decodes serially
+    total_frames_ = segments_[0].reader->scanFrames();
+
+    opened_ = true;
+
+    return true;
+}
+
+void Mp3BulkDecoder::close()
+{
+    for (unsigned int index = 0; index < readers_; index++) {
+        segments_[index].reader->close();
+    }
+
+    opened_ = false;
+}
+
+size_t Mp3BulkDecoder::decodeToI16(int16_t *buffer, size_t frames, unsigned int segments)
+{
+    if (!opened_) {
+        return 0;
+    }
+
+    if ((total_frames_ > 0) && (frames > total_frames_)) {
+        frames = total_frames_;
+    }
+
+    if (segments > readers_) {
+        segments = readers_;
+    }
+
+    if ((total_frames_ == 0) || (segments == 0)) {
+        segments = 1;
+    }
+
+    if (segments > frames / MIN_SEGMENT_FRAMES) {
+        segments = static_cast<unsigned int>(frames / MIN_SEGMENT_FRAMES);
+
+        if (segments == 0) {
+            segments = 1;
+        }
+    }
+
+    for (unsigned int index = 0; index < segments; index++) {
+        Segment &segment = segments_[index];
+
+        segment.first_frame = frames * index / segments;
+        segment.frames = frames * (index + 1) / segments - segment.first_frame;
+        segment.buffer = buffer + segment.first_frame * channels_;
+        segment.decoded_frames = 0;
+    }
+
+    std::thread threads[MAX_SEGMENTS];
+
+    for (unsigned int index = 1; index < segments; index++) {
+        threads[index] = std::thread(&Mp3BulkDecoder::decodeSegment, &segments_[index], channels_);
+    }
+
+    decodeSegment(&segments_[0], channels_);
+
+    for (unsigned int index = 1; index < segments; index++) {
+        threads[index].join();
+    }
+
+    // Anything after a short segment would leave a gap in the output
+    size_t decoded_frames = 0;
+
+    for (unsigned int index = 0; index < segments; index++) {
+        decoded_frames += segments_[index].decoded_frames;
+
+        if (segments_[index].decoded_frames < segments_[index].frames) {
+            break;
+        }
+    }
+
+    return decoded_frames;
+}
+
+void Mp3BulkDecoder::decodeSegment(Segment *segment, unsigned int channels)
+{
+    Mp3Reader *reader = segment->reader;
+
+    // The seek preroll primes the bit reservoir, overlap and polyphase
+    // state from the frames before the segment and drops their output
+    if (segment->first_frame == 0) {
+        reader->rewind(false);
+    } else if (!reader->seek(segment->first_frame)) {
+        return;
+    }
+
+    while (segment->decoded_frames < segment->frames) {
+        size_t frames = reader->decodeToI16(segment->buffer + segment->decoded_frames * channels,
+                                            segment->frames - segment->decoded_frames);
+        if (frames == 0) {
+            break;
+        }
+
+        segment->decoded_frames += frames;
+    }
+}
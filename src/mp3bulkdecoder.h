@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mp3reader.h"
+
+#ifndef MP3BULKDECODER_SEGMENTS
+#define MP3BULKDECODER_SEGMENTS 16
+#endif
+
+// Decodes a whole MP3 stream in segments on parallel threads, for cache
+// warming and transcoding. The stitched output matches a serial decode
+class Mp3BulkDecoder
+{
+public:
+    static const unsigned int MAX_SEGMENTS = MP3BULKDECODER_SEGMENTS;
+
+    // Shorter segments would spend most of their time in the seek preroll
+    static const size_t MIN_SEGMENT_FRAMES = 65536;
+
+public:
+    Mp3BulkDecoder();
+
+    // Every segment needs its own reader and its own handle to the same file
+    bool addReader(Mp3Reader *reader, void *file);
+
+    bool open();
+
+    void close();
+
+    // Decodes interleaved frames from the start of the stream on up to
+    // segments threads, the calling thread included
+    size_t decodeToI16(int16_t *buffer, size_t frames, unsigned int segments = MAX_SEGMENTS);
+
+    // Exact for streams with a Xing frame, counted from the frame headers otherwise
+    size_t totalFrames()
+    {
+        return total_frames_;
+    }
+
+    unsigned long samplingRate()
+    {
+        return sampling_rate_;
+    }
+
+    unsigned int channels()
+    {
+        return channels_;
+    }
+
+private:
+    struct Segment
+    {
+        Mp3Reader *reader;
+        void *file;
+
+        int16_t *buffer;
+        size_t first_frame;
+        size_t frames;
+
+        size_t decoded_frames;
+    };
+
+    static void decodeSegment(Segment *segment, unsigned int channels);
+
+private:
+    Segment segments_[MAX_SEGMENTS];
+    unsigned int readers_;
+
+    bool opened_;
+
+    size_t total_frames_;
+
+    unsigned long sampling_rate_;
+    unsigned int channels_;
+};
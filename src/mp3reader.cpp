@@ -13,6 +13,61 @@ enum class Id3Flags : uint8_t
 static const size_t ID3_HEADER_SIZE = 10;
 static const size_t ID3_FOOTER_SIZE = 10;
 
+static const size_t FRAME_HEADER_SIZE = 4;
+static const size_t MAX_MAIN_DATA_BEGIN = 511;
+
+// Header, CRC and MPEG-1 stereo side information
+static const size_t MAX_SIDE_DATA_SIZE = FRAME_HEADER_SIZE + 2 + 32;
+
+// Samples between the encoder input and the decoder output, as LAME counts them
+static const size_t DECODER_DELAY = 529;
+
+static const size_t XING_FRAMES_FLAG = 0x01;
+static const size_t XING_BYTES_FLAG = 0x02;
+static const size_t XING_TOC_FLAG = 0x04;
+static const size_t XING_QUALITY_FLAG = 0x08;
+static const size_t XING_TOC_SIZE = 100;
+
+static const size_t LAME_TAG_SIZE = 24;
+static const size_t LAME_DELAY_OFFSET = 21;
+
+// Header, CRC, side information and a Xing tag with every field, then a LAME tag
+static const size_t XING_FRAME_SIZE = MAX_SIDE_DATA_SIZE + 8 + 4 + 4 + XING_TOC_SIZE + 4 + LAME_TAG_SIZE;
+
+// Frames that have to follow a sync word before open() trusts it
+static const unsigned int CONFIRMED_FRAMES = 2;
+
+// Same match as MP3FindSyncWord, memchr() skips the non-0xff bytes with vector loads
+static inline int findSyncWord(const uint8_t *buffer, size_t length)
+{
+    const uint8_t *position = buffer;
+    const uint8_t *end = buffer + length;
+
+    while (end - position >= 2) {
+        const uint8_t *candidate = static_cast<const uint8_t *>(memchr(position, SYNCWORDH, end - position - 1));
+        if (candidate == nullptr) {
+            break;
+        }
+
+        if ((candidate[1] & SYNCWORDL) == SYNCWORDL) {
+            return static_cast<int>(candidate - buffer);
+        }
+
+        position = candidate + 1;
+    }
+
+    return -1;
+}
+
+// Every field is rewritten by MP3Decode before it is read, so the readers
+// decoding on one thread take turns with a single copy
+static Helix::MP3DecScratch &decoderScratch()
+{
+    alignas(64) static thread_local Helix::MP3DecScratch scratch;
+
+    return scratch;
+}
+
 Mp3Reader::Mp3Reader(TellCallback tell_callback,
                      SeekCallback seek_callback,
                      ReadCallback read_callback)
@@ -20,13 +75,10 @@ Mp3Reader::Mp3Reader(TellCallback tell_callback,
                   seek_callback,
                   read_callback),
       frame_header_(),
-      side_info_(),
+      mp3_dec_info_(),
       scale_factor_info_(),
-      huffman_info_(),
-      dequant_info_(),
       imdct_info_(),
       subband_info_(),
-      mp3_dec_info_(),
       initial_data_offset_(0),
       chunk_data_offset_(0),
       next_data_offset_(0),
@@ -34,9 +86,21 @@ Mp3Reader::Mp3Reader(TellCallback tell_callback,
       prefetched_bytes_(0),
       current_chunk_(nullptr),
       frame_buffer_(),
+      planar_frames_(false),
+      direct_frames_(false),
       decoded_frames_(0),
-      current_frame_(nullptr),
-      next_frame_(nullptr)
+      current_frame_(0),
+      next_frame_(0),
+      mp3_frame_samples_(0),
+      mp3_frame_number_(0),
+      skip_frames_(0),
+      leading_frames_(0),
+      frame_position_(0),
+      seek_index_(),
+      seek_index_entries_(0),
+      seek_index_stride_(1),
+      indexed_mp3_frames_(0),
+      indexed_end_offset_(0)
 {
 }
 
@@ -50,27 +114,12 @@ bool Mp3Reader::open(void *file,
 
     mode_ = mode;
 
-    memset(&frame_header_, 0, sizeof(frame_header_));
-    memset(&side_info_, 0, sizeof(side_info_));
-    memset(&scale_factor_info_, 0, sizeof(scale_factor_info_));
-    memset(&huffman_info_, 0, sizeof(huffman_info_));
-    memset(&dequant_info_, 0, sizeof(dequant_info_));
-    memset(&imdct_info_, 0, sizeof(imdct_info_));
-    memset(&subband_info_, 0, sizeof(subband_info_));
-    memset(&mp3_dec_info_, 0, sizeof(mp3_dec_info_));
-
-    mp3_dec_info_.FrameHeaderPS = &frame_header_;
-    mp3_dec_info_.SideInfoPS = &side_info_;
-    mp3_dec_info_.ScaleFactorInfoPS = &scale_factor_info_;
-    mp3_dec_info_.HuffmanInfoPS = &huffman_info_;
-    mp3_dec_info_.DequantInfoPS = &dequant_info_;
-    mp3_dec_info_.IMDCTInfoPS = &imdct_info_;
-    mp3_dec_info_.SubbandInfoPS = &subband_info_;
+    resetDecoder();
 
     initial_data_offset_ = 0;
     next_data_offset_ = 0;
 
-    if (!seek(next_data_offset_)) {
+    if (!seekFile(next_data_offset_)) {
         return false;
     }
 
@@ -134,7 +183,13 @@ bool Mp3Reader::open(void *file,
 
         int result = Helix::MP3GetNextFrameInfo(&mp3_dec_info_, &frame_info, current_chunk_);
         if (result == Helix::ERR_MP3_NONE) {
-            break;
+            channels_ = frame_info.nChans;
+            sampling_rate_ = frame_info.samprate;
+
+            // Free format frames have no length to check the next header with
+            if ((frame_info.bitrate == 0) || confirmFrames(chunk_data_offset_)) {
+                break;
+            }
         }
 
         current_chunk_ += 1;
@@ -144,8 +199,22 @@ bool Mp3Reader::open(void *file,
 
     initial_data_offset_ = chunk_data_offset_;
 
-    channels_ = frame_info.nChans;
-    sampling_rate_ = frame_info.samprate;
+    mp3_frame_samples_ = frame_info.outputSamps / frame_info.nChans;
+
+    leading_frames_ = 0;
+    total_frames_ = 0;
+
+    loop_start_ = 0;
+    loop_end_ = 0;
+
+    if (readXingFrame(frame_info)) {
+        loop_end_ = total_frames_;
+    }
+
+    seek_index_entries_ = 0;
+    seek_index_stride_ = 1;
+    indexed_mp3_frames_ = 0;
+    indexed_end_offset_ = initial_data_offset_;
 
     opened_ = true;
 
@@ -161,23 +230,141 @@ void Mp3Reader::close()
 
 void Mp3Reader::rewind(bool preload)
 {
+    // Overlap and reservoir left from the previous position would leak into the first frames
+    resetDecoder();
+
     next_data_offset_ = initial_data_offset_;
 
     current_chunk_ = chunk_buffer_;
     chunk_data_offset_ = 0;
     prefetched_bytes_ = 0;
 
-    current_frame_ = frame_buffer_;
-    next_frame_ = frame_buffer_;
+    current_frame_ = 0;
+    next_frame_ = 0;
     decoded_frames_ = 0;
 
+    mp3_frame_number_ = 0;
+    skip_frames_ = leading_frames_;
+    frame_position_ = 0;
+
     if (preload) {
-        if (findNextChunk()) {
+        if (findNextFrame()) {
             decodeNextFrames();
         }
     }
 }
 
+bool Mp3Reader::seek(size_t frame)
+{
+    if (!opened_) {
+        return false;
+    }
+
+    // Nothing changes before the rewind below, a seek that fails until then leaves the reader in place
+    if ((total_frames_ > 0) && (frame >= total_frames_)) {
+        return false;
+    }
+
+    size_t stream_frame = frame + leading_frames_;
+    size_t target_mp3_frame = stream_frame / mp3_frame_samples_;
+
+    size_t first_mp3_frame = 0;
+    if (target_mp3_frame > MP3READER_SEEK_PREROLL_FRAMES) {
+        first_mp3_frame = target_mp3_frame - MP3READER_SEEK_PREROLL_FRAMES;
+    }
+
+    size_t offsets[MP3READER_SEEK_PREROLL_FRAMES + 1];
+
+    if (!walkFrames(first_mp3_frame, target_mp3_frame, offsets)) {
+        return false;
+    }
+
+    // The three frames before the target are decoded in full, which takes
+    // the bit reservoir they refer to and primes the overlap buffers along
+    // with the block type the first of them leaves for the next overlap
+    size_t start_mp3_frame = 0;
+    if (target_mp3_frame > 3) {
+        start_mp3_frame = target_mp3_frame - 3;
+    }
+
+    size_t reservoir_bytes = 0;
+
+    while ((start_mp3_frame > first_mp3_frame) && (reservoir_bytes < MAX_MAIN_DATA_BEGIN)) {
+        start_mp3_frame--;
+
+        size_t frame_size = offsets[(start_mp3_frame + 1) % (MP3READER_SEEK_PREROLL_FRAMES + 1)] -
+                            offsets[start_mp3_frame % (MP3READER_SEEK_PREROLL_FRAMES + 1)];
+
+        if (frame_size > MAX_SIDE_DATA_SIZE) {
+            reservoir_bytes += frame_size - MAX_SIDE_DATA_SIZE;
+        }
+    }
+
+    rewind(false);
+
+    next_data_offset_ = offsets[start_mp3_frame % (MP3READER_SEEK_PREROLL_FRAMES + 1)];
+    mp3_frame_number_ = start_mp3_frame;
+
+    // The preroll output is dropped, but a preroll without any leaves the target unprimed
+    bool primed = start_mp3_frame == target_mp3_frame;
+    skip_frames_ = 0;
+
+    // The target frame is decoded here as well, the reader then starts from the frame buffer
+    while (mp3_frame_number_ <= target_mp3_frame) {
+        if (mp3_frame_number_ == target_mp3_frame) {
+            skip_frames_ = stream_frame - target_mp3_frame * mp3_frame_samples_;
+            frame_position_ = frame;
+        }
+
+        if (!findNextFrame()) {
+            rewind(false);
+            return false;
+        }
+
+        if (!decodeNextFrames()) {
+            if (!refillNextChunk()) {
+                rewind(false);
+                return false;
+            }
+
+            continue;
+        }
+
+        if ((mp3_frame_number_ <= target_mp3_frame) && (decoded_frames_ > 0)) {
+            primed = true;
+        }
+    }
+
+    if (!primed || (decoded_frames_ == 0)) {
+        rewind(false);
+        return false;
+    }
+
+    return true;
+}
+
+size_t Mp3Reader::scanFrames()
+{
+    if (!opened_) {
+        return 0;
+    }
+
+    if (total_frames_ > 0) {
+        return total_frames_;
+    }
+
+    // Runs until no frame follows, past junk the same way the decoder resyncs
+    walkFrames(SIZE_MAX, SIZE_MAX, nullptr);
+
+    rewind(false);
+
+    if (indexed_mp3_frames_ * mp3_frame_samples_ <= leading_frames_) {
+        return 0;
+    }
+
+    return indexed_mp3_frames_ * mp3_frame_samples_ - leading_frames_;
+}
+
 size_t Mp3Reader::decodeToI16(int16_t *buffer, size_t frames, unsigned int upmixing)
 {
     if (!opened_) {
@@ -188,17 +375,37 @@ size_t Mp3Reader::decodeToI16(int16_t *buffer, size_t frames, unsigned int upmix
     size_t processed_frames = 0;
 
     while (processed_frames < frames) {
-        size_t retrieved_frames = retrieveNextFrames(frames - processed_frames);
+        int16_t *const *outputs = nullptr;
+
+        // Whole MP3 frames go straight to the caller's buffer
+        if ((upmixing == 1) && (frames - processed_frames >= MP3READER_PLANE_LENGTH)) {
+            outputs = &frame_pointer;
+        }
+
+        size_t retrieved_frames = retrieveNextFrames(frames - processed_frames, false, outputs);
         if (retrieved_frames == 0) {
             break;
         }
 
-        if (upmixing == 1) {
+        if (direct_frames_) {
+            frame_pointer += retrieved_frames * channels_;
+        } else if (planar_frames_) {
+            for (size_t frame_index = 0; frame_index < retrieved_frames; frame_index++) {
+                for (unsigned int channel = 0; channel < channels_; channel++) {
+                    int16_t sample = frame_buffer_[MP3READER_PLANE_LENGTH * channel + current_frame_ + frame_index];
+
+                    for (unsigned int copy = 0; copy < upmixing; copy++) {
+                        *frame_pointer = sample;
+                        frame_pointer++;
+                    }
+                }
+            }
+        } else if (upmixing == 1) {
             size_t samples = retrieved_frames * channels_;
-            memcpy(frame_pointer, current_frame_, samples * 2);
+            memcpy(frame_pointer, frame_buffer_ + current_frame_ * channels_, samples * 2);
             frame_pointer += samples;
         } else {
-            int16_t *sample_pointer = current_frame_;
+            int16_t *sample_pointer = frame_buffer_ + current_frame_ * channels_;
 
             for (size_t frame_index = 0; frame_index < retrieved_frames; frame_index++) {
                 for (unsigned int channel = 0; channel < channels_; channel++) {
@@ -219,12 +426,96 @@ size_t Mp3Reader::decodeToI16(int16_t *buffer, size_t frames, unsigned int upmix
     return processed_frames;
 }
 
+size_t Mp3Reader::decodeToI16(int16_t *const *buffers, size_t frames, unsigned int upmixing)
+{
+    if (!opened_) {
+        return 0;
+    }
+
+    size_t processed_frames = 0;
+
+    while (processed_frames < frames) {
+        int16_t *planes[MAX_CHANNELS];
+        int16_t *const *outputs = nullptr;
+
+        // Whole MP3 frames go straight to the first plane of each channel
+        if (frames - processed_frames >= MP3READER_PLANE_LENGTH) {
+            for (unsigned int channel = 0; channel < channels_; channel++) {
+                planes[channel] = buffers[channel * upmixing] + processed_frames;
+            }
+
+            outputs = planes;
+        }
+
+        size_t retrieved_frames = retrieveNextFrames(frames - processed_frames, true, outputs);
+        if (retrieved_frames == 0) {
+            break;
+        }
+
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            int16_t *plane_pointer = buffers[channel * upmixing] + processed_frames;
+
+            if (direct_frames_) {
+                // Decoded in place
+            } else if (planar_frames_) {
+                memcpy(plane_pointer,
+                       frame_buffer_ + MP3READER_PLANE_LENGTH * channel + current_frame_,
+                       retrieved_frames * 2);
+            } else {
+                int16_t *sample_pointer = frame_buffer_ + current_frame_ * channels_ + channel;
+
+                for (size_t frame_index = 0; frame_index < retrieved_frames; frame_index++) {
+                    plane_pointer[frame_index] = *sample_pointer;
+                    sample_pointer += channels_;
+                }
+            }
+
+            for (unsigned int copy = 1; copy < upmixing; copy++) {
+                memcpy(buffers[channel * upmixing + copy] + processed_frames,
+                       plane_pointer,
+                       retrieved_frames * 2);
+            }
+        }
+
+        processed_frames += retrieved_frames;
+    }
+
+    return processed_frames;
+}
+
+Mp3Reader::Footprint Mp3Reader::footprint()
+{
+    Footprint footprint;
+
+    footprint.reader_bytes = sizeof(Mp3Reader);
+    footprint.decoder_bytes = sizeof(frame_header_) + sizeof(mp3_dec_info_) + sizeof(scale_factor_info_) + sizeof(imdct_info_) + sizeof(subband_info_);
+    footprint.buffer_bytes = sizeof(chunk_buffer_) + sizeof(frame_buffer_);
+    footprint.scratch_bytes = sizeof(Helix::MP3DecScratch);
+
+    return footprint;
+}
+
+void Mp3Reader::resetDecoder()
+{
+    memset(&frame_header_, 0, sizeof(frame_header_));
+    memset(&mp3_dec_info_, 0, sizeof(mp3_dec_info_));
+    memset(&scale_factor_info_, 0, sizeof(scale_factor_info_));
+    memset(&imdct_info_, 0, sizeof(imdct_info_));
+    memset(&subband_info_, 0, sizeof(subband_info_));
+
+    // The scratch pointers are set by decodeNextFrames()
+    mp3_dec_info_.FrameHeaderPS = &frame_header_;
+    mp3_dec_info_.ScaleFactorInfoPS = &scale_factor_info_;
+    mp3_dec_info_.IMDCTInfoPS = &imdct_info_;
+    mp3_dec_info_.SubbandInfoPS = &subband_info_;
+}
+
 inline size_t Mp3Reader::tell()
 {
     return tell_callback_(file_);
 }
 
-inline bool Mp3Reader::seek(size_t offset)
+inline bool Mp3Reader::seekFile(size_t offset)
 {
     return seek_callback_(file_, offset);
 }
@@ -253,12 +544,17 @@ inline bool Mp3Reader::readCharBuffer(char *buffer, size_t length)
     return true;
 }
 
-size_t Mp3Reader::retrieveNextFrames(size_t frames)
+size_t Mp3Reader::retrieveNextFrames(size_t frames, bool planar, int16_t *const *outputs)
 {
     bool do_rewind = mode_ == Mode::Continuous;
 
+    direct_frames_ = false;
+
     while (decoded_frames_ == 0) {
-        if (!findNextChunk()) {
+        // Encoder padding is left out when the exact length is known
+        bool stream_end = (total_frames_ > 0) && (frame_position_ >= total_frames_);
+
+        if (stream_end || !findNextFrame()) {
             if (!do_rewind) {
                 return 0;
             }
@@ -269,7 +565,22 @@ size_t Mp3Reader::retrieveNextFrames(size_t frames)
             continue;
         }
 
-        if (!decodeNextFrames()) {
+        // 0 for a free format frame or one that does not match the stream's format
+        size_t frame_size = frameSize(current_chunk_);
+
+        // A frame cut off by the end of the buffer would fail to decode after clearing a whole output frame
+        if (frame_size > prefetched_bytes_) {
+            refillNextChunk();
+        }
+
+        // Skipped frames are decoded into the frame buffer, and so are frames
+        // that may hold more samples than the caller has room for
+        int16_t *const *frame_outputs = nullptr;
+        if ((skip_frames_ == 0) && (frame_size != 0)) {
+            frame_outputs = outputs;
+        }
+
+        if (!decodeNextFrames(planar, frame_outputs)) {
             if (!refillNextChunk()) {
                 return 0;
             }
@@ -277,7 +588,16 @@ size_t Mp3Reader::retrieveNextFrames(size_t frames)
             continue;
         }
 
-        next_frame_ = frame_buffer_;
+        if ((frame_outputs != nullptr) && (decoded_frames_ > 0)) {
+            direct_frames_ = true;
+
+            frames = decoded_frames_;
+            decoded_frames_ = 0;
+
+            frame_position_ += frames;
+
+            return frames;
+        }
     }
 
     current_frame_ = next_frame_;
@@ -286,17 +606,19 @@ size_t Mp3Reader::retrieveNextFrames(size_t frames)
         frames = decoded_frames_;
     }
 
-    next_frame_ = current_frame_ + channels_ * frames;
+    next_frame_ = current_frame_ + frames;
     decoded_frames_ -= frames;
 
+    frame_position_ += frames;
+
     return frames;
 }
 
 bool Mp3Reader::findNextChunk()
 {
-    int offset = Helix::MP3FindSyncWord(current_chunk_, prefetched_bytes_);
+    int offset = findSyncWord(current_chunk_, prefetched_bytes_);
     while (offset < 0) {
-        if (!seek(next_data_offset_)) {
+        if (!seekFile(next_data_offset_)) {
             return false;
         }
 
@@ -323,7 +645,7 @@ bool Mp3Reader::findNextChunk()
         prefetched_bytes_ += read_bytes;
         next_data_offset_ += read_bytes;
 
-        offset = Helix::MP3FindSyncWord(current_chunk_, prefetched_bytes_);
+        offset = findSyncWord(current_chunk_, prefetched_bytes_);
     }
 
     current_chunk_ += offset;
@@ -342,7 +664,7 @@ bool Mp3Reader::refillNextChunk()
     memmove(chunk_buffer_, current_chunk_, prefetched_bytes_);
     current_chunk_ = chunk_buffer_;
 
-    if (!seek(next_data_offset_)) {
+    if (!seekFile(next_data_offset_)) {
         return false;
     }
 
@@ -360,23 +682,398 @@ bool Mp3Reader::refillNextChunk()
     return true;
 }
 
-bool Mp3Reader::decodeNextFrames()
+bool Mp3Reader::findNextFrame()
 {
+    // Where the last decoded frame ends
+    size_t frame_offset = next_data_offset_ - prefetched_bytes_;
+
+    while (findNextChunk()) {
+        if (prefetched_bytes_ < FRAME_HEADER_SIZE) {
+            refillNextChunk();
+        }
+
+        if (prefetched_bytes_ >= FRAME_HEADER_SIZE) {
+            size_t frame_size = frameSize(current_chunk_);
+
+            // Free format sizes are left to the decoder
+            bool free_format = (current_chunk_[2] & 0xf0) == 0;
+
+            if ((chunk_data_offset_ == frame_offset) && ((frame_size != 0) || free_format)) {
+                return true;
+            }
+
+            // A sync word after junk has to start a run of frames, as in walkFrames()
+            if ((frame_size != 0) && confirmFrames(chunk_data_offset_)) {
+                indexResync(mp3_frame_number_, frame_offset, chunk_data_offset_);
+                return true;
+            }
+        }
+
+        current_chunk_ += 1;
+        prefetched_bytes_ -= 1;
+        chunk_data_offset_ += 1;
+    }
+
+    return false;
+}
+
+bool Mp3Reader::decodeNextFrames(bool planar, int16_t *const *outputs)
+{
+    // Decode-ahead and the bulk decoder can move a reader between threads
+    Helix::MP3DecScratch &scratch = decoderScratch();
+
+    mp3_dec_info_.SideInfoPS = &scratch.si;
+    mp3_dec_info_.HuffmanInfoPS = &scratch.hi;
+    mp3_dec_info_.DequantInfoPS = &scratch.di;
+    mp3_dec_info_.IMDCTOutInfoPS = &scratch.mo;
+
     int bytes_left = prefetched_bytes_;
     uint8_t *next_chunk = current_chunk_;
 
     decoded_frames_ = 0;
 
-    int result = Helix::MP3Decode(&mp3_dec_info_, &next_chunk, &bytes_left, frame_buffer_, 0);
-    if (result != Helix::ERR_MP3_NONE) {
+    int result;
+
+    if (planar) {
+        int16_t *planes[MAX_CHANNELS] = {
+            frame_buffer_,
+            frame_buffer_ + MP3READER_PLANE_LENGTH
+        };
+
+        if (outputs != nullptr) {
+            for (unsigned int channel = 0; channel < channels_; channel++) {
+                planes[channel] = outputs[channel];
+            }
+        }
+
+        result = Helix::MP3DecodePlanar(&mp3_dec_info_, &next_chunk, &bytes_left, planes, 0);
+    } else {
+        int16_t *output = frame_buffer_;
+
+        if (outputs != nullptr) {
+            output = outputs[0];
+        }
+
+        result = Helix::MP3Decode(&mp3_dec_info_, &next_chunk, &bytes_left, output, 0);
+    }
+
+    if (outputs == nullptr) {
+        planar_frames_ = planar;
+    }
+
+    // A frame missing its bit reservoir data only refills the reservoir
+    if (result == Helix::ERR_MP3_NONE) {
+        decoded_frames_ = mp3_dec_info_.nGrans * mp3_dec_info_.nGranSamps;
+    } else if (result != Helix::ERR_MP3_MAINDATA_UNDERFLOW) {
         return false;
     }
 
-    decoded_frames_ = mp3_dec_info_.nGrans * mp3_dec_info_.nGranSamps;
+    next_frame_ = 0;
+
+    // Encoder delay, or the part of the frame before a seek target
+    if (skip_frames_ > 0) {
+        size_t skipped_frames = skip_frames_;
+        if (skipped_frames > decoded_frames_) {
+            skipped_frames = decoded_frames_;
+        }
+
+        next_frame_ = skipped_frames;
+        decoded_frames_ -= skipped_frames;
+        skip_frames_ -= skipped_frames;
+    }
+
+    // Encoder padding
+    if ((total_frames_ > 0) && (decoded_frames_ > total_frames_ - frame_position_)) {
+        decoded_frames_ = total_frames_ - frame_position_;
+    }
+
+    size_t frame_size = next_chunk - current_chunk_;
+
+    indexFrame(mp3_frame_number_, chunk_data_offset_, frame_size);
+    mp3_frame_number_++;
 
-    chunk_data_offset_ += next_chunk - current_chunk_;
-    prefetched_bytes_ -= next_chunk - current_chunk_;
+    chunk_data_offset_ += frame_size;
+    prefetched_bytes_ -= frame_size;
     current_chunk_ = next_chunk;
 
     return true;
 }
+
+bool Mp3Reader::readXingFrame(const Helix::MP3FrameInfo &frame_info)
+{
+    uint8_t frame[XING_FRAME_SIZE];
+
+    if (!seekFile(initial_data_offset_)) {
+        return false;
+    }
+
+    size_t read_bytes = read(frame, sizeof(frame));
+    if (read_bytes < FRAME_HEADER_SIZE) {
+        return false;
+    }
+
+    size_t frame_size = frameSize(frame);
+    if (frame_size == 0) {
+        return false;
+    }
+
+    // The tag takes the place of the main data
+    size_t tag_offset = FRAME_HEADER_SIZE;
+
+    if ((frame[1] & 0x01) == 0) {
+        tag_offset += 2;
+    }
+
+    if (frame_info.version == Helix::MPEG1) {
+        tag_offset += (frame_info.nChans == 1) ? 17 : 32;
+    } else {
+        tag_offset += (frame_info.nChans == 1) ? 9 : 17;
+    }
+
+    if (tag_offset + 8 > read_bytes) {
+        return false;
+    }
+
+    const uint8_t *tag = frame + tag_offset;
+
+    if ((memcmp(tag, "Xing", 4) != 0) && (memcmp(tag, "Info", 4) != 0)) {
+        return false;
+    }
+
+    uint32_t flags = (static_cast<uint32_t>(tag[4]) << 24) |
+                     (static_cast<uint32_t>(tag[5]) << 16) |
+                     (static_cast<uint32_t>(tag[6]) << 8) |
+                     static_cast<uint32_t>(tag[7]);
+
+    tag += 8;
+
+    size_t mp3_frames = 0;
+
+    if ((flags & XING_FRAMES_FLAG) != 0) {
+        if (tag + 4 > frame + read_bytes) {
+            return false;
+        }
+
+        mp3_frames = (static_cast<size_t>(tag[0]) << 24) |
+                     (static_cast<size_t>(tag[1]) << 16) |
+                     (static_cast<size_t>(tag[2]) << 8) |
+                     static_cast<size_t>(tag[3]);
+
+        tag += 4;
+    }
+
+    if ((flags & XING_BYTES_FLAG) != 0) {
+        tag += 4;
+    }
+
+    if ((flags & XING_TOC_FLAG) != 0) {
+        tag += XING_TOC_SIZE;
+    }
+
+    if ((flags & XING_QUALITY_FLAG) != 0) {
+        tag += 4;
+    }
+
+    // The frame carries no audio
+    initial_data_offset_ += frame_size;
+
+    if (mp3_frames == 0) {
+        return false;
+    }
+
+    size_t stream_frames = mp3_frames * mp3_frame_samples_;
+
+    total_frames_ = stream_frames;
+
+    // LAME and FFmpeg store 12-bit encoder delay and padding counts
+    if ((tag + LAME_TAG_SIZE <= frame + read_bytes) &&
+        ((memcmp(tag, "LAME", 4) == 0) || (memcmp(tag, "Lavc", 4) == 0) || (memcmp(tag, "Lavf", 4) == 0))) {
+        size_t delay = (static_cast<size_t>(tag[LAME_DELAY_OFFSET]) << 4) |
+                       (tag[LAME_DELAY_OFFSET + 1] >> 4);
+        size_t padding = (static_cast<size_t>(tag[LAME_DELAY_OFFSET + 1] & 0x0f) << 8) |
+                         tag[LAME_DELAY_OFFSET + 2];
+
+        if (delay + padding < stream_frames) {
+            leading_frames_ = delay + DECODER_DELAY;
+            total_frames_ = stream_frames - delay - padding;
+
+            // The decoder delay may run past the padding
+            if (total_frames_ > stream_frames - leading_frames_) {
+                total_frames_ = stream_frames - leading_frames_;
+            }
+        }
+    }
+
+    return true;
+}
+
+size_t Mp3Reader::frameSize(uint8_t *header)
+{
+    Helix::MP3FrameInfo frame_info;
+
+    if (Helix::MP3GetNextFrameInfo(&mp3_dec_info_, &frame_info, header) != Helix::ERR_MP3_NONE) {
+        return 0;
+    }
+
+    // Free format frames have no bitrate to derive their size from
+    if ((frame_info.bitrate == 0) ||
+        (static_cast<unsigned long>(frame_info.samprate) != sampling_rate_) ||
+        (static_cast<unsigned int>(frame_info.nChans) != channels_)) {
+        return 0;
+    }
+
+    size_t slot_bytes = frame_info.outputSamps / frame_info.nChans / 8;
+    size_t padding = (header[2] >> 1) & 0x01;
+
+    return slot_bytes * frame_info.bitrate / frame_info.samprate + padding;
+}
+
+bool Mp3Reader::confirmFrames(size_t offset)
+{
+    uint8_t header[FRAME_HEADER_SIZE];
+
+    for (unsigned int frame = 0; frame <= CONFIRMED_FRAMES; frame++) {
+        if (!seekFile(offset)) {
+            return false;
+        }
+
+        size_t read_bytes = read(header, sizeof(header));
+
+        // A stream may end right after the candidate
+        if ((frame > 0) && (read_bytes == 0)) {
+            return true;
+        }
+
+        if (read_bytes < sizeof(header)) {
+            return false;
+        }
+
+        size_t frame_size = frameSize(header);
+        if (frame_size == 0) {
+            return false;
+        }
+
+        offset += frame_size;
+    }
+
+    return true;
+}
+
+void Mp3Reader::indexFrame(size_t mp3_frame, size_t offset, size_t frame_size)
+{
+    if ((mp3_frame != indexed_mp3_frames_) || (offset != indexed_end_offset_)) {
+        return;
+    }
+
+    if (mp3_frame % seek_index_stride_ == 0) {
+        // A full index keeps every other entry at twice the stride
+        if (seek_index_entries_ == MP3READER_SEEK_INDEX_SIZE) {
+            for (size_t entry = 0; entry < MP3READER_SEEK_INDEX_SIZE / 2; entry++) {
+                seek_index_[entry] = seek_index_[entry * 2];
+            }
+
+            seek_index_entries_ = MP3READER_SEEK_INDEX_SIZE / 2;
+            seek_index_stride_ *= 2;
+        }
+
+        if (mp3_frame % seek_index_stride_ == 0) {
+            seek_index_[seek_index_entries_] = offset;
+            seek_index_entries_++;
+        }
+    }
+
+    indexed_mp3_frames_++;
+    indexed_end_offset_ = offset + frame_size;
+}
+
+void Mp3Reader::indexResync(size_t mp3_frame, size_t offset, size_t resync_offset)
+{
+    // Junk right after the indexed frames moves where the next one starts
+    if ((mp3_frame == indexed_mp3_frames_) && (offset == indexed_end_offset_)) {
+        indexed_end_offset_ = resync_offset;
+    }
+}
+
+bool Mp3Reader::walkFrames(size_t first_mp3_frame, size_t last_mp3_frame, size_t *offsets)
+{
+    size_t mp3_frame = indexed_mp3_frames_;
+    size_t offset = indexed_end_offset_;
+
+    if (first_mp3_frame < indexed_mp3_frames_) {
+        size_t entry = first_mp3_frame / seek_index_stride_;
+
+        mp3_frame = entry * seek_index_stride_;
+        offset = seek_index_[entry];
+    }
+
+    // Only frame headers are read, the decoder reads its prefetched bytes
+    // again from the file once the walk has borrowed the chunk buffer
+    next_data_offset_ -= prefetched_bytes_;
+    prefetched_bytes_ = 0;
+    current_chunk_ = chunk_buffer_;
+
+    size_t buffer_offset = 0;
+    size_t buffered_bytes = 0;
+
+    // Where junk after the last frame starts
+    size_t junk_offset = SIZE_MAX;
+
+    while (true) {
+        if ((offset < buffer_offset) || (offset + FRAME_HEADER_SIZE > buffer_offset + buffered_bytes)) {
+            if (!seekFile(offset)) {
+                return false;
+            }
+
+            buffer_offset = offset;
+            buffered_bytes = read(chunk_buffer_, MP3READER_CHUNK_BUFFER_SIZE);
+
+            if (buffered_bytes < FRAME_HEADER_SIZE) {
+                return false;
+            }
+        }
+
+        // Skips to the next sync word that starts a run of frames, as findNextFrame() does
+        if (junk_offset != SIZE_MAX) {
+            size_t available = buffer_offset + buffered_bytes - offset;
+
+            int sync = findSyncWord(chunk_buffer_ + (offset - buffer_offset), available);
+            if (sync < 0) {
+                // The last byte may begin a sync word
+                offset += available - 1;
+                continue;
+            }
+
+            offset += sync;
+
+            if (!confirmFrames(offset)) {
+                offset++;
+                continue;
+            }
+
+            indexResync(mp3_frame, junk_offset, offset);
+            junk_offset = SIZE_MAX;
+
+            continue;
+        }
+
+        size_t frame_size = frameSize(chunk_buffer_ + (offset - buffer_offset));
+        if (frame_size == 0) {
+            junk_offset = offset;
+            offset++;
+            continue;
+        }
+
+        if (mp3_frame >= first_mp3_frame) {
+            offsets[mp3_frame % (MP3READER_SEEK_PREROLL_FRAMES + 1)] = offset;
+        }
+
+        indexFrame(mp3_frame, offset, frame_size);
+
+        if (mp3_frame == last_mp3_frame) {
+            return true;
+        }
+
+        mp3_frame++;
+        offset += frame_size;
+    }
+}
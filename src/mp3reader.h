@@ -16,6 +16,14 @@ namespace Helix
 
 #define MP3READER_CHUNK_BUFFER_SIZE MP3READER_BUFFER_SIZE
 #define MP3READER_FRAME_BUFFER_SIZE 4608
+#define MP3READER_PLANE_LENGTH (MP3READER_FRAME_BUFFER_SIZE / 4)
+
+#ifndef MP3READER_SEEK_INDEX_SIZE
+#define MP3READER_SEEK_INDEX_SIZE 256
+#endif
+
+// Enough MP3 frames at 8 kbps to refill a full bit reservoir
+#define MP3READER_SEEK_PREROLL_FRAMES 64
 
 class Mp3Reader : public AudioReader
 {
@@ -24,6 +32,16 @@ public:
 
     static const unsigned int MAX_FRAME_SIZE = 16;
 
+    // Memory each reader holds, and the Helix scratch every reader decoding
+    // on the same thread shares
+    struct Footprint
+    {
+        size_t reader_bytes;
+        size_t decoder_bytes;
+        size_t buffer_bytes;
+        size_t scratch_bytes;
+    };
+
 public:
     Mp3Reader(TellCallback tell_callback,
               SeekCallback seek_callback,
@@ -37,36 +55,57 @@ public:
 
     void rewind(bool preload = true) override;
 
+    bool seek(size_t frame) override;
+
+    // Counts frames by walking every frame header when totalFrames() is
+    // unknown, 0 if the stream cannot be walked. Rewinds the reader
+    size_t scanFrames();
+
     size_t decodeToI16(int16_t *buffer, size_t frames, unsigned int upmixing = 1) override;
 
+    size_t decodeToI16(int16_t *const *buffers, size_t frames, unsigned int upmixing = 1) override;
+
     unsigned int bitsPerSample()
     {
         return 16;
     }
 
+    static Footprint footprint();
+
 private:
+    void resetDecoder();
+
     inline size_t tell();
-    inline bool seek(size_t offset);
+    inline bool seekFile(size_t offset);
     inline size_t read(uint8_t *buffer, size_t length);
 
     inline bool readU8(uint8_t *value);
     inline bool readCharBuffer(char *buffer, size_t length);
 
-    size_t retrieveNextFrames(size_t frames);
+    size_t retrieveNextFrames(size_t frames, bool planar, int16_t *const *outputs = nullptr);
 
     bool findNextChunk();
+    bool findNextFrame();
     bool refillNextChunk();
-    bool decodeNextFrames();
+    bool decodeNextFrames(bool planar = false, int16_t *const *outputs = nullptr);
+
+    bool readXingFrame(const Helix::MP3FrameInfo &frame_info);
+
+    size_t frameSize(uint8_t *header);
+    bool confirmFrames(size_t offset);
+    void indexFrame(size_t mp3_frame, size_t offset, size_t frame_size);
+    void indexResync(size_t mp3_frame, size_t offset, size_t resync_offset);
+    bool walkFrames(size_t first_mp3_frame, size_t last_mp3_frame, size_t *offsets);
 
 private:
+    // Decoder state carried from frame to frame, the header and the
+    // MP3DecInfo scalars first so they share cache lines. The per-frame
+    // state is in the thread's Helix::MP3DecScratch
     Helix::FrameHeader frame_header_;
-    Helix::SideInfo side_info_;
-    Helix::ScaleFactorInfo scale_factor_info_;
-    Helix::HuffmanInfo huffman_info_;
-    Helix::DequantInfo dequant_info_;
-    Helix::IMDCTInfo imdct_info_;
-    Helix::SubbandInfo subband_info_;
     Helix::MP3DecInfo mp3_dec_info_;
+    Helix::ScaleFactorInfo scale_factor_info_;
+    alignas(64) Helix::IMDCTInfo imdct_info_;
+    alignas(64) Helix::SubbandInfo subband_info_;
 
     size_t initial_data_offset_;
     size_t chunk_data_offset_;
@@ -77,7 +116,24 @@ private:
     uint8_t *current_chunk_;
 
     alignas(4) int16_t frame_buffer_[MP3READER_FRAME_BUFFER_SIZE / 2];
+    bool planar_frames_;
+    bool direct_frames_;
     size_t decoded_frames_;
-    int16_t *current_frame_;
-    int16_t *next_frame_;
+    size_t current_frame_;
+    size_t next_frame_;
+
+    size_t mp3_frame_samples_;
+    size_t mp3_frame_number_;
+    size_t skip_frames_;
+
+    // Encoder and decoder delay dropped from the start of the stream
+    size_t leading_frames_;
+    size_t frame_position_;
+
+    // File offsets of every seek_index_stride_-th MP3 frame
+    size_t seek_index_[MP3READER_SEEK_INDEX_SIZE];
+    size_t seek_index_entries_;
+    size_t seek_index_stride_;
+    size_t indexed_mp3_frames_;
+    size_t indexed_end_offset_;
 };
@@ -0,0 +1,464 @@
+#include "pcmconverter.h"
+
+#include "audiokernels.h"
+
+#include <cstring>
+
+static const uint32_t DITHER_SEEDS[4] = {
+    0x9e3779b9, 0x7f4a7c15, 0x85ebca6b, 0xc2b2ae35
+};
+
+#ifdef HAS_G711
+static const int16_t alaw_table[256] = {
+    -5504, -5248, -6016, -5760, -4480, -4224, -4992, -4736,
+    -7552, -7296, -8064, -7808, -6528, -6272, -7040, -6784,
+    -2752, -2624, -3008, -2880, -2240, -2112, -2496, -2368,
+    -3776, -3648, -4032, -3904, -3264, -3136, -3520, -3392,
+    -22016, -20992, -24064, -23040, -17920, -16896, -19968, -18944,
+    -30208, -29184, -32256, -31232, -26112, -25088, -28160, -27136,
+    -11008, -10496, -12032, -11520, -8960, -8448, -9984, -9472,
+    -15104, -14592, -16128, -15616, -13056, -12544, -14080, -13568,
+    -344, -328, -376, -360, -280, -264, -312, -296,
+    -472, -456, -504, -488, -408, -392, -440, -424,
+    -88, -72, -120, -104, -24, -8, -56, -40,
+    -216, -200, -248, -232, -152, -136, -184, -168,
+    -1376, -1312, -1504, -1440, -1120, -1056, -1248, -1184,
+    -1888, -1824, -2016, -1952, -1632, -1568, -1760, -1696,
+    -688, -656, -752, -720, -560, -528, -624, -592,
+    -944, -912, -1008, -976, -816, -784, -880, -848,
+    5504, 5248, 6016, 5760, 4480, 4224, 4992, 4736,
+    7552, 7296, 8064, 7808, 6528, 6272, 7040, 6784,
+    2752, 2624, 3008, 2880, 2240, 2112, 2496, 2368,
+    3776, 3648, 4032, 3904, 3264, 3136, 3520, 3392,
+    22016, 20992, 24064, 23040, 17920, 16896, 19968, 18944,
+    30208, 29184, 32256, 31232, 26112, 25088, 28160, 27136,
+    11008, 10496, 12032, 11520, 8960, 8448, 9984, 9472,
+    15104, 14592, 16128, 15616, 13056, 12544, 14080, 13568,
+    344, 328, 376, 360, 280, 264, 312, 296,
+    472, 456, 504, 488, 408, 392, 440, 424,
+    88, 72, 120, 104, 24, 8, 56, 40,
+    216, 200, 248, 232, 152, 136, 184, 168,
+    1376, 1312, 1504, 1440, 1120, 1056, 1248, 1184,
+    1888, 1824, 2016, 1952, 1632, 1568, 1760, 1696,
+    688, 656, 752, 720, 560, 528, 624, 592,
+    944, 912, 1008, 976, 816, 784, 880, 848,
+};
+
+static const int16_t mulaw_table[256] = {
+    -32124, -31100, -30076, -29052, -28028, -27004, -25980, -24956,
+    -23932, -22908, -21884, -20860, -19836, -18812, -17788, -16764,
+    -15996, -15484, -14972, -14460, -13948, -13436, -12924, -12412,
+    -11900, -11388, -10876, -10364, -9852, -9340, -8828, -8316,
+    -7932, -7676, -7420, -7164, -6908, -6652, -6396, -6140,
+    -5884, -5628, -5372, -5116, -4860, -4604, -4348, -4092,
+    -3900, -3772, -3644, -3516, -3388, -3260, -3132, -3004,
+    -2876, -2748, -2620, -2492, -2364, -2236, -2108, -1980,
+    -1884, -1820, -1756, -1692, -1628, -1564, -1500, -1436,
+    -1372, -1308, -1244, -1180, -1116, -1052, -988, -924,
+    -876, -844, -812, -780, -748, -716, -684, -652,
+    -620, -588, -556, -524, -492, -460, -428, -396,
+    -372, -356, -340, -324, -308, -292, -276, -260,
+    -244, -228, -212, -196, -180, -164, -148, -132,
+    -120, -112, -104, -96, -88, -80, -72, -64,
+    -56, -48, -40, -32, -24, -16, -8, 0,
+    32124, 31100, 30076, 29052, 28028, 27004, 25980, 24956,
+    23932, 22908, 21884, 20860, 19836, 18812, 17788, 16764,
+    15996, 15484, 14972, 14460, 13948, 13436, 12924, 12412,
+    11900, 11388, 10876, 10364, 9852, 9340, 8828, 8316,
+    7932, 7676, 7420, 7164, 6908, 6652, 6396, 6140,
+    5884, 5628, 5372, 5116, 4860, 4604, 4348, 4092,
+    3900, 3772, 3644, 3516, 3388, 3260, 3132, 3004,
+    2876, 2748, 2620, 2492, 2364, 2236, 2108, 1980,
+    1884, 1820, 1756, 1692, 1628, 1564, 1500, 1436,
+    1372, 1308, 1244, 1180, 1116, 1052, 988, 924,
+    876, 844, 812, 780, 748, 716, 684, 652,
+    620, 588, 556, 524, 492, 460, 428, 396,
+    372, 356, 340, 324, 308, 292, 276, 260,
+    244, 228, 212, 196, 180, 164, 148, 132,
+    120, 112, 104, 96, 88, 80, 72, 64,
+    56, 48, 40, 32, 24, 16, 8, 0,
+};
+#endif
+
+static inline uint32_t loadU32(const uint8_t *input)
+{
+    return static_cast<uint32_t>(input[0]) |
+           (static_cast<uint32_t>(input[1]) << 8) |
+           (static_cast<uint32_t>(input[2]) << 16) |
+           (static_cast<uint32_t>(input[3]) << 24);
+}
+
+static inline uint32_t nextRandom(uint32_t *state)
+{
+    uint32_t value = *state;
+
+    value ^= value << 13;
+    value ^= value >> 17;
+    value ^= value << 5;
+
+    *state = value;
+
+    return value;
+}
+
+static inline int16_t reduceToI16(int32_t value, uint32_t *dither_state)
+{
+    if (dither_state == nullptr) {
+        return static_cast<int16_t>(value >> 16);
+    }
+
+    // Triangular noise of +-1 LSB is added at 24 bits before rounding to 16 bits
+    uint32_t random = nextRandom(dither_state);
+    int32_t dither = static_cast<int32_t>(random & 0xff) -
+                     static_cast<int32_t>((random >> 8) & 0xff);
+
+    int32_t sample = ((value >> 8) + dither + 128) >> 8;
+
+    if (sample > INT16_MAX) {
+        sample = INT16_MAX;
+    } else if (sample < INT16_MIN) {
+        sample = INT16_MIN;
+    }
+
+    return static_cast<int16_t>(sample);
+}
+
+static inline int16_t *storeSample(int16_t *output, int16_t sample, unsigned int upmixing)
+{
+    for (unsigned int copy = 0; copy < upmixing; copy++) {
+        *output = sample;
+        output++;
+    }
+
+    return output;
+}
+
+struct Unsigned8Samples
+{
+    static const size_t SIZE = 1;
+
+    static int16_t load(const uint8_t *input)
+    {
+        return static_cast<int16_t>((input[0] ^ 0x80) << 8);
+    }
+};
+
+struct Signed16Samples
+{
+    static const size_t SIZE = 2;
+
+    static int16_t load(const uint8_t *input)
+    {
+        return static_cast<int16_t>(input[0] | (input[1] << 8));
+    }
+};
+
+struct Signed24Samples
+{
+    static const size_t SIZE = 3;
+
+    static int32_t load(const uint8_t *input)
+    {
+        return static_cast<int32_t>((static_cast<uint32_t>(input[0]) << 8) |
+                                    (static_cast<uint32_t>(input[1]) << 16) |
+                                    (static_cast<uint32_t>(input[2]) << 24));
+    }
+};
+
+struct Signed32Samples
+{
+    static const size_t SIZE = 4;
+
+    static int32_t load(const uint8_t *input)
+    {
+        return static_cast<int32_t>(loadU32(input));
+    }
+};
+
+#ifdef HAS_IEEE_FLOAT
+struct Float32Samples
+{
+    static const size_t SIZE = 4;
+
+    static int32_t load(const uint8_t *input)
+    {
+        uint32_t bits = loadU32(input);
+        float value;
+
+        memcpy(&value, &bits, sizeof(value));
+
+        if (!(value >= -1.0f)) {
+            value = -1.0f;
+        } else if (value > 1.0f) {
+            value = 1.0f;
+        }
+
+        return static_cast<int32_t>(value * AudioKernels::F32_SCALE);
+    }
+};
+
+struct Float64Samples
+{
+    static const size_t SIZE = 8;
+
+    static int32_t load(const uint8_t *input)
+    {
+        uint64_t bits = static_cast<uint64_t>(loadU32(input)) |
+                        (static_cast<uint64_t>(loadU32(input + 4)) << 32);
+        double value;
+
+        memcpy(&value, &bits, sizeof(value));
+
+        if (!(value >= -1.0)) {
+            value = -1.0;
+        } else if (value > 1.0) {
+            value = 1.0;
+        }
+
+        return static_cast<int32_t>(value * AudioKernels::F64_SCALE);
+    }
+};
+#endif
+
+#ifdef HAS_G711
+struct ALawSamples
+{
+    static const size_t SIZE = 1;
+
+    static int16_t load(const uint8_t *input)
+    {
+        return alaw_table[input[0]];
+    }
+};
+
+struct MuLawSamples
+{
+    static const size_t SIZE = 1;
+
+    static int16_t load(const uint8_t *input)
+    {
+        return mulaw_table[input[0]];
+    }
+};
+#endif
+
+// Formats that already are 16-bit after loading
+template <typename Samples>
+static void convertDirect(int16_t *output,
+                          const uint8_t *input,
+                          size_t samples,
+                          size_t stride,
+                          unsigned int upmixing,
+                          AudioKernels::ConvertKernel kernel)
+{
+    size_t sample = 0;
+
+    if (kernel && (stride == Samples::SIZE) && ((upmixing == 1) || (upmixing == 2))) {
+        sample = kernel(output, input, samples, upmixing);
+
+        output += sample * upmixing;
+        input += sample * Samples::SIZE;
+    }
+
+    for (; sample < samples; sample++) {
+        output = storeSample(output, Samples::load(input), upmixing);
+        input += stride;
+    }
+}
+
+// Formats that are loaded as full scale 32-bit and then reduced to 16-bit
+template <typename Samples>
+static void convertReduced(int16_t *output,
+                           const uint8_t *input,
+                           size_t samples,
+                           size_t stride,
+                           unsigned int upmixing,
+                           uint32_t *dither_state,
+                           AudioKernels::ReduceKernel kernel)
+{
+    size_t sample = 0;
+
+    if (kernel && (stride == Samples::SIZE) && ((upmixing == 1) || (upmixing == 2))) {
+        sample = kernel(output, input, samples, upmixing, dither_state);
+
+        output += sample * upmixing;
+        input += sample * Samples::SIZE;
+    }
+
+    for (; sample < samples; sample++) {
+        output = storeSample(output, reduceToI16(Samples::load(input), dither_state), upmixing);
+        input += stride;
+    }
+}
+
+PcmConverter::PcmConverter()
+    : encoding_(Encoding::Unknown),
+      sample_size_(0),
+      dither_(false),
+      dither_state_{DITHER_SEEDS[0], DITHER_SEEDS[1], DITHER_SEEDS[2], DITHER_SEEDS[3]}
+{
+}
+
+bool PcmConverter::setFormat(bool floating, size_t sample_size)
+{
+    encoding_ = Encoding::Unknown;
+    sample_size_ = 0;
+
+    if (floating) {
+        switch (sample_size) {
+#ifdef HAS_IEEE_FLOAT
+        case 4:
+            return setEncoding(Encoding::Float32);
+        case 8:
+            return setEncoding(Encoding::Float64);
+#endif
+        default:
+            return false;
+        }
+    }
+
+    switch (sample_size) {
+    case 0:
+        return false;
+    case 1:
+        return setEncoding(Encoding::Unsigned8);
+    case 2:
+        return setEncoding(Encoding::Signed16);
+    case 3:
+        return setEncoding(Encoding::Signed24);
+    case 4:
+        return setEncoding(Encoding::Signed32);
+    default:
+        encoding_ = Encoding::SignedWide;
+        sample_size_ = sample_size;
+        return true;
+    }
+}
+
+bool PcmConverter::setEncoding(Encoding encoding)
+{
+    switch (encoding) {
+    case Encoding::Unsigned8:
+        sample_size_ = Unsigned8Samples::SIZE;
+        break;
+    case Encoding::Signed16:
+        sample_size_ = Signed16Samples::SIZE;
+        break;
+    case Encoding::Signed24:
+        sample_size_ = Signed24Samples::SIZE;
+        break;
+    case Encoding::Signed32:
+        sample_size_ = Signed32Samples::SIZE;
+        break;
+#ifdef HAS_IEEE_FLOAT
+    case Encoding::Float32:
+        sample_size_ = Float32Samples::SIZE;
+        break;
+    case Encoding::Float64:
+        sample_size_ = Float64Samples::SIZE;
+        break;
+#endif
+#ifdef HAS_G711
+    case Encoding::ALaw:
+        sample_size_ = ALawSamples::SIZE;
+        break;
+    case Encoding::MuLaw:
+        sample_size_ = MuLawSamples::SIZE;
+        break;
+#endif
+    default:
+        encoding_ = Encoding::Unknown;
+        sample_size_ = 0;
+        return false;
+    }
+
+    encoding_ = encoding;
+
+    return true;
+}
+
+void PcmConverter::convert(int16_t *output, const uint8_t *input, size_t samples, unsigned int upmixing)
+{
+    convertSamples(output, input, samples, sample_size_, upmixing);
+}
+
+void PcmConverter::convertPlane(int16_t *output, const uint8_t *input, size_t samples, size_t stride)
+{
+    convertSamples(output, input, samples, stride, 1);
+}
+
+const char *PcmConverter::vectorExtension()
+{
+    switch (audioKernels().level) {
+    case AudioKernels::Level::SSE2:
+        return "SSE2";
+    case AudioKernels::Level::SSE41:
+        return "SSE4.1";
+    case AudioKernels::Level::AVX2:
+        return "AVX2";
+    case AudioKernels::Level::NEON:
+        return "NEON";
+    default:
+        return "none";
+    }
+}
+
+void PcmConverter::convertSamples(int16_t *output,
+                                  const uint8_t *input,
+                                  size_t samples,
+                                  size_t stride,
+                                  unsigned int upmixing)
+{
+    uint32_t *dither_state = dither_ ? dither_state_ : nullptr;
+    const AudioKernels &kernels = audioKernels();
+
+    switch (encoding_) {
+    case Encoding::Unsigned8:
+        convertDirect<Unsigned8Samples>(output, input, samples, stride, upmixing, kernels.convertUnsigned8);
+        break;
+    case Encoding::Signed16:
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if ((stride == Signed16Samples::SIZE) && (upmixing == 1)) {
+            memcpy(output, input, samples * 2);
+            break;
+        }
+#endif
+        convertDirect<Signed16Samples>(output, input, samples, stride, upmixing, kernels.convertSigned16);
+        break;
+    case Encoding::Signed24:
+        convertReduced<Signed24Samples>(output, input, samples, stride, upmixing, dither_state, kernels.convertSigned24);
+        break;
+    case Encoding::Signed32:
+        convertReduced<Signed32Samples>(output, input, samples, stride, upmixing, dither_state, kernels.convertSigned32);
+        break;
+    case Encoding::SignedWide:
+        // Only the most significant 32 bits are used
+        convertReduced<Signed32Samples>(output,
+                                        input + sample_size_ - Signed32Samples::SIZE,
+                                        samples,
+                                        stride,
+                                        upmixing,
+                                        dither_state,
+                                        kernels.convertSigned32);
+        break;
+#ifdef HAS_IEEE_FLOAT
+    case Encoding::Float32:
+        convertReduced<Float32Samples>(output, input, samples, stride, upmixing, dither_state, kernels.convertFloat32);
+        break;
+    case Encoding::Float64:
+        convertReduced<Float64Samples>(output, input, samples, stride, upmixing, dither_state, kernels.convertFloat64);
+        break;
+#endif
+#ifdef HAS_G711
+    case Encoding::ALaw:
+        convertDirect<ALawSamples>(output, input, samples, stride, upmixing, nullptr);
+        break;
+    case Encoding::MuLaw:
+        convertDirect<MuLawSamples>(output, input, samples, stride, upmixing, nullptr);
+        break;
+#endif
+    default:
+        memset(output, 0, samples * upmixing * 2);
+        break;
+    }
+}
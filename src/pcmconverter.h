@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class PcmConverter
+{
+public:
+    enum class Encoding : unsigned int
+    {
+        Unknown,
+        Unsigned8,
+        Signed16,
+        Signed24,
+        Signed32,
+        SignedWide,
+#ifdef HAS_IEEE_FLOAT
+        Float32,
+        Float64,
+#endif
+#ifdef HAS_G711
+        ALaw,
+        MuLaw,
+#endif
+    };
+
+public:
+    PcmConverter();
+
+    bool setFormat(bool floating, size_t sample_size);
+
+    // Formats with a fixed sample size only
+    bool setEncoding(Encoding encoding);
+
+    // Little-endian samples to native int16, each one written upmixing times
+    void convert(int16_t *output, const uint8_t *input, size_t samples, unsigned int upmixing = 1);
+
+    // Samples stride bytes apart to a contiguous plane
+    void convertPlane(int16_t *output, const uint8_t *input, size_t samples, size_t stride);
+
+    void setDither(bool enabled)
+    {
+        dither_ = enabled;
+    }
+
+    bool dither()
+    {
+        return dither_;
+    }
+
+    Encoding encoding()
+    {
+        return encoding_;
+    }
+
+    size_t sampleSize()
+    {
+        return sample_size_;
+    }
+
+    static const char *vectorExtension();
+
+private:
+    void convertSamples(int16_t *output,
+                        const uint8_t *input,
+                        size_t samples,
+                        size_t stride,
+                        unsigned int upmixing);
+
+private:
+    Encoding encoding_;
+    size_t sample_size_;
+
+    bool dither_;
+    uint32_t dither_state_[4];
+};
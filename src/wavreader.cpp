@@ -32,17 +32,53 @@ WavReader::WavReader(TellCallback tell_callback,
                   seek_callback,
                   read_callback),
       file_size_(0),
+      rf64_(false),
+      ds64_data_size_(0),
+      ds64_sample_count_(0),
+      ds64_table_offset_(0),
+      ds64_table_length_(0),
       format_(Format::Unknown),
       bytes_per_second_(0),
       bits_per_sample_(0),
       block_alignment_(0),
       frame_size_(0),
       channel_size_(0),
+      converter_(),
+      native_frames_(false),
+#ifdef HAS_ADPCM
+      decoder_(),
+      fact_frames_(0),
+      block_offset_(0),
+      block_end_offset_(0),
+      block_skip_frames_(0),
+      block_frames_left_(0),
+#endif
       initial_data_chunk_offset_(0),
       final_data_chunk_offset_(0),
       next_data_chunk_offset_(0),
+      next_data_chunk_(0),
       current_data_chunk_frames_(0),
+      chunk_index_(),
+      indexed_chunks_(0),
+      indexed_frames_(0),
+      indexed_end_offset_(0),
+      read_data_chunks_(0),
+      read_data_chunk_frames_(0),
+      frame_position_(0),
+      resume_pending_(false),
+      resume_offset_(0),
+      loop_head_(),
+      loop_head_loaded_(false),
+      loop_chunk_(0),
+      loop_skipped_frames_(0),
+      loop_head_offset_(0),
+      loop_head_size_(0),
+      loop_head_frames_(0),
+      loop_fade_(),
+      crossfade_frames_(0),
+      loop_fade_frames_(0),
       frame_buffer_(),
+      buffer_size_(WAVREADER_BUFFER_SIZE),
       prefetched_frames_(0),
       current_frame_(nullptr),
       next_frame_(nullptr),
@@ -55,19 +91,30 @@ bool WavReader::open(void *file,
                      bool preload)
 {
     char chunk_id[4];
-    uint32_t chunk_size;
+    size_t chunk_size;
     size_t next_chunk_offset;
 
     opened_ = false;
 
     file_ = file;
 
+    rf64_ = false;
+
+    total_frames_ = 0;
+
+    loop_start_ = 0;
+    loop_end_ = 0;
+
+#ifdef HAS_ADPCM
+    fact_frames_ = 0;
+#endif
+
     mode_ = mode;
 
     next_chunk_offset = 0;
 
     while (true) {
-        if (!seek(next_chunk_offset)) {
+        if (!seekFile(next_chunk_offset)) {
             return false;
         }
 
@@ -75,7 +122,7 @@ bool WavReader::open(void *file,
             return false;
         }
 
-        if (!readU32(&chunk_size)) {
+        if (!readChunkSize(chunk_id, &chunk_size)) {
             return false;
         }
 
@@ -83,13 +130,23 @@ bool WavReader::open(void *file,
             break;
         }
 
+        if ((memcmp(chunk_id, "RF64", sizeof(chunk_id)) == 0) ||
+            (memcmp(chunk_id, "BW64", sizeof(chunk_id)) == 0)) {
+            rf64_ = true;
+            break;
+        }
+
         next_chunk_offset = tell() + chunk_size;
         if ((next_chunk_offset & 1) != 0) {
             next_chunk_offset++;
         }
     }
 
-    file_size_ = chunk_size;
+    if (!rf64_) {
+        file_size_ = chunk_size;
+    }
+
+    size_t riff_offset = tell();
 
     char riff_type[4];
 
@@ -101,12 +158,20 @@ bool WavReader::open(void *file,
         return false;
     }
 
+    if (rf64_) {
+        if (!readDs64Chunk()) {
+            return false;
+        }
+    }
+
+    size_t riff_end_offset = riff_offset + file_size_;
+
     while (true) {
         if (!readCharBuffer(chunk_id, sizeof(chunk_id))) {
             return false;
         }
 
-        if (!readU32(&chunk_size)) {
+        if (!readChunkSize(chunk_id, &chunk_size)) {
             return false;
         }
 
@@ -119,7 +184,13 @@ bool WavReader::open(void *file,
             break;
         }
 
-        if (!seek(next_chunk_offset)) {
+        if (memcmp(chunk_id, "smpl", sizeof(chunk_id)) == 0) {
+            if (!readSampleChunk(chunk_size)) {
+                return false;
+            }
+        }
+
+        if (!seekFile(next_chunk_offset)) {
             return false;
         }
     }
@@ -134,10 +205,26 @@ bool WavReader::open(void *file,
     case static_cast<uint16_t>(Format::Pcm):
         format_ = Format::Pcm;
         break;
+#ifdef HAS_ADPCM
+    case static_cast<uint16_t>(Format::MsAdpcm):
+        format_ = Format::MsAdpcm;
+        break;
+    case static_cast<uint16_t>(Format::ImaAdpcm):
+        format_ = Format::ImaAdpcm;
+        break;
+#endif
 #ifdef HAS_IEEE_FLOAT
     case static_cast<uint16_t>(Format::IeeeFloat):
         format_ = Format::IeeeFloat;
         break;
+#endif
+#ifdef HAS_G711
+    case static_cast<uint16_t>(Format::ALaw):
+        format_ = Format::ALaw;
+        break;
+    case static_cast<uint16_t>(Format::MuLaw):
+        format_ = Format::MuLaw;
+        break;
 #endif
     default:
         return false;
@@ -189,14 +276,26 @@ bool WavReader::open(void *file,
 
     frame_size_ = block_alignment_;
 
-    if (frame_size_ > MAX_FRAME_SIZE) {
+    if (!compressed()) {
+        if (frame_size_ > MAX_FRAME_SIZE) {
+            return false;
+        }
+
+        channel_size_ = frame_size_ / channels_;
+    }
+
+    if (!setUpDecoding(chunk_size)) {
         return false;
     }
 
-    channel_size_ = frame_size_ / channels_;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    native_frames_ = (converter_.encoding() == PcmConverter::Encoding::Signed16);
+#else
+    native_frames_ = false;
+#endif
 
     while (true) {
-        if (!seek(next_chunk_offset)) {
+        if (!seekFile(next_chunk_offset)) {
             return false;
         }
 
@@ -204,7 +303,7 @@ bool WavReader::open(void *file,
             return false;
         }
 
-        if (!readU32(&chunk_size)) {
+        if (!readChunkSize(chunk_id, &chunk_size)) {
             return false;
         }
 
@@ -227,6 +326,33 @@ bool WavReader::open(void *file,
             next_chunk_offset++;
         }
 
+#ifdef HAS_ADPCM
+        if ((memcmp(chunk_id, "fact", sizeof(chunk_id)) == 0) && (chunk_size >= 4)) {
+            uint32_t fact_frames;
+
+            if (!readU32(&fact_frames)) {
+                return false;
+            }
+
+            fact_frames_ = fact_frames;
+
+            // The full count of an RF64 file is kept in the ds64 chunk
+            if (rf64_ && (fact_frames == UINT32_MAX)) {
+                fact_frames_ = ds64_sample_count_;
+            }
+
+            continue;
+        }
+#endif
+
+        if (memcmp(chunk_id, "smpl", sizeof(chunk_id)) == 0) {
+            if (!readSampleChunk(chunk_size)) {
+                return false;
+            }
+
+            continue;
+        }
+
         if (memcmp(chunk_id, "LIST", sizeof(chunk_id)) == 0) {
             char list_type[4];
 
@@ -238,22 +364,69 @@ bool WavReader::open(void *file,
                 continue;
             }
 
+            // Silent chunks cannot be expressed in whole blocks
+            if (compressed()) {
+                return false;
+            }
+
             initial_data_chunk_offset_ = tell();
             if ((initial_data_chunk_offset_ & 1) != 0) {
                 initial_data_chunk_offset_++;
             }
 
-            final_data_chunk_offset_ = tell() + chunk_size;
-            if ((final_data_chunk_offset_ & 1) != 0) {
-                final_data_chunk_offset_++;
-            }
+            final_data_chunk_offset_ = next_chunk_offset;
+
+            break;
+        }
+    }
+
+    // Sampler metadata usually follows the audio data
+    next_chunk_offset = final_data_chunk_offset_;
+
+    while ((loop_end_ == 0) && (next_chunk_offset + CHUNK_HEADER_SIZE <= riff_end_offset)) {
+        if (!seekFile(next_chunk_offset)) {
+            break;
+        }
+
+        if (!readCharBuffer(chunk_id, sizeof(chunk_id))) {
+            break;
+        }
 
+        if (!readChunkSize(chunk_id, &chunk_size)) {
             break;
         }
+
+        next_chunk_offset = tell() + chunk_size;
+        if ((next_chunk_offset & 1) != 0) {
+            next_chunk_offset++;
+        }
+
+        if (memcmp(chunk_id, "smpl", sizeof(chunk_id)) == 0) {
+            if (!readSampleChunk(chunk_size)) {
+                break;
+            }
+        }
+    }
+
+    buildChunkIndex();
+
+    // Without a sampler loop the whole file repeats, if its length is known
+    if (indexed_end_offset_ >= final_data_chunk_offset_) {
+        total_frames_ = indexed_frames_;
+
+        if ((loop_end_ == 0) || (loop_end_ > indexed_frames_)) {
+            loop_end_ = indexed_frames_;
+        }
+
+        if (loop_start_ >= loop_end_) {
+            loop_start_ = 0;
+        }
     }
 
     opened_ = true;
 
+    loadLoop();
+
     rewind(preload);
 
     return true;
@@ -266,9 +439,21 @@ void WavReader::close()
 
 void WavReader::rewind(bool preload)
 {
+    next_data_chunk_ = 0;
     next_data_chunk_offset_ = initial_data_chunk_offset_;
     current_data_chunk_frames_ = 0;
 
+    read_data_chunks_ = 0;
+    read_data_chunk_frames_ = 0;
+
+    frame_position_ = 0;
+
+    resume_pending_ = false;
+
+#ifdef HAS_ADPCM
+    block_frames_left_ = 0;
+#endif
+
     memset(frame_buffer_, 0, MAX_FRAME_SIZE);
     current_frame_ = frame_buffer_;
     next_frame_ = frame_buffer_;
@@ -283,6 +468,95 @@ void WavReader::rewind(bool preload)
     }
 }
 
+bool WavReader::seek(size_t frame)
+{
+    if (!opened_) {
+        return false;
+    }
+
+    if (frame < indexed_frames_) {
+        size_t chunk_number = findIndexedChunk(frame);
+        const Chunk &chunk = chunk_index_[chunk_number];
+
+        rewind(false);
+
+        frame_position_ = frame;
+
+        return startChunk(chunk_number, chunk, frame - chunk.first_frame);
+    }
+
+    // Walk the chunks past the index without touching the reader, so a seek
+    // past the end leaves playback where it was
+    size_t chunk_number = indexed_chunks_;
+    size_t chunk_offset = initial_data_chunk_offset_;
+
+    if (indexed_chunks_ > 0) {
+        chunk_offset = indexed_end_offset_;
+    }
+
+    size_t file_offset = tell();
+    size_t first_frame = indexed_frames_;
+    Chunk chunk;
+    bool found = false;
+
+    while (chunk_offset < final_data_chunk_offset_) {
+        if (!readChunkHeader(chunk_offset, &chunk, &chunk_offset)) {
+            break;
+        }
+
+        if (frame < first_frame + chunk.frames) {
+            found = true;
+            break;
+        }
+
+        first_frame += chunk.frames;
+        chunk_number++;
+    }
+
+    if (!found) {
+        if (!resume_pending_) {
+            resume_pending_ = true;
+            resume_offset_ = file_offset;
+        }
+
+        return false;
+    }
+
+    rewind(false);
+
+    frame_position_ = frame;
+    next_data_chunk_offset_ = chunk_offset;
+
+    return startChunk(chunk_number, chunk, frame - first_frame);
+}
+
+void WavReader::setBufferSize(size_t size)
+{
+    if (size > WAVREADER_BUFFER_SIZE) {
+        size = WAVREADER_BUFFER_SIZE;
+    } else if (size < MAX_FRAME_SIZE) {
+        size = MAX_FRAME_SIZE;
+    }
+
+    buffer_size_ = size;
+}
+
+void WavReader::setLoopCrossfade(size_t frames)
+{
+    if (frames > WAVREADER_MAX_CROSSFADE_FRAMES) {
+        frames = WAVREADER_MAX_CROSSFADE_FRAMES;
+    }
+
+    crossfade_frames_ = frames;
+
+    if (opened_) {
+        size_t frame = frame_position_;
+
+        loadLoop();
+        seek(frame);
+    }
+}
+
 size_t WavReader::decodeToI16(int16_t *buffer, size_t frames, unsigned int upmixing)
 {
     if (!opened_) {
@@ -291,56 +565,144 @@ size_t WavReader::decodeToI16(int16_t *buffer, size_t frames, unsigned int upmix
 
     int16_t *frame_pointer = buffer;
     size_t processed_frames = 0;
+    bool silent_block = true;
 
     while (processed_frames < frames) {
-        size_t decoded_frames = decodeNextFrames(frames - processed_frames);
+        int16_t *outputs[MAX_CHANNELS];
+
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            outputs[channel] = frame_pointer + channel * upmixing;
+        }
+
+        size_t decoded_frames = 0;
+
+#ifdef HAS_ADPCM
+        if (compressed()) {
+            decoded_frames = decodeNextBlockFrames(outputs,
+                                                   channels_ * upmixing,
+                                                   upmixing,
+                                                   frames - processed_frames);
+            if (decoded_frames == 0) {
+                break;
+            }
+
+            silent_block = false;
+        }
+#endif
+
+        if ((decoded_frames == 0) && native_frames_ && (upmixing == 1)) {
+            decoded_frames = readNextFramesDirectly(reinterpret_cast<uint8_t *>(frame_pointer),
+                                                    frames - processed_frames);
+            if (decoded_frames > 0) {
+                silent_block = false;
+            }
+        }
+
         if (decoded_frames == 0) {
-            break;
+            decoded_frames = decodeNextFrames(frames - processed_frames);
+            if (decoded_frames == 0) {
+                break;
+            }
+
+            if (silence_) {
+                memset(frame_pointer, 0, decoded_frames * channels_ * upmixing * 2);
+            } else {
+                silent_block = false;
+
+                converter_.convert(frame_pointer, current_frame_, decoded_frames * channels_, upmixing);
+            }
         }
 
-        if (channel_size_ == 1) {
-            uint8_t *sample_pointer = current_frame_;
+        if (crossfadeLoop(outputs, channels_ * upmixing, upmixing, decoded_frames)) {
+            silent_block = false;
+        }
 
-            for (size_t frame_index = 0; frame_index < decoded_frames; frame_index++) {
-                for (unsigned int channel = 0; channel < channels_; channel++) {
-                    int16_t sample;
-                    sample = static_cast<int16_t>(*sample_pointer) - 128;
-                    sample = static_cast<int16_t>(sample << 8);
-                    sample_pointer++;
-
-                    for (unsigned int copy = 0; copy < upmixing; copy++) {
-                        *frame_pointer = sample;
-                        frame_pointer++;
-                    }
-                }
+        frame_pointer += decoded_frames * channels_ * upmixing;
+        processed_frames += decoded_frames;
+    }
+
+    silent_block_ = silent_block && (processed_frames > 0);
+
+    return processed_frames;
+}
+
+size_t WavReader::decodeToI16(int16_t *const *buffers, size_t frames, unsigned int upmixing)
+{
+    if (!opened_) {
+        return 0;
+    }
+
+    size_t processed_frames = 0;
+    bool silent_block = true;
+
+    while (processed_frames < frames) {
+        int16_t *outputs[MAX_CHANNELS];
+
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            outputs[channel] = buffers[channel * upmixing] + processed_frames;
+        }
+
+        size_t decoded_frames = 0;
+
+        if (native_frames_ && (channels_ == 1)) {
+            uint8_t *plane_pointer = reinterpret_cast<uint8_t *>(outputs[0]);
+            decoded_frames = readNextFramesDirectly(plane_pointer, frames - processed_frames);
+        }
+
+#ifdef HAS_ADPCM
+        if (compressed()) {
+            decoded_frames = decodeNextBlockFrames(outputs, 1, 1, frames - processed_frames);
+            if (decoded_frames == 0) {
+                break;
             }
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-        } else if ((channel_size_ == 2) && (upmixing == 1)) {
-            size_t samples = decoded_frames * channels_;
-            memcpy(frame_pointer, current_frame_, samples * 2);
-            frame_pointer += samples;
+        }
 #endif
-        } else {
-            uint8_t *sample_pointer = current_frame_ + channel_size_ - 2;
 
-            for (size_t frame_index = 0; frame_index < decoded_frames; frame_index++) {
+        if (decoded_frames == 0) {
+            decoded_frames = decodeNextFrames(frames - processed_frames);
+            if (decoded_frames == 0) {
+                break;
+            }
+
+            if (silence_) {
+                for (unsigned int channel = 0; channel < channels_ * upmixing; channel++) {
+                    memset(buffers[channel] + processed_frames, 0, decoded_frames * 2);
+                }
+
+                // Still silent unless the loop crossfade blends audio in
+                if (!crossfadeLoop(outputs, 1, 1, decoded_frames)) {
+                    processed_frames += decoded_frames;
+                    continue;
+                }
+            } else {
                 for (unsigned int channel = 0; channel < channels_; channel++) {
-                    int16_t sample;
-                    memcpy(&sample, sample_pointer, 2);
-                    sample = le16toh(sample);
-                    sample_pointer += channel_size_;
-
-                    for (unsigned int copy = 0; copy < upmixing; copy++) {
-                        *frame_pointer = sample;
-                        frame_pointer++;
-                    }
+                    converter_.convertPlane(outputs[channel],
+                                            current_frame_ + channel * channel_size_,
+                                            decoded_frames,
+                                            frame_size_);
                 }
+
+                crossfadeLoop(outputs, 1, 1, decoded_frames);
+            }
+        } else {
+            crossfadeLoop(outputs, 1, 1, decoded_frames);
+        }
+
+        silent_block = false;
+
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            for (unsigned int copy = 1; copy < upmixing; copy++) {
+                memcpy(buffers[channel * upmixing + copy] + processed_frames,
+                       outputs[channel],
+                       decoded_frames * 2);
             }
         }
 
         processed_frames += decoded_frames;
     }
 
+    silent_block_ = silent_block && (processed_frames > 0);
+
     return processed_frames;
 }
 
@@ -349,7 +711,7 @@ inline size_t WavReader::tell()
     return tell_callback_(file_);
 }
 
-inline bool WavReader::seek(size_t offset)
+inline bool WavReader::seekFile(size_t offset)
 {
     return seek_callback_(file_, offset);
 }
@@ -383,82 +745,650 @@ inline bool WavReader::readU32(uint32_t *value)
     return true;
 }
 
-inline bool WavReader::readCharBuffer(char *buffer, size_t length)
+inline bool WavReader::readU64(uint64_t *value)
 {
-    if (read(reinterpret_cast<uint8_t *>(buffer),
-             length) < length) {
+    uint32_t low;
+    uint32_t high;
+
+    if (!readU32(&low) || !readU32(&high)) {
         return false;
     }
 
+    *value = (static_cast<uint64_t>(high) << 32) | low;
+
     return true;
 }
 
-inline size_t WavReader::decodeNextFrames(size_t frames)
+inline bool WavReader::readSize(size_t *value)
 {
-    switch (format_) {
-    case Format::Pcm:
-        return decodeNextPcmFrames(frames);
-#ifdef HAS_IEEE_FLOAT
-    case Format::IeeeFloat:
-        return decodeNextIeeeFloatFrames(frames);
-#endif
-    default:
-        return 0;
+    uint64_t size;
+
+    if (!readU64(&size)) {
+        return false;
     }
 
-    return 0;
+    if (size > SIZE_MAX) {
+        return false;
+    }
+
+    *value = static_cast<size_t>(size);
+
+    return true;
 }
 
-size_t WavReader::decodeNextPcmFrames(size_t frames)
+inline bool WavReader::readCharBuffer(char *buffer, size_t length)
 {
-    return retrieveNextFrames(frames);
+    if (read(reinterpret_cast<uint8_t *>(buffer),
+             length) < length) {
+        return false;
+    }
+
+    return true;
 }
 
-#ifdef HAS_IEEE_FLOAT
-size_t WavReader::decodeNextIeeeFloatFrames(size_t frames)
+bool WavReader::readChunkSize(const char *chunk_id, size_t *size)
 {
-    frames = retrieveNextFrames(frames);
+    uint32_t chunk_size;
 
-    if (channel_size_ == 4) {
-        uint8_t *sample_pointer = current_frame_;
+    if (!readU32(&chunk_size)) {
+        return false;
+    }
 
-        for (size_t frame_index = 0; frame_index < frames; frame_index++) {
-            for (unsigned int channel = 0; channel < channels_; channel++) {
-                int32_t sample;
-                float value;
+    *size = chunk_size;
 
-                memcpy(&value, sample_pointer, 4);
+    if (!rf64_ || (chunk_size != UINT32_MAX)) {
+        return true;
+    }
 
-                if (value > 1.0f) {
-                    value = 1.0f;
-                } else if (value < -1.0f) {
-                    value = -1.0f;
-                }
+    if (memcmp(chunk_id, "data", 4) == 0) {
+        *size = ds64_data_size_;
+        return true;
+    }
 
-                value *= static_cast<float>(INT32_MAX - 127);
-                sample = htole32(static_cast<int32_t>(value));
+    size_t offset = tell();
 
-                memcpy(sample_pointer, &sample, 4);
+    if (!seekFile(ds64_table_offset_)) {
+        return false;
+    }
 
-                sample_pointer += channel_size_;
-            }
+    for (uint32_t entry = 0; entry < ds64_table_length_; entry++) {
+        char table_id[4];
+        size_t table_size;
+
+        if (!readCharBuffer(table_id, sizeof(table_id))) {
+            return false;
+        }
+
+        if (!readSize(&table_size)) {
+            return false;
+        }
+
+        if (memcmp(table_id, chunk_id, sizeof(table_id)) == 0) {
+            *size = table_size;
+            break;
         }
-    } else {
-        memset(current_frame_, 0, frames * frame_size_);
     }
 
-    return frames;
+    return seekFile(offset);
 }
-#endif
 
-size_t WavReader::retrieveNextFrames(size_t frames)
+bool WavReader::readDs64Chunk()
 {
-    if (!prepareCurrentChunk()) {
-        return 0;
+    char chunk_id[4];
+    uint32_t chunk_size;
+
+    if (!readCharBuffer(chunk_id, sizeof(chunk_id))) {
+        return false;
     }
 
-    if (!silence_) {
-        if (prefetched_frames_ == 0) {
+    if (memcmp(chunk_id, "ds64", sizeof(chunk_id)) != 0) {
+        return false;
+    }
+
+    if (!readU32(&chunk_size)) {
+        return false;
+    }
+
+    if (chunk_size < DS64_SIZE) {
+        return false;
+    }
+
+    size_t next_chunk_offset = tell() + chunk_size;
+    if ((next_chunk_offset & 1) != 0) {
+        next_chunk_offset++;
+    }
+
+    if (!readSize(&file_size_)) {
+        return false;
+    }
+
+    if (!readSize(&ds64_data_size_)) {
+        return false;
+    }
+
+    if (!readSize(&ds64_sample_count_)) {
+        return false;
+    }
+
+    if (!readU32(&ds64_table_length_)) {
+        return false;
+    }
+
+    ds64_table_offset_ = tell();
+
+    if (ds64_table_length_ > (chunk_size - DS64_SIZE) / DS64_TABLE_ENTRY_SIZE) {
+        ds64_table_length_ = (chunk_size - DS64_SIZE) / DS64_TABLE_ENTRY_SIZE;
+    }
+
+    return seekFile(next_chunk_offset);
+}
+
+bool WavReader::readSampleChunk(size_t chunk_size)
+{
+    if (chunk_size < SMPL_SIZE) {
+        return true;
+    }
+
+    // Manufacturer, product, sample period, MIDI note and SMPTE fields are not used
+    if (!seekFile(tell() + 28)) {
+        return false;
+    }
+
+    uint32_t loops;
+    uint32_t sampler_data;
+
+    if (!readU32(&loops) || !readU32(&sampler_data)) {
+        return false;
+    }
+
+    if (loops > (chunk_size - SMPL_SIZE) / SMPL_LOOP_SIZE) {
+        loops = (chunk_size - SMPL_SIZE) / SMPL_LOOP_SIZE;
+    }
+
+    for (uint32_t loop = 0; loop < loops; loop++) {
+        uint32_t cue_point;
+        uint32_t type;
+        uint32_t start;
+        uint32_t end;
+        uint32_t fraction;
+        uint32_t play_count;
+
+        if (!readU32(&cue_point) ||
+            !readU32(&type) ||
+            !readU32(&start) ||
+            !readU32(&end) ||
+            !readU32(&fraction) ||
+            !readU32(&play_count)) {
+            return false;
+        }
+
+        // Only forward loops can be played, the end frame is inclusive
+        if ((type == 0) && (start <= end)) {
+            loop_start_ = start;
+            loop_end_ = static_cast<size_t>(end) + 1;
+            break;
+        }
+    }
+
+    return true;
+}
+
+inline bool WavReader::compressed()
+{
+#ifdef HAS_ADPCM
+    return (format_ == Format::MsAdpcm) || (format_ == Format::ImaAdpcm);
+#else
+    return false;
+#endif
+}
+
+bool WavReader::setUpDecoding(size_t format_size)
+{
+    switch (format_) {
+    case Format::Pcm:
+        return converter_.setFormat(false, channel_size_);
+#ifdef HAS_IEEE_FLOAT
+    case Format::IeeeFloat:
+        return converter_.setFormat(true, channel_size_);
+#endif
+#ifdef HAS_G711
+    case Format::ALaw:
+        return (channel_size_ == 1) && converter_.setEncoding(PcmConverter::Encoding::ALaw);
+    case Format::MuLaw:
+        return (channel_size_ == 1) && converter_.setEncoding(PcmConverter::Encoding::MuLaw);
+#endif
+#ifdef HAS_ADPCM
+    case Format::MsAdpcm:
+    case Format::ImaAdpcm:
+        return readAdpcmFormat(format_size);
+#endif
+    default:
+        return false;
+    }
+}
+
+size_t WavReader::framesInChunk(size_t bytes)
+{
+#ifdef HAS_ADPCM
+    if (compressed()) {
+        size_t frames = (bytes / block_alignment_) * decoder_.blockFrames() +
+                        decoder_.framesInBlock(bytes % block_alignment_);
+
+        // The last block is usually padded
+        if ((fact_frames_ > 0) && (frames > fact_frames_)) {
+            frames = fact_frames_;
+        }
+
+        return frames;
+    }
+#endif
+
+    return bytes / frame_size_;
+}
+
+inline size_t WavReader::decodeNextFrames(size_t frames)
+{
+    switch (format_) {
+    case Format::Pcm:
+        return decodeNextPcmFrames(frames);
+#ifdef HAS_G711
+    case Format::ALaw:
+    case Format::MuLaw:
+        return decodeNextPcmFrames(frames);
+#endif
+#ifdef HAS_IEEE_FLOAT
+    case Format::IeeeFloat:
+        return decodeNextIeeeFloatFrames(frames);
+#endif
+    default:
+        return 0;
+    }
+
+    return 0;
+}
+
+size_t WavReader::decodeNextPcmFrames(size_t frames)
+{
+    return retrieveNextFrames(frames);
+}
+
+#ifdef HAS_IEEE_FLOAT
+size_t WavReader::decodeNextIeeeFloatFrames(size_t frames)
+{
+    return retrieveNextFrames(frames);
+}
+#endif
+
+#ifdef HAS_ADPCM
+bool WavReader::readAdpcmFormat(size_t format_size)
+{
+    if ((block_alignment_ == 0) || (block_alignment_ > WAVREADER_BUFFER_SIZE)) {
+        return false;
+    }
+
+    uint16_t extension_size = 0;
+    uint16_t block_frames = 0;
+
+    if (format_size >= 20) {
+        if (!readU16(&extension_size)) {
+            return false;
+        }
+
+        if (extension_size >= 2) {
+            if (!readU16(&block_frames)) {
+                return false;
+            }
+        }
+    }
+
+    AdpcmDecoder::Type type = AdpcmDecoder::Type::Ima;
+
+    if (format_ == Format::MsAdpcm) {
+        type = AdpcmDecoder::Type::Microsoft;
+    }
+
+    if (!decoder_.setFormat(type, channels_, block_alignment_, block_frames)) {
+        return false;
+    }
+
+    if ((format_ == Format::MsAdpcm) && (extension_size >= 4)) {
+        uint16_t coefficients;
+
+        if (!readU16(&coefficients)) {
+            return false;
+        }
+
+        if ((coefficients > AdpcmDecoder::MAX_COEFFICIENTS) ||
+            (extension_size < 4 + 4 * coefficients)) {
+            return false;
+        }
+
+        for (unsigned int index = 0; index < coefficients; index++) {
+            uint16_t first;
+            uint16_t second;
+
+            if (!readU16(&first) || !readU16(&second)) {
+                return false;
+            }
+
+            decoder_.setCoefficients(index,
+                                     static_cast<int16_t>(first),
+                                     static_cast<int16_t>(second));
+        }
+    }
+
+    return true;
+}
+
+size_t WavReader::decodeNextBlockFrames(int16_t *const *outputs,
+                                       size_t stride,
+                                       unsigned int copies,
+                                       size_t frames)
+{
+    if (!prepareCurrentChunk()) {
+        return 0;
+    }
+
+    if (block_frames_left_ == 0) {
+        if (loadNextBlock() == 0) {
+            return 0;
+        }
+    }
+
+    if (frames > block_frames_left_) {
+        frames = block_frames_left_;
+    }
+
+    if (frames > current_data_chunk_frames_) {
+        frames = current_data_chunk_frames_;
+    }
+
+    frames = framesBeforeLoopEnd(frames);
+
+    decoder_.decode(outputs, stride, copies, frames);
+
+    block_frames_left_ -= frames;
+    current_data_chunk_frames_ -= frames;
+    frame_position_ += frames;
+
+    return frames;
+}
+
+size_t WavReader::loadNextBlock()
+{
+    block_frames_left_ = 0;
+
+    if (block_offset_ >= block_end_offset_) {
+        return 0;
+    }
+
+    if (!resumeReading()) {
+        return 0;
+    }
+
+    size_t bytes_to_read = block_end_offset_ - block_offset_;
+    if (bytes_to_read > block_alignment_) {
+        bytes_to_read = block_alignment_;
+    }
+
+    size_t read_bytes = read(frame_buffer_, bytes_to_read);
+
+    block_offset_ += read_bytes;
+
+    if (read_bytes < bytes_to_read) {
+        block_offset_ = block_end_offset_;
+    }
+
+    size_t frames = decoder_.startBlock(frame_buffer_, read_bytes);
+
+    // Sample accurate seeking decodes up to the requested frame
+    if (block_skip_frames_ > 0) {
+        size_t skipped_frames = block_skip_frames_;
+        if (skipped_frames > frames) {
+            skipped_frames = frames;
+        }
+
+        decoder_.skip(skipped_frames);
+        frames -= skipped_frames;
+        block_skip_frames_ = 0;
+    }
+
+    block_frames_left_ = frames;
+
+    return frames;
+}
+#endif
+
+inline size_t WavReader::framesBeforeLoopEnd(size_t frames)
+{
+    if ((mode_ == Mode::Continuous) && (frame_position_ < loop_end_)) {
+        if (frames > loop_end_ - frame_position_) {
+            frames = loop_end_ - frame_position_;
+        }
+    }
+
+    return frames;
+}
+
+void WavReader::loadLoop()
+{
+    loop_head_loaded_ = false;
+    loop_fade_frames_ = 0;
+
+    if ((loop_end_ <= loop_start_) || (loop_start_ >= indexed_frames_)) {
+        return;
+    }
+
+    size_t loop_frames = loop_end_ - loop_start_;
+
+    size_t fade_frames = crossfade_frames_;
+    if (fade_frames > loop_start_) {
+        fade_frames = loop_start_;
+    }
+
+    if (fade_frames > loop_frames) {
+        fade_frames = loop_frames;
+    }
+
+    // Decode the frames leading up to the loop start for blending into the loop tail
+    if (fade_frames > 0) {
+        Mode mode = mode_;
+        mode_ = Mode::Single;
+
+        if (seek(loop_start_ - fade_frames) && (decodeToI16(loop_fade_, fade_frames) == fade_frames)) {
+            loop_fade_frames_ = fade_frames;
+        }
+
+        mode_ = mode;
+    }
+
+    rewind(false);
+
+    loop_chunk_ = findIndexedChunk(loop_start_);
+
+    const Chunk &chunk = chunk_index_[loop_chunk_];
+
+    loop_skipped_frames_ = loop_start_ - chunk.first_frame;
+
+    if (chunk.silent) {
+        loop_head_loaded_ = true;
+        return;
+    }
+
+    if (!startChunk(loop_chunk_, chunk, loop_skipped_frames_)) {
+        return;
+    }
+
+#ifdef HAS_ADPCM
+    if (compressed()) {
+        size_t bytes_to_read = block_end_offset_ - block_offset_;
+        if (bytes_to_read > block_alignment_) {
+            bytes_to_read = block_alignment_;
+        }
+
+        if (bytes_to_read > sizeof(loop_head_)) {
+            return;
+        }
+
+        if (read(loop_head_, bytes_to_read) < bytes_to_read) {
+            return;
+        }
+
+        loop_head_offset_ = block_offset_;
+        loop_head_size_ = bytes_to_read;
+        loop_head_loaded_ = true;
+
+        return;
+    }
+#endif
+
+    size_t frames = sizeof(loop_head_) / frame_size_;
+
+    if (frames > current_data_chunk_frames_) {
+        frames = current_data_chunk_frames_;
+    }
+
+    if (frames > loop_frames) {
+        frames = loop_frames;
+    }
+
+    size_t bytes_to_read = frames * frame_size_;
+
+    if (read(loop_head_, bytes_to_read) < bytes_to_read) {
+        return;
+    }
+
+    loop_head_offset_ = chunk.offset + CHUNK_HEADER_SIZE + loop_skipped_frames_ * frame_size_;
+    loop_head_size_ = bytes_to_read;
+    loop_head_frames_ = frames;
+    loop_head_loaded_ = true;
+}
+
+bool WavReader::restartLoop()
+{
+    if (!loop_head_loaded_) {
+        return seek(loop_start_);
+    }
+
+    // Continue from the frames kept in memory, the file is repositioned on the next read
+    rewind(false);
+
+    const Chunk &chunk = chunk_index_[loop_chunk_];
+
+    enterChunk(loop_chunk_, chunk, loop_skipped_frames_);
+
+    frame_position_ = loop_start_;
+    read_data_chunks_ = loop_chunk_ + 1;
+
+    if (silence_) {
+        return true;
+    }
+
+#ifdef HAS_ADPCM
+    if (compressed()) {
+        size_t frames = decoder_.startBlock(loop_head_, loop_head_size_);
+        size_t skipped_frames = loop_skipped_frames_ % decoder_.blockFrames();
+
+        if (skipped_frames > frames) {
+            skipped_frames = frames;
+        }
+
+        decoder_.skip(skipped_frames);
+
+        block_frames_left_ = frames - skipped_frames;
+        block_offset_ = loop_head_offset_ + loop_head_size_;
+        block_end_offset_ = chunk.offset + CHUNK_HEADER_SIZE + chunk.size;
+        block_skip_frames_ = 0;
+
+        resume_pending_ = true;
+        resume_offset_ = block_offset_;
+
+        return true;
+    }
+#endif
+
+    prefetched_frames_ = loop_head_frames_;
+    next_frame_ = loop_head_;
+    current_frame_ = loop_head_;
+
+    read_data_chunk_frames_ = current_data_chunk_frames_ - loop_head_frames_;
+
+    if (read_data_chunk_frames_ > 0) {
+        resume_pending_ = true;
+        resume_offset_ = loop_head_offset_ + loop_head_size_;
+    }
+
+    return true;
+}
+
+bool WavReader::crossfadeLoop(int16_t *const *outputs,
+                              size_t stride,
+                              unsigned int copies,
+                              size_t frames)
+{
+    if ((mode_ != Mode::Continuous) || (loop_fade_frames_ == 0)) {
+        return false;
+    }
+
+    // The outputs hold the frames right before the current position
+    size_t fade_start = loop_end_ - loop_fade_frames_;
+    size_t first_frame = frame_position_ - frames;
+
+    if ((frame_position_ <= fade_start) || (first_frame >= loop_end_)) {
+        return false;
+    }
+
+    size_t frame = 0;
+    if (first_frame < fade_start) {
+        frame = fade_start - first_frame;
+    }
+
+    size_t end_frame = frames;
+    if (end_frame > loop_end_ - first_frame) {
+        end_frame = loop_end_ - first_frame;
+    }
+
+    int32_t fade_frames = static_cast<int32_t>(loop_fade_frames_);
+
+    for (; frame < end_frame; frame++) {
+        size_t fade_frame = first_frame + frame - fade_start;
+        int32_t weight = static_cast<int32_t>(fade_frame);
+
+        for (unsigned int channel = 0; channel < channels_; channel++) {
+            int16_t *output = outputs[channel] + frame * stride;
+
+            int32_t tail = output[0];
+            int32_t lead = loop_fade_[fade_frame * channels_ + channel];
+            int16_t sample = static_cast<int16_t>((tail * (fade_frames - weight) + lead * weight) / fade_frames);
+
+            for (unsigned int copy = 0; copy < copies; copy++) {
+                output[copy] = sample;
+            }
+        }
+    }
+
+    return true;
+}
+
+inline bool WavReader::resumeReading()
+{
+    if (!resume_pending_) {
+        return true;
+    }
+
+    resume_pending_ = false;
+
+    return seekFile(resume_offset_);
+}
+
+size_t WavReader::retrieveNextFrames(size_t frames)
+{
+    if (!prepareCurrentChunk()) {
+        return 0;
+    }
+
+    if (!silence_) {
+        if (prefetched_frames_ == 0) {
             if (prefetchNextFrames() < 1) {
                 return 0;
             }
@@ -472,85 +1402,327 @@ size_t WavReader::retrieveNextFrames(size_t frames)
             frames = prefetched_frames_;
         }
 
+        if (frames > current_data_chunk_frames_) {
+            frames = current_data_chunk_frames_;
+        }
+
+        frames = framesBeforeLoopEnd(frames);
+
         next_frame_ = current_frame_ + frame_size_ * frames;
         prefetched_frames_ -= frames;
     } else {
-        frames = 1;
+        if (frames > current_data_chunk_frames_) {
+            frames = current_data_chunk_frames_;
+        }
+
+        frames = framesBeforeLoopEnd(frames);
     }
 
     current_data_chunk_frames_ -= frames;
+    frame_position_ += frames;
 
     return frames;
 }
 
+size_t WavReader::readNextFramesDirectly(uint8_t *buffer, size_t frames)
+{
+    // Short requests are cheaper through the staging buffer
+    if (frames * frame_size_ < buffer_size_) {
+        return 0;
+    }
+
+    if (!prepareCurrentChunk()) {
+        return 0;
+    }
+
+    if (silence_ || (prefetched_frames_ > 0)) {
+        return 0;
+    }
+
+    // The file has to be positioned right at the current frame
+    if ((read_data_chunks_ != next_data_chunk_) ||
+        (read_data_chunk_frames_ != current_data_chunk_frames_)) {
+        return 0;
+    }
+
+    if (frames > current_data_chunk_frames_) {
+        frames = current_data_chunk_frames_;
+    }
+
+    frames = framesBeforeLoopEnd(frames);
+
+    if (!resumeReading()) {
+        return 0;
+    }
+
+    size_t bytes_to_read = frames * frame_size_;
+    size_t read_bytes = read(buffer, bytes_to_read);
+
+    size_t read_frames = read_bytes / frame_size_;
+
+    current_data_chunk_frames_ -= read_frames;
+    read_data_chunk_frames_ -= read_frames;
+    frame_position_ += read_frames;
+
+    if (read_bytes < bytes_to_read) {
+        read_data_chunk_frames_ = 0;
+        read_data_chunks_ = indexed_chunks_;
+    }
+
+    return read_frames;
+}
+
 bool WavReader::prepareCurrentChunk()
 {
-    if (current_data_chunk_frames_ == 0) {
-        if (next_data_chunk_offset_ == final_data_chunk_offset_) {
-            if (mode_ == Mode::Continuous) {
+    bool rewound = false;
+
+    if ((mode_ == Mode::Continuous) && (frame_position_ == loop_end_) && (loop_end_ > loop_start_)) {
+        if (!restartLoop()) {
+            return false;
+        }
+    }
+
+    while (current_data_chunk_frames_ == 0) {
+        if (next_data_chunk_ < indexed_chunks_) {
+            if (!startChunk(next_data_chunk_, chunk_index_[next_data_chunk_], 0)) {
+                return false;
+            }
+
+            continue;
+        }
+
+        if (next_data_chunk_offset_ >= final_data_chunk_offset_) {
+            if ((mode_ == Mode::Continuous) && !rewound) {
                 rewind(false);
+                rewound = true;
+                continue;
             } else {
                 return false;
             }
         }
 
-        if (!seek(next_data_chunk_offset_)) {
+        Chunk chunk;
+
+        if (!readChunkHeader(next_data_chunk_offset_, &chunk, &next_data_chunk_offset_)) {
             return false;
         }
 
-        char chunk_id[4];
-        uint32_t chunk_size;
-
-        if (!readCharBuffer(chunk_id, sizeof(chunk_id))) {
+        if (!startChunk(next_data_chunk_, chunk, 0)) {
             return false;
         }
+    }
 
-        if (memcmp(chunk_id, "data", sizeof(chunk_id)) == 0) {
-            silence_ = false;
-        } else if (memcmp(chunk_id, "slnt", sizeof(chunk_id)) == 0) {
-            silence_ = true;
-        } else {
-            return false;
+    return true;
+}
+
+void WavReader::enterChunk(size_t chunk_number, const Chunk &chunk, size_t skipped_frames)
+{
+    next_data_chunk_ = chunk_number + 1;
+
+    if (next_data_chunk_ < indexed_chunks_) {
+        next_data_chunk_offset_ = chunk_index_[next_data_chunk_].offset;
+    } else if (next_data_chunk_ == indexed_chunks_) {
+        next_data_chunk_offset_ = indexed_end_offset_;
+    }
+
+    silence_ = chunk.silent;
+    current_data_chunk_frames_ = chunk.frames - skipped_frames;
+}
+
+bool WavReader::startChunk(size_t chunk_number, const Chunk &chunk, size_t skipped_frames)
+{
+    enterChunk(chunk_number, chunk, skipped_frames);
+
+    if (silence_) {
+        return true;
+    }
+
+    resume_pending_ = false;
+
+#ifdef HAS_ADPCM
+    if (compressed()) {
+        size_t data_offset = chunk.offset + CHUNK_HEADER_SIZE;
+        size_t block_frames = decoder_.blockFrames();
+
+        block_offset_ = data_offset + (skipped_frames / block_frames) * block_alignment_;
+        block_end_offset_ = data_offset + chunk.size;
+        block_skip_frames_ = skipped_frames % block_frames;
+        block_frames_left_ = 0;
+
+        return seekFile(block_offset_);
+    }
+#endif
+
+    // Data may already be buffered by a read-ahead from the previous chunk
+    if (read_data_chunks_ > chunk_number) {
+        return true;
+    }
+
+    if (!seekFile(chunk.offset + CHUNK_HEADER_SIZE + skipped_frames * frame_size_)) {
+        return false;
+    }
+
+    read_data_chunks_ = chunk_number + 1;
+    read_data_chunk_frames_ = current_data_chunk_frames_;
+
+    return true;
+}
+
+size_t WavReader::prefetchNextFrames()
+{
+#ifdef HAS_ADPCM
+    if (compressed()) {
+        return loadNextBlock();
+    }
+#endif
+
+    if (!resumeReading()) {
+        return 0;
+    }
+
+    size_t buffer_frames = buffer_size_ / frame_size_;
+    size_t read_frames = 0;
+
+    while (read_frames < buffer_frames) {
+        if (read_data_chunk_frames_ == 0) {
+            // Start reading the next indexed data chunk before the current one runs out
+            size_t chunk_number = read_data_chunks_;
+
+            while ((chunk_number < indexed_chunks_) && chunk_index_[chunk_number].silent) {
+                chunk_number++;
+            }
+
+            if (chunk_number >= indexed_chunks_) {
+                break;
+            }
+
+            const Chunk &chunk = chunk_index_[chunk_number];
+
+            if (!seekFile(chunk.offset + CHUNK_HEADER_SIZE)) {
+                break;
+            }
+
+            read_data_chunks_ = chunk_number + 1;
+            read_data_chunk_frames_ = chunk.frames;
+
+            continue;
         }
 
-        if (!readU32(&chunk_size)) {
-            return false;
+        size_t frames_to_read = buffer_frames - read_frames;
+        if (frames_to_read > read_data_chunk_frames_) {
+            frames_to_read = read_data_chunk_frames_;
         }
 
-        if (!silence_) {
-            current_data_chunk_frames_ = chunk_size / frame_size_;
-        } else {
-            uint32_t silent_frames;
+        size_t bytes_to_read = frames_to_read * frame_size_;
+        size_t read_bytes = read(frame_buffer_ + read_frames * frame_size_, bytes_to_read);
 
-            if (!readU32(&silent_frames)) {
-                return false;
-            }
+        size_t chunk_read_frames = read_bytes / frame_size_;
 
-            current_data_chunk_frames_ = silent_frames;
+        read_frames += chunk_read_frames;
+        read_data_chunk_frames_ -= chunk_read_frames;
+
+        if (read_bytes < bytes_to_read) {
+            read_data_chunk_frames_ = 0;
+            read_data_chunks_ = indexed_chunks_;
+            break;
         }
+    }
+
+    prefetched_frames_ = read_frames;
+
+    return read_frames;
+}
+
+bool WavReader::readChunkHeader(size_t offset, Chunk *chunk, size_t *next_offset)
+{
+    if (!seekFile(offset)) {
+        return false;
+    }
+
+    char chunk_id[4];
+    size_t chunk_size;
+
+    if (!readCharBuffer(chunk_id, sizeof(chunk_id))) {
+        return false;
+    }
+
+    if (memcmp(chunk_id, "data", sizeof(chunk_id)) == 0) {
+        chunk->silent = false;
+    } else if (memcmp(chunk_id, "slnt", sizeof(chunk_id)) == 0) {
+        chunk->silent = true;
+    } else {
+        return false;
+    }
 
-        next_data_chunk_offset_ = tell() + chunk_size;
-        if ((next_data_chunk_offset_ & 1) != 0) {
-            next_data_chunk_offset_++;
+    if (!readChunkSize(chunk_id, &chunk_size)) {
+        return false;
+    }
+
+    *next_offset = tell() + chunk_size;
+    if ((*next_offset & 1) != 0) {
+        (*next_offset)++;
+    }
+
+    chunk->offset = offset;
+    chunk->size = chunk_size;
+    chunk->first_frame = 0;
+
+    if (!chunk->silent) {
+        chunk->frames = framesInChunk(chunk_size);
+    } else {
+        uint32_t silent_frames;
+
+        if (!readU32(&silent_frames)) {
+            return false;
         }
+
+        chunk->frames = silent_frames;
     }
 
     return true;
 }
 
-size_t WavReader::prefetchNextFrames()
+void WavReader::buildChunkIndex()
 {
-    size_t frames_to_read = WAVREADER_BUFFER_SIZE / frame_size_;
-    if (frames_to_read > current_data_chunk_frames_) {
-        frames_to_read = current_data_chunk_frames_;
+    size_t chunk_offset = initial_data_chunk_offset_;
+    size_t first_frame = 0;
+
+    indexed_chunks_ = 0;
+
+    while ((indexed_chunks_ < WAVREADER_CHUNK_INDEX_SIZE) &&
+           (chunk_offset < final_data_chunk_offset_)) {
+        Chunk &chunk = chunk_index_[indexed_chunks_];
+        size_t next_chunk_offset;
+
+        if (!readChunkHeader(chunk_offset, &chunk, &next_chunk_offset)) {
+            break;
+        }
+
+        chunk.first_frame = first_frame;
+        first_frame += chunk.frames;
+
+        chunk_offset = next_chunk_offset;
+        indexed_chunks_++;
     }
 
-    size_t bytes_to_read = frames_to_read * frame_size_;
-    size_t read_bytes = read(frame_buffer_, bytes_to_read);
+    indexed_frames_ = first_frame;
+    indexed_end_offset_ = chunk_offset;
+}
 
-    size_t read_frames = read_bytes / frame_size_;
+size_t WavReader::findIndexedChunk(size_t frame)
+{
+    size_t lower = 0;
+    size_t upper = indexed_chunks_;
 
-    prefetched_frames_ = read_frames;
+    while (upper - lower > 1) {
+        size_t middle = lower + (upper - lower) / 2;
 
-    return read_frames;
+        if (chunk_index_[middle].first_frame <= frame) {
+            lower = middle;
+        } else {
+            upper = middle;
+        }
+    }
+
+    return lower;
 }
@@ -4,11 +4,28 @@
 #include <cstdint>
 
 #include "audioreader.h"
+#include "pcmconverter.h"
+
+#ifdef HAS_ADPCM
+#include "adpcmdecoder.h"
+#endif
 
 #ifndef WAVREADER_BUFFER_SIZE
 #define WAVREADER_BUFFER_SIZE 2048
 #endif
 
+#ifndef WAVREADER_CHUNK_INDEX_SIZE
+#define WAVREADER_CHUNK_INDEX_SIZE 32
+#endif
+
+#ifndef WAVREADER_LOOP_HEAD_SIZE
+#define WAVREADER_LOOP_HEAD_SIZE WAVREADER_BUFFER_SIZE
+#endif
+
+#ifndef WAVREADER_MAX_CROSSFADE_FRAMES
+#define WAVREADER_MAX_CROSSFADE_FRAMES 256
+#endif
+
 class WavReader : public AudioReader
 {
 public:
@@ -16,8 +33,18 @@ public:
     {
         Unknown = 0,
         Pcm = 1,
+#ifdef HAS_ADPCM
+        MsAdpcm = 2,
+#endif
 #ifdef HAS_IEEE_FLOAT
         IeeeFloat = 3,
+#endif
+#ifdef HAS_G711
+        ALaw = 6,
+        MuLaw = 7,
+#endif
+#ifdef HAS_ADPCM
+        ImaAdpcm = 0x11,
 #endif
     };
 
@@ -25,6 +52,14 @@ public:
 
     static const unsigned int MAX_FRAME_SIZE = 16;
 
+    static const size_t CHUNK_HEADER_SIZE = 8;
+
+    static const size_t DS64_SIZE = 28;
+    static const size_t DS64_TABLE_ENTRY_SIZE = 12;
+
+    static const size_t SMPL_SIZE = 36;
+    static const size_t SMPL_LOOP_SIZE = 24;
+
 public:
     WavReader(TellCallback tell_callback,
               SeekCallback seek_callback,
@@ -38,8 +73,12 @@ public:
 
     void rewind(bool preload = true) override;
 
+    bool seek(size_t frame) override;
+
     size_t decodeToI16(int16_t *buffer, size_t frames, unsigned int upmixing = 1) override;
 
+    size_t decodeToI16(int16_t *const *buffers, size_t frames, unsigned int upmixing = 1) override;
+
     Format format()
     {
         return format_;
@@ -60,15 +99,63 @@ public:
         return block_alignment_;
     }
 
+    // Bytes of the staging buffer used per read, up to WAVREADER_BUFFER_SIZE
+    void setBufferSize(size_t size);
+
+    size_t bufferSize()
+    {
+        return buffer_size_;
+    }
+
+    // Frames of the loop tail blended into the audio leading up to the loop start
+    void setLoopCrossfade(size_t frames);
+
+    size_t loopCrossfade()
+    {
+        return crossfade_frames_;
+    }
+
+    // TPDF dither for samples wider than 16 bits
+    void setDither(bool enabled)
+    {
+        converter_.setDither(enabled);
+    }
+
+    bool dither()
+    {
+        return converter_.dither();
+    }
+
+private:
+    struct Chunk
+    {
+        size_t offset;
+        size_t size;
+        size_t first_frame;
+        size_t frames;
+        bool silent;
+    };
+
 private:
     inline size_t tell();
-    inline bool seek(size_t offset);
+    inline bool seekFile(size_t offset);
     inline size_t read(uint8_t *buffer, size_t length);
 
     inline bool readU16(uint16_t *value);
     inline bool readU32(uint32_t *value);
+    inline bool readU64(uint64_t *value);
+    inline bool readSize(size_t *value);
     inline bool readCharBuffer(char *buffer, size_t length);
 
+    bool readChunkSize(const char *chunk_id, size_t *size);
+    bool readDs64Chunk();
+    bool readSampleChunk(size_t chunk_size);
+
+    inline bool compressed();
+
+    bool setUpDecoding(size_t format_size);
+    size_t framesInChunk(size_t bytes);
+
     inline size_t decodeNextFrames(size_t frames);
 
     size_t decodeNextPcmFrames(size_t frames);
@@ -76,14 +163,45 @@ private:
     size_t decodeNextIeeeFloatFrames(size_t frames);
 #endif
 
+#ifdef HAS_ADPCM
+    bool readAdpcmFormat(size_t format_size);
+    size_t decodeNextBlockFrames(int16_t *const *outputs,
+                                 size_t stride,
+                                 unsigned int copies,
+                                 size_t frames);
+    size_t loadNextBlock();
+#endif
+
+    inline size_t framesBeforeLoopEnd(size_t frames);
+    void loadLoop();
+    bool restartLoop();
+    bool crossfadeLoop(int16_t *const *outputs,
+                       size_t stride,
+                       unsigned int copies,
+                       size_t frames);
+
+    inline bool resumeReading();
     size_t retrieveNextFrames(size_t frames);
+    size_t readNextFramesDirectly(uint8_t *buffer, size_t frames);
 
     bool prepareCurrentChunk();
+    void enterChunk(size_t chunk_number, const Chunk &chunk, size_t skipped_frames);
+    bool startChunk(size_t chunk_number, const Chunk &chunk, size_t skipped_frames);
     size_t prefetchNextFrames();
 
+    bool readChunkHeader(size_t offset, Chunk *chunk, size_t *next_offset);
+    void buildChunkIndex();
+    size_t findIndexedChunk(size_t frame);
+
 private:
     size_t file_size_;
 
+    bool rf64_;
+    size_t ds64_data_size_;
+    size_t ds64_sample_count_;
+    size_t ds64_table_offset_;
+    uint32_t ds64_table_length_;
+
     Format format_;
     unsigned long bytes_per_second_;
     unsigned int bits_per_sample_;
@@ -91,12 +209,51 @@ private:
     size_t frame_size_;
     size_t channel_size_;
 
+    PcmConverter converter_;
+    bool native_frames_;
+
+#ifdef HAS_ADPCM
+    AdpcmDecoder decoder_;
+    size_t fact_frames_;
+    size_t block_offset_;
+    size_t block_end_offset_;
+    size_t block_skip_frames_;
+    size_t block_frames_left_;
+#endif
+
     size_t initial_data_chunk_offset_;
     size_t final_data_chunk_offset_;
     size_t next_data_chunk_offset_;
+    size_t next_data_chunk_;
     size_t current_data_chunk_frames_;
 
+    Chunk chunk_index_[WAVREADER_CHUNK_INDEX_SIZE];
+    size_t indexed_chunks_;
+    size_t indexed_frames_;
+    size_t indexed_end_offset_;
+
+    size_t read_data_chunks_;
+    size_t read_data_chunk_frames_;
+
+    size_t frame_position_;
+
+    bool resume_pending_;
+    size_t resume_offset_;
+
+    alignas(4) uint8_t loop_head_[WAVREADER_LOOP_HEAD_SIZE];
+    bool loop_head_loaded_;
+    size_t loop_chunk_;
+    size_t loop_skipped_frames_;
+    size_t loop_head_offset_;
+    size_t loop_head_size_;
+    size_t loop_head_frames_;
+
+    int16_t loop_fade_[WAVREADER_MAX_CROSSFADE_FRAMES * MAX_CHANNELS];
+    size_t crossfade_frames_;
+    size_t loop_fade_frames_;
+
     alignas(4) uint8_t frame_buffer_[WAVREADER_BUFFER_SIZE];
+    size_t buffer_size_;
     size_t prefetched_frames_;
     uint8_t *current_frame_;
     uint8_t *next_frame_;
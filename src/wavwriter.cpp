@@ -0,0 +1,341 @@
+#include "wavwriter.h"
+
+#include <cstring>
+
+static const size_t RIFF_HEADER_SIZE = 12;
+static const size_t CHUNK_HEADER_SIZE = 8;
+static const size_t PCM_FORMAT_SIZE = 16;
+static const size_t EXTENDED_FORMAT_SIZE = 18;
+static const size_t FACT_SIZE = 4;
+
+static const uint16_t PCM_FORMAT = 1;
+#ifdef HAS_IEEE_FLOAT
+static const uint16_t IEEE_FLOAT_FORMAT = 3;
+#endif
+
+static inline uint8_t *storeU16(uint8_t *output, uint16_t value)
+{
+    output[0] = static_cast<uint8_t>(value);
+    output[1] = static_cast<uint8_t>(value >> 8);
+
+    return output + 2;
+}
+
+static inline uint8_t *storeU32(uint8_t *output, uint32_t value)
+{
+    output[0] = static_cast<uint8_t>(value);
+    output[1] = static_cast<uint8_t>(value >> 8);
+    output[2] = static_cast<uint8_t>(value >> 16);
+    output[3] = static_cast<uint8_t>(value >> 24);
+
+    return output + 4;
+}
+
+static inline uint8_t *storeId(uint8_t *output, const char *id)
+{
+    for (unsigned int index = 0; index < 4; index++) {
+        output[index] = static_cast<uint8_t>(id[index]);
+    }
+
+    return output + 4;
+}
+
+WavWriter::WavWriter(SeekCallback seek_callback,
+                     WriteCallback write_callback)
+    : opened_(false),
+      file_(nullptr),
+      seek_callback_(seek_callback),
+      write_callback_(write_callback),
+      sampling_rate_(0),
+      channels_(0),
+      encoding_(Encoding::Signed16),
+      sample_size_(2),
+      frames_(0),
+      failed_(false),
+      buffer_(),
+      buffered_bytes_(0)
+{
+}
+
+bool WavWriter::open(void *file,
+                     unsigned long sampling_rate,
+                     unsigned int channels,
+                     Encoding encoding)
+{
+    opened_ = false;
+
+    if ((channels < 1) || (channels > MAX_CHANNELS)) {
+        return false;
+    }
+
+    switch (encoding) {
+    case Encoding::Signed16:
+        sample_size_ = 2;
+        break;
+    case Encoding::Signed24:
+        sample_size_ = 3;
+        break;
+    case Encoding::Signed32:
+        sample_size_ = 4;
+        break;
+#ifdef HAS_IEEE_FLOAT
+    case Encoding::Float32:
+        sample_size_ = 4;
+        break;
+#endif
+    default:
+        return false;
+    }
+
+    file_ = file;
+    sampling_rate_ = sampling_rate;
+    channels_ = channels;
+    encoding_ = encoding;
+
+    frames_ = 0;
+    failed_ = false;
+    buffered_bytes_ = 0;
+
+    // Sizes are left at zero until close()
+    if (!writeHeader()) {
+        return false;
+    }
+
+    opened_ = true;
+
+    return true;
+}
+
+bool WavWriter::close()
+{
+    if (!opened_) {
+        return false;
+    }
+
+    opened_ = false;
+
+    if (!flush()) {
+        return false;
+    }
+
+    size_t data_size = frames_ * channels_ * sample_size_;
+
+    // A pad byte keeps the RIFF chunk word aligned
+    if ((data_size & 1) != 0) {
+        const uint8_t pad = 0;
+
+        if (!writeFile(&pad, 1)) {
+            return false;
+        }
+    }
+
+    if (!seek_callback_(file_, 0)) {
+        return false;
+    }
+
+    return writeHeader() && !failed_;
+}
+
+size_t WavWriter::write(const int16_t *buffer, size_t frames)
+{
+    if (!opened_) {
+        return 0;
+    }
+
+    frames = writableFrames(frames);
+
+    size_t frame_size = channels_ * sample_size_;
+    size_t written_frames = 0;
+
+    while (written_frames < frames) {
+        if (buffered_bytes_ + frame_size > sizeof(buffer_)) {
+            if (!flush()) {
+                break;
+            }
+        }
+
+        size_t batch_frames = (sizeof(buffer_) - buffered_bytes_) / frame_size;
+        if (batch_frames > frames - written_frames) {
+            batch_frames = frames - written_frames;
+        }
+
+        const int16_t *sample = buffer + written_frames * channels_;
+        size_t samples = batch_frames * channels_;
+
+        for (size_t index = 0; index < samples; index++) {
+            writeSample(sample[index]);
+        }
+
+        written_frames += batch_frames;
+    }
+
+    frames_ += written_frames;
+
+    return written_frames;
+}
+
+size_t WavWriter::write(const int16_t *const *buffers, size_t frames)
+{
+    if (!opened_) {
+        return 0;
+    }
+
+    frames = writableFrames(frames);
+
+    size_t frame_size = channels_ * sample_size_;
+    size_t written_frames = 0;
+
+    while (written_frames < frames) {
+        if (buffered_bytes_ + frame_size > sizeof(buffer_)) {
+            if (!flush()) {
+                break;
+            }
+        }
+
+        size_t batch_frames = (sizeof(buffer_) - buffered_bytes_) / frame_size;
+        if (batch_frames > frames - written_frames) {
+            batch_frames = frames - written_frames;
+        }
+
+        for (size_t frame = written_frames; frame < written_frames + batch_frames; frame++) {
+            for (unsigned int channel = 0; channel < channels_; channel++) {
+                writeSample(buffers[channel][frame]);
+            }
+        }
+
+        written_frames += batch_frames;
+    }
+
+    frames_ += written_frames;
+
+    return written_frames;
+}
+
+inline bool WavWriter::writeFile(const uint8_t *buffer, size_t length)
+{
+    if (write_callback_(file_, buffer, length) < length) {
+        failed_ = true;
+        return false;
+    }
+
+    return true;
+}
+
+bool WavWriter::flush()
+{
+    if (buffered_bytes_ == 0) {
+        return true;
+    }
+
+    size_t length = buffered_bytes_;
+    buffered_bytes_ = 0;
+
+    return writeFile(buffer_, length);
+}
+
+size_t WavWriter::writableFrames(size_t frames)
+{
+    if (failed_) {
+        return 0;
+    }
+
+    // Chunk sizes are 32-bit
+    size_t frame_size = channels_ * sample_size_;
+    size_t max_frames = (UINT32_MAX - headerSize()) / frame_size;
+
+    if (frames > max_frames - frames_) {
+        frames = max_frames - frames_;
+    }
+
+    return frames;
+}
+
+inline void WavWriter::writeSample(int16_t sample)
+{
+    uint8_t *output = buffer_ + buffered_bytes_;
+
+    switch (encoding_) {
+    case Encoding::Signed16:
+        storeU16(output, static_cast<uint16_t>(sample));
+        break;
+    case Encoding::Signed24:
+        output[0] = 0;
+        storeU16(output + 1, static_cast<uint16_t>(sample));
+        break;
+    case Encoding::Signed32:
+        storeU32(output, static_cast<uint32_t>(sample) << 16);
+        break;
+#ifdef HAS_IEEE_FLOAT
+    case Encoding::Float32: {
+        float value = static_cast<float>(sample) * (1.0f / 32768.0f);
+        uint32_t bits;
+
+        memcpy(&bits, &value, sizeof(bits));
+        storeU32(output, bits);
+        break;
+    }
+#endif
+    }
+
+    buffered_bytes_ += sample_size_;
+}
+
+size_t WavWriter::headerSize()
+{
+#ifdef HAS_IEEE_FLOAT
+    if (encoding_ == Encoding::Float32) {
+        return RIFF_HEADER_SIZE +
+               CHUNK_HEADER_SIZE + EXTENDED_FORMAT_SIZE +
+               CHUNK_HEADER_SIZE + FACT_SIZE +
+               CHUNK_HEADER_SIZE;
+    }
+#endif
+
+    return RIFF_HEADER_SIZE + CHUNK_HEADER_SIZE + PCM_FORMAT_SIZE + CHUNK_HEADER_SIZE;
+}
+
+bool WavWriter::writeHeader()
+{
+    uint8_t header[64];
+    uint8_t *output = header;
+
+    size_t data_size = frames_ * channels_ * sample_size_;
+    size_t riff_size = headerSize() - CHUNK_HEADER_SIZE + data_size + (data_size & 1);
+
+    uint16_t format = PCM_FORMAT;
+    size_t format_size = PCM_FORMAT_SIZE;
+
+#ifdef HAS_IEEE_FLOAT
+    if (encoding_ == Encoding::Float32) {
+        format = IEEE_FLOAT_FORMAT;
+        format_size = EXTENDED_FORMAT_SIZE;
+    }
+#endif
+
+    output = storeId(output, "RIFF");
+    output = storeU32(output, static_cast<uint32_t>(riff_size));
+    output = storeId(output, "WAVE");
+
+    output = storeId(output, "fmt ");
+    output = storeU32(output, static_cast<uint32_t>(format_size));
+    output = storeU16(output, format);
+    output = storeU16(output, static_cast<uint16_t>(channels_));
+    output = storeU32(output, static_cast<uint32_t>(sampling_rate_));
+    output = storeU32(output, static_cast<uint32_t>(sampling_rate_ * channels_ * sample_size_));
+    output = storeU16(output, static_cast<uint16_t>(channels_ * sample_size_));
+    output = storeU16(output, static_cast<uint16_t>(sample_size_ * 8));
+
+    // Non-PCM formats carry an extension size and a fact chunk
+    if (format_size == EXTENDED_FORMAT_SIZE) {
+        output = storeU16(output, 0);
+
+        output = storeId(output, "fact");
+        output = storeU32(output, static_cast<uint32_t>(FACT_SIZE));
+        output = storeU32(output, static_cast<uint32_t>(frames_));
+    }
+
+    output = storeId(output, "data");
+    output = storeU32(output, static_cast<uint32_t>(data_size));
+
+    return writeFile(header, static_cast<size_t>(output - header));
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef WAVWRITER_BUFFER_SIZE
+#define WAVWRITER_BUFFER_SIZE 65536
+#endif
+
+class WavWriter
+{
+public:
+    typedef bool (*SeekCallback)(void *file, size_t offset);
+    typedef size_t (*WriteCallback)(void *file, const uint8_t *buffer, size_t length);
+
+    enum class Encoding : unsigned int
+    {
+        Signed16,
+        Signed24,
+        Signed32,
+#ifdef HAS_IEEE_FLOAT
+        Float32,
+#endif
+    };
+
+    static const unsigned int MAX_CHANNELS = 8;
+
+public:
+    WavWriter(SeekCallback seek_callback,
+              WriteCallback write_callback);
+
+    bool open(void *file,
+              unsigned long sampling_rate,
+              unsigned int channels,
+              Encoding encoding = Encoding::Signed16);
+
+    // Flushes the buffer and fills in the chunk sizes
+    bool close();
+
+    size_t write(const int16_t *buffer, size_t frames);
+
+    size_t write(const int16_t *const *buffers, size_t frames);
+
+    bool opened()
+    {
+        return opened_;
+    }
+
+    Encoding encoding()
+    {
+        return encoding_;
+    }
+
+    unsigned long samplingRate()
+    {
+        return sampling_rate_;
+    }
+
+    unsigned int channels()
+    {
+        return channels_;
+    }
+
+    size_t frames()
+    {
+        return frames_;
+    }
+
+private:
+    inline bool writeFile(const uint8_t *buffer, size_t length);
+    bool flush();
+
+    size_t writableFrames(size_t frames);
+    inline void writeSample(int16_t sample);
+
+    size_t headerSize();
+    bool writeHeader();
+
+private:
+    bool opened_;
+
+    void *file_;
+
+    SeekCallback seek_callback_;
+    WriteCallback write_callback_;
+
+    unsigned long sampling_rate_;
+    unsigned int channels_;
+
+    Encoding encoding_;
+    size_t sample_size_;
+
+    size_t frames_;
+    bool failed_;
+
+    alignas(4) uint8_t buffer_[WAVWRITER_BUFFER_SIZE];
+    size_t buffered_bytes_;
+};